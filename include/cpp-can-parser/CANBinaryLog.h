@@ -0,0 +1,255 @@
+#ifndef CANBINARYLOG_H
+#define CANBINARYLOG_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "CANLogReader.h"
+#include "cpp_can_parser_export.h"
+
+namespace CppCAN {
+
+/**
+ * @brief Compact binary log of CAN frames
+ *
+ * Layout of a file (all the integers are little-endian):
+ * - File header (16 bytes): the magic "CPPCANBL", the version (uint32) and a reserved uint32
+ * - Blocks, each one made of a 40-byte header (magic "CBLK", size of the records,
+ *   number of frames, CRC-32 of the records, timestamp of the first frame, smallest
+ *   and largest timestamps) followed by the records of its frames
+ * - Block index: one 32-byte entry per block (offset, smallest and largest timestamps,
+ *   number of frames)
+ * - Channel table (optional): number of names (uint32) then, for each channel, the
+ *   length of its name (one byte) followed by the name
+ * - Footer (24 bytes): offset of the index (uint64), number of blocks (uint32),
+ *   CRC-32 of the index and of the channel table, and the magic "CPCBLIDX"
+ *
+ * A record holds:
+ * - the difference with the previous timestamp of the block (zigzag varint, in nanoseconds).
+ *   The first frame of a block is relative to the timestamp of the first frame (0).
+ * - a header byte: DLC (bits 0-3), extended ID (bit 4), CAN FD (bit 5), remote frame (bit 6)
+ *   and presence of the extra byte (bit 7)
+ * - the optional extra byte: bit rate switch (bit 0), error state indicator (bit 1),
+ *   Tx (bit 2), error frame (bit 3) and presence of the channel byte (bit 4)
+ * - the optional channel byte (the channel is 0 when it is absent)
+ * - the CAN ID (varint)
+ * - the payload, whose size is given by the DLC (no payload for remote frames)
+ *
+ * A file whose index is missing (eg. if the writer was interrupted) can still be read:
+ * the blocks are then found by walking through their headers. The names of the
+ * channels are lost in this case.
+ */
+namespace binlog {
+  static const std::size_t FILE_HEADER_SIZE = 16;
+  static const std::size_t BLOCK_HEADER_SIZE = 40;
+  static const std::size_t INDEX_ENTRY_SIZE = 32;
+  static const std::size_t FOOTER_SIZE = 24;
+  static const uint32_t VERSION = 1;
+
+  /**
+   * @return The CRC-32 (IEEE 802.3) of the given bytes
+   */
+  CPP_CAN_PARSER_EXPORT uint32_t crc32(const uint8_t* data, std::size_t size);
+
+  /**
+   * @return true if the given bytes start with the header of a binary log
+   */
+  CPP_CAN_PARSER_EXPORT bool is_binary_log(const char* begin, const char* end);
+}
+
+/**
+ * @brief Buffered, append-only writer of binary logs
+ *
+ * The frames are encoded in memory and a whole block is written at once when it
+ * reaches Options::block_size bytes. The index and the footer are written by close().
+ */
+class CPP_CAN_PARSER_EXPORT BinaryLogWriter {
+public:
+  struct CPP_CAN_PARSER_EXPORT Options {
+    /**
+     * @brief Default options: 64 KiB blocks
+     */
+    Options();
+
+    std::size_t block_size; // Size of the records of a block (approximate)
+  };
+
+public:
+  /**
+   * @throw CANLogException if the file cannot be created
+   */
+  BinaryLogWriter(const std::string& path, const Options& options = Options());
+
+  /**
+   * @brief Closes the log if close() was not called (errors are ignored)
+   */
+  ~BinaryLogWriter();
+
+  BinaryLogWriter(const BinaryLogWriter&) = delete;
+  BinaryLogWriter& operator=(const BinaryLogWriter&) = delete;
+
+  /**
+   * @brief Appends a frame to the log. Payloads whose length is not a valid
+   *        CAN FD length are padded with zeros.
+   * @throw CANLogException if the file cannot be written
+   */
+  void write(const LogFrame& frame);
+
+  /**
+   * @brief Sets the names of the channels (eg. CandumpReader::channels()): the
+   *        name of channel i is names[i]. They are written by close(), names
+   *        longer than 255 bytes are truncated.
+   */
+  void set_channels(const std::vector<std::string>& names);
+
+  /**
+   * @brief Writes the last block, the index, the channel table and the footer
+   * @throw CANLogException if the file cannot be written
+   */
+  void close();
+
+  /**
+   * @return The number of frames written so far
+   */
+  std::size_t frame_count() const;
+
+  /**
+   * @return The number of blocks written so far
+   */
+  std::size_t block_count() const;
+
+private:
+  struct IndexEntry {
+    uint64_t offset;
+    int64_t min_timestamp;
+    int64_t max_timestamp;
+    uint32_t frame_count;
+  };
+
+  void flush_block();
+  void write_bytes(const void* data, std::size_t size);
+
+  std::FILE* file_;
+  Options options_;
+  std::vector<uint8_t> records_;
+  std::vector<IndexEntry> index_;
+  std::vector<std::string> channels_;
+  uint64_t offset_;
+  uint32_t block_frames_;
+  int64_t first_timestamp_; // Timestamps of the current block
+  int64_t min_timestamp_;
+  int64_t max_timestamp_;
+  int64_t last_timestamp_;
+  std::size_t frame_count_;
+};
+
+/**
+ * @brief Sequential reader of the frames stored in consecutive blocks of a binary log
+ *
+ * The checksum of each block is verified before its frames are read.
+ */
+class CPP_CAN_PARSER_EXPORT BinaryBlockReader {
+public:
+  /**
+   * @param begin Header of the first block
+   * @param end End of the last block
+   */
+  BinaryBlockReader(const char* begin, const char* end);
+
+  /**
+   * @brief Reads the next frame
+   * @return false after the last frame of the last block
+   * @throw CANLogException if a block is corrupted
+   */
+  bool next(LogFrame& frame);
+
+  /**
+   * @return The number of frames read so far
+   */
+  std::size_t frame_count() const;
+
+private:
+  bool next_block();
+
+  const uint8_t* block_;   // Next block header
+  const uint8_t* end_;
+  const uint8_t* cursor_;  // Next record
+  const uint8_t* records_end_;
+  uint32_t remaining_;     // Frames left in the current block
+  int64_t timestamp_;
+  std::size_t frames_;
+};
+
+/**
+ * @brief Reader of a whole binary log held in memory (usually a MappedFile)
+ */
+class CPP_CAN_PARSER_EXPORT BinaryLogReader {
+public:
+  struct CPP_CAN_PARSER_EXPORT BlockInfo {
+    uint64_t offset; // Offset of the block header in the file
+    uint64_t size;   // Size of the block, header included
+    int64_t min_timestamp;
+    int64_t max_timestamp;
+    uint32_t frame_count;
+  };
+
+public:
+  /**
+   * @throw CANLogException if the data is not a binary log or if the version is not supported
+   */
+  BinaryLogReader(const char* begin, const char* end);
+
+  /**
+   * @return The blocks of the log, found through the index or by walking through
+   *         the blocks if the index is missing or corrupted
+   */
+  const std::vector<BlockInfo>& blocks() const;
+
+  /**
+   * @return true if the blocks were found through the index
+   */
+  bool has_index() const;
+
+  /**
+   * @return The total number of frames in the log
+   */
+  std::size_t frame_count() const;
+
+  /**
+   * @return The names of the channels, indexed by LogFrame::channel (empty if the
+   *         writer was given none or if the index is missing)
+   */
+  const std::vector<std::string>& channels() const;
+
+  /**
+   * @return A reader of the blocks [first, last)
+   */
+  BinaryBlockReader blocks_reader(std::size_t first, std::size_t last) const;
+
+  /**
+   * @brief Reads the next frame of the log
+   * @return false at the end of the log
+   * @throw CANLogException if a block is corrupted
+   */
+  bool next(LogFrame& frame);
+
+  /**
+   * @brief Moves the reader to the first block that contains frames received
+   *        at or after the given timestamp
+   */
+  void seek(int64_t timestamp);
+
+private:
+  const char* begin_;
+  const char* end_;
+  std::vector<BlockInfo> blocks_;
+  std::vector<std::string> channels_;
+  bool has_index_;
+  BinaryBlockReader reader_;
+};
+
+}
+
+#endif
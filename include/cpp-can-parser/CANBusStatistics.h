@@ -0,0 +1,189 @@
+#ifndef CANBUSSTATISTICS_H
+#define CANBUSSTATISTICS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+#include "CANDatabase.h"
+#include "CANLogReader.h"
+#include "cpp_can_parser_export.h"
+
+namespace CppCAN {
+
+/**
+ * @brief Streaming bus load and bandwidth statistics per channel and per CAN ID
+ *
+ * The time that each frame occupies the bus is computed from its format (11-bit or
+ * 29-bit ID, classic CAN or CAN FD), its payload length and the bitrates of the bus.
+ * CAN FD frames with the bit rate switch use the data bitrate from the ESI bit to
+ * the CRC. Stuff bits are counted exactly from the bits of the frame or with the
+ * worst-case bound of Davis et al. (Options::stuffing).
+ *
+ * The statistics are kept both since the beginning and over a rolling window made
+ * of Options::buckets buckets. Each channel and each (channel, CAN ID) pair has its
+ * own totals and buckets: the memory used grows with the number of channels and IDs,
+ * not with the number of frames. Time is given by the timestamps of the frames.
+ * A frame older than the bucket that replaced its own is only counted in the totals.
+ */
+class CPP_CAN_PARSER_EXPORT CANBusStatistics {
+public:
+  /**
+   * - NoStuffing: stuff bits are ignored
+   * - WorstCase: one stuff bit every 4 bits after the first one (upper bound)
+   * - Exact: the stuff bits are counted on the actual bits of the frame (with the
+   *   CRC of classic frames; CAN FD frames have fixed stuff bits in their CRC field)
+   */
+  enum Stuffing {
+    NoStuffing, WorstCase, Exact
+  };
+
+  struct CPP_CAN_PARSER_EXPORT Options {
+    /**
+     * @brief Default options: bitrates from the database (500 kbit/s if there is none)
+     *        and 2 Mbit/s, worst-case stuffing, 1 s window in 10 buckets
+     */
+    Options();
+
+    uint32_t nominal_bitrate; // Bit/s, 0 means the baudrate of the database (see CANDatabase::bit_timing())
+    uint32_t data_bitrate;    // Bit/s, CAN FD data phase
+    Stuffing stuffing;
+    int64_t window;           // Nanoseconds
+    std::size_t buckets;      // Resolution of the rolling window
+  };
+
+  /**
+   * @brief Length of a frame on the bus, including the stuff bits, the end of frame
+   *        and the interframe space
+   */
+  struct CPP_CAN_PARSER_EXPORT FrameBits {
+    uint32_t nominal; // Bits sent at the nominal bitrate
+    uint32_t data;    // Bits sent at the data bitrate (CAN FD frames with bit rate switch)
+  };
+
+  struct CPP_CAN_PARSER_EXPORT Load {
+    uint64_t frames;
+    uint64_t bytes;     // Payload bytes
+    uint64_t bits;      // Bits on the bus (both phases)
+    int64_t busy_time;  // Nanoseconds
+    double load;        // busy_time divided by the duration
+  };
+
+  struct CPP_CAN_PARSER_EXPORT Talker {
+    uint8_t channel;
+    unsigned long long dbc_id; // See CANFrame::dbc_id()
+    const CANFrame* frame;     // nullptr if the frame is not in the database
+    Load window;
+    Load total;
+  };
+
+public:
+  /**
+   * @brief The database (which must outlive the statistics) gives the baudrate and
+   *        the frames reported by top_talkers()
+   */
+  CANBusStatistics(const CANDatabase& database, const Options& options = Options());
+
+  /**
+   * @return The length of a frame on the bus
+   */
+  static FrameBits frame_bits(const LogFrame& frame, Stuffing stuffing);
+
+  /**
+   * @return The expected bus load of the periodic frames of a database (see
+   *         CANFrame::period()), from their DLC and format, with worst-case stuffing
+   */
+  static double estimate(const CANDatabase& database, const Options& options = Options());
+
+  /**
+   * @brief Accounts for a frame. Error frames are only counted (see errors()).
+   */
+  void add(const LogFrame& frame);
+
+  void add(const LogFrame* frames, std::size_t count);
+
+  /**
+   * @return The duration of a frame on the bus (nanoseconds)
+   */
+  int64_t duration(const LogFrame& frame) const;
+
+  /**
+   * @return The load of a channel over the rolling window
+   */
+  Load channel_load(uint8_t channel) const;
+
+  /**
+   * @return The load of a channel since the first frame
+   */
+  Load channel_total(uint8_t channel) const;
+
+  /**
+   * @return The number of error frames seen on a channel
+   */
+  uint64_t errors(uint8_t channel) const;
+
+  /**
+   * @return The (at most count) CAN IDs that used the bus the most over the rolling
+   *         window, on the given channel or on all the channels if it is negative
+   */
+  std::vector<Talker> top_talkers(std::size_t count, int channel = -1) const;
+
+  /**
+   * @return The number of (channel, CAN ID) pairs seen
+   */
+  std::size_t id_count() const;
+
+  uint32_t nominal_bitrate() const;
+  uint32_t data_bitrate() const;
+
+private:
+  /**
+   * @brief Totals since the first frame and per bucket of the rolling window
+   */
+  struct Counters {
+    explicit Counters(std::size_t buckets);
+
+    void add(int64_t bucket, std::size_t slot, uint32_t bytes, uint32_t bits, int64_t time);
+    Load total(int64_t duration) const;
+    Load window(int64_t current, int64_t duration) const;
+
+    Load sum;
+    std::vector<int64_t> epochs; // Bucket held by each slot (-1 if none)
+    std::vector<Load> slots;
+  };
+
+  struct Channel {
+    explicit Channel(std::size_t buckets);
+
+    Counters counters;
+    uint64_t errors;
+    int64_t first_timestamp; // -1 before the first frame
+  };
+
+  struct Id {
+    Id(std::size_t buckets, uint8_t channel, unsigned long long dbc_id, const CANFrame* frame);
+
+    Counters counters;
+    uint8_t channel;
+    unsigned long long dbc_id;
+    const CANFrame* frame;
+  };
+
+  static int64_t duration(const FrameBits& bits, uint32_t nominal_bitrate, uint32_t data_bitrate);
+
+  Channel& channel(uint8_t channel);
+  const Channel* find_channel(uint8_t channel) const;
+  int64_t window_duration(const Channel& channel) const;
+
+  const CANDatabase* database_;
+  Options options_;
+  int64_t bucket_size_;
+  int64_t last_timestamp_; // Latest timestamp seen on any channel
+  std::vector<Channel> channels_;
+  std::vector<Id> ids_;
+  std::unordered_map<uint64_t, uint32_t> id_index_; // (channel, DBC ID) -> index in ids_
+};
+
+}
+
+#endif
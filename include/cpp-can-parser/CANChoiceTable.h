@@ -0,0 +1,113 @@
+#ifndef CANCHOICETABLE_H
+#define CANCHOICETABLE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "cpp_can_parser_export.h"
+
+namespace CppCAN {
+
+/**
+ * @brief Compiled form of the choices of a signal (see CANSignal::choices())
+ *
+ * The labels are stored in a single buffer and the table is either:
+ * - dense: an array indexed by (value - smallest value), used when the values are compact
+ * - sparse: a sorted array of values searched by bisection
+ *
+ * In both cases, the translation of a raw value to its label neither allocates
+ * nor follows the pointers of a tree. A hash index gives the value associated
+ * with a label (eg. for encoders or for filters that match on labels).
+ */
+class CPP_CAN_PARSER_EXPORT CANChoiceTable {
+public:
+  /**
+   * @brief Constructs an empty table
+   */
+  CANChoiceTable();
+
+  /**
+   * @brief Compiles the given choices
+   */
+  explicit CANChoiceTable(const std::map<unsigned int, std::string>& choices);
+
+  /**
+   * @return The number of choices
+   */
+  std::size_t size() const;
+
+  bool empty() const;
+
+  /**
+   * @return true if the table is an array indexed by value
+   */
+  bool is_dense() const;
+
+  /**
+   * @return The label associated with the value or an empty view whose data()
+   *         is nullptr if there is none
+   */
+  std::string_view label(uint64_t value) const;
+
+  /**
+   * @brief Reverse lookup: finds the value associated with a label. If several
+   *        values have the same label, the smallest one is given.
+   * @return false if no value has this label
+   */
+  bool find(std::string_view label, unsigned int& value) const;
+
+  /**
+   * @return The memory (in bytes) used by the table
+   */
+  std::size_t memory() const;
+
+private:
+  struct Entry {
+    uint32_t offset; // Position of the label in text_ (NO_ENTRY for missing values)
+    uint32_t length;
+  };
+
+  static const uint32_t NO_ENTRY = 0xFFFFFFFF;
+
+  std::string_view view(const Entry& entry) const;
+  unsigned int value_at(std::size_t i) const;
+
+  std::string text_;
+  unsigned int base_;                // Smallest value (dense tables)
+  bool dense_;
+  std::size_t size_;
+  std::vector<Entry> entries_;       // Indexed by value - base_ or parallel to values_
+  std::vector<unsigned int> values_; // Sorted values (sparse tables)
+  std::vector<uint32_t> index_;      // Open-addressing hash table of entries_ indices
+};
+
+inline std::string_view
+CANChoiceTable::view(const Entry& entry) const {
+  return std::string_view(text_.data() + entry.offset, entry.length);
+}
+
+inline std::string_view
+CANChoiceTable::label(uint64_t value) const {
+  if(dense_) {
+    uint64_t i = value - base_;
+    if(i < entries_.size() && entries_[i].offset != NO_ENTRY)
+      return view(entries_[i]);
+
+    return std::string_view();
+  }
+
+  auto ite = std::lower_bound(values_.begin(), values_.end(), value,
+                              [](unsigned int v, uint64_t target) { return v < target; });
+  if(ite == values_.end() || *ite != value)
+    return std::string_view();
+
+  return view(entries_[ite - values_.begin()]);
+}
+
+}
+
+#endif
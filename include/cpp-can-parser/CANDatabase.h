@@ -1,6 +1,7 @@
 #ifndef CANDatabase_H
 #define CANDatabase_H
 
+#include <cstdint>
 #include <string>
 #include <memory>
 #include <stdexcept>
@@ -21,17 +22,28 @@ namespace CppCAN {
  * - Offset
  * - Endianness
  * - Signedness
+ * - Value type (optional) : integer (default), IEEE-754 float or double (SIG_VALTYPE_)
  * - Minimum (optional)
  * - Maximum (optional)
  * - Comment (optional)
  * - Choices (optional) : map of unsigned int -> std::string (so one can associate 
- *                        a string value to an integer value)
+ *                        a string value to an integer value). The map is immutable and
+ *                        can be shared between signals (see CANDatabase::internChoices()).
+ * - Multiplexing (optional) : a multiplexor switch selects which multiplexed signals
+ *                             are present in the frame. A multiplexed signal is present
+ *                             if the value of its switch is in one of its ranges.
  * 
- * All the attributes except for the comment and choices must be defined at the instanciation
- * and are immutable.
+ * All the attributes except for the comment, choices, value type and multiplexing must
+ * be defined at the instanciation and are immutable.
+ *
+ * The attributes needed to decode the signal are packed in a 24-byte Layout stored
+ * at the beginning of the object, apart from the name, comment and choices.
  */
 class CPP_CAN_PARSER_EXPORT CANSignal {
 public:
+  using choices_type = std::map<unsigned int, std::string>;
+  using shared_choices = std::shared_ptr<const choices_type>;
+
   struct CPP_CAN_PARSER_EXPORT Range {
     static Range fromString(const std::string& minstr, const std::string& maxstr);
 
@@ -51,6 +63,49 @@ public:
     BigEndian, LittleEndian
   };
 
+  /**
+   * - Integer: the raw value is an integer (signed or not, see signedness())
+   * - Float: the raw value is an IEEE-754 single-precision number (32 bits)
+   * - Double: the raw value is an IEEE-754 double-precision number (64 bits)
+   */
+  enum ValueType {
+    Integer, Float, Double
+  };
+
+  /**
+   * - NotMultiplexed: the signal is always present
+   * - Multiplexor: the signal is a multiplexor switch (M)
+   * - Multiplexed: the signal depends on a multiplexor switch (m<N>)
+   * - MultiplexedMultiplexor: the signal depends on a multiplexor switch and is itself
+   *                           a multiplexor switch (m<N>M, extended multiplexing)
+   */
+  enum Multiplexing {
+    NotMultiplexed, Multiplexor, Multiplexed, MultiplexedMultiplexor
+  };
+
+  /**
+   * @brief Decoding attributes of a signal, packed in 24 bytes
+   */
+  struct CPP_CAN_PARSER_EXPORT Layout {
+    Signedness signedness() const;
+    Endianness endianness() const;
+    ValueType value_type() const;
+
+    double scale;
+    double offset;
+    uint32_t start_bit;
+    uint16_t length;
+    uint8_t flags; // Bit 0: Signed, bit 1: LittleEndian, bits 2-3: ValueType
+  };
+
+  /**
+   * @brief Inclusive range of multiplexor values
+   */
+  struct CPP_CAN_PARSER_EXPORT MultiplexerRange {
+    unsigned long long min;
+    unsigned long long max;
+  };
+
 public:
   CANSignal() = delete;
   CANSignal(const std::string& name, unsigned int start_bit, unsigned int length,
@@ -78,23 +133,81 @@ public:
 
   Endianness endianness() const;
 
+  ValueType value_type() const;
+
+  /**
+   * @return The packed decoding attributes of the signal
+   */
+  const Layout& layout() const;
+
   const std::map<unsigned int, std::string>& choices() const;
 
+  /**
+   * @return The shared choices of the signal (nullptr if the signal has no choices)
+   */
+  const shared_choices& shared_choices_ptr() const;
+
+  Multiplexing multiplexing() const;
+
+  /**
+   * @return true if the signal is a multiplexor switch (Multiplexor or MultiplexedMultiplexor)
+   */
+  bool is_multiplexor() const;
+
+  /**
+   * @return true if the signal depends on a multiplexor switch (Multiplexed or MultiplexedMultiplexor)
+   */
+  bool is_multiplexed() const;
+
+  /**
+   * @return The name of the switch of a multiplexed signal. If empty, the switch
+   *         is the multiplexor of the frame (see CANFrame::multiplexor()).
+   */
+  const std::string& multiplexer_switch() const;
+
+  /**
+   * @return The values of the switch for which a multiplexed signal is present
+   */
+  const std::vector<MultiplexerRange>& multiplexer_ranges() const;
+
   void setComment(const std::string& comment);
 
+  /**
+   * @brief Gives the signal its own copy of the choices
+   */
   void setChoices(const std::map<unsigned int, std::string>& choices);
 
+  /**
+   * @brief Shares the given choices (see CANDatabase::internChoices())
+   */
+  void setChoices(const shared_choices& choices);
+
+  void setValueType(ValueType value_type);
+
+  /**
+   * @brief Sets the multiplexing type of the signal. If the signal is multiplexed,
+   *        it is present when the frame's multiplexor is equal to value.
+   */
+  void setMultiplexing(Multiplexing multiplexing, unsigned long long value = 0);
+
+  /**
+   * @brief Extended multiplexing: the signal is present when the given switch
+   *        has a value in one of the given ranges.
+   */
+  void setMultiplexerSwitch(const std::string& switch_name, const std::vector<MultiplexerRange>& ranges);
+
 private:
+  // Hot: read while decoding
+  Layout layout_;
+
+  // Cold
   std::string name_;
-  unsigned int start_bit_;
-  unsigned int length_;
-  double scale_;
-  double offset_;
-  Signedness signedness_;
-  Endianness endianness_;
   Range range_;
   std::string comment_;
-  std::map<unsigned int, std::string> choices_;
+  shared_choices choices_;
+  Multiplexing multiplexing_;
+  std::string multiplexer_switch_;
+  std::vector<MultiplexerRange> multiplexer_ranges_;
 };
 
 /**
@@ -104,12 +217,17 @@ private:
  * - Name
  * - CAN ID
  * - DLC
+ * - Frame format (optional): standard or extended ID, classic CAN or CAN FD
  * - Period (optional)
  * - Comment (optional)
  * - List of signals
  * 
  * The name, CAN ID and DLC must be defined at the instanciation and are immutable.
- * The comment and period can respectivelly be changed with setComment() and setPeriod().
+ * As in DBC files, a CAN ID with the bit 31 set (EXTENDED_ID_FLAG) represents an 
+ * extended (29-bit) ID: can_id() returns the ID without the flag and is_extended()
+ * tells if the ID is extended.
+ * The comment, period and CAN FD flag can respectivelly be changed with setComment(), 
+ * setPeriod() and setFD().
  * The list of signals can be modified with addSignal() and removeSignal(). Use clear()
  * to empty the signals' list.
  * 
@@ -124,6 +242,36 @@ private:
  */
 class CPP_CAN_PARSER_EXPORT CANFrame {
 public:
+  /**
+   * - StandardCAN: 11-bit ID, classic CAN (up to 8 bytes)
+   * - ExtendedCAN: 29-bit ID, classic CAN (up to 8 bytes)
+   * - StandardCAN_FD: 11-bit ID, CAN FD (up to 64 bytes)
+   * - ExtendedCAN_FD: 29-bit ID, CAN FD (up to 64 bytes)
+   */
+  enum FrameFormat {
+    StandardCAN, ExtendedCAN, StandardCAN_FD, ExtendedCAN_FD
+  };
+
+  /**
+   * @brief Bit set in the DBC representation of extended CAN IDs
+   */
+  static const unsigned long long EXTENDED_ID_FLAG = 0x80000000ULL;
+
+  /**
+   * @brief Maximum payload length of a CAN FD frame
+   */
+  static const unsigned int MAX_PAYLOAD_LENGTH = 64;
+
+  /**
+   * @return The payload length (in bytes) associated with a CAN FD DLC (0-15)
+   */
+  static unsigned int dlc_to_length(unsigned int dlc);
+
+  /**
+   * @return The smallest DLC whose payload length can hold the given number of bytes
+   */
+  static unsigned int length_to_dlc(unsigned int length);
+
   using container_type = std::map<std::string, CANSignal>;
   using iterator = container_type::iterator;
   using const_iterator = container_type::const_iterator;
@@ -137,7 +285,8 @@ public:
   /**
    * @brief Construct a new frame.
    * @param name Name of the frame
-   * @param can_id CAN ID of the frame
+   * @param can_id CAN ID of the frame (the ID is extended only if EXTENDED_ID_FLAG
+   *               is set, as in DBC files)
    * @param dlc DLC of the frame
    * @param comment Optional comment for the frame
    */
@@ -156,15 +305,43 @@ public:
   const std::string& name() const;
 
   /**
-   * @return The CAN ID of the frame
+   * @return The CAN ID of the frame (without EXTENDED_ID_FLAG)
    */
   unsigned long long can_id() const;
 
+  /**
+   * @return The CAN ID of the frame as found in DBC files, ie. with EXTENDED_ID_FLAG
+   *         for extended IDs. This is the key of the frame in CANDatabase.
+   */
+  unsigned long long dbc_id() const;
+
   /**
    * @return The DLC of the frame
    */
   unsigned int dlc() const;
 
+  /**
+   * @return The payload length of the frame in bytes. The DLC is a byte count
+   *         except for the CAN FD DLCs 9, 10, 11, 13, 14 and 15 (see dlc_to_length()),
+   *         which are not valid CAN FD lengths. 12 is always 12 bytes.
+   */
+  unsigned int length() const;
+
+  /**
+   * @return The frame format (by default, the format is classic CAN)
+   */
+  FrameFormat frame_format() const;
+
+  /**
+   * @return true if the CAN ID is a 29-bit ID
+   */
+  bool is_extended() const;
+
+  /**
+   * @return true if the frame is a CAN FD frame
+   */
+  bool is_fd() const;
+
   /**
    * @return The period of the frame (If unspecified, then return 0)
    */
@@ -175,12 +352,29 @@ public:
    */
   const std::string& comment() const;
 
+  /**
+   * @return true if at least one signal of the frame is multiplexed
+   */
+  bool is_multiplexed() const;
+
+  /**
+   * @return The name of the frame's multiplexor signal, ie. the signal defined with M
+   *         (if there is none, return an empty string)
+   */
+  const std::string& multiplexor() const;
+
 public:
   /**
    * @brief Sets a new value for the frame's period.
    */
   void setPeriod(unsigned int val);
 
+  /**
+   * @brief Marks the frame as a CAN FD frame (see VFrameFormat in DBC files).
+   *        Whether the ID is extended or not only depends on the CAN ID.
+   */
+  void setFD(bool fd);
+
   /**
    * @brief Updates the frame's associated comment.
    */
@@ -251,6 +445,8 @@ private:
   std::string name_;
   unsigned long long can_id_;
   unsigned int dlc_;
+  bool extended_;
+  bool fd_;
   unsigned int period_;
   std::string comment_;
   
@@ -268,6 +464,14 @@ private:
  *   the same operations are available with operator[]
  * - addFrame and removeFrame to alter the database's content
  *
+ * Frames are identified by their DBC ID (see CANFrame::dbc_id()): extended IDs have
+ * the bit 31 set. For convenience, an extended frame can also be found with its bare
+ * 29-bit ID as long as no standard frame has the same ID.
+ *
+ * The choices of the signals are stored in a pool of immutable value tables: identical
+ * tables are only stored once (see internChoices()). The named value tables of DBC
+ * files (VAL_TABLE_) are available through value_tables().
+ *
  * If the database was parsed from a file, the filename() method can be used to
  * retrieve the name of the source file.
  */
@@ -301,6 +505,15 @@ public:
     const std::string& src_string, std::vector<parsing_warning>* warnings = nullptr);
 
 public:
+  /**
+   * @brief Bit timing of the bus (BS_ section of DBC files)
+   */
+  struct CPP_CAN_PARSER_EXPORT BitTiming {
+    unsigned int baudrate; // As written in the DBC file (kbit/s), 0 if it is not specified
+    unsigned int btr1;
+    unsigned int btr2;
+  };
+
   struct CPP_CAN_PARSER_EXPORT IDKey {
     std::string str_key;
     unsigned long long int_key;
@@ -331,7 +544,7 @@ public:
 
   /**
    * Creates a copy of the database: the individual frames are deep copied so there is no
-   * shared memory betwwen the two databases.
+   * shared memory betwwen the two databases (except for the value tables which are immutable).
    */
   CANDatabase(const CANDatabase&);
 
@@ -413,6 +626,13 @@ public:
    */
   const std::string& filename() const;
 
+  /**
+   * @return The bit timing of the bus (all zeros if the DBC file does not specify it)
+   */
+  const BitTiming& bit_timing() const;
+
+  void set_bit_timing(const BitTiming& timing);
+
   
   /* Set of methods used to behave like a STL container.
      Very useful for range-based for loops. Inspired from std::map but
@@ -444,6 +664,28 @@ public:
   void removeFrame(unsigned int idx);
   void removeFrame(const std::string& name);
 
+public:
+  /**
+   * @return The value table of the pool whose content is equal to the given choices.
+   *         The table is added to the pool if there is no such table.
+   */
+  CANSignal::shared_choices internChoices(const CANSignal::choices_type& choices);
+
+  /**
+   * @brief Adds a named value table (VAL_TABLE_ in DBC files). The table is interned.
+   */
+  void addValueTable(const std::string& name, const CANSignal::choices_type& choices);
+
+  /**
+   * @return The named value tables of the database
+   */
+  const std::map<std::string, CANSignal::shared_choices>& value_tables() const;
+
+  /**
+   * @return The number of distinct value tables in the pool
+   */
+  std::size_t value_table_pool_size() const;
+
 private:
   class CANDatabaseImpl;
   CANDatabaseImpl* impl;
@@ -9,6 +9,8 @@ namespace CppCAN {
 namespace analysis {
     /**
      * @brief Analyses the frame signals to see if some signals are overlapping
+     *        or exceed the payload of the frame (see CANFrame::length(), up to 64 bytes
+     *        for CAN FD frames)
      * @param src The CANFrame instance to inspect
      * @return true if no overlapping is detected, false otherwise
      */
@@ -18,7 +20,8 @@ namespace analysis {
      * @brief Overload of is_frame_layout_ok() that outputs a diagnosis of the
      *        problematic signals if a layout error is detected.
      * @param src The CANFrame instance to inspect
-     * @param diagnosis Filled with the names of all the overlapping signals
+     * @param diagnosis Filled with the names of all the overlapping signals and
+     *                  of the signals exceeding the payload
      * @return true if no overlapping is detected, false otherwise
      */
     CPP_CAN_PARSER_EXPORT bool is_frame_layout_ok(const CANFrame& src, std::vector<std::string>& diagnosis);
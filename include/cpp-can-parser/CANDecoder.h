@@ -0,0 +1,762 @@
+#ifndef CANDECODER_H
+#define CANDECODER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "CANDatabase.h"
+#include "CANChoiceTable.h"
+#include "cpp_can_parser_export.h"
+
+namespace CppCAN {
+
+/**
+ * @brief Stable reference to a signal of a CANDecoder
+ *
+ * A handle is resolved once with CANDecoder::handle() and then gives a direct
+ * access to the signal's plan (CANDecoder::plan()) and to its value in the caches
+ * sized from the decoder (eg. SignalValueCache) without any string comparison.
+ * A handle stays valid as long as the decoder (and thus the database) lives.
+ */
+struct CPP_CAN_PARSER_EXPORT SignalHandle {
+  static const uint32_t INVALID = 0xFFFFFFFF;
+
+  /**
+   * @brief Constructs an invalid handle
+   */
+  SignalHandle();
+  SignalHandle(uint32_t frame, uint32_t signal, uint32_t index);
+
+  bool valid() const;
+
+  bool operator==(const SignalHandle& other) const;
+  bool operator!=(const SignalHandle& other) const;
+
+  uint32_t frame;  // Index of the frame in CANDecoder::frames()
+  uint32_t signal; // Index of the signal in FramePlan::signals
+  uint32_t index;  // Index of the signal among all the signals of the decoder
+};
+
+/**
+ * @brief Precomputed decoding engine for the frames of a CANDatabase
+ *
+ * Building a CANDecoder walks the database once and compiles every signal
+ * into a SignalPlan: the bit position is turned into a byte offset and a shift
+ * over a 64-bit word read at this offset, and the scale/offset pair is classified
+ * so that, whenever possible, the physical value can be computed without any
+ * floating-point arithmetic. Payloads of up to 64 bytes (CAN FD) are decoded
+ * the same way as classic CAN payloads: a signal costs a single unaligned
+ * 64-bit load (two for signals longer than 57 bits that are not byte-aligned).
+ *
+ * The choices of the signals (see CANSignal::choices()) are compiled into
+ * CANChoiceTable objects. Optionally, short signals (see Options::lut_max_bits)
+ * are also given lookup tables that map every possible raw value to its physical
+ * value and to its label. The tables are shared between identical signals and
+ * between the copies of a decoder.
+ *
+ * The decoder keeps pointers to the CANSignal objects of the database: the
+ * database must outlive the decoder and must not be modified after the
+ * decoder has been built.
+ */
+class CPP_CAN_PARSER_EXPORT CANDecoder {
+public:
+  /**
+   * @brief Classification of the (scale, offset) pair of a signal
+   * - Identity: scale is 1 and offset is 0, physical == raw
+   * - IntegerOffset: scale and offset are integers, physical == raw * scale + offset
+   * - RationalScale: scale and offset are decimal numbers (k * 10^-e), the physical
+   *                  value is exactly representable as a fixed-point number
+   *   compile() only keeps these two kinds when raw * int_scale + int_offset fits in
+   *   63 bits for every raw value of the signal: other signals are General.
+   * - General: anything else, floating-point arithmetic is required
+   * - IEEEFloat: the raw bits are an IEEE-754 float or double (see CANSignal::value_type()),
+   *              physical == value * scale + offset. The bits are reinterpreted in place,
+   *              the integer paths are never used.
+   */
+  enum SignalKind {
+    Identity, IntegerOffset, RationalScale, General, IEEEFloat
+  };
+
+  /**
+   * @brief A value represented as mantissa * 10^exponent
+   */
+  struct CPP_CAN_PARSER_EXPORT FixedPoint {
+    int64_t mantissa;
+    int exponent;
+  };
+
+  /**
+   * @brief Options of the decoding plans' construction
+   */
+  struct CPP_CAN_PARSER_EXPORT Options {
+    /**
+     * @brief Default options: no lookup table, 8 bits and 1 MiB if they are enabled
+     */
+    Options();
+
+    /**
+     * @brief Builds lookup tables for the signals of at most lut_max_bits bits
+     */
+    bool build_luts;
+
+    /**
+     * @brief Maximum length (in bits) of the signals that get a lookup table
+     */
+    unsigned lut_max_bits;
+
+    /**
+     * @brief Maximum amount of memory (in bytes) used by all the lookup tables.
+     *        Signals that do not fit in the budget are decoded arithmetically.
+     */
+    std::size_t lut_memory_limit;
+  };
+
+  /**
+   * @brief Zero-padded copy of a payload of up to 64 bytes. The padding lets every
+   *        signal be read with 64-bit loads without any bound check. The decoding
+   *        functions only copy the payloads shorter than FramePlan::load_length.
+   */
+  struct CPP_CAN_PARSER_EXPORT Payload {
+    static const std::size_t PADDED_SIZE = 80;
+
+    /**
+     * @brief Copies the payload (bytes beyond the 64th are ignored)
+     */
+    Payload(const uint8_t* data, std::size_t len);
+
+    uint8_t bytes[PADDED_SIZE];
+  };
+
+  /**
+   * @brief Decoding parameters of a single signal
+   */
+  struct CPP_CAN_PARSER_EXPORT SignalPlan {
+    /**
+     * @param data Payload of at least byte_offset + 8 bytes (16 if wide), eg. a
+     *             payload of FramePlan::load_length bytes
+     * @return The bits of the signal, not sign-extended
+     */
+    uint64_t bits(const uint8_t* data) const;
+    uint64_t bits(const Payload& payload) const;
+
+    /**
+     * @return The raw value of the signal (sign-extended if the signal is signed)
+     */
+    int64_t raw(const uint8_t* data) const;
+    int64_t raw(const Payload& payload) const;
+
+    /**
+     * @return The physical value of the signal, using the lookup table if any
+     */
+    double physical(const uint8_t* data) const;
+    double physical(const Payload& payload) const;
+
+    /**
+     * @return The physical value of the signal as a floating-point number.
+     *         Identity and IntegerOffset signals only use integer arithmetic
+     *         before the final conversion. The raw value of IEEEFloat signals
+     *         is their bit pattern.
+     */
+    double physical(int64_t raw) const;
+
+    /**
+     * @return The value encoded by the bits of an IEEEFloat signal
+     *         (single precision if the signal is 32-bit long, double otherwise)
+     */
+    double ieee(uint64_t bits) const;
+
+    /**
+     * @return The physical value as an integer. Exact for Identity and IntegerOffset
+     *         signals, truncated otherwise (the result is undefined if the value of
+     *         an IEEEFloat signal does not fit in 64 bits).
+     */
+    int64_t integer(int64_t raw) const;
+
+    /**
+     * @return The physical value as a fixed-point number with the natural exponent
+     *         of the signal (0 for Identity/IntegerOffset, -e for RationalScale).
+     *         General and IEEEFloat signals are rounded to 10^-9.
+     */
+    FixedPoint fixed(int64_t raw) const;
+
+    /**
+     * @return The mantissa of the physical value for the declared exponent.
+     *         No floating-point arithmetic is involved unless the signal is General
+     *         or IEEEFloat.
+     *         If the declared exponent is coarser than the natural one, the result
+     *         is truncated toward zero.
+     */
+    int64_t fixed(int64_t raw, int exponent) const;
+
+    /**
+     * @return true if integer() returns the exact physical value
+     */
+    bool is_integer() const;
+
+    /**
+     * @return The label associated with the raw value or an empty view whose data()
+     *         is nullptr if there is none
+     */
+    std::string_view label(int64_t raw) const;
+
+    /**
+     * @brief Converts the value of a choice (see CANSignal::choices(), negative
+     *        values of the DBC file wrap around) into a raw value of the signal:
+     *        the value is sign-extended from 32 bits if the signal is signed.
+     * @return false if the value does not fit in the length of the signal
+     */
+    bool choice_raw(unsigned int value, int64_t& raw) const;
+
+    SignalKind kind;
+    bool is_signed;
+    bool big_endian;
+    bool wide;           // The signal spans two 64-bit words
+    uint8_t byte_offset; // Byte offset of the 64-bit word in the payload
+    uint8_t shift;
+    uint8_t length;
+    uint64_t mask;
+    double scale;
+    double offset;
+    const double* lut_values; // Indexed by bits(), nullptr if no table
+    int64_t int_scale;        // scale == int_scale * 10^exponent
+    int64_t int_offset;       // offset == int_offset * 10^exponent
+    int exponent;             // Decimal exponent of int_scale and int_offset
+    const CANSignal* signal;
+    const std::string_view* lut_labels; // Indexed by bits(), nullptr if no table
+    const CANChoiceTable* choices;      // nullptr if the signal has no choices
+  };
+
+  /**
+   * @brief The fields of a SignalPlan read by the decoding loops, packed in 24 bytes
+   *        (see FramePlan::packed). Returns the same values as the SignalPlan.
+   */
+  struct CPP_CAN_PARSER_EXPORT PackedSignal {
+    enum Flags : uint8_t {
+      Signed = 1,
+      BigEndian = 2,
+      Wide = 4,
+      Lookup = 8 // The physical values are read from lut_values
+    };
+
+    uint64_t bits(const uint8_t* data) const;
+    int64_t raw(const uint8_t* data) const;
+    double physical(const uint8_t* data) const;
+    int64_t integer(const uint8_t* data) const;
+
+    uint8_t kind; // SignalKind
+    uint8_t flags;
+    uint8_t byte_offset;
+    uint8_t shift;
+    uint8_t length;
+    union {
+      double scale;             // RationalScale, General and IEEEFloat signals
+      int64_t int_scale;        // Identity and IntegerOffset signals
+      const double* lut_values; // Lookup signals
+    };
+    union {
+      double offset;
+      int64_t int_offset;
+    };
+  };
+
+  /**
+   * @brief Values of a multiplexor switch that select the same multiplexed signals
+   */
+  struct CPP_CAN_PARSER_EXPORT MuxSegment {
+    uint64_t first;
+    uint64_t last;
+    uint32_t begin; // [begin, end) is the range of the selected signals in MuxTable::targets
+    uint32_t end;
+  };
+
+  /**
+   * @brief Jump table of a multiplexor switch: gives the multiplexed signals
+   *        selected by each value of the switch.
+   */
+  struct CPP_CAN_PARSER_EXPORT MuxTable {
+    static const uint32_t NO_SEGMENT = 0xFFFFFFFF;
+
+    /**
+     * @return The segment that contains the value or nullptr if no signal is selected
+     */
+    const MuxSegment* find(uint64_t value) const;
+
+    uint32_t switch_signal;           // Index of the switch in FramePlan::signals
+    std::vector<MuxSegment> segments; // Sorted by value
+    std::vector<uint32_t> dense;      // value -> index in segments (only for small values)
+    std::vector<uint32_t> targets;    // Indices of the multiplexed signals in FramePlan::signals
+  };
+
+  /**
+   * @brief Decoding parameters of a whole frame
+   */
+  struct CPP_CAN_PARSER_EXPORT FramePlan {
+    /**
+     * @return true if the frame contains multiplexed signals
+     */
+    bool is_multiplexed() const;
+
+    const CANFrame* frame;
+    std::size_t index; // Position of the plan in frames()
+    std::size_t first_signal; // SignalHandle::index of the first signal of the frame
+    unsigned long long can_id; // Without CANFrame::EXTENDED_ID_FLAG
+    unsigned long long dbc_id; // See CANFrame::dbc_id()
+    bool extended;
+    std::size_t load_length; // Bytes read by the signals: shorter payloads are copied into a Payload
+    std::vector<SignalPlan> signals;
+    std::vector<PackedSignal> packed; // Same order as signals, read by the decoding loops
+
+    // Only filled for multiplexed frames
+    std::vector<uint32_t> static_signals; // Signals that do not depend on any switch
+    std::vector<MuxTable> mux_tables;
+    std::vector<uint32_t> root_tables;    // Tables of the switches that are not multiplexed
+    std::vector<int32_t> switch_tables;   // For each signal, index of its table in mux_tables or -1
+  };
+
+  /**
+   * @brief Classifies the given scale/offset pair (whatever the length of the signal,
+   *        see compile())
+   * @param exponent Filled with the decimal exponent used by the integer representation
+   * @param int_scale Filled with the scale's mantissa
+   * @param int_offset Filled with the offset's mantissa
+   */
+  static SignalKind classify(double scale, double offset, int& exponent,
+                             int64_t& int_scale, int64_t& int_offset);
+
+  /**
+   * @brief Compiles the decoding plan of a single signal
+   * @throw CANDatabaseException if the signal cannot be extracted from a 64-byte payload
+   *        or if a float (double) signal is not 32-bit (64-bit) long
+   */
+  static SignalPlan compile(const CANSignal& signal);
+
+  /**
+   * @brief Loads the payload as a little-endian word (missing bytes are 0)
+   */
+  static uint64_t load_le(const uint8_t* data, std::size_t len);
+
+  /**
+   * @brief Loads the payload as a big-endian word (missing bytes are 0)
+   */
+  static uint64_t load_be(const uint8_t* data, std::size_t len);
+
+  /**
+   * @brief Loads 8 bytes as a little-endian word
+   */
+  static uint64_t load_le(const uint8_t* data);
+
+  /**
+   * @brief Loads 8 bytes as a big-endian word
+   */
+  static uint64_t load_be(const uint8_t* data);
+
+  /**
+   * @brief Loads the word of a signal at data (see SignalPlan::shift and
+   *        SignalPlan::wide). The bits above the signal are not cleared.
+   */
+  static uint64_t load_word(const uint8_t* data, unsigned shift, bool big_endian, bool wide);
+
+  /**
+   * @return The value encoded by the bits of an IEEE-754 float (length 32) or double
+   */
+  static double ieee(uint64_t bits, unsigned length);
+
+public:
+  /**
+   * @brief Builds the decoding plans of all the frames of the database
+   * @throw CANDatabaseException if a signal cannot be decoded
+   */
+  CANDecoder(const CANDatabase& db, const Options& options = Options());
+
+  CANDecoder(const CANDecoder&) = default;
+  CANDecoder& operator=(const CANDecoder&) = default;
+  CANDecoder(CANDecoder&&) = default;
+  CANDecoder& operator=(CANDecoder&&) = default;
+
+public:
+  /**
+   * @return The plan associated with the given CAN ID or nullptr if the CAN ID is unknown.
+   *         Like in CANDatabase, the CAN ID is a DBC ID (see CANFrame::dbc_id()) but
+   *         extended frames can also be found with their bare 29-bit ID.
+   */
+  const FramePlan* find(unsigned long long can_id) const;
+
+  /**
+   * @return The plan associated with the given CAN ID and format or nullptr if there is none
+   */
+  const FramePlan* find(unsigned long long can_id, bool extended) const;
+
+  /**
+   * @return The plan associated with the given CAN ID
+   * @throw std::out_of_range if the CAN ID is unknown
+   */
+  const FramePlan& at(unsigned long long can_id) const;
+
+  /**
+   * @return All the frame plans sorted by DBC ID
+   */
+  const std::vector<FramePlan>& frames() const;
+
+  /**
+   * @brief Lists the signals present in the frame. For multiplexed frames, only the
+   *        signals selected by the multiplexors' values are listed: they are found
+   *        through the jump tables of the switches.
+   * @param out Filled with the indices of the signals (must have room for
+   *            plan.signals.size() values)
+   * @return The number of signals present in the frame
+   */
+  std::size_t active_signals(const FramePlan& plan, const uint8_t* data, std::size_t len, uint32_t* out) const;
+
+  /**
+   * @brief Extracts the raw value of all the signals of the frame.
+   *        out must have room for plan.signals.size() values.
+   *        The signals are read in place when len is at least plan.load_length,
+   *        from a zero-padded copy of the payload otherwise (missing bytes are 0).
+   *        For multiplexed frames, the values of the signals that are not present
+   *        (see active_signals()) are left untouched. This also applies to
+   *        decode() and decode_integer().
+   */
+  void decode_raw(const FramePlan& plan, const uint8_t* data, std::size_t len, int64_t* out) const;
+
+  /**
+   * @brief Decodes the physical value of all the signals of the frame.
+   *        out must have room for plan.signals.size() values.
+   */
+  void decode(const FramePlan& plan, const uint8_t* data, std::size_t len, double* out) const;
+
+  /**
+   * @brief Decodes the physical value of all the signals of the frame as integers
+   *        (see SignalPlan::integer()). out must have room for plan.signals.size() values.
+   */
+  void decode_integer(const FramePlan& plan, const uint8_t* data, std::size_t len, int64_t* out) const;
+
+  /**
+   * @return The number of distinct lookup tables shared by the signals
+   *         (the choice tables are not included)
+   */
+  std::size_t lut_count() const;
+
+  /**
+   * @return The number of distinct choice tables shared by the signals
+   */
+  std::size_t choice_table_count() const;
+
+  /**
+   * @return The memory (in bytes) used by the lookup tables
+   */
+  std::size_t lut_memory() const;
+
+public:
+  /**
+   * @return The handle of the given signal
+   * @throw std::out_of_range if the frame or the signal does not exist
+   */
+  SignalHandle handle(unsigned long long can_id, const std::string& signal_name) const;
+
+  /**
+   * @return The handle of the given signal or an invalid handle if it does not exist
+   */
+  SignalHandle find_handle(unsigned long long can_id, const std::string& signal_name) const;
+
+  /**
+   * @return The handle of the i-th signal of the given frame
+   */
+  SignalHandle handle(const FramePlan& plan, std::size_t i) const;
+
+  /**
+   * @return The frame plan of the given signal
+   */
+  const FramePlan& frame(SignalHandle handle) const;
+
+  /**
+   * @return The plan of the given signal
+   */
+  const SignalPlan& plan(SignalHandle handle) const;
+
+  /**
+   * @return The total number of signals in the decoder (ie. the size of the caches
+   *         indexed by SignalHandle::index)
+   */
+  std::size_t signal_count() const;
+
+private:
+  class LookupTables;
+
+  std::vector<FramePlan> frames_;
+  std::size_t signal_count_;
+  std::shared_ptr<const LookupTables> luts_;
+};
+
+/**
+ * @brief Last decoded values of all the signals of a decoder, indexed by SignalHandle
+ */
+class CPP_CAN_PARSER_EXPORT SignalValueCache {
+public:
+  /**
+   * @brief Creates a cache for all the signals of the decoder (initialized to 0).
+   *        The decoder must outlive the cache.
+   */
+  SignalValueCache(const CANDecoder& decoder);
+
+  /**
+   * @brief Decodes the frame and stores the values of its signals
+   */
+  void update(const CANDecoder::FramePlan& plan, const uint8_t* data, std::size_t len);
+
+  /**
+   * @brief Looks the frame up and decodes it
+   * @return false if the CAN ID is unknown
+   */
+  bool update(unsigned long long can_id, const uint8_t* data, std::size_t len);
+
+  /**
+   * @return The last decoded value of the signal
+   */
+  double operator[](SignalHandle handle) const;
+
+  /**
+   * @return The last decoded values of the signals of the frame (in the plan's order)
+   */
+  const double* values(const CANDecoder::FramePlan& plan) const;
+
+private:
+  const CANDecoder* decoder_;
+  std::vector<double> values_;
+};
+
+inline double
+SignalValueCache::operator[](SignalHandle handle) const {
+  return values_[handle.index];
+}
+
+inline const CANDecoder::SignalPlan&
+CANDecoder::plan(SignalHandle handle) const {
+  return frames_[handle.frame].signals[handle.signal];
+}
+
+inline const CANDecoder::FramePlan&
+CANDecoder::frame(SignalHandle handle) const {
+  return frames_[handle.frame];
+}
+
+inline bool
+CANDecoder::FramePlan::is_multiplexed() const {
+  return !mux_tables.empty();
+}
+
+inline const CANDecoder::MuxSegment*
+CANDecoder::MuxTable::find(uint64_t value) const {
+  uint32_t idx = NO_SEGMENT;
+
+  if(!dense.empty()) {
+    if(value < dense.size())
+      idx = dense[value];
+  }
+  else {
+    // Segments are sorted and disjoint: binary search on the last value
+    std::size_t lo = 0, hi = segments.size();
+    while(lo < hi) {
+      std::size_t mid = (lo + hi) / 2;
+      if(segments[mid].last < value)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+    if(lo < segments.size() && segments[lo].first <= value)
+      idx = static_cast<uint32_t>(lo);
+  }
+
+  return idx != NO_SEGMENT ? &segments[idx] : nullptr;
+}
+
+inline uint64_t
+CANDecoder::load_le(const uint8_t* data) {
+  // The compilers turn both the copy and the byte loop into a single load
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  uint64_t result;
+  std::memcpy(&result, data, sizeof(result));
+  return result;
+#else
+  return load_le(data, 8);
+#endif
+}
+
+inline uint64_t
+CANDecoder::load_be(const uint8_t* data) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  return __builtin_bswap64(load_le(data));
+#else
+  return load_be(data, 8);
+#endif
+}
+
+inline uint64_t
+CANDecoder::load_word(const uint8_t* data, unsigned shift, bool big_endian, bool wide) {
+  uint64_t value;
+
+  if(big_endian) {
+    value = load_be(data + (wide ? 8 : 0)) >> shift;
+    if(wide)
+      value |= load_be(data) << (64 - shift);
+  }
+  else {
+    value = load_le(data) >> shift;
+    if(wide)
+      value |= load_le(data + 8) << (64 - shift);
+  }
+
+  return value;
+}
+
+inline double
+CANDecoder::ieee(uint64_t bits, unsigned length) {
+  // memcpy is the only well-defined reinterpretation, it is compiled to a register move
+  if(length == 32) {
+    uint32_t single_bits = static_cast<uint32_t>(bits);
+    float value;
+    std::memcpy(&value, &single_bits, sizeof(value));
+    return value;
+  }
+
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+inline uint64_t
+CANDecoder::SignalPlan::bits(const uint8_t* data) const {
+  return load_word(data + byte_offset, shift, big_endian, wide) & mask;
+}
+
+inline uint64_t
+CANDecoder::SignalPlan::bits(const Payload& payload) const {
+  return bits(payload.bytes);
+}
+
+inline int64_t
+CANDecoder::SignalPlan::raw(const uint8_t* data) const {
+  uint64_t value = bits(data);
+
+  if(is_signed) {
+    uint64_t sign_bit = uint64_t(1) << (length - 1);
+    return static_cast<int64_t>((value ^ sign_bit) - sign_bit);
+  }
+
+  return static_cast<int64_t>(value);
+}
+
+inline int64_t
+CANDecoder::SignalPlan::raw(const Payload& payload) const {
+  return raw(payload.bytes);
+}
+
+inline double
+CANDecoder::SignalPlan::ieee(uint64_t bits) const {
+  return CANDecoder::ieee(bits, length);
+}
+
+inline double
+CANDecoder::SignalPlan::physical(int64_t raw) const {
+  switch(kind) {
+  case Identity:
+    return static_cast<double>(raw);
+  case IntegerOffset:
+    return static_cast<double>(raw * int_scale + int_offset);
+  case IEEEFloat:
+    return ieee(static_cast<uint64_t>(raw)) * scale + offset;
+  default:
+    return raw * scale + offset;
+  }
+}
+
+inline double
+CANDecoder::SignalPlan::physical(const uint8_t* data) const {
+  if(lut_values != nullptr)
+    return lut_values[bits(data)];
+
+  return physical(raw(data));
+}
+
+inline double
+CANDecoder::SignalPlan::physical(const Payload& payload) const {
+  return physical(payload.bytes);
+}
+
+inline int64_t
+CANDecoder::SignalPlan::integer(int64_t raw) const {
+  switch(kind) {
+  case Identity:
+    return raw;
+  case IntegerOffset:
+    return raw * int_scale + int_offset;
+  default:
+    return static_cast<int64_t>(physical(raw));
+  }
+}
+
+inline bool
+CANDecoder::SignalPlan::is_integer() const {
+  return kind == Identity || kind == IntegerOffset;
+}
+
+inline uint64_t
+CANDecoder::PackedSignal::bits(const uint8_t* data) const {
+  // length is at least 1: the mask is not stored
+  return load_word(data + byte_offset, shift, (flags & BigEndian) != 0, (flags & Wide) != 0) &
+         (~uint64_t(0) >> (64 - length));
+}
+
+inline int64_t
+CANDecoder::PackedSignal::raw(const uint8_t* data) const {
+  uint64_t value = bits(data);
+
+  if(flags & Signed) {
+    uint64_t sign_bit = uint64_t(1) << (length - 1);
+    return static_cast<int64_t>((value ^ sign_bit) - sign_bit);
+  }
+
+  return static_cast<int64_t>(value);
+}
+
+inline double
+CANDecoder::PackedSignal::physical(const uint8_t* data) const {
+  if(flags & Lookup)
+    return lut_values[bits(data)];
+
+  int64_t value = raw(data);
+  switch(kind) {
+  case Identity:
+    return static_cast<double>(value);
+  case IntegerOffset:
+    return static_cast<double>(value * int_scale + int_offset);
+  case IEEEFloat:
+    return ieee(static_cast<uint64_t>(value), length) * scale + offset;
+  default:
+    return value * scale + offset;
+  }
+}
+
+inline int64_t
+CANDecoder::PackedSignal::integer(const uint8_t* data) const {
+  if(flags & Lookup)
+    return static_cast<int64_t>(lut_values[bits(data)]);
+
+  int64_t value = raw(data);
+  switch(kind) {
+  case Identity:
+    return value;
+  case IntegerOffset:
+    return value * int_scale + int_offset;
+  case IEEEFloat:
+    return static_cast<int64_t>(ieee(static_cast<uint64_t>(value), length) * scale + offset);
+  default:
+    return static_cast<int64_t>(value * scale + offset);
+  }
+}
+
+}
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef CANEXPRESSION_H
+#define CANEXPRESSION_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "CANDecoder.h"
+#include "CANLogReader.h"
+#include "cpp_can_parser_export.h"
+
+namespace CppCAN {
+
+/**
+ * @brief Syntax or type error in an expression (the message gives the position)
+ */
+class CANExpressionException : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+/**
+ * @brief Arithmetic and logical expression over the physical values of signals,
+ *        compiled to bytecode
+ *
+ * Grammar (usual C precedence, && and || are short-circuited):
+ *
+ *   expr    := or
+ *   or      := and ( "||" and )*
+ *   and     := compare ( "&&" compare )*
+ *   compare := sum ( ( "==" | "!=" | "<" | "<=" | ">" | ">=" ) sum )?
+ *   sum     := product ( ( "+" | "-" ) product )*
+ *   product := unary ( ( "*" | "/" ) unary )*
+ *   unary   := ( "-" | "!" ) unary | primary
+ *   primary := number | "true" | "false" | "(" expr ")" | signal | "\"label\""
+ *   signal  := Frame.Signal | Signal (if the name is unique in the database)
+ *
+ * A label (eg. Gear == "Drive") can only be compared with a signal that has this
+ * choice: it is replaced by the physical value of the choice. Expressions are
+ * type-checked when they are compiled: the operands of the logical operators must
+ * be booleans and the operands of the arithmetic operators and of <, <=, >, >=
+ * must be numbers: like in C, !Speed > 3 is (!Speed) > 3 and does not type-check,
+ * write !(Speed > 3). Constant sub-expressions are folded. Expressions nested more
+ * than 256 levels deep (parentheses, unary operators or chains of operators) are
+ * rejected. So are the expressions that need more than MAX_STACK values on the
+ * evaluation stack: each nested right operand keeps the value of its left operand
+ * on the stack, eg. 1 + (1 + (1 + ... Speed)) cannot be nested more than about
+ * 30 levels deep.
+ *
+ * The bytecode runs on a small fixed-size stack and reads the values of the
+ * signals from an array indexed by SignalHandle::index (eg. the values stored
+ * by a CANTriggerSet). Evaluating an expression never allocates.
+ */
+class CPP_CAN_PARSER_EXPORT CANExpression {
+public:
+  enum Type {
+    Number, Boolean
+  };
+
+  /**
+   * @brief Maximum depth of the evaluation stack
+   */
+  static const std::size_t MAX_STACK = 32;
+
+  enum OpCode : uint32_t {
+    Constant,    // Pushes constant
+    Load,        // Pushes values[index]
+    Negate,
+    Not,
+    Add, Subtract, Multiply, Divide,
+    Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual,
+    JumpIfFalse, // Jumps to index if the top is false (and keeps it), pops it otherwise
+    JumpIfTrue   // Jumps to index if the top is true (and keeps it), pops it otherwise
+  };
+
+  struct CPP_CAN_PARSER_EXPORT Instruction {
+    OpCode op;
+    uint32_t index;  // Load: SignalHandle::index, jumps: target instruction
+    double constant;
+  };
+
+public:
+  /**
+   * @brief Parses, type-checks and compiles an expression. The decoder must
+   *        outlive the expression.
+   * @throw CANExpressionException if the expression is invalid
+   */
+  CANExpression(const CANDecoder& decoder, const std::string& text);
+
+  /**
+   * @param values Physical values of the signals, indexed by SignalHandle::index
+   * @return The value of the expression (1 or 0 for boolean expressions)
+   */
+  double value(const double* values) const;
+
+  /**
+   * @return true if the value of the expression is not 0 (booleans and numbers)
+   */
+  bool evaluate(const double* values) const;
+
+  Type type() const;
+
+  const std::string& text() const;
+
+  /**
+   * @return The signals read by the expression, sorted by SignalHandle::index
+   */
+  const std::vector<SignalHandle>& signals() const;
+
+  /**
+   * @return The frames that carry the signals read by the expression (indices
+   *         in CANDecoder::frames(), sorted)
+   */
+  const std::vector<uint32_t>& frames() const;
+
+  const std::vector<Instruction>& code() const;
+
+  const CANDecoder& decoder() const;
+
+private:
+  class Compiler;
+
+  const CANDecoder* decoder_;
+  std::string text_;
+  Type type_;
+  std::vector<Instruction> code_;
+  std::vector<SignalHandle> signals_;
+  std::vector<uint32_t> frames_;
+};
+
+/**
+ * @brief Set of boolean rules (CANExpression) evaluated on a stream of frames
+ *
+ * The set keeps the latest value of every signal (NaN until the signal is
+ * received: comparisons with it are false, except !=). Each received frame
+ * updates the values of its signals and re-evaluates only the rules that read
+ * one of them, found through a per-frame index built when the rules are added.
+ * The callback is called when a rule becomes true (active) or false again.
+ * Multiplexed signals absent from a frame keep their previous value.
+ * The set is not thread-safe.
+ */
+class CPP_CAN_PARSER_EXPORT CANTriggerSet {
+public:
+  struct CPP_CAN_PARSER_EXPORT Event {
+    std::size_t rule;  // Index returned by add()
+    bool active;       // New state of the rule
+    int64_t timestamp; // Nanoseconds, timestamp of the frame that changed the state
+  };
+
+  using Callback = std::function<void(const Event& event)>;
+
+public:
+  /**
+   * @param callback Called for every change of state (optional). The decoder
+   *                 must outlive the set.
+   */
+  CANTriggerSet(const CANDecoder& decoder, const Callback& callback = Callback());
+
+  /**
+   * @brief Compiles and adds a rule
+   * @return The index of the rule
+   * @throw CANExpressionException if the expression is invalid or is not boolean
+   */
+  std::size_t add(const std::string& text);
+
+  /**
+   * @brief Decodes the frame, stores the values of its signals and evaluates
+   *        the rules that read them
+   * @param timestamp Nanoseconds (see LogFrame::timestamp)
+   * @return The number of rules evaluated
+   */
+  std::size_t update(const CANDecoder::FramePlan& plan, const uint8_t* data, std::size_t len, int64_t timestamp);
+
+  /**
+   * @brief Looks the frame up and updates it. Remote and error frames are ignored.
+   * @return The number of rules evaluated
+   */
+  std::size_t update(const LogFrame& frame);
+
+  /**
+   * @return true if the rule was true after the last evaluation
+   */
+  bool active(std::size_t rule) const;
+
+  const CANExpression& rule(std::size_t rule) const;
+
+  std::size_t size() const;
+
+  /**
+   * @return The latest values of the signals, indexed by SignalHandle::index
+   */
+  const double* values() const;
+
+private:
+  const CANDecoder* decoder_;
+  Callback callback_;
+  std::vector<CANExpression> rules_;
+  std::vector<char> active_;
+  std::vector<double> values_;
+  std::vector<double> decoded_;        // Sized for the largest frame of the decoder
+  std::vector<uint32_t> rule_offsets_; // Rules of frame i: rule_indices_[rule_offsets_[i], rule_offsets_[i + 1])
+  std::vector<uint32_t> rule_indices_;
+};
+
+}
+
+#endif
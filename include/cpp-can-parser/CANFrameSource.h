@@ -0,0 +1,242 @@
+#ifndef CANFRAMESOURCE_H
+#define CANFRAMESOURCE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "CANLogReader.h"
+#include "cpp_can_parser_export.h"
+
+namespace CppCAN {
+
+/**
+ * @brief Source of live CAN frames, read in batches
+ *
+ * The frames are written into a buffer of LogFrame provided by the caller:
+ * a source does not allocate anything per frame and the frames can be given
+ * straight to CANDecoder (or to a SignalValueCache).
+ */
+class CPP_CAN_PARSER_EXPORT CANFrameSource {
+public:
+  virtual ~CANFrameSource();
+
+  /**
+   * @brief Waits for frames and reads all the available ones, up to capacity
+   * @return The number of frames read. 0 if the timeout of the source expired,
+   *         if the call was interrupted or if the source is closed (see closed()).
+   * @throw CANLogException if the source cannot be read
+   */
+  virtual std::size_t read(LogFrame* frames, std::size_t capacity) = 0;
+
+  /**
+   * @return true once the source will not give any more frames
+   */
+  virtual bool closed() const = 0;
+
+  /**
+   * @return The names of the interfaces, indexed by LogFrame::channel. Only the
+   *         thread that calls read() may call this function.
+   */
+  virtual const std::vector<std::string>& channels() const = 0;
+};
+
+/**
+ * @brief Raw CAN socket of Linux (SocketCAN)
+ *
+ * The frames are received by batches with a single recvmmsg() system call
+ * into buffers allocated once by the constructor. When no frame is queued, read()
+ * waits with poll() for a frame, the timeout or close(). CAN FD frames are accepted
+ * (Options::fd) and each frame gets the timestamp given by the kernel: the
+ * hardware timestamp of the interface if there is one and if it is enabled
+ * (Options::hardware_timestamps), the software timestamp otherwise. Frames sent
+ * by the host on the interface are flagged with LogFrame::Tx.
+ *
+ * Frames lost because the receive queue of the socket was full are counted by
+ * the kernel (see dropped()). Like the lines of CandumpReader, the frames of the
+ * interfaces seen after the first 256 ones are skipped: LogFrame::channel cannot
+ * index them.
+ *
+ * The source can be tested on any Linux machine with a virtual interface:
+ *   ip link add dev vcan0 type vcan && ip link set up vcan0
+ *
+ * On other systems, the constructor throws a CANLogException.
+ */
+class CPP_CAN_PARSER_EXPORT SocketCANSource : public CANFrameSource {
+public:
+  struct CPP_CAN_PARSER_EXPORT Options {
+    /**
+     * @brief Default options: batches of 64 frames, CAN FD and hardware timestamps
+     *        enabled, no error frames, no timeout
+     */
+    Options();
+
+    std::size_t batch_size;   // Maximum number of frames received by a system call
+    bool fd;                  // Receive CAN FD frames
+    bool error_frames;        // Receive all the error frames (CAN_ERR_MASK)
+    bool hardware_timestamps; // Use the timestamps of the interface when available
+    bool receive_own;         // Receive the frames sent through this socket
+    int timeout;              // Milliseconds, negative to wait forever
+    int receive_buffer;       // Size of the socket's receive buffer in bytes, 0 for the system's default
+  };
+
+public:
+  /**
+   * @brief Opens a raw CAN socket bound to the given interface ("" or "any" to
+   *        receive the frames of all the CAN interfaces)
+   * @throw CANLogException if the socket cannot be opened or bound
+   */
+  explicit SocketCANSource(const std::string& interface_name, const Options& options = Options());
+  ~SocketCANSource() override;
+
+  SocketCANSource(const SocketCANSource&) = delete;
+  SocketCANSource& operator=(const SocketCANSource&) = delete;
+
+  std::size_t read(LogFrame* frames, std::size_t capacity) override;
+
+  /**
+   * @return false until close() is called
+   */
+  bool closed() const override;
+
+  const std::vector<std::string>& channels() const override;
+
+  /**
+   * @brief Stops the source: a read() blocked in another thread returns 0 at
+   *        once and the next ones return 0. Can be called from any thread.
+   *        The socket is released by the destructor.
+   */
+  void close();
+
+  /**
+   * @return The number of frames dropped by the kernel since the socket was opened
+   */
+  uint32_t dropped() const;
+
+  /**
+   * @return The file descriptor of the socket (eg. to wait on several sources with
+   *         poll()), valid until the source is destroyed
+   */
+  int native_handle() const;
+
+private:
+  class Buffers;
+
+  /**
+   * @brief Gives the channel of the interface, added to channels() on first use
+   * @return false if 256 other interfaces already have a channel
+   */
+  bool channel(int ifindex, uint8_t& index);
+
+  int socket_;
+  int wakeup_;                // eventfd signaled by close()
+  std::atomic<bool> closed_;
+  Options options_;
+  std::unique_ptr<Buffers> buffers_;
+  std::vector<std::pair<int, uint8_t>> ifindexes_; // Interface index -> channel
+  std::vector<std::string> channels_;
+  uint32_t dropped_;
+};
+
+/**
+ * @brief In-process source fed by another thread, eg. to test the consumers of
+ *        SocketCANSource without any CAN interface or to replay a log
+ *
+ * The frames are stored in a ring of fixed capacity: push() waits while the ring
+ * is full.
+ */
+class CPP_CAN_PARSER_EXPORT FakeCANSource : public CANFrameSource {
+public:
+  /**
+   * @param capacity Number of frames stored in the ring
+   * @param timeout Milliseconds, negative to wait forever (see read())
+   * @param channels Names of the channels of the pushed frames
+   */
+  explicit FakeCANSource(std::size_t capacity = 4096, int timeout = -1,
+                         const std::vector<std::string>& channels = std::vector<std::string>());
+
+  std::size_t read(LogFrame* frames, std::size_t capacity) override;
+
+  /**
+   * @return true when close() was called and all the frames were read
+   */
+  bool closed() const override;
+
+  const std::vector<std::string>& channels() const override;
+
+  /**
+   * @brief Adds a frame, waiting for room in the ring if needed
+   * @return false if the source is closed (the frame is dropped)
+   */
+  bool push(const LogFrame& frame);
+
+  /**
+   * @brief Wakes the reader up: the frames already pushed can still be read,
+   *        then read() returns 0 and closed() returns true
+   */
+  void close();
+
+private:
+  mutable std::mutex mutex_;
+  std::condition_variable readable_;
+  std::condition_variable writable_;
+  std::vector<LogFrame> ring_;
+  std::size_t head_; // Next frame to read
+  std::size_t size_;
+  int timeout_;
+  bool closed_;
+  std::vector<std::string> channels_;
+};
+
+/**
+ * @brief Frames read from a log, eg. to replay a log through a CANPipeline
+ */
+class CPP_CAN_PARSER_EXPORT LogReaderSource : public CANFrameSource {
+public:
+  using NextFrame = std::function<bool(LogFrame&)>;
+
+  /**
+   * @brief Reads the frames of a text log. The reader must outlive the source.
+   *        The channels are those of the reader if it is a CandumpReader.
+   */
+  explicit LogReaderSource(CANLogReader& reader);
+
+  /**
+   * @param next Gives the next frame of the log or returns false at its end
+   *             (eg. a lambda around BinaryLogReader::next())
+   */
+  LogReaderSource(const NextFrame& next, const std::vector<std::string>& channels);
+
+  std::size_t read(LogFrame* frames, std::size_t capacity) override;
+  bool closed() const override;
+  const std::vector<std::string>& channels() const override;
+
+private:
+  NextFrame next_;
+  const CandumpReader* candump_;
+  std::vector<std::string> channels_;
+  bool closed_;
+};
+
+namespace socketcan {
+  static const std::size_t CLASSIC_MTU = 16; // sizeof(struct can_frame)
+  static const std::size_t FD_MTU = 72;      // sizeof(struct canfd_frame)
+
+  /**
+   * @brief Converts a frame in the format of the kernel (struct can_frame or
+   *        struct canfd_frame, in the byte order of the host) into a LogFrame.
+   *        The timestamp and the channel are left untouched.
+   * @param size CLASSIC_MTU or FD_MTU
+   * @return false if the size or the length of the frame is invalid
+   */
+  CPP_CAN_PARSER_EXPORT bool parse_frame(const uint8_t* data, std::size_t size, LogFrame& frame);
+}
+
+}
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef CANIDFILTER_H
+#define CANIDFILTER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "CANDatabase.h"
+#include "CANLogReader.h"
+#include "cpp_can_parser_export.h"
+
+namespace CppCAN {
+
+/**
+ * @brief Acceptance filter on CAN IDs, compiled from ID lists, ranges,
+ *        mask/value pairs and databases
+ *
+ * Standard (11-bit) IDs are compiled into a 2048-bit bitmap whatever the rules
+ * are: testing one is a single load and a bit test. Extended (29-bit) IDs use:
+ * - an open-addressing hash set for single IDs, small ranges and masks with few
+ *   free bits (they are expanded into their IDs)
+ * - sorted, merged ranges searched by bisection for the larger ranges
+ * - the remaining mask/value pairs, tested one after the other
+ *
+ * The rules are added before the filter is used. A filter is then only read:
+ * a const filter can be shared by any number of threads (eg. by several
+ * IdFilterStage of a pipeline) without synchronization.
+ */
+class CPP_CAN_PARSER_EXPORT CANIdFilter {
+public:
+  static const std::size_t STANDARD_IDS = 2048;
+  static const uint32_t MAX_EXTENDED_ID = 0x1FFFFFFF;
+
+  /**
+   * @brief Extended ranges of at most this many IDs and masks with at most
+   *        log2(EXPAND_LIMIT) free bits are expanded into the hash set
+   */
+  static const uint32_t EXPAND_LIMIT = 4096;
+
+public:
+  /**
+   * @brief Creates a filter that rejects every frame
+   */
+  CANIdFilter();
+
+  /**
+   * @return A filter that accepts the frames of the database
+   */
+  static CANIdFilter from_database(const CANDatabase& database);
+
+  /**
+   * @brief Accepts a CAN ID
+   * @throw std::out_of_range if the ID does not fit in 11 bits (29 bits if extended)
+   */
+  CANIdFilter& add_id(uint32_t id, bool extended);
+
+  /**
+   * @brief Accepts the CAN IDs from first to last (included)
+   * @throw std::out_of_range if last does not fit in 11 bits (29 bits if extended)
+   * @throw std::invalid_argument if first is greater than last
+   */
+  CANIdFilter& add_range(uint32_t first, uint32_t last, bool extended);
+
+  /**
+   * @brief Accepts the CAN IDs such that (id & mask) == (value & mask), like
+   *        the acceptance filters of CAN controllers. A mask of 0 accepts every ID.
+   */
+  CANIdFilter& add_mask(uint32_t value, uint32_t mask, bool extended);
+
+  /**
+   * @brief Accepts the frames of the database (see CANFrame::can_id() and
+   *        CANFrame::is_extended()). The frames whose ID does not fit in 11 bits
+   *        (29 bits if extended), like the VECTOR__INDEPENDENT_SIG_MSG pseudo-message
+   *        of Vector databases, are skipped.
+   */
+  CANIdFilter& add_database(const CANDatabase& database);
+
+  /**
+   * @return true if the CAN ID (without CANFrame::EXTENDED_ID_FLAG) is accepted
+   */
+  bool matches(uint32_t id, bool extended) const;
+
+  /**
+   * @return true if the ID of the frame is accepted. Error frames never match.
+   */
+  bool matches(const LogFrame& frame) const;
+
+  /**
+   * @brief Same as matches() for a batch of frames
+   * @param indices Filled with the indices of the matching frames (must have room
+   *                for count values)
+   * @return The number of matching frames
+   */
+  std::size_t scan(const LogFrame* frames, std::size_t count, uint32_t* indices) const;
+
+  /**
+   * @return The number of accepted standard IDs
+   */
+  std::size_t standard_count() const;
+
+  /**
+   * @return The number of extended IDs in the hash set
+   */
+  std::size_t extended_id_count() const;
+
+  /**
+   * @return The merged ranges of extended IDs (first, last), sorted
+   */
+  const std::vector<std::pair<uint32_t, uint32_t>>& extended_ranges() const;
+
+  /**
+   * @return The mask/value pairs of extended IDs that are not expanded (value, mask)
+   */
+  const std::vector<std::pair<uint32_t, uint32_t>>& extended_masks() const;
+
+private:
+  static const uint32_t EMPTY_SLOT = 0xFFFFFFFF;
+
+  bool matches_extended(uint32_t id) const;
+  void insert(uint32_t id);
+  void set_standard(uint32_t id);
+  uint32_t slot(uint32_t id) const;
+
+  uint64_t standard_[STANDARD_IDS / 64];
+  std::vector<uint32_t> slots_; // Hash set, size is a power of two (or 0)
+  uint32_t shift_;              // 32 - log2(slots_.size())
+  std::size_t extended_ids_;
+  std::vector<std::pair<uint32_t, uint32_t>> ranges_;
+  std::vector<std::pair<uint32_t, uint32_t>> masks_;
+};
+
+inline bool
+CANIdFilter::matches(uint32_t id, bool extended) const {
+  if(!extended)
+    return id < STANDARD_IDS && ((standard_[id >> 6] >> (id & 63)) & 1) != 0;
+  return matches_extended(id);
+}
+
+inline bool
+CANIdFilter::matches(const LogFrame& frame) const {
+  return !(frame.flags & LogFrame::ErrorFrame) && matches(frame.can_id, frame.is_extended());
+}
+
+}
+
+#endif
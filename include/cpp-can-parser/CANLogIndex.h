@@ -0,0 +1,145 @@
+#ifndef CANLOGINDEX_H
+#define CANLOGINDEX_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "CANLogReader.h"
+#include "ParallelLogDecoder.h"
+#include "cpp_can_parser_export.h"
+
+namespace CppCAN {
+
+/**
+ * @brief Sidecar index of a log, built in a single pass
+ *
+ * The log is divided into regions (ranges of lines of about Options::region_size
+ * bytes, or the blocks of binary logs). The index keeps, for each region:
+ * - its position in the log and the time of the event before it (checkpoint)
+ * - the smallest and largest timestamps of its frames
+ * - the CAN IDs of its frames, as one bitmap of regions per CAN ID
+ *
+ * A query ("frames with the ID X between t1 and t2") only reads the regions
+ * whose time range intersects [t1, t2] and whose bitmap contains X.
+ *
+ * The index can be saved next to the log and reloaded later. It remembers the
+ * size and a fingerprint of the log so that a stale index can be detected
+ * (see matches()).
+ */
+class CPP_CAN_PARSER_EXPORT CANLogIndex {
+public:
+  struct CPP_CAN_PARSER_EXPORT Options {
+    /**
+     * @brief Default options: 256 KiB regions
+     */
+    Options();
+
+    std::size_t region_size; // Size of the regions of text logs (approximate)
+  };
+
+  struct CPP_CAN_PARSER_EXPORT Region {
+    uint64_t begin;          // Offset of the first line (or block) of the region
+    uint64_t end;
+    int64_t time;            // Time of the event before the region (relative Vector timestamps)
+    int64_t min_timestamp;   // Only meaningful if frame_count is not 0
+    int64_t max_timestamp;
+    uint32_t frame_count;
+  };
+
+  using Callback = std::function<void(const LogFrame&)>;
+
+public:
+  /**
+   * @brief Reads the whole log and builds its index
+   * @throw CANLogException if a binary log is corrupted
+   */
+  static CANLogIndex build(ParallelLogDecoder::Format format, const char* begin, const char* end,
+                           const Options& options = Options());
+
+  /**
+   * @brief Loads an index saved by save()
+   * @throw CANLogException if the file cannot be read or is not a valid index
+   */
+  static CANLogIndex load(const std::string& path);
+
+  /**
+   * @brief Saves the index (eg. next to the log, as "<log>.idx")
+   * @throw CANLogException if the file cannot be written
+   */
+  void save(const std::string& path) const;
+
+  /**
+   * @return true if the index was built from the given log (same size and fingerprint)
+   */
+  bool matches(const char* begin, const char* end) const;
+
+  ParallelLogDecoder::Format format() const;
+
+  const std::vector<Region>& regions() const;
+
+  /**
+   * @return The CAN IDs found in the log (DBC IDs, see LogFrame::dbc_id()), sorted
+   */
+  const std::vector<unsigned long long>& ids() const;
+
+  /**
+   * @return The names of the interfaces of a candump log
+   */
+  const std::vector<std::string>& channels() const;
+
+  /**
+   * @return true if the region contains frames with the given DBC ID
+   */
+  bool contains(unsigned long long dbc_id, std::size_t region) const;
+
+  /**
+   * @return The regions that may contain frames with the given DBC ID received
+   *         between from and to (both included)
+   */
+  std::vector<std::size_t> find_regions(unsigned long long dbc_id, int64_t from, int64_t to) const;
+
+  /**
+   * @return The regions that may contain frames received between from and to
+   */
+  std::vector<std::size_t> find_regions(int64_t from, int64_t to) const;
+
+  /**
+   * @brief Gives the frames with the given DBC ID received between from and to
+   *        (both included) to the callback, in the order of the log. Only the
+   *        regions returned by find_regions() are read.
+   * @param begin The log from which the index was built
+   * @return The number of frames given to the callback
+   */
+  std::size_t query(const char* begin, const char* end, unsigned long long dbc_id,
+                    int64_t from, int64_t to, const Callback& callback) const;
+
+  /**
+   * @brief Same as query() for all the frames received between from and to
+   */
+  std::size_t query(const char* begin, const char* end, int64_t from, int64_t to,
+                    const Callback& callback) const;
+
+private:
+  CANLogIndex();
+
+  std::size_t read_regions(const char* begin, const std::vector<std::size_t>& regions,
+                           const std::function<bool(const LogFrame&)>& filter,
+                           const Callback& callback) const;
+
+  static uint32_t fingerprint(const char* begin, const char* end);
+
+  ParallelLogDecoder::Format format_;
+  uint64_t log_size_;
+  uint32_t fingerprint_;
+  std::vector<Region> regions_;
+  std::vector<unsigned long long> ids_;
+  std::vector<uint64_t> bitmaps_; // One bitmap of bitmap_words_ words per ID (same order as ids_)
+  std::size_t bitmap_words_;
+  std::vector<std::string> channels_;
+};
+
+}
+
+#endif
@@ -0,0 +1,264 @@
+#ifndef CANLOGREADER_H
+#define CANLOGREADER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "CANDatabase.h"
+#include "cpp_can_parser_export.h"
+
+namespace CppCAN {
+
+/**
+ * @brief Exception thrown when a log cannot be opened or read
+ */
+class CANLogException : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+/**
+ * @brief A CAN frame read from a log (fixed size, no allocation)
+ */
+struct CPP_CAN_PARSER_EXPORT LogFrame {
+  enum Flags {
+    Extended = 0x01,
+    FD = 0x02,
+    BitRateSwitch = 0x04,
+    ErrorStateIndicator = 0x08,
+    Remote = 0x10,
+    Tx = 0x20,
+    ErrorFrame = 0x40
+  };
+
+  bool is_extended() const;
+  bool is_fd() const;
+
+  /**
+   * @return The CAN ID as found in DBC files (see CANFrame::dbc_id())
+   */
+  unsigned long long dbc_id() const;
+
+  int64_t timestamp; // Nanoseconds
+  uint32_t can_id;   // Without CANFrame::EXTENDED_ID_FLAG
+  uint8_t length;    // Payload length in bytes
+  uint8_t channel;   // Index of the interface/channel
+  uint8_t flags;
+  uint8_t data[CANFrame::MAX_PAYLOAD_LENGTH];
+};
+
+/**
+ * @brief Read-only memory mapping of a whole file
+ *
+ * The pages are loaded on demand by the operating system and can be evicted at
+ * any time: reading a log through a mapping uses a bounded amount of memory
+ * whatever the size of the file is.
+ */
+class CPP_CAN_PARSER_EXPORT MappedFile {
+public:
+  /**
+   * @throw CANLogException if the file cannot be opened or mapped
+   */
+  explicit MappedFile(const std::string& path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* begin() const;
+  const char* end() const;
+  std::size_t size() const;
+
+private:
+  const char* data_;
+  std::size_t size_;
+#ifdef _WIN32
+  void* file_;
+  void* mapping_;
+#endif
+};
+
+/**
+ * @brief Base class of the streaming readers of text logs
+ *
+ * A reader walks a range of characters (usually a MappedFile) line by line and
+ * never copies the text. Lines that cannot be parsed are skipped and counted.
+ */
+class CPP_CAN_PARSER_EXPORT CANLogReader {
+public:
+  virtual ~CANLogReader();
+
+  /**
+   * @brief Reads the next frame of the log
+   * @return false at the end of the log
+   */
+  virtual bool next(LogFrame& frame) = 0;
+
+  /**
+   * @return The number of lines read so far
+   */
+  std::size_t line_count() const;
+
+  /**
+   * @return The number of lines that were not frames and could not be parsed
+   */
+  std::size_t skipped_lines() const;
+
+  /**
+   * @return The position of the reader in the text
+   */
+  const char* position() const;
+
+protected:
+  CANLogReader(const char* begin, const char* end);
+
+  /**
+   * @brief Gives the next line without its end-of-line characters
+   * @return false at the end of the text
+   */
+  bool next_line(const char*& line, const char*& line_end);
+
+  const char* cursor_;
+  const char* end_;
+  std::size_t lines_;
+  std::size_t skipped_;
+};
+
+/**
+ * @brief Reader of the logs written by "candump -L" (or "candump -l")
+ *
+ * The lines look like:
+ * - (1436509052.249713) can0 123#DEADBEEF: classic frame (3 hex digits: standard ID)
+ * - (1436509052.249713) can0 12345678#00: extended ID (8 hex digits)
+ * - (1436509052.249713) can0 123#R: remote frame
+ * - (1436509052.249713) can0 123##1DEADBEEF: CAN FD frame, the first digit holds the flags
+ *
+ * Interfaces are numbered in order of appearance (see channels()).
+ */
+class CPP_CAN_PARSER_EXPORT CandumpReader : public CANLogReader {
+public:
+  CandumpReader(const char* begin, const char* end);
+
+  bool next(LogFrame& frame) override;
+
+  /**
+   * @brief Parses a single line
+   * @return false if the line is not a valid frame
+   */
+  bool parse_line(const char* line, const char* line_end, LogFrame& frame);
+
+  /**
+   * @return The names of the interfaces, indexed by LogFrame::channel
+   */
+  const std::vector<std::string>& channels() const;
+
+private:
+  /**
+   * @brief Finds (or adds) the index of the given interface
+   * @return false if there are already 256 interfaces
+   */
+  bool channel(const char* name, std::size_t length, uint8_t& index);
+
+  std::vector<std::string> channels_;
+};
+
+/**
+ * @brief Reader of the Vector ASCII logs (.asc)
+ *
+ * The header ("date", "base hex|dec timestamps absolute|relative") is
+ * interpreted and the following events are read:
+ * - 1.250000 1  123  Rx   d 8 00 01 02 03 04 05 06 07: classic frame ("123x" for extended IDs)
+ * - 1.250000 1  123  Tx   r: remote frame
+ * - 1.250000 1  ErrorFrame
+ * - 1.250000 CANFD 1 Rx 123 Name 1 0 d 12 00 01 ...: CAN FD frame (the name is optional)
+ *
+ * The other events (statistics, triggers, comments...) are skipped without being
+ * parsed. Timestamps are given relative to the start of the measurement, even if
+ * the log uses relative timestamps, and LogFrame::channel is the channel number
+ * minus one (channels are numbered from 1 in .asc files).
+ */
+class CPP_CAN_PARSER_EXPORT AscReader : public CANLogReader {
+public:
+  AscReader(const char* begin, const char* end);
+
+  /**
+   * @brief Reads a part [begin, end) of a log whose header was read by header
+   * @param time Time of the last event before begin (only used by logs with
+   *             relative timestamps)
+   */
+  AscReader(const char* begin, const char* end, const AscReader& header, int64_t time = 0);
+
+  bool next(LogFrame& frame) override;
+
+  /**
+   * @brief Reads the header lines at the current position, up to the first event
+   */
+  void read_header();
+
+  /**
+   * @return The date of the start of the measurement (nanoseconds since 01/01/1970,
+   *         in the time zone of the log) or -1 if the log has no valid "date" line
+   */
+  int64_t start_time() const;
+
+  /**
+   * @return The time of the last event read (relative to the start of the measurement)
+   */
+  int64_t last_event_time() const;
+
+  /**
+   * @return true if the IDs are written in hexadecimal ("base hex", the default)
+   */
+  bool is_hex() const;
+
+  /**
+   * @return true if each timestamp is relative to the previous event
+   */
+  bool has_relative_timestamps() const;
+
+private:
+  enum LineResult {
+    Frame,
+    OtherEvent,
+    Invalid
+  };
+
+  LineResult parse_event(const char* line, const char* line_end, LogFrame& frame);
+  LineResult parse_classic(const char* c, const char* end, LogFrame& frame);
+  LineResult parse_fd(const char* c, const char* end, LogFrame& frame);
+  void parse_header(const char* line, const char* line_end);
+  bool parse_id(const char* begin, const char* end, LogFrame& frame) const;
+
+  int64_t start_time_;
+  int64_t last_time_; // Time of the previous event (relative timestamps)
+  bool hex_;
+  bool relative_;
+};
+
+namespace logs {
+  /**
+   * @brief Parses hexadecimal digits
+   * @return false if a character is not a hexadecimal digit
+   */
+  CPP_CAN_PARSER_EXPORT bool parse_hex(const char* begin, const char* end, uint32_t& value);
+
+  /**
+   * @brief Parses a timestamp in seconds with an optional fractional part
+   *        (eg. "1436509052.249713") into nanoseconds
+   * @return false if the text is not a valid timestamp
+   */
+  CPP_CAN_PARSER_EXPORT bool parse_timestamp(const char* begin, const char* end, int64_t& nanoseconds);
+
+  /**
+   * @brief Parses a date in the format of the Vector logs, eg. "Mon Sep 18 10:12:13.456 am 2023"
+   *        or "Mon Sep 18 22:12:13 2023"
+   * @return false if the text is not a valid date
+   */
+  CPP_CAN_PARSER_EXPORT bool parse_asc_date(const char* begin, const char* end, int64_t& nanoseconds);
+}
+
+}
+
+#endif
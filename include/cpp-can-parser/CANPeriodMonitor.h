@@ -0,0 +1,157 @@
+#ifndef CANPERIODMONITOR_H
+#define CANPERIODMONITOR_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "CANDatabase.h"
+#include "CANLogReader.h"
+#include "cpp_can_parser_export.h"
+
+namespace CppCAN {
+
+namespace details {
+  class TimerWheel;
+}
+
+/**
+ * @brief Detects missing, late and too fast periodic frames (see CANFrame::period())
+ *
+ * Every frame of the database that has a period is monitored. On each reception,
+ * the interval since the previous reception is compared with the period and added
+ * to the jitter histogram of the frame, and the deadline of the frame (the
+ * reception time plus Options::timeout_ratio periods) is armed in a hierarchical
+ * timer wheel. A frame that misses its deadline is reported once and is then
+ * considered missing until it is received again. Receiving a frame and moving
+ * the clock are O(1).
+ *
+ * The monitor has no clock of its own: time is given by the timestamps of the
+ * frames and by advance(). When replaying a log, the timestamps of the frames are
+ * enough, whatever the replay speed is. On a live feed, advance() must also be
+ * called regularly (eg. whenever the source's read() times out) with the current
+ * time in the time base of the timestamps, so that timeouts are reported even when
+ * no frame is received. The monitor is not thread-safe.
+ */
+class CPP_CAN_PARSER_EXPORT CANPeriodMonitor {
+public:
+  /**
+   * @brief Bin i of a jitter histogram counts the intervals in
+   *        [i / 8, (i + 1) / 8) periods. The last bin also counts all the longer intervals.
+   */
+  static const std::size_t HISTOGRAM_BINS = 16;
+  static const std::size_t BINS_PER_PERIOD = 8;
+
+  struct CPP_CAN_PARSER_EXPORT Options {
+    /**
+     * @brief Default options: 1 ms resolution, ±10% tolerance, timeout after 3 periods
+     */
+    Options();
+
+    int64_t resolution;  // Nanoseconds per tick of the timer wheel
+    double tolerance;    // Intervals outside of [1 - tolerance, 1 + tolerance] periods are early or late
+    double timeout_ratio; // A frame is missing after timeout_ratio periods without reception
+  };
+
+  /**
+   * - Timeout: the frame was not received before its deadline (timestamp is the deadline)
+   * - Recovered: a missing frame was received again
+   * - Late: the interval is longer than the period (plus the tolerance)
+   * - Early: the interval is shorter than the period (minus the tolerance)
+   */
+  enum EventType {
+    Timeout, Recovered, Late, Early
+  };
+
+  struct CPP_CAN_PARSER_EXPORT Event {
+    EventType type;
+    const CANFrame* frame;
+    int64_t timestamp; // Nanoseconds
+    int64_t interval;  // Since the previous reception (nanoseconds)
+  };
+
+  struct CPP_CAN_PARSER_EXPORT FrameStats {
+    const CANFrame* frame;
+    int64_t period;         // Nanoseconds
+    int64_t last_timestamp; // -1 if the frame was never received
+    int64_t min_interval;   // 0 until two frames have been received
+    int64_t max_interval;
+    uint64_t received;
+    uint64_t timeouts;
+    uint64_t late;
+    uint64_t early;
+    bool missing;
+    uint64_t histogram[HISTOGRAM_BINS];
+  };
+
+  using Callback = std::function<void(const Event& event)>;
+
+public:
+  /**
+   * @param callback Called for every event (optional). The database must outlive the monitor.
+   */
+  CANPeriodMonitor(const CANDatabase& database, const Callback& callback = Callback(),
+                   const Options& options = Options());
+  ~CANPeriodMonitor();
+
+  CANPeriodMonitor(const CANPeriodMonitor&) = delete;
+  CANPeriodMonitor& operator=(const CANPeriodMonitor&) = delete;
+
+  /**
+   * @brief Records the reception of a frame. Timeouts that happened before the
+   *        frame are reported first.
+   * @return false if the frame is not monitored
+   */
+  bool receive(const LogFrame& frame);
+
+  /**
+   * @param dbc_id See CANFrame::dbc_id()
+   * @param timestamp Nanoseconds
+   */
+  bool receive(unsigned long long dbc_id, int64_t timestamp);
+
+  /**
+   * @brief Reports the frames whose deadline is before the given time
+   * @param now Nanoseconds, in the time base of the timestamps of the frames
+   */
+  void advance(int64_t now);
+
+  /**
+   * @return The statistics of a frame, or nullptr if the frame is not monitored
+   */
+  const FrameStats* stats(unsigned long long dbc_id) const;
+
+  /**
+   * @return The statistics of all the monitored frames
+   */
+  const std::vector<FrameStats>& frames() const;
+
+  /**
+   * @return The latest time seen (-1 before the first frame or call to advance())
+   */
+  int64_t now() const;
+
+private:
+  static const uint32_t NOT_MONITORED = 0xFFFFFFFF;
+
+  uint32_t find(unsigned long long dbc_id) const;
+  void start(int64_t now);
+  void arm(uint32_t index);
+  void expire(uint32_t index);
+  void report(EventType type, uint32_t index, int64_t timestamp, int64_t interval);
+
+  Callback callback_;
+  Options options_;
+  std::vector<FrameStats> frames_;
+  std::vector<int64_t> deadlines_;
+  std::vector<uint32_t> standard_ids_; // Index in frames_ of each 11-bit ID
+  std::unordered_map<unsigned long long, uint32_t> extended_ids_;
+  std::unique_ptr<details::TimerWheel> wheel_;
+  int64_t now_;
+};
+
+}
+
+#endif
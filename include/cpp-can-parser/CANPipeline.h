@@ -0,0 +1,265 @@
+#ifndef CANPIPELINE_H
+#define CANPIPELINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CANBinaryLog.h"
+#include "CANDecoder.h"
+#include "CANFrameSource.h"
+#include "CANIdFilter.h"
+#include "CANLogReader.h"
+#include "CANRawFilter.h"
+#include "cpp_can_parser_export.h"
+
+namespace CppCAN {
+
+/**
+ * @brief Multi-threaded chain of processing stages fed by frame sources
+ *
+ * Each source and each stage runs on its own thread. They are connected by bounded
+ * lock-free rings (see SPSCRing and MPSCRing) that carry the frames by value as
+ * fixed-size LogFrame records: no lock is taken and nothing is allocated per frame.
+ *
+ *   sources --> ring --> stage 0 --> ring --> stage 1 --> ... --> last stage
+ *
+ * The first ring is shared by all the sources. When a ring is full, its producer
+ * applies the backpressure policy of the pipeline (Options::backpressure). Every
+ * source and stage has counters of the frames that went through it and of the frames
+ * that it dropped (see Counters).
+ *
+ * The pipeline ends when all the sources are closed (see CANFrameSource::closed())
+ * or after stop(): the stages then process the frames left in the rings and their
+ * flush() function is called.
+ */
+class CPP_CAN_PARSER_EXPORT CANPipeline {
+public:
+  /**
+   * - Block: the producer waits until there is room in the ring (no frame is lost)
+   * - DropOldest: the oldest frame of the ring is dropped to make room for the new one
+   * - DropNewest: the new frame is dropped
+   */
+  enum Backpressure {
+    Block, DropOldest, DropNewest
+  };
+
+  struct CPP_CAN_PARSER_EXPORT Options {
+    /**
+     * @brief Default options: rings of 4096 frames, batches of 64 frames, blocking producers
+     */
+    Options();
+
+    std::size_t ring_size;     // Capacity of each ring (rounded up to a power of two)
+    std::size_t batch_size;    // Maximum number of frames moved at once between two threads
+    Backpressure backpressure;
+  };
+
+  /**
+   * @brief Snapshot of the counters of a source or a stage
+   */
+  struct CPP_CAN_PARSER_EXPORT Counters {
+    uint64_t frames_in;  // Frames read from the source or from the input ring
+    uint64_t frames_out; // Frames given to the next ring and not dropped
+    uint64_t dropped;    // Frames dropped because the next ring was full
+    uint64_t stalls;     // Times the producer had to wait for room in the next ring (Block)
+  };
+
+  /**
+   * @brief Processing stage. process() is always called by the same thread.
+   */
+  class CPP_CAN_PARSER_EXPORT Stage {
+  public:
+    virtual ~Stage();
+
+    /**
+     * @brief Processes a batch of frames. The frames can be modified or removed:
+     *        the first frames of the batch (the return value) are given to the
+     *        next stage.
+     * @return The number of frames kept
+     */
+    virtual std::size_t process(LogFrame* frames, std::size_t count) = 0;
+
+    /**
+     * @brief Called once after the last batch
+     */
+    virtual void flush();
+  };
+
+public:
+  CANPipeline(const Options& options = Options());
+
+  /**
+   * @brief Stops the pipeline (see stop()) and waits for its threads
+   */
+  ~CANPipeline();
+
+  CANPipeline(const CANPipeline&) = delete;
+  CANPipeline& operator=(const CANPipeline&) = delete;
+
+  /**
+   * @brief Adds a source. The source must outlive the pipeline.
+   */
+  void add_source(CANFrameSource& source);
+
+  /**
+   * @brief Appends a stage. The stage must outlive the pipeline.
+   */
+  void add_stage(Stage& stage);
+
+  /**
+   * @brief Starts the threads of the sources and of the stages
+   * @throw std::logic_error if the pipeline has no source or no stage or if it is already started
+   */
+  void start();
+
+  /**
+   * @brief Asks the sources to stop reading. Sources whose read() never returns
+   *        (eg. a SocketCANSource without timeout on a silent bus) must also be closed.
+   */
+  void stop();
+
+  /**
+   * @brief Waits until all the frames have been processed
+   * @throw The first exception thrown by a source or by a stage (the pipeline is
+   *        then stopped without processing the frames left)
+   */
+  void wait();
+
+  /**
+   * @brief Same as start() followed by wait()
+   */
+  void run();
+
+  Counters source_counters(std::size_t source) const;
+  Counters stage_counters(std::size_t stage) const;
+
+private:
+  class Link;
+  struct AtomicCounters;
+
+  void source_thread(std::size_t index);
+  void stage_thread(std::size_t index);
+
+  /**
+   * @brief Pushes a batch into a ring, applying the backpressure policy
+   */
+  void push(Link& link, const LogFrame* frames, std::size_t count, AtomicCounters& counters);
+
+  void fail(std::exception_ptr error);
+
+  Options options_;
+  std::vector<CANFrameSource*> sources_;
+  std::vector<Stage*> stages_;
+  std::vector<std::unique_ptr<Link>> links_; // links_[i] is the input of stages_[i]
+  std::vector<std::unique_ptr<AtomicCounters>> source_counters_;
+  std::vector<std::unique_ptr<AtomicCounters>> stage_counters_;
+  std::vector<std::thread> threads_;
+  std::atomic<bool> stop_;
+  std::atomic<bool> abort_;
+  std::atomic<std::size_t> running_sources_;
+  std::mutex error_mutex_;
+  std::exception_ptr error_;
+};
+
+/**
+ * @brief Decodes the frames with a CANDecoder built from the loaded CANDatabase
+ *        and gives the values to a callback. The frames are passed on unchanged.
+ */
+class CPP_CAN_PARSER_EXPORT DecodeStage : public CANPipeline::Stage {
+public:
+  /**
+   * @param values The physical values of the signals, in the order of plan.signals
+   *               (signals absent from multiplexed frames are NaN)
+   */
+  using Callback = std::function<void(const LogFrame& frame, const CANDecoder::FramePlan& plan,
+                                      const double* values)>;
+
+  /**
+   * @param drop_unknown Remove the frames that are not in the database (and the
+   *                     remote and error frames) from the pipeline
+   */
+  DecodeStage(const CANDecoder& decoder, const Callback& callback, bool drop_unknown = false);
+
+  std::size_t process(LogFrame* frames, std::size_t count) override;
+
+  /**
+   * @return The number of frames decoded so far
+   */
+  std::size_t decoded() const;
+
+private:
+  const CANDecoder* decoder_;
+  Callback callback_;
+  bool drop_unknown_;
+  std::vector<double> values_; // Sized for the largest frame of the decoder
+  std::size_t decoded_;
+};
+
+/**
+ * @brief Keeps the frames that match at least one of the filters (see CANRawFilter)
+ */
+class CPP_CAN_PARSER_EXPORT FilterStage : public CANPipeline::Stage {
+public:
+  explicit FilterStage(const std::vector<CANRawFilter>& filters);
+
+  std::size_t process(LogFrame* frames, std::size_t count) override;
+
+private:
+  std::vector<CANRawFilter> filters_;
+};
+
+/**
+ * @brief Keeps the frames whose CAN ID is accepted by the filter. The filter must
+ *        outlive the stage and can be shared by several stages.
+ */
+class CPP_CAN_PARSER_EXPORT IdFilterStage : public CANPipeline::Stage {
+public:
+  explicit IdFilterStage(const CANIdFilter& filter);
+
+  std::size_t process(LogFrame* frames, std::size_t count) override;
+
+private:
+  const CANIdFilter* filter_;
+};
+
+/**
+ * @brief Writes the frames into a binary log. The frames are passed on unchanged.
+ */
+class CPP_CAN_PARSER_EXPORT BinaryLogStage : public CANPipeline::Stage {
+public:
+  /**
+   * @param writer Closed by flush(). The writer must outlive the stage.
+   */
+  explicit BinaryLogStage(BinaryLogWriter& writer);
+
+  std::size_t process(LogFrame* frames, std::size_t count) override;
+  void flush() override;
+
+private:
+  BinaryLogWriter* writer_;
+};
+
+/**
+ * @brief Gives the batches of frames to a callback. The frames are passed on unchanged.
+ */
+class CPP_CAN_PARSER_EXPORT CallbackStage : public CANPipeline::Stage {
+public:
+  using Callback = std::function<void(const LogFrame* frames, std::size_t count)>;
+
+  explicit CallbackStage(const Callback& callback);
+
+  std::size_t process(LogFrame* frames, std::size_t count) override;
+
+private:
+  Callback callback_;
+};
+
+}
+
+#endif
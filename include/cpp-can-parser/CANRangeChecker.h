@@ -0,0 +1,94 @@
+#ifndef CANRANGECHECKER_H
+#define CANRANGECHECKER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "CANDecoder.h"
+#include "cpp_can_parser_export.h"
+
+namespace CppCAN {
+
+/**
+ * @brief Out-of-range detection for decoded signals
+ *
+ * The physical range of each signal (see CANSignal::range()) is converted once
+ * into a range of raw values. Checking a frame then only compares the raw values
+ * returned by CANDecoder::decode_raw() against these bounds: there is no conversion
+ * to the physical domain and no branch, so the comparisons are vectorized by the
+ * compiler.
+ *
+ * Signals without range (undefined or [0|0] in DBC files) and IEEE-754 float signals
+ * are never reported. Neither are the multiplexed signals that are not selected by
+ * their switch: decode_raw() does not write their raw values, so the checker finds the
+ * selected ones through the jump tables of the frame plan (see CANDecoder::MuxTable),
+ * from the raw values of the switches.
+ *
+ * Violations are reported as a bitmask: bit i of word i / 64 is set if the
+ * signal i of the frame plan is out of range.
+ */
+class CPP_CAN_PARSER_EXPORT CANRangeChecker {
+public:
+  /**
+   * @brief Raw-domain bounds of the signals of a frame (structure of arrays)
+   */
+  struct CPP_CAN_PARSER_EXPORT FrameBounds {
+    std::vector<int64_t> min;
+    std::vector<int64_t> max;
+    std::vector<uint64_t> static_mask; // mask_words() words: the signals that do not depend on any switch
+  };
+
+  /**
+   * @return The number of 64-bit words needed by the bitmask of the given frame
+   */
+  static std::size_t mask_words(const CANDecoder::FramePlan& plan);
+
+  /**
+   * @brief Computes the raw-domain bounds of a signal
+   * @return false if the signal has no range to check
+   */
+  static bool raw_bounds(const CANDecoder::SignalPlan& plan, int64_t& min, int64_t& max);
+
+public:
+  /**
+   * @brief Precomputes the raw-domain bounds of all the signals of the decoder.
+   *        The checker can only be used with the plans of this decoder.
+   */
+  CANRangeChecker(const CANDecoder& decoder);
+
+  /**
+   * @return The bounds of the given frame
+   */
+  const FrameBounds& bounds(const CANDecoder::FramePlan& plan) const;
+
+  /**
+   * @brief Checks the raw values of a single frame
+   * @param raw Raw values as given by CANDecoder::decode_raw()
+   * @param mask Filled with mask_words(plan) words
+   * @return true if all the signals are within their range
+   */
+  bool check(const CANDecoder::FramePlan& plan, const int64_t* raw, uint64_t* mask) const;
+
+  /**
+   * @brief Shortcut for frames with at most 64 signals
+   * @return The bitmask of the violations (the signals beyond the 64th are ignored)
+   */
+  uint64_t check(const CANDecoder::FramePlan& plan, const int64_t* raw) const;
+
+  /**
+   * @brief Checks a batch of frames with the same CAN ID
+   * @param raw count rows of plan.signals.size() raw values
+   * @param count Number of frames in the batch
+   * @param masks Filled with count rows of mask_words(plan) words
+   * @return The number of frames with at least one violation
+   */
+  std::size_t check_batch(const CANDecoder::FramePlan& plan, const int64_t* raw,
+                          std::size_t count, uint64_t* masks) const;
+
+private:
+  std::vector<FrameBounds> bounds_;
+};
+
+}
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef CANRAWFILTER_H
+#define CANRAWFILTER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include "CANDatabase.h"
+#include "CANDecoder.h"
+#include "CANLogReader.h"
+#include "cpp_can_parser_export.h"
+
+namespace CppCAN {
+
+/**
+ * @brief Predicate on the raw bits of the payloads of a frame
+ *
+ * Conditions such as "GearPosition == Reverse" are compiled once into a
+ * (mask, expected) pair over the bytes of the payload: the physical value is
+ * converted back to its raw value (inverse scale/offset, or reverse lookup of
+ * the label in the signal's choices) and the bits of the raw value are placed
+ * at the position given by the start bit, the length and the endianness of the
+ * signal. Several conditions on the same frame are merged into the same pair
+ * (logical AND). Testing a payload is then a few AND/compare operations on
+ * 64-bit words, without decoding any signal.
+ *
+ * When a multiplexed signal is present for a single value of its switch (m<N>),
+ * the condition on the switch is added as well. Otherwise (switch ranges of
+ * extended multiplexing), the switch is not checked and exact() returns false:
+ * matching frames must then be decoded to confirm that the signal is present.
+ *
+ * Bytes beyond the length of a payload are considered to be 0, as in CANDecoder.
+ * Floating-point signals are compared bitwise (0.0 and -0.0 are different values).
+ */
+class CPP_CAN_PARSER_EXPORT CANRawFilter {
+public:
+  static const std::size_t WORDS = CANFrame::MAX_PAYLOAD_LENGTH / 8;
+
+  /**
+   * @brief Number of payloads tested at once by scan() before the matches are gathered
+   */
+  static const std::size_t BATCH_SIZE = 256;
+
+public:
+  /**
+   * @brief Creates a filter that matches all the frames of the given frame's CAN ID.
+   *        The frame must outlive the filter.
+   */
+  explicit CANRawFilter(const CANFrame& frame);
+
+  /**
+   * @brief Adds the condition "signal == value" (physical value)
+   * @throw std::out_of_range if the frame has no such signal
+   * @throw CANDatabaseException if the signal cannot be extracted from a 64-byte payload
+   */
+  CANRawFilter& equals(const std::string& signal, double value);
+
+  /**
+   * @brief Adds the condition "signal == label" (see CANSignal::choices()). The
+   *        filter is not satisfiable if the values of the label do not fit in the signal.
+   * @throw std::out_of_range if the frame has no such signal or if no choice has this label
+   * @throw CANDatabaseException if the signal cannot be extracted from a 64-byte payload
+   */
+  CANRawFilter& equals(const std::string& signal, const std::string& label);
+
+  /**
+   * @brief Adds the condition "bits of the signal == raw" (only the length() low bits
+   *        of raw are used)
+   * @throw std::out_of_range if the frame has no such signal
+   * @throw CANDatabaseException if the signal cannot be extracted from a 64-byte payload
+   */
+  CANRawFilter& equals_raw(const std::string& signal, uint64_t raw);
+
+  /**
+   * @return false if no payload can match (eg. the value is not representable by
+   *         the signal or two conditions contradict each other)
+   */
+  bool satisfiable() const;
+
+  /**
+   * @return true if a match guarantees that the conditions hold (see the
+   *         description of the class for multiplexed signals)
+   */
+  bool exact() const;
+
+  /**
+   * @return The DBC ID of the frame (see CANFrame::dbc_id())
+   */
+  unsigned long long dbc_id() const;
+
+  const CANFrame& frame() const;
+
+  /**
+   * @return The number of 64-bit words of the payload that are tested
+   */
+  std::size_t word_count() const;
+
+  /**
+   * @return The mask of the i-th word of the payload (little-endian, bit 0 is
+   *         bit 0 of the byte 8 * i)
+   */
+  uint64_t mask(std::size_t i) const;
+
+  /**
+   * @return The expected value of the masked bits of the i-th word
+   */
+  uint64_t expected(std::size_t i) const;
+
+  /**
+   * @return true if the payload matches the conditions
+   */
+  bool matches(const uint8_t* data, std::size_t len) const;
+
+  /**
+   * @return true if the frame has the CAN ID of the filter and its payload matches.
+   *         Remote and error frames never match.
+   */
+  bool matches(const LogFrame& frame) const;
+
+  /**
+   * @brief Tests a batch of payloads stored stride bytes apart (eg. stride 8 for
+   *        an array of classic CAN payloads). Each payload must be at least
+   *        8 * word_count() bytes long. The payloads are tested BATCH_SIZE at a
+   *        time by a branchless loop that the compiler can vectorize (packed
+   *        classic payloads, ie. stride 8, give contiguous loads).
+   * @param indices Filled with the indices of the matching payloads (must have room
+   *                for count values)
+   * @return The number of matching payloads
+   */
+  std::size_t scan(const uint8_t* payloads, std::size_t stride, std::size_t count,
+                   uint32_t* indices) const;
+
+  /**
+   * @brief Same as matches() for a batch of frames
+   * @param indices Filled with the indices of the matching frames (must have room
+   *                for count values)
+   * @return The number of matching frames
+   */
+  std::size_t scan(const LogFrame* frames, std::size_t count, uint32_t* indices) const;
+
+private:
+  /**
+   * @brief Adds the condition "bits of the signal == bits" and the condition on
+   *        the switch of a multiplexed signal
+   */
+  void add(const CANSignal& signal, uint64_t bits);
+
+  /**
+   * @brief Adds the condition on the switch of a multiplexed signal, if possible
+   */
+  void add_switch(const CANSignal& signal);
+
+  /**
+   * @brief Ors the bits of the signal into the words at the position given by the plan
+   */
+  static void place(const CANDecoder::SignalPlan& plan, uint64_t bits, uint64_t* words);
+
+  const CANFrame* frame_;
+  uint64_t mask_[WORDS];
+  uint64_t expected_[WORDS];
+  std::size_t words_;
+  bool satisfiable_;
+  bool exact_;
+};
+
+inline bool
+CANRawFilter::matches(const uint8_t* data, std::size_t len) const {
+  uint64_t result = satisfiable_ ? 0 : 1;
+
+  for(std::size_t i = 0; i < words_; i++) {
+    std::size_t first = 8 * i;
+    uint64_t word = 0;
+    if(len >= first + 8)
+      word = CANDecoder::load_le(data + first);
+    else if(len > first)
+      word = CANDecoder::load_le(data + first, len - first);
+
+    result |= (word & mask_[i]) ^ expected_[i];
+  }
+
+  return result == 0;
+}
+
+}
+
+#endif
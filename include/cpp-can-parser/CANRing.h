@@ -0,0 +1,266 @@
+#ifndef CANRING_H
+#define CANRING_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace CppCAN {
+
+/**
+ * @brief Size of a cache line: the indices written by different threads are kept
+ *        on different lines so that they do not invalidate each other (false sharing)
+ */
+static const std::size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * @return The smallest power of two greater than or equal to value (at least 2)
+ */
+inline std::size_t
+ring_capacity(std::size_t value) {
+  std::size_t capacity = 2;
+  while(capacity < value)
+    capacity *= 2;
+  return capacity;
+}
+
+/**
+ * @brief Bounded lock-free ring for a single producer thread and a single consumer thread
+ *
+ * The elements are copied by value into a preallocated array whose size is a power
+ * of two. Each side owns one index and keeps a cached copy of the other side's
+ * index: the shared indices are only read when the cached copy says that the ring
+ * is full (producer) or empty (consumer).
+ */
+template<typename T>
+class SPSCRing {
+public:
+  /**
+   * @param capacity Minimum number of elements (rounded up to a power of two)
+   */
+  explicit SPSCRing(std::size_t capacity)
+    : slots_(ring_capacity(capacity)), mask_(slots_.size() - 1),
+      head_(0), cached_tail_(0), tail_(0), cached_head_(0) { }
+
+  SPSCRing(const SPSCRing&) = delete;
+  SPSCRing& operator=(const SPSCRing&) = delete;
+
+  /**
+   * @brief Producer: appends an element
+   * @return false if the ring is full
+   */
+  bool try_push(const T& value) {
+    return try_push(&value, 1) == 1;
+  }
+
+  /**
+   * @brief Producer: appends as many elements as possible
+   * @return The number of elements appended
+   */
+  std::size_t try_push(const T* values, std::size_t count) {
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if(capacity() - (tail - cached_head_) < count)
+      cached_head_ = head_.load(std::memory_order_acquire);
+
+    std::size_t room = capacity() - (tail - cached_head_);
+    if(count > room)
+      count = room;
+
+    for(std::size_t i = 0; i < count; i++)
+      slots_[(tail + i) & mask_] = values[i];
+
+    tail_.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  /**
+   * @brief Consumer: removes the oldest element
+   * @return false if the ring is empty
+   */
+  bool try_pop(T& value) {
+    return try_pop(&value, 1) == 1;
+  }
+
+  /**
+   * @brief Consumer: removes up to count elements
+   * @return The number of elements removed
+   */
+  std::size_t try_pop(T* values, std::size_t count) {
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    if(cached_tail_ - head < count)
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+
+    std::size_t available = cached_tail_ - head;
+    if(count > available)
+      count = available;
+
+    for(std::size_t i = 0; i < count; i++)
+      values[i] = slots_[(head + i) & mask_];
+
+    head_.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+  /**
+   * @return The number of elements in the ring (approximate if the other side is active)
+   */
+  std::size_t size() const {
+    return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+  }
+
+  std::size_t capacity() const {
+    return slots_.size();
+  }
+
+private:
+  std::vector<T> slots_;
+  std::size_t mask_;
+
+  // Consumer side
+  alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head_;
+  std::size_t cached_tail_;
+
+  // Producer side
+  alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> tail_;
+  std::size_t cached_head_;
+};
+
+/**
+ * @brief Bounded lock-free ring for several producer threads (Vyukov's algorithm)
+ *
+ * Each slot carries a sequence number that tells whether it is free or full for
+ * a given turn: producers reserve a slot with a compare-and-swap on the tail and
+ * publish the element by updating the slot's sequence. try_pop() is also safe for
+ * concurrent callers, so that a producer can drop the oldest element when the
+ * ring is full.
+ */
+template<typename T>
+class MPSCRing {
+public:
+  /**
+   * @param capacity Minimum number of elements (rounded up to a power of two)
+   */
+  explicit MPSCRing(std::size_t capacity)
+    : capacity_(ring_capacity(capacity)), mask_(capacity_ - 1), slots_(new Slot[capacity_]),
+      head_(0), tail_(0) {
+    for(std::size_t i = 0; i < capacity_; i++)
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  MPSCRing(const MPSCRing&) = delete;
+  MPSCRing& operator=(const MPSCRing&) = delete;
+
+  /**
+   * @brief Appends an element (any thread)
+   * @return false if the ring is full
+   */
+  bool try_push(const T& value) {
+    std::size_t position = tail_.load(std::memory_order_relaxed);
+    Slot* slot;
+
+    while(true) {
+      slot = &slots_[position & mask_];
+      std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      std::intptr_t diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+
+      if(diff == 0) {
+        if(tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if(diff < 0) {
+        return false;
+      }
+      else {
+        position = tail_.load(std::memory_order_relaxed);
+      }
+    }
+
+    slot->value = value;
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Appends as many elements as possible
+   * @return The number of elements appended
+   */
+  std::size_t try_push(const T* values, std::size_t count) {
+    std::size_t pushed = 0;
+    while(pushed < count && try_push(values[pushed]))
+      pushed++;
+    return pushed;
+  }
+
+  /**
+   * @brief Removes the oldest element
+   * @return false if the ring is empty
+   */
+  bool try_pop(T& value) {
+    std::size_t position = head_.load(std::memory_order_relaxed);
+    Slot* slot;
+
+    while(true) {
+      slot = &slots_[position & mask_];
+      std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      std::intptr_t diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1);
+
+      if(diff == 0) {
+        if(head_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if(diff < 0) {
+        return false;
+      }
+      else {
+        position = head_.load(std::memory_order_relaxed);
+      }
+    }
+
+    value = slot->value;
+    slot->sequence.store(position + capacity_, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Removes up to count elements
+   * @return The number of elements removed
+   */
+  std::size_t try_pop(T* values, std::size_t count) {
+    std::size_t popped = 0;
+    while(popped < count && try_pop(values[popped]))
+      popped++;
+    return popped;
+  }
+
+  /**
+   * @return The number of elements in the ring (approximate if other threads are active)
+   */
+  std::size_t size() const {
+    std::size_t tail = tail_.load(std::memory_order_acquire);
+    std::size_t head = head_.load(std::memory_order_acquire);
+    return tail > head ? tail - head : 0;
+  }
+
+  std::size_t capacity() const {
+    return capacity_;
+  }
+
+private:
+  struct Slot {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+
+  std::size_t capacity_;
+  std::size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+
+  alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head_;
+  alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> tail_;
+};
+
+}
+
+#endif
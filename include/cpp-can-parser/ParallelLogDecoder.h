@@ -0,0 +1,168 @@
+#ifndef PARALLELLOGDECODER_H
+#define PARALLELLOGDECODER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "CANBinaryLog.h"
+#include "CANDecoder.h"
+#include "CANLogReader.h"
+#include "CANRawFilter.h"
+#include "cpp_can_parser_export.h"
+
+namespace CppCAN {
+
+/**
+ * @brief Multi-threaded decoding of a log held in memory (usually a MappedFile)
+ *
+ * The log is split at line (or block) boundaries into chunks of about Options::chunk_size
+ * bytes. The chunks are parsed and decoded by a pool of worker threads that share
+ * the same (read-only) decoder, and are then handed over to the consumer one by one,
+ * in the order of the log, on the thread that called run(). The result is thus the
+ * same as if the log had been read sequentially, whatever the number of threads is.
+ *
+ * Decoded chunks wait in a reorder buffer until all the chunks before them have
+ * been consumed. The buffer holds at most Options::max_pending_chunks chunks: the
+ * workers stop when it is full, so the memory used does not depend on the size
+ * of the log.
+ *
+ * Vector logs with relative timestamps cannot be split (each timestamp depends on
+ * all the previous ones): they are decoded as a single chunk.
+ */
+class CPP_CAN_PARSER_EXPORT ParallelLogDecoder {
+public:
+  enum Format {
+    Candump, // See CandumpReader
+    Asc,     // See AscReader
+    Binary   // See BinaryLogReader (the chunks are made of whole blocks)
+  };
+
+  /**
+   * @brief Frames and values of a chunk of the log
+   */
+  struct CPP_CAN_PARSER_EXPORT DecodedChunk {
+    std::size_t sequence; // Position of the chunk in the log
+    const char* begin;    // Text of the chunk
+    const char* end;
+
+    std::vector<LogFrame> frames;
+
+    // For each frame, its plan or nullptr if the frame is unknown or has no
+    // payload (remote and error frames)
+    std::vector<const CANDecoder::FramePlan*> plans;
+
+    // The values of the i-th frame are values[value_offsets[i]] to
+    // values[value_offsets[i + 1] - 1], in the order of plans[i]->signals.
+    // Signals absent from multiplexed frames are NaN.
+    std::vector<uint32_t> value_offsets;
+    std::vector<double> values;
+
+    // Candump logs: names of the interfaces. In the worker stage, LogFrame::channel
+    // indexes this list; when the chunk is given to the consumer, the channels
+    // have been renumbered to index ParallelLogDecoder::channels().
+    // Binary logs: the channel table of the log (see BinaryLogReader::channels()).
+    std::vector<std::string> channels;
+
+    std::size_t line_count;    // Text logs only
+    std::size_t skipped_lines;
+
+    std::string output; // Free for the worker stage
+  };
+
+  struct CPP_CAN_PARSER_EXPORT Options {
+    /**
+     * @brief Default options: one thread per core, 1 MiB chunks and two
+     *        pending chunks per thread
+     */
+    Options();
+
+    unsigned threads;              // 0 means one thread per core
+    std::size_t chunk_size;        // Approximate size of a chunk in bytes
+    std::size_t max_pending_chunks; // 0 means two chunks per thread
+
+    /**
+     * @brief Optional processing of the decoded chunks, run by the workers before
+     *        the chunks are put in the reorder buffer (eg. to format the values
+     *        into DecodedChunk::output). The function is called concurrently.
+     */
+    std::function<void(DecodedChunk&)> worker_stage;
+
+    /**
+     * @brief If not empty, only the frames that match one of the filters are kept
+     *        and decoded (see CANRawFilter). The other frames are dropped right
+     *        after being read and are not counted by frame_count().
+     */
+    std::vector<CANRawFilter> filters;
+  };
+
+  using Consumer = std::function<void(const DecodedChunk&)>;
+
+public:
+  /**
+   * @brief Prepares the decoding of the log [begin, end). The decoder and the
+   *        text must outlive this object.
+   */
+  ParallelLogDecoder(const CANDecoder& decoder, Format format,
+                     const char* begin, const char* end,
+                     const Options& options = Options());
+
+  /**
+   * @brief Decodes the whole log and gives the chunks to the consumer in the
+   *        order of the log. Exceptions thrown by the workers or by the consumer
+   *        stop the decoding and are rethrown.
+   * @throw CANLogException if a candump log has more than 256 interfaces (a
+   *        LogFrame::channel cannot index them)
+   */
+  void run(const Consumer& consumer);
+
+  /**
+   * @return The number of chunks of the log
+   */
+  std::size_t chunk_count() const;
+
+  /**
+   * @return The number of worker threads
+   */
+  unsigned thread_count() const;
+
+  /**
+   * @return The names of the interfaces of a candump log (filled by run()) or the
+   *         channel table of a binary log
+   */
+  const std::vector<std::string>& channels() const;
+
+  /**
+   * @return The number of frames read (and kept, see Options::filters) by run()
+   */
+  std::size_t frame_count() const;
+
+  /**
+   * @return The number of lines skipped by run() (see CANLogReader::skipped_lines())
+   */
+  std::size_t skipped_lines() const;
+
+  /**
+   * @brief Parses and decodes a chunk (used by the workers)
+   * @param chunk Its text (begin and end) and its sequence are set by the caller
+   */
+  void decode_chunk(DecodedChunk& chunk) const;
+
+private:
+  void remap_channels(DecodedChunk& chunk);
+
+  const CANDecoder* decoder_;
+  Format format_;
+  Options options_;
+  AscReader asc_header_;           // Header of Vector logs
+  std::vector<const char*> bounds_; // chunk_count() + 1 line or block boundaries
+  std::vector<std::string> channels_;
+  std::vector<std::string> binary_channels_; // Channel table of binary logs
+  std::size_t frame_count_;
+  std::size_t skipped_lines_;
+};
+
+}
+
+#endif
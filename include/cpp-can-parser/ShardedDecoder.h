@@ -0,0 +1,174 @@
+#ifndef SHARDEDDECODER_H
+#define SHARDEDDECODER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CANDecoder.h"
+#include "CANLogReader.h"
+#include "CANPipeline.h"
+#include "cpp_can_parser_export.h"
+
+namespace CppCAN {
+
+/**
+ * @brief Multi-threaded decoding of a stream of frames that keeps the order of the
+ *        frames of each CAN ID
+ *
+ * The CAN IDs are split into shards. Every CAN ID always belongs to the same shard
+ * and each shard has its own queue, which is only consumed by one worker thread at
+ * a time: the callback thus sees the frames of a CAN ID in the order they were
+ * pushed. Frames of different CAN IDs are decoded concurrently.
+ *
+ * Each shard is owned by a worker. With Assignment::LoadAware, the CAN IDs of the
+ * database are spread over the shards according to their expected rate (see
+ * CANFrame::period()), and the shards are regularly reassigned to the workers
+ * according to the number of frames seen (see Options::rebalance_interval). An idle
+ * worker can also steal a whole shard that is waiting for its owner
+ * (Options::work_stealing).
+ *
+ * Frames are pushed by a single thread (push() or the pipeline thread when the
+ * decoder is used as a CANPipeline stage). Frames that are not in the database
+ * and remote and error frames are not decoded.
+ */
+class CPP_CAN_PARSER_EXPORT ShardedDecoder : public CANPipeline::Stage {
+public:
+  /**
+   * - Hash: the shard of a CAN ID is given by a hash of the ID and shard i is owned
+   *   by worker i % threads
+   * - LoadAware: see the class description
+   */
+  enum Assignment {
+    Hash, LoadAware
+  };
+
+  struct CPP_CAN_PARSER_EXPORT Options {
+    /**
+     * @brief Default options: one thread per core, 16 shards per thread of 1024 frames
+     *        each, batches of 64 frames, load-aware assignment with work stealing
+     */
+    Options();
+
+    unsigned threads;             // 0 means one thread per core
+    std::size_t shards;           // 0 means 16 shards per thread
+    std::size_t shard_queue_size; // Capacity of the queue of each shard
+    std::size_t batch_size;       // Maximum number of frames of a shard decoded at once
+    Assignment assignment;
+    uint64_t rebalance_interval;  // LoadAware: frames pushed between two reassignments (0: never)
+    bool work_stealing;
+  };
+
+  struct CPP_CAN_PARSER_EXPORT WorkerCounters {
+    uint64_t frames;  // Frames decoded
+    uint64_t batches; // Batches of frames decoded
+    uint64_t steals;  // Shards taken from another worker
+  };
+
+  /**
+   * @param values The physical values of the signals, in the order of plan.signals
+   *               (signals absent from multiplexed frames are NaN)
+   * @param worker Index of the worker thread that calls the callback. The callback
+   *               is called concurrently by different workers.
+   */
+  using Callback = std::function<void(const LogFrame& frame, const CANDecoder::FramePlan& plan,
+                                      const double* values, unsigned worker)>;
+
+public:
+  /**
+   * @brief Starts the worker threads. The decoder must outlive this object.
+   */
+  ShardedDecoder(const CANDecoder& decoder, const Callback& callback, const Options& options = Options());
+
+  /**
+   * @brief Stops the workers. The frames that are still queued are not decoded.
+   */
+  ~ShardedDecoder();
+
+  ShardedDecoder(const ShardedDecoder&) = delete;
+  ShardedDecoder& operator=(const ShardedDecoder&) = delete;
+
+  /**
+   * @brief Queues frames for decoding. Waits when the queue of a shard is full.
+   */
+  void push(const LogFrame* frames, std::size_t count);
+
+  /**
+   * @brief Waits until all the frames pushed so far have been decoded
+   * @throw The first exception thrown by the callback (the decoding is then stopped)
+   */
+  void finish();
+
+  /**
+   * @brief Same as push(). The frames are passed on unchanged.
+   */
+  std::size_t process(LogFrame* frames, std::size_t count) override;
+
+  /**
+   * @brief Same as finish()
+   */
+  void flush() override;
+
+  /**
+   * @return The shard of the frames with the given CAN ID and format
+   */
+  std::size_t shard(unsigned long long can_id, bool extended) const;
+
+  /**
+   * @return The worker that currently owns the given shard
+   */
+  unsigned owner(std::size_t shard) const;
+
+  /**
+   * @return The number of frames pushed to the given shard
+   */
+  uint64_t shard_frames(std::size_t shard) const;
+
+  WorkerCounters worker_counters(unsigned worker) const;
+
+  unsigned thread_count() const;
+  std::size_t shard_count() const;
+
+  /**
+   * @return The number of frames decoded so far
+   */
+  uint64_t decoded() const;
+
+private:
+  struct Item;
+  struct Shard;
+  struct Worker;
+
+  void assign_frames();
+  void rebalance();
+  void worker_thread(unsigned index);
+
+  /**
+   * @brief Decodes the next batch of a shard if it is not already being decoded
+   * @return true if frames were decoded
+   */
+  bool drain(Shard& shard, Worker& worker);
+
+  const CANDecoder* decoder_;
+  Callback callback_;
+  Options options_;
+  std::vector<uint32_t> frame_shards_; // Shard of each plan of the decoder (LoadAware)
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+  uint64_t queued_;                    // Frames given to the shards
+  uint64_t next_rebalance_;
+  std::atomic<uint64_t> decoded_;
+  std::atomic<bool> abort_;
+  std::mutex error_mutex_;
+  std::exception_ptr error_;
+};
+
+}
+
+#endif
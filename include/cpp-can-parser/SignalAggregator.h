@@ -0,0 +1,146 @@
+#ifndef SIGNALAGGREGATOR_H
+#define SIGNALAGGREGATOR_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include "CANDecoder.h"
+#include "CANLogReader.h"
+#include "cpp_can_parser_export.h"
+
+namespace CppCAN {
+
+/**
+ * @brief Statistics of a signal over a window
+ */
+struct CPP_CAN_PARSER_EXPORT SignalAggregate {
+  uint32_t signal; // SignalHandle::index (see SignalAggregator::handle())
+  uint32_t count;  // Number of samples
+  double min;
+  double max;
+  double mean;
+  double last;     // Latest sample of the window
+};
+
+/**
+ * @brief Min, max, mean, last value and number of samples of every signal of a
+ *        decoder over tumbling or sliding time windows
+ *
+ * Time is divided into panes of Options::hop nanoseconds, aligned on multiples of
+ * the hop, and a window is made of the last Options::window / Options::hop panes.
+ * When the hop equals the window, the windows are tumbling (each sample belongs to
+ * one window); otherwise they are sliding (a window is emitted every hop).
+ *
+ * The state is a few contiguous arrays of (panes x signals) entries indexed by
+ * SignalHandle::index, allocated once from the decoder's signal count: adding a
+ * sample updates one entry and allocates nothing. When a sample (or advance())
+ * reaches the end of the current pane, the windows that ended are merged and given
+ * to the callback as compact SignalAggregate records, one per signal that has
+ * samples in the window. Empty windows are not emitted.
+ *
+ * Time is given by the timestamps of the samples. Samples older than the current
+ * pane are counted in the current pane. The aggregator is not thread-safe.
+ */
+class CPP_CAN_PARSER_EXPORT SignalAggregator {
+public:
+  struct CPP_CAN_PARSER_EXPORT Options {
+    /**
+     * @brief Default options: tumbling windows of 1 s
+     */
+    Options();
+
+    int64_t window; // Nanoseconds, rounded up to a multiple of the hop
+    int64_t hop;    // Nanoseconds between two windows, 0 means the window (tumbling windows)
+  };
+
+  /**
+   * @param start Start of the window (nanoseconds, included)
+   * @param end End of the window (nanoseconds, excluded)
+   * @param aggregates One record per signal with samples, by increasing SignalHandle::index.
+   *                   The records are only valid during the call.
+   */
+  using Callback = std::function<void(int64_t start, int64_t end, const SignalAggregate* aggregates,
+                                      std::size_t count)>;
+
+public:
+  /**
+   * @brief Creates an aggregator for all the signals of the decoder. The decoder
+   *        must outlive the aggregator.
+   * @throw std::invalid_argument if the window or the hop is not positive
+   */
+  SignalAggregator(const CANDecoder& decoder, const Callback& callback, const Options& options = Options());
+
+  /**
+   * @brief Adds a sample of a signal
+   * @param timestamp Nanoseconds (see LogFrame::timestamp)
+   */
+  void add(SignalHandle handle, double value, int64_t timestamp);
+
+  /**
+   * @brief Adds the decoded values of a frame (eg. from a DecodeStage callback).
+   *        NaN values (signals absent from multiplexed frames) are ignored.
+   * @param values The values of the signals, in the order of plan.signals
+   */
+  void add(const CANDecoder::FramePlan& plan, const double* values, int64_t timestamp);
+
+  /**
+   * @brief Looks the frame up, decodes it and adds the values of its signals
+   * @return false if the frame is unknown or is a remote or error frame
+   */
+  bool add(const LogFrame& frame);
+
+  /**
+   * @brief Emits the windows that end at or before the given time. On a live feed,
+   *        call it regularly so that windows are emitted even when no sample arrives.
+   * @param now Nanoseconds, in the time base of the timestamps
+   */
+  void advance(int64_t now);
+
+  /**
+   * @brief Emits all the windows that still hold samples (including the current,
+   *        partial one) and clears the aggregator
+   */
+  void flush();
+
+  /**
+   * @return The handle of a signal from its index (see SignalAggregate::signal)
+   */
+  SignalHandle handle(uint32_t index) const;
+
+  int64_t window() const;
+  int64_t hop() const;
+  const CANDecoder& decoder() const;
+
+private:
+  void start(int64_t timestamp);
+  void next_pane();
+  void emit();
+
+  const CANDecoder* decoder_;
+  Callback callback_;
+  int64_t hop_;
+  std::size_t panes_;
+  std::size_t signal_count_;
+
+  // (panes x signals) entries, pane-major
+  std::vector<uint32_t> counts_;
+  std::vector<double> mins_;
+  std::vector<double> maxs_;
+  std::vector<double> sums_;
+  std::vector<double> lasts_;
+
+  std::vector<uint64_t> pane_samples_; // Samples in each pane
+  std::size_t pane_;                   // Current pane
+  std::size_t offset_;                 // pane_ * signal_count_
+  int64_t end_;                        // End of the current pane, INT64_MIN before the first sample
+
+  std::vector<SignalAggregate> merged_;  // One per signal, reset after each window
+  std::vector<SignalAggregate> emitted_;
+  std::vector<uint32_t> frames_;         // Frame index of each signal
+  std::vector<double> decoded_;          // Sized for the largest frame of the decoder
+};
+
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef SIGNALSTATETABLE_H
+#define SIGNALSTATETABLE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "CANDecoder.h"
+#include "CANLogReader.h"
+#include "CANRing.h"
+#include "cpp_can_parser_export.h"
+
+namespace CppCAN {
+
+/**
+ * @brief Value of a signal and time of its last update
+ */
+struct CPP_CAN_PARSER_EXPORT SignalSample {
+  double value;
+  int64_t timestamp; // Nanoseconds (see LogFrame::timestamp), -1 if the signal was never received
+};
+
+/**
+ * @brief Latest value of every signal of a decoder, shared between one writer
+ *        thread and any number of reader threads
+ *
+ * The table is allocated once, with one entry per signal (indexed by SignalHandle)
+ * and one sequence counter (seqlock) per frame. The writer decodes each frame in
+ * place: it makes the sequence of the frame odd, stores the values and timestamps
+ * of the signals and makes the sequence even again. Readers copy the values and
+ * retry if the sequence was odd or changed meanwhile. The writer never waits for
+ * the readers and neither side takes a lock or allocates memory.
+ *
+ * A snapshot of a frame (see snapshot()) holds values that were all written by
+ * the same update. Multiplexed signals that are absent from a frame keep their
+ * previous value and timestamp.
+ */
+class CPP_CAN_PARSER_EXPORT SignalStateTable {
+public:
+  /**
+   * @brief Creates a table for all the signals of the decoder. The decoder must
+   *        outlive the table.
+   */
+  explicit SignalStateTable(const CANDecoder& decoder);
+
+  SignalStateTable(const SignalStateTable&) = delete;
+  SignalStateTable& operator=(const SignalStateTable&) = delete;
+
+  /**
+   * @brief Writer: decodes the frame and stores the values of its signals
+   * @param timestamp Nanoseconds (see LogFrame::timestamp)
+   */
+  void update(const CANDecoder::FramePlan& plan, const uint8_t* data, std::size_t len, int64_t timestamp);
+
+  /**
+   * @brief Writer: looks the frame up and decodes it
+   * @return false if the frame is unknown or is a remote or error frame
+   */
+  bool update(const LogFrame& frame);
+
+  /**
+   * @brief Reader: latest value of a signal
+   */
+  SignalSample get(SignalHandle handle) const;
+
+  /**
+   * @brief Reader: consistent copy of the latest values of the signals of a frame
+   * @param samples Filled with plan.signals.size() samples, in the plan's order
+   * @return The timestamp of the last update of the frame (-1 if it was never received)
+   */
+  int64_t snapshot(const CANDecoder::FramePlan& plan, SignalSample* samples) const;
+
+  /**
+   * @return The number of updates of the frame
+   */
+  uint64_t updates(const CANDecoder::FramePlan& plan) const;
+
+  const CANDecoder& decoder() const;
+
+private:
+  /**
+   * @brief Sequence counter and last update of a frame, alone on its cache line
+   */
+  struct alignas(CACHE_LINE_SIZE) FrameState {
+    FrameState() : sequence(0), timestamp(-1), updates(0) { }
+
+    std::atomic<uint64_t> sequence; // Odd while the frame is being written
+    std::atomic<int64_t> timestamp;
+    std::atomic<uint64_t> updates;
+  };
+
+  const CANDecoder* decoder_;
+  std::unique_ptr<FrameState[]> frames_;
+  std::unique_ptr<std::atomic<uint64_t>[]> values_; // Bits of the doubles
+  std::unique_ptr<std::atomic<int64_t>[]> timestamps_;
+  std::vector<double> decoded_; // Writer only, sized for the largest frame of the decoder
+};
+
+}
+
+#endif
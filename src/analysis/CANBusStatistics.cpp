@@ -0,0 +1,364 @@
+#include "CANBusStatistics.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace CppCAN;
+
+static const uint32_t DEFAULT_NOMINAL_BITRATE = 500000;
+static const uint32_t DEFAULT_DATA_BITRATE = 2000000;
+static const int64_t DEFAULT_WINDOW = 1000000000;
+static const std::size_t DEFAULT_BUCKETS = 10;
+
+static const double NANOSECONDS_PER_SECOND = 1e9;
+static const double MILLISECONDS_PER_SECOND = 1e3;
+static const uint32_t BITS_PER_KBIT = 1000;
+
+// CRC delimiter, ACK slot, ACK delimiter, end of frame and interframe space
+static const uint32_t FRAME_TRAILER_BITS = 1 + 2 + 7 + 3;
+
+// Stuff count field of CAN FD frames (3 bits in Gray code and a parity bit)
+static const uint32_t FD_STUFF_COUNT_BITS = 4;
+static const std::size_t FD_CRC17_MAX_LENGTH = 16;
+
+namespace {
+  /**
+   * @brief Bits of a frame between the start of frame and the CRC: counts the
+   *        stuff bits (a bit of opposite value after 5 identical bits) and
+   *        computes the CRC-15 of classic frames
+   */
+  class BitStream {
+  public:
+    BitStream() : bits(0), stuffed(0), crc(0), last_(2), run_(0) { }
+
+    void push(uint32_t value, unsigned count, bool in_crc = true) {
+      for(unsigned i = count; i-- > 0;)
+        push_bit((value >> i) & 1, in_crc);
+    }
+
+    uint32_t bits;
+    uint32_t stuffed;
+    uint32_t crc;
+
+  private:
+    void push_bit(unsigned bit, bool in_crc) {
+      bits++;
+      if(in_crc) {
+        unsigned next = bit ^ ((crc >> 14) & 1);
+        crc = (crc << 1) & 0x7FFF;
+        if(next)
+          crc ^= 0x4599;
+      }
+
+      if(bit == last_) {
+        run_++;
+      }
+      else {
+        last_ = bit;
+        run_ = 1;
+      }
+
+      // The stuff bit starts a new run
+      if(run_ == 5) {
+        stuffed++;
+        last_ = !bit;
+        run_ = 1;
+      }
+    }
+
+    unsigned last_;
+    unsigned run_;
+  };
+}
+
+CANBusStatistics::Options::Options()
+  : nominal_bitrate(0), data_bitrate(DEFAULT_DATA_BITRATE), stuffing(WorstCase), window(DEFAULT_WINDOW),
+    buckets(DEFAULT_BUCKETS) { }
+
+CANBusStatistics::Counters::Counters(std::size_t buckets)
+  : sum(), epochs(buckets, -1), slots(buckets, Load()) { }
+
+void CANBusStatistics::Counters::add(int64_t bucket, std::size_t slot, uint32_t bytes, uint32_t bits, int64_t time) {
+  sum.frames++;
+  sum.bytes += bytes;
+  sum.bits += bits;
+  sum.busy_time += time;
+
+  // A late frame whose bucket was already replaced by a newer one only counts
+  // in the totals
+  if(epochs[slot] > bucket)
+    return;
+
+  if(epochs[slot] < bucket) {
+    epochs[slot] = bucket;
+    slots[slot] = Load();
+  }
+
+  slots[slot].frames++;
+  slots[slot].bytes += bytes;
+  slots[slot].bits += bits;
+  slots[slot].busy_time += time;
+}
+
+CANBusStatistics::Load CANBusStatistics::Counters::total(int64_t duration) const {
+  Load result = sum;
+  result.load = duration > 0 ? static_cast<double>(result.busy_time) / duration : 0.;
+  return result;
+}
+
+CANBusStatistics::Load CANBusStatistics::Counters::window(int64_t current, int64_t duration) const {
+  Load result = Load();
+  int64_t oldest = current - static_cast<int64_t>(slots.size());
+
+  for(std::size_t i = 0; i < slots.size(); i++) {
+    if(epochs[i] > oldest && epochs[i] <= current) {
+      result.frames += slots[i].frames;
+      result.bytes += slots[i].bytes;
+      result.bits += slots[i].bits;
+      result.busy_time += slots[i].busy_time;
+    }
+  }
+
+  result.load = duration > 0 ? static_cast<double>(result.busy_time) / duration : 0.;
+  return result;
+}
+
+CANBusStatistics::Channel::Channel(std::size_t buckets)
+  : counters(buckets), errors(0), first_timestamp(-1) { }
+
+CANBusStatistics::Id::Id(std::size_t buckets, uint8_t channel, unsigned long long dbc_id, const CANFrame* frame)
+  : counters(buckets), channel(channel), dbc_id(dbc_id), frame(frame) { }
+
+CANBusStatistics::CANBusStatistics(const CANDatabase& database, const Options& options)
+  : database_(&database), options_(options), last_timestamp_(-1) {
+  if(options_.nominal_bitrate == 0)
+    options_.nominal_bitrate = database.bit_timing().baudrate * BITS_PER_KBIT;
+  if(options_.nominal_bitrate == 0)
+    options_.nominal_bitrate = DEFAULT_NOMINAL_BITRATE;
+  if(options_.data_bitrate == 0)
+    options_.data_bitrate = options_.nominal_bitrate;
+
+  options_.buckets = std::max<std::size_t>(options_.buckets, 1);
+  bucket_size_ = std::max<int64_t>(options_.window / static_cast<int64_t>(options_.buckets), 1);
+  options_.window = bucket_size_ * static_cast<int64_t>(options_.buckets);
+}
+
+CANBusStatistics::FrameBits CANBusStatistics::frame_bits(const LogFrame& frame, Stuffing stuffing) {
+  bool fd = frame.is_fd();
+  bool extended = frame.is_extended();
+  bool remote = !fd && (frame.flags & LogFrame::Remote);
+  uint32_t length = remote ? 0 : frame.length;
+  uint32_t dlc = fd ? CANFrame::length_to_dlc(length) : std::min<uint32_t>(frame.length, 15);
+  uint32_t id = frame.can_id;
+
+  BitStream stream;
+  stream.push(0, 1); // Start of frame
+  if(extended) {
+    stream.push(id >> 18, 11);
+    stream.push(3, 2); // SRR, IDE
+    stream.push(id & 0x3FFFF, 18);
+    stream.push(remote, 1); // RTR (RRS for CAN FD)
+    if(!fd)
+      stream.push(0, 2); // r1, r0
+  }
+  else {
+    stream.push(id & 0x7FF, 11);
+    stream.push(remote, 1); // RTR (RRS for CAN FD)
+    stream.push(0, fd ? 1 : 2); // IDE (and r0)
+  }
+
+  bool brs = fd && (frame.flags & LogFrame::BitRateSwitch);
+  if(fd) {
+    stream.push(2, 2); // FDF, res
+    stream.push(brs, 1);
+  }
+
+  // The data phase starts after the BRS bit
+  uint32_t arbitration_bits = stream.bits;
+  uint32_t arbitration_stuffed = stream.stuffed;
+
+  if(fd)
+    stream.push((frame.flags & LogFrame::ErrorStateIndicator) ? 1 : 0, 1);
+  stream.push(dlc, 4);
+  for(uint32_t i = 0; i < length; i++)
+    stream.push(frame.data[i], 8);
+
+  uint32_t fixed_bits = 0;
+  if(fd) {
+    // Stuff count and CRC, with a fixed stuff bit before and after every 4 bits
+    uint32_t crc_bits = length <= FD_CRC17_MAX_LENGTH ? 17 : 21;
+    fixed_bits = FD_STUFF_COUNT_BITS + crc_bits + 1 + (FD_STUFF_COUNT_BITS + crc_bits) / 4;
+  }
+  else {
+    stream.push(stream.crc, 15, false);
+  }
+
+  uint32_t dynamic_bits = stream.bits;
+  uint32_t stuffed = 0;
+  switch(stuffing) {
+  case NoStuffing:
+    arbitration_stuffed = 0;
+    break;
+  case WorstCase:
+    // Davis et al.: after the first bit, a stuff bit at most every 4 bits
+    stuffed = (dynamic_bits - 1) / 4;
+    arbitration_stuffed = (arbitration_bits - 1) / 4;
+    break;
+  case Exact:
+    stuffed = stream.stuffed;
+    break;
+  }
+
+  FrameBits result;
+  if(brs) {
+    result.nominal = arbitration_bits + arbitration_stuffed + FRAME_TRAILER_BITS;
+    result.data = dynamic_bits - arbitration_bits + stuffed - arbitration_stuffed + fixed_bits;
+  }
+  else {
+    result.nominal = dynamic_bits + stuffed + fixed_bits + FRAME_TRAILER_BITS;
+    result.data = 0;
+  }
+  return result;
+}
+
+int64_t CANBusStatistics::duration(const FrameBits& bits, uint32_t nominal_bitrate, uint32_t data_bitrate) {
+  double seconds = static_cast<double>(bits.nominal) / nominal_bitrate + static_cast<double>(bits.data) / data_bitrate;
+  return std::llround(seconds * NANOSECONDS_PER_SECOND);
+}
+
+int64_t CANBusStatistics::duration(const LogFrame& frame) const {
+  return duration(frame_bits(frame, options_.stuffing), options_.nominal_bitrate, options_.data_bitrate);
+}
+
+double CANBusStatistics::estimate(const CANDatabase& database, const Options& options) {
+  CANBusStatistics statistics(database, options);
+  double load = 0.;
+
+  for(const auto& entry : database) {
+    const CANFrame& frame = entry.second;
+    if(frame.period() == 0)
+      continue;
+
+    // CAN FD frames are assumed to switch to the data bitrate
+    LogFrame record = LogFrame();
+    record.can_id = static_cast<uint32_t>(frame.can_id());
+    record.length = static_cast<uint8_t>(frame.length());
+    record.flags = (frame.is_extended() ? LogFrame::Extended : 0) |
+                   (frame.is_fd() ? LogFrame::FD | LogFrame::BitRateSwitch : 0);
+
+    FrameBits bits = frame_bits(record, WorstCase);
+    int64_t time = duration(bits, statistics.options_.nominal_bitrate, statistics.options_.data_bitrate);
+    load += time / NANOSECONDS_PER_SECOND * (MILLISECONDS_PER_SECOND / frame.period());
+  }
+
+  return load;
+}
+
+CANBusStatistics::Channel& CANBusStatistics::channel(uint8_t channel) {
+  while(channels_.size() <= channel)
+    channels_.emplace_back(options_.buckets);
+  return channels_[channel];
+}
+
+const CANBusStatistics::Channel* CANBusStatistics::find_channel(uint8_t channel) const {
+  return channel < channels_.size() ? &channels_[channel] : nullptr;
+}
+
+void CANBusStatistics::add(const LogFrame& frame) {
+  Channel& stats = channel(frame.channel);
+  if(stats.first_timestamp < 0)
+    stats.first_timestamp = frame.timestamp;
+  last_timestamp_ = std::max(last_timestamp_, frame.timestamp);
+
+  if(frame.flags & LogFrame::ErrorFrame) {
+    stats.errors++;
+    return;
+  }
+
+  FrameBits bits = frame_bits(frame, options_.stuffing);
+  int64_t time = duration(bits, options_.nominal_bitrate, options_.data_bitrate);
+  uint32_t bytes = (frame.flags & LogFrame::Remote) ? 0 : frame.length;
+  int64_t bucket = std::max<int64_t>(frame.timestamp, 0) / bucket_size_;
+  std::size_t slot = static_cast<std::size_t>(bucket % static_cast<int64_t>(options_.buckets));
+
+  stats.counters.add(bucket, slot, bytes, bits.nominal + bits.data, time);
+
+  unsigned long long dbc_id = frame.dbc_id();
+  uint64_t key = (static_cast<uint64_t>(frame.channel) << 32) | dbc_id;
+  auto it = id_index_.find(key);
+  if(it == id_index_.end()) {
+    const CANFrame* known = database_->contains(dbc_id) ? &database_->at(dbc_id) : nullptr;
+    it = id_index_.emplace(key, static_cast<uint32_t>(ids_.size())).first;
+    ids_.emplace_back(options_.buckets, frame.channel, dbc_id, known);
+  }
+  ids_[it->second].counters.add(bucket, slot, bytes, bits.nominal + bits.data, time);
+}
+
+void CANBusStatistics::add(const LogFrame* frames, std::size_t count) {
+  for(std::size_t i = 0; i < count; i++)
+    add(frames[i]);
+}
+
+int64_t CANBusStatistics::window_duration(const Channel& channel) const {
+  // The current bucket is only partly elapsed
+  int64_t current_start = (std::max<int64_t>(last_timestamp_, 0) / bucket_size_) * bucket_size_;
+  int64_t duration = options_.window - bucket_size_ + (last_timestamp_ - current_start);
+  return std::min(duration, last_timestamp_ - channel.first_timestamp);
+}
+
+CANBusStatistics::Load CANBusStatistics::channel_load(uint8_t channel) const {
+  const Channel* stats = find_channel(channel);
+  if(stats == nullptr)
+    return Load();
+  return stats->counters.window(std::max<int64_t>(last_timestamp_, 0) / bucket_size_, window_duration(*stats));
+}
+
+CANBusStatistics::Load CANBusStatistics::channel_total(uint8_t channel) const {
+  const Channel* stats = find_channel(channel);
+  if(stats == nullptr)
+    return Load();
+  return stats->counters.total(last_timestamp_ - stats->first_timestamp);
+}
+
+uint64_t CANBusStatistics::errors(uint8_t channel) const {
+  const Channel* stats = find_channel(channel);
+  return stats != nullptr ? stats->errors : 0;
+}
+
+std::vector<CANBusStatistics::Talker> CANBusStatistics::top_talkers(std::size_t count, int channel) const {
+  int64_t current = std::max<int64_t>(last_timestamp_, 0) / bucket_size_;
+  std::vector<Talker> talkers;
+
+  for(const Id& id : ids_) {
+    if(channel >= 0 && id.channel != channel)
+      continue;
+
+    const Channel& stats = channels_[id.channel];
+    Talker talker;
+    talker.channel = id.channel;
+    talker.dbc_id = id.dbc_id;
+    talker.frame = id.frame;
+    talker.window = id.counters.window(current, window_duration(stats));
+    talker.total = id.counters.total(last_timestamp_ - stats.first_timestamp);
+    if(talker.window.frames > 0)
+      talkers.push_back(talker);
+  }
+
+  count = std::min(count, talkers.size());
+  std::partial_sort(talkers.begin(), talkers.begin() + count, talkers.end(), [](const Talker& a, const Talker& b) {
+    return a.window.busy_time != b.window.busy_time ? a.window.busy_time > b.window.busy_time : a.dbc_id < b.dbc_id;
+  });
+  talkers.resize(count);
+  return talkers;
+}
+
+std::size_t CANBusStatistics::id_count() const {
+  return ids_.size();
+}
+
+uint32_t CANBusStatistics::nominal_bitrate() const {
+  return options_.nominal_bitrate;
+}
+
+uint32_t CANBusStatistics::data_bitrate() const {
+  return options_.data_bitrate;
+}
@@ -14,7 +14,7 @@ using namespace CppCAN;
  * lr_end_bit: End bit position in the byte (excluded)
  */
 struct SignalRange {
-    uint8_t byte;
+    unsigned byte;
     char lr_start_bit;
     char lr_end_bit;
 };
@@ -63,7 +63,7 @@ SignalRanges big_endian_ranges(const CANSignal& src) {
         char rbit = std::max<char>(-1, lbit - bitsLeft);
 
         // The static_cast are not "necessary" but it removes some warnings
-        result.push_back({ static_cast<uint8_t>(current_byte), 
+        result.push_back({ static_cast<unsigned>(current_byte), 
                            lbit, rbit });
         
         bitsLeft -= lbit - rbit;
@@ -93,7 +93,7 @@ SignalRanges little_endian_ranges(const CANSignal& src) {
         char rbit = std::min<char>(lbit + bitsLeft, 8);
 
         // The static_cast are not "necessary" but it removes some warnings
-        result.push_back({ static_cast<uint8_t>(current_byte), 
+        result.push_back({ static_cast<unsigned>(current_byte), 
                            lbit, rbit });
 
         bitsLeft -= rbit - lbit;
@@ -123,7 +123,30 @@ std::vector<SignalLayoutEntry> compute_layout(const CANFrame& src) {
     return result;
 }
 
+/**
+ * Two multiplexed signals that depend on the same switch but on disjoint
+ * sets of values are never present together in a frame.
+ */
+static bool
+mutually_exclusive(const CANSignal& s1, const CANSignal& s2) {
+  if(!s1.is_multiplexed() || !s2.is_multiplexed() ||
+     s1.multiplexer_switch() != s2.multiplexer_switch())
+    return false;
+
+  for(const auto& r1 : s1.multiplexer_ranges()) {
+    for(const auto& r2 : s2.multiplexer_ranges()) {
+      if(r1.min <= r2.max && r2.min <= r1.max)
+        return false;
+    }
+  }
+
+  return true;
+}
+
 bool overlap(const SignalLayoutEntry& e1, const SignalLayoutEntry& e2) {
+  if(mutually_exclusive(*e1.src_signal, *e2.src_signal))
+    return false;
+
   for(const SignalRange& r1 : e1.ranges) {
     for(const SignalRange& r2: e2.ranges) {
       // Find if r2 shares a SignalRange with the same byte with r1 
@@ -148,10 +171,31 @@ bool overlap(const SignalLayoutEntry& e1, const SignalLayoutEntry& e2) {
   return false;
 }
 
+/**
+ * A signal cannot use bytes beyond the payload of the frame. Frames whose
+ * DLC is 0 are not checked (the DLC is unknown in some DBC files).
+ */
+static bool
+exceeds_payload(const SignalLayoutEntry& e, const CANFrame& frame) {
+  unsigned length = std::min(frame.length(), CANFrame::MAX_PAYLOAD_LENGTH);
+  if(frame.dlc() == 0)
+    return false;
+
+  for(const SignalRange& r : e.ranges) {
+    if(r.byte >= length)
+      return true;
+  }
+
+  return false;
+}
+
 bool CppCAN::analysis::is_frame_layout_ok(const CANFrame& src) {
     auto layout = compute_layout(src);
 
     for(size_t i = 0; i < layout.size(); i++) {
+        if(exceeds_payload(layout[i], src))
+            return false;
+
         for(size_t j = i + 1; j < layout.size(); j++) {
             if(overlap(layout[i], layout[j])) {
                 return false;            
@@ -175,6 +219,9 @@ bool CppCAN::analysis::is_frame_layout_ok(const CANFrame& src, std::vector<std::
     };
 
     for(size_t i = 0; i < layout.size(); i++) {
+        if(exceeds_payload(layout[i], src))
+            report_issue(i, *layout[i].src_signal);
+
         for(size_t j = i + 1; j < layout.size(); j++) {
             if(overlap(layout[i], layout[j])) {
                 report_issue(i, *layout[i].src_signal);
@@ -0,0 +1,158 @@
+#include "CANPeriodMonitor.h"
+#include "TimerWheel.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace CppCAN;
+
+static const int64_t NANOSECONDS_PER_MILLISECOND = 1000000;
+static const std::size_t STANDARD_ID_COUNT = 2048;
+
+static const int64_t DEFAULT_RESOLUTION = NANOSECONDS_PER_MILLISECOND;
+static const double DEFAULT_TOLERANCE = 0.1;
+static const double DEFAULT_TIMEOUT_RATIO = 3.;
+
+const std::size_t CANPeriodMonitor::HISTOGRAM_BINS;
+const std::size_t CANPeriodMonitor::BINS_PER_PERIOD;
+const uint32_t CANPeriodMonitor::NOT_MONITORED;
+
+CANPeriodMonitor::Options::Options()
+  : resolution(DEFAULT_RESOLUTION), tolerance(DEFAULT_TOLERANCE), timeout_ratio(DEFAULT_TIMEOUT_RATIO) { }
+
+CANPeriodMonitor::CANPeriodMonitor(const CANDatabase& database, const Callback& callback, const Options& options)
+  : callback_(callback), options_(options), standard_ids_(STANDARD_ID_COUNT, NOT_MONITORED), now_(-1) {
+  options_.resolution = std::max<int64_t>(options_.resolution, 1);
+  options_.timeout_ratio = std::max(options_.timeout_ratio, 1.);
+
+  for(const auto& entry : database) {
+    const CANFrame& frame = entry.second;
+    if(frame.period() == 0)
+      continue;
+
+    FrameStats stats = FrameStats();
+    stats.frame = &frame;
+    stats.period = static_cast<int64_t>(frame.period()) * NANOSECONDS_PER_MILLISECOND;
+    stats.last_timestamp = -1;
+
+    uint32_t index = static_cast<uint32_t>(frames_.size());
+    if(!frame.is_extended() && frame.can_id() < STANDARD_ID_COUNT)
+      standard_ids_[frame.can_id()] = index;
+    else
+      extended_ids_[frame.dbc_id()] = index;
+    frames_.push_back(stats);
+  }
+
+  deadlines_.resize(frames_.size(), 0);
+  wheel_.reset(new details::TimerWheel(frames_.size()));
+}
+
+CANPeriodMonitor::~CANPeriodMonitor() { }
+
+uint32_t CANPeriodMonitor::find(unsigned long long dbc_id) const {
+  if(dbc_id < STANDARD_ID_COUNT)
+    return standard_ids_[dbc_id];
+
+  auto it = extended_ids_.find(dbc_id);
+  return it != extended_ids_.end() ? it->second : NOT_MONITORED;
+}
+
+bool CANPeriodMonitor::receive(const LogFrame& frame) {
+  if(frame.flags & (LogFrame::Remote | LogFrame::ErrorFrame))
+    return false;
+  return receive(frame.dbc_id(), frame.timestamp);
+}
+
+bool CANPeriodMonitor::receive(unsigned long long dbc_id, int64_t timestamp) {
+  advance(timestamp);
+
+  uint32_t index = find(dbc_id);
+  if(index == NOT_MONITORED)
+    return false;
+
+  FrameStats& stats = frames_[index];
+  if(stats.last_timestamp >= 0) {
+    int64_t interval = timestamp - stats.last_timestamp;
+
+    if(stats.missing) {
+      stats.missing = false;
+      report(Recovered, index, timestamp, interval);
+    }
+    else if(interval < stats.period * (1. - options_.tolerance)) {
+      stats.early++;
+      report(Early, index, timestamp, interval);
+    }
+    else if(interval > stats.period * (1. + options_.tolerance)) {
+      stats.late++;
+      report(Late, index, timestamp, interval);
+    }
+
+    int64_t bin = std::max<int64_t>(interval, 0) / (stats.period / static_cast<int64_t>(BINS_PER_PERIOD));
+    stats.histogram[std::min<int64_t>(bin, HISTOGRAM_BINS - 1)]++;
+    stats.min_interval = stats.received > 1 ? std::min(stats.min_interval, interval) : interval;
+    stats.max_interval = stats.received > 1 ? std::max(stats.max_interval, interval) : interval;
+  }
+
+  stats.last_timestamp = timestamp;
+  stats.received++;
+  arm(index);
+  return true;
+}
+
+void CANPeriodMonitor::start(int64_t now) {
+  now_ = now;
+  wheel_->reset(static_cast<uint64_t>(std::max<int64_t>(now, 0) / options_.resolution));
+}
+
+void CANPeriodMonitor::advance(int64_t now) {
+  if(now_ < 0)
+    start(now);
+  if(now <= now_)
+    return;
+
+  now_ = now;
+  uint64_t tick = static_cast<uint64_t>(std::max<int64_t>(now, 0) / options_.resolution);
+  wheel_->advance(tick, [this](uint32_t index) { expire(index); });
+}
+
+void CANPeriodMonitor::arm(uint32_t index) {
+  const FrameStats& stats = frames_[index];
+  int64_t deadline = stats.last_timestamp + std::llround(stats.period * options_.timeout_ratio);
+  deadlines_[index] = deadline;
+
+  // The timer expires on the first tick that is not before the deadline
+  int64_t tick = (std::max<int64_t>(deadline, 0) + options_.resolution - 1) / options_.resolution;
+  wheel_->schedule(index, static_cast<uint64_t>(tick));
+}
+
+void CANPeriodMonitor::expire(uint32_t index) {
+  FrameStats& stats = frames_[index];
+  stats.missing = true;
+  stats.timeouts++;
+  report(Timeout, index, deadlines_[index], deadlines_[index] - stats.last_timestamp);
+}
+
+void CANPeriodMonitor::report(EventType type, uint32_t index, int64_t timestamp, int64_t interval) {
+  if(!callback_)
+    return;
+
+  Event event;
+  event.type = type;
+  event.frame = frames_[index].frame;
+  event.timestamp = timestamp;
+  event.interval = interval;
+  callback_(event);
+}
+
+const CANPeriodMonitor::FrameStats* CANPeriodMonitor::stats(unsigned long long dbc_id) const {
+  uint32_t index = find(dbc_id);
+  return index != NOT_MONITORED ? &frames_[index] : nullptr;
+}
+
+const std::vector<CANPeriodMonitor::FrameStats>& CANPeriodMonitor::frames() const {
+  return frames_;
+}
+
+int64_t CANPeriodMonitor::now() const {
+  return now_;
+}
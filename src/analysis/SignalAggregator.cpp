@@ -0,0 +1,228 @@
+#include "SignalAggregator.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+using namespace CppCAN;
+
+static const int64_t DEFAULT_WINDOW = 1000000000; // 1 s
+static const int64_t DEFAULT_HOP = 0;
+
+static const int64_t NOT_STARTED = std::numeric_limits<int64_t>::min();
+
+/**
+ * @return The start of the pane of a timestamp (timestamps can be negative)
+ */
+static int64_t pane_start(int64_t timestamp, int64_t hop) {
+  int64_t quotient = timestamp / hop;
+  if(timestamp % hop < 0)
+    quotient--;
+  return quotient * hop;
+}
+
+SignalAggregator::Options::Options()
+  : window(DEFAULT_WINDOW), hop(DEFAULT_HOP) { }
+
+SignalAggregator::SignalAggregator(const CANDecoder& decoder, const Callback& callback, const Options& options)
+  : decoder_(&decoder), callback_(callback), hop_(options.hop > 0 ? options.hop : options.window),
+    panes_(0), signal_count_(decoder.signal_count()), pane_(0), offset_(0), end_(NOT_STARTED) {
+  if(options.window <= 0 || options.hop < 0)
+    throw std::invalid_argument("The window and the hop of a SignalAggregator must be positive");
+
+  panes_ = static_cast<std::size_t>((options.window + hop_ - 1) / hop_);
+
+  std::size_t entries = panes_ * signal_count_;
+  counts_.resize(entries, 0);
+  mins_.resize(entries);
+  maxs_.resize(entries);
+  sums_.resize(entries);
+  lasts_.resize(entries);
+  pane_samples_.resize(panes_, 0);
+
+  merged_.resize(signal_count_, SignalAggregate());
+  emitted_.reserve(signal_count_);
+
+  frames_.resize(signal_count_);
+  std::size_t largest = 0;
+  for(const CANDecoder::FramePlan& plan : decoder.frames()) {
+    std::fill(frames_.begin() + plan.first_signal, frames_.begin() + plan.first_signal + plan.signals.size(),
+              static_cast<uint32_t>(plan.index));
+    largest = std::max(largest, plan.signals.size());
+  }
+  decoded_.resize(largest);
+}
+
+void SignalAggregator::add(SignalHandle handle, double value, int64_t timestamp) {
+  if(timestamp >= end_)
+    advance(timestamp);
+
+  std::size_t i = offset_ + handle.index;
+  if(counts_[i] == 0) {
+    mins_[i] = maxs_[i] = sums_[i] = value;
+  }
+  else {
+    mins_[i] = std::min(mins_[i], value);
+    maxs_[i] = std::max(maxs_[i], value);
+    sums_[i] += value;
+  }
+  counts_[i]++;
+  lasts_[i] = value;
+  pane_samples_[pane_]++;
+}
+
+void SignalAggregator::add(const CANDecoder::FramePlan& plan, const double* values, int64_t timestamp) {
+  if(timestamp >= end_)
+    advance(timestamp);
+
+  std::size_t base = offset_ + plan.first_signal;
+  std::size_t added = 0;
+  for(std::size_t s = 0; s < plan.signals.size(); s++) {
+    double value = values[s];
+    if(std::isnan(value))
+      continue;
+
+    std::size_t i = base + s;
+    if(counts_[i] == 0) {
+      mins_[i] = maxs_[i] = sums_[i] = value;
+    }
+    else {
+      mins_[i] = std::min(mins_[i], value);
+      maxs_[i] = std::max(maxs_[i], value);
+      sums_[i] += value;
+    }
+    counts_[i]++;
+    lasts_[i] = value;
+    added++;
+  }
+  pane_samples_[pane_] += added;
+}
+
+bool SignalAggregator::add(const LogFrame& frame) {
+  if(frame.flags & (LogFrame::Remote | LogFrame::ErrorFrame))
+    return false;
+
+  const CANDecoder::FramePlan* plan = decoder_->find(frame.can_id, frame.is_extended());
+  if(plan == nullptr)
+    return false;
+
+  std::fill(decoded_.begin(), decoded_.begin() + plan->signals.size(), std::numeric_limits<double>::quiet_NaN());
+  decoder_->decode(*plan, frame.data, frame.length, decoded_.data());
+  add(*plan, decoded_.data(), frame.timestamp);
+  return true;
+}
+
+void SignalAggregator::start(int64_t timestamp) {
+  pane_ = 0;
+  offset_ = 0;
+  end_ = pane_start(timestamp, hop_) + hop_;
+}
+
+void SignalAggregator::advance(int64_t now) {
+  if(end_ == NOT_STARTED) {
+    start(now);
+    return;
+  }
+
+  while(now >= end_) {
+    emit();
+    next_pane();
+
+    // Skips the windows that would be empty
+    bool empty = std::all_of(pane_samples_.begin(), pane_samples_.end(), [](uint64_t n) { return n == 0; });
+    if(empty && now >= end_)
+      end_ = pane_start(now, hop_) + hop_;
+  }
+}
+
+void SignalAggregator::flush() {
+  if(end_ == NOT_STARTED)
+    return;
+
+  // The current pane is the oldest one of the last window that contains it
+  advance(end_ + static_cast<int64_t>(panes_ - 1) * hop_);
+
+  std::fill(counts_.begin(), counts_.end(), 0);
+  std::fill(pane_samples_.begin(), pane_samples_.end(), 0);
+  end_ = NOT_STARTED;
+}
+
+void SignalAggregator::next_pane() {
+  pane_ = (pane_ + 1) % panes_;
+  offset_ = pane_ * signal_count_;
+  if(pane_samples_[pane_] != 0) {
+    std::fill(counts_.begin() + offset_, counts_.begin() + offset_ + signal_count_, 0);
+    pane_samples_[pane_] = 0;
+  }
+  end_ += hop_;
+}
+
+void SignalAggregator::emit() {
+  bool empty = std::all_of(pane_samples_.begin(), pane_samples_.end(), [](uint64_t n) { return n == 0; });
+  if(empty)
+    return;
+
+  // Panes from the oldest to the current one, so that the last value of the newest pane wins
+  for(std::size_t k = 1; k <= panes_; k++) {
+    std::size_t pane = (pane_ + k) % panes_;
+    if(pane_samples_[pane] == 0)
+      continue;
+
+    std::size_t base = pane * signal_count_;
+    for(std::size_t s = 0; s < signal_count_; s++) {
+      std::size_t i = base + s;
+      uint32_t count = counts_[i];
+      if(count == 0)
+        continue;
+
+      SignalAggregate& merged = merged_[s];
+      if(merged.count == 0) {
+        merged.min = mins_[i];
+        merged.max = maxs_[i];
+        merged.mean = sums_[i];
+      }
+      else {
+        merged.min = std::min(merged.min, mins_[i]);
+        merged.max = std::max(merged.max, maxs_[i]);
+        merged.mean += sums_[i];
+      }
+      merged.count += count;
+      merged.last = lasts_[i];
+    }
+  }
+
+  emitted_.clear();
+  for(std::size_t s = 0; s < signal_count_; s++) {
+    SignalAggregate& merged = merged_[s];
+    if(merged.count == 0)
+      continue;
+
+    merged.signal = static_cast<uint32_t>(s);
+    merged.mean /= merged.count;
+    emitted_.push_back(merged);
+    merged.count = 0;
+  }
+
+  if(callback_)
+    callback_(end_ - static_cast<int64_t>(panes_) * hop_, end_, emitted_.data(), emitted_.size());
+}
+
+SignalHandle SignalAggregator::handle(uint32_t index) const {
+  if(index >= signal_count_)
+    return SignalHandle();
+
+  const CANDecoder::FramePlan& plan = decoder_->frames()[frames_[index]];
+  return SignalHandle(frames_[index], index - plan.first_signal, index);
+}
+
+int64_t SignalAggregator::window() const {
+  return static_cast<int64_t>(panes_) * hop_;
+}
+
+int64_t SignalAggregator::hop() const {
+  return hop_;
+}
+
+const CANDecoder& SignalAggregator::decoder() const {
+  return *decoder_;
+}
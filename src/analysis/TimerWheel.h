@@ -0,0 +1,169 @@
+#ifndef TimerWheel_H
+#define TimerWheel_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace CppCAN {
+namespace details {
+
+/**
+ * @brief Hierarchical timer wheel (Varghese and Lauck) with a fixed set of timers
+ *
+ * Time is counted in ticks. Level 0 has one slot per tick for the next 256 ticks,
+ * level 1 one slot per 256 ticks for the next 65536 ticks and so on. Timers are
+ * stored in intrusive doubly-linked lists: scheduling and cancelling a timer are
+ * O(1), and a timer is moved down (cascaded) at most once per level before it
+ * expires.
+ */
+class TimerWheel {
+public:
+  static constexpr unsigned LEVELS = 4;
+  static constexpr unsigned SLOT_BITS = 8;
+  static constexpr unsigned SLOTS = 1 << SLOT_BITS;
+
+  /**
+   * @param timers Number of timers (identified by 0 to timers - 1)
+   */
+  explicit TimerWheel(std::size_t timers)
+    : timers_(timers), heads_(LEVELS * SLOTS, NONE), current_(0), armed_(0) { }
+
+  /**
+   * @brief Sets the current tick (without expiring anything)
+   */
+  void reset(uint64_t tick) {
+    current_ = tick;
+  }
+
+  uint64_t current() const {
+    return current_;
+  }
+
+  bool armed(uint32_t timer) const {
+    return timers_[timer].slot != NONE;
+  }
+
+  /**
+   * @brief (Re)schedules a timer. Timers that are already due expire on the next tick.
+   */
+  void schedule(uint32_t timer, uint64_t tick) {
+    cancel(timer);
+    timers_[timer].expires = tick;
+    link(timer, current_ + 1);
+    armed_++;
+  }
+
+  void cancel(uint32_t timer) {
+    if(!armed(timer))
+      return;
+
+    unlink(timer);
+    armed_--;
+  }
+
+  /**
+   * @brief Moves the wheel up to the given tick and calls expired(timer) for each
+   *        timer that expires on the way. The function can schedule timers.
+   */
+  template<typename Expired>
+  void advance(uint64_t tick, Expired&& expired) {
+    while(current_ < tick) {
+      if(armed_ == 0) {
+        current_ = tick;
+        break;
+      }
+
+      current_++;
+      cascade();
+
+      uint32_t slot = current_ & (SLOTS - 1);
+      while(heads_[slot] != NONE) {
+        uint32_t timer = heads_[slot];
+        unlink(timer);
+        armed_--;
+        expired(timer);
+      }
+    }
+  }
+
+private:
+  static constexpr uint32_t NONE = 0xFFFFFFFF;
+
+  struct Timer {
+    Timer() : expires(0), prev(NONE), next(NONE), slot(NONE) { }
+
+    uint64_t expires;
+    uint32_t prev;
+    uint32_t next;
+    uint32_t slot; // level * SLOTS + index, NONE if the timer is not armed
+  };
+
+  /**
+   * @brief Moves the timers of the higher levels whose slot starts at the current tick
+   */
+  void cascade() {
+    for(unsigned level = 1; level < LEVELS; level++) {
+      if(current_ & ((uint64_t(1) << (level * SLOT_BITS)) - 1))
+        break;
+
+      uint32_t slot = level * SLOTS + ((current_ >> (level * SLOT_BITS)) & (SLOTS - 1));
+      uint32_t timer = heads_[slot];
+      heads_[slot] = NONE;
+      while(timer != NONE) {
+        uint32_t next = timers_[timer].next;
+        timers_[timer].slot = NONE;
+        link(timer, current_);
+        timer = next;
+      }
+    }
+  }
+
+  /**
+   * @param first First tick that will still be processed
+   */
+  void link(uint32_t timer, uint64_t first) {
+    Timer& entry = timers_[timer];
+    uint64_t tick = entry.expires > first ? entry.expires : first;
+    uint64_t delta = tick - current_;
+
+    unsigned level = 0;
+    while(level + 1 < LEVELS && delta >= (uint64_t(1) << ((level + 1) * SLOT_BITS)))
+      level++;
+
+    // Beyond the last level, the timer waits in the farthest slot and is cascaded again
+    uint64_t range = uint64_t(1) << (LEVELS * SLOT_BITS);
+    if(delta >= range)
+      tick = current_ + range - 1;
+
+    uint32_t slot = level * SLOTS + ((tick >> (level * SLOT_BITS)) & (SLOTS - 1));
+    entry.slot = slot;
+    entry.prev = NONE;
+    entry.next = heads_[slot];
+    if(entry.next != NONE)
+      timers_[entry.next].prev = timer;
+    heads_[slot] = timer;
+  }
+
+  void unlink(uint32_t timer) {
+    Timer& entry = timers_[timer];
+    if(entry.prev != NONE)
+      timers_[entry.prev].next = entry.next;
+    else
+      heads_[entry.slot] = entry.next;
+    if(entry.next != NONE)
+      timers_[entry.next].prev = entry.prev;
+
+    entry.prev = entry.next = entry.slot = NONE;
+  }
+
+  std::vector<Timer> timers_;
+  std::vector<uint32_t> heads_;
+  uint64_t current_;
+  std::size_t armed_;
+};
+
+}
+}
+
+#endif
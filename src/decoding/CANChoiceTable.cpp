@@ -0,0 +1,115 @@
+#include "CANChoiceTable.h"
+#include <functional>
+
+using namespace CppCAN;
+
+// A table is dense if it wastes at most half of its entries (small tables
+// are always dense as long as they do not exceed this number of holes)
+static const std::size_t MAX_DENSE_HOLES = 16;
+
+// Upper bound of the dense tables' size, whatever the density is
+static const std::size_t MAX_DENSE_SIZE = 1 << 16;
+
+const uint32_t CANChoiceTable::NO_ENTRY;
+
+static std::size_t
+hash_label(std::string_view label) {
+  return std::hash<std::string_view>()(label);
+}
+
+CANChoiceTable::CANChoiceTable()
+  : base_(0), dense_(true), size_(0) { }
+
+CANChoiceTable::CANChoiceTable(const std::map<unsigned int, std::string>& choices)
+  : base_(0), dense_(true), size_(choices.size()) {
+  if(choices.empty())
+    return;
+
+  std::size_t text_size = 0;
+  for(const auto& choice : choices)
+    text_size += choice.second.size();
+  text_.reserve(text_size);
+
+  base_ = choices.begin()->first;
+  std::size_t span = static_cast<std::size_t>(choices.rbegin()->first - base_) + 1;
+  dense_ = span <= MAX_DENSE_SIZE && span <= 2 * choices.size() + MAX_DENSE_HOLES;
+
+  if(dense_)
+    entries_.assign(span, { NO_ENTRY, 0 });
+  else
+    values_.reserve(choices.size());
+
+  for(const auto& choice : choices) {
+    Entry entry = { static_cast<uint32_t>(text_.size()), static_cast<uint32_t>(choice.second.size()) };
+    text_ += choice.second;
+
+    if(dense_) {
+      entries_[choice.first - base_] = entry;
+    }
+    else {
+      values_.push_back(choice.first);
+      entries_.push_back(entry);
+    }
+  }
+
+  // Power of two capacity with a load factor of at most 0.5
+  std::size_t capacity = 2;
+  while(capacity < 2 * size_)
+    capacity *= 2;
+  index_.assign(capacity, NO_ENTRY);
+
+  // The entries are visited by increasing value: the first value of
+  // a label is kept in the index
+  for(std::size_t i = 0; i < entries_.size(); i++) {
+    if(entries_[i].offset == NO_ENTRY)
+      continue;
+
+    std::string_view label = view(entries_[i]);
+    std::size_t slot = hash_label(label) & (capacity - 1);
+    bool duplicate = false;
+
+    while(index_[slot] != NO_ENTRY && !duplicate) {
+      duplicate = view(entries_[index_[slot]]) == label;
+      slot = (slot + 1) & (capacity - 1);
+    }
+
+    if(!duplicate)
+      index_[slot] = static_cast<uint32_t>(i);
+  }
+}
+
+std::size_t CANChoiceTable::size() const {
+  return size_;
+}
+
+bool CANChoiceTable::empty() const {
+  return size_ == 0;
+}
+
+bool CANChoiceTable::is_dense() const {
+  return dense_;
+}
+
+unsigned int CANChoiceTable::value_at(std::size_t i) const {
+  return dense_ ? base_ + static_cast<unsigned int>(i) : values_[i];
+}
+
+bool CANChoiceTable::find(std::string_view label, unsigned int& value) const {
+  if(index_.empty())
+    return false;
+
+  std::size_t mask = index_.size() - 1;
+  for(std::size_t slot = hash_label(label) & mask; index_[slot] != NO_ENTRY; slot = (slot + 1) & mask) {
+    if(view(entries_[index_[slot]]) == label) {
+      value = value_at(index_[slot]);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+std::size_t CANChoiceTable::memory() const {
+  return text_.capacity() + entries_.capacity() * sizeof(Entry) +
+         values_.capacity() * sizeof(unsigned int) + index_.capacity() * sizeof(uint32_t);
+}
@@ -0,0 +1,801 @@
+#include "CANDecoder.h"
+#include "ChoicesHash.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+using namespace CppCAN;
+
+static_assert(sizeof(CANDecoder::PackedSignal) == 24, "CANDecoder::PackedSignal must stay packed");
+
+// Maximum number of decimal digits that we look for when classifying
+// a scale/offset pair as a decimal (RationalScale) one.
+static const int MAX_DECIMAL_DIGITS = 9;
+
+static const int64_t POW10[] = {
+  1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL,
+  100000000LL, 1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL,
+  10000000000000LL, 100000000000000LL, 1000000000000000LL, 10000000000000000LL,
+  100000000000000000LL, 1000000000000000000LL
+};
+
+static const int POW10_SIZE = sizeof(POW10) / sizeof(POW10[0]);
+
+static const unsigned PAYLOAD_BITS = CANFrame::MAX_PAYLOAD_LENGTH * 8;
+
+// Hard limit of the lookup tables' size, whatever the options are (2^24 entries)
+static const unsigned MAX_LUT_BITS = 24;
+
+// Multiplexor jump tables are indexed directly by the switch's value when
+// all the values of the table are below this limit
+static const uint64_t MAX_DENSE_MUX_VALUE = 1024;
+
+/**
+ * Checks if value * 10^digits is an integer (up to the precision of the
+ * textual representation found in DBC files) and stores it in mantissa.
+ */
+static bool
+to_mantissa(double value, int digits, int64_t& mantissa) {
+  double scaled = value * static_cast<double>(POW10[digits]);
+
+  // Beyond 2^53, doubles cannot represent all the integers
+  if(std::fabs(scaled) > 9007199254740992.0)
+    return false;
+
+  double rounded = std::round(scaled);
+  if(std::fabs(scaled - rounded) > 1e-12 * std::max(1.0, std::fabs(scaled)))
+    return false;
+
+  mantissa = static_cast<int64_t>(rounded);
+  return true;
+}
+
+/**
+ * Pool of lookup tables shared by the plans of a decoder. The tables are
+ * deduplicated: two signals with the same length, signedness, scale and offset
+ * share the same value table and two signals with the same choices share the
+ * same choice table (and the same label table if they have the same length).
+ */
+class CANDecoder::LookupTables {
+public:
+  using ValueKey = std::tuple<unsigned, bool, double, double>;
+  using LabelKey = std::tuple<unsigned, bool, const CANChoiceTable*>;
+
+  LookupTables(std::size_t memory_limit)
+    : memory_limit_(memory_limit), memory_(0) { }
+
+  const CANChoiceTable* choices(const CANSignal& signal) {
+    const auto& choices = signal.choices();
+    if(choices.size() == 0)
+      return nullptr;
+
+    // The signals of a parsed database share their choices (see CANDatabase::internChoices())
+    auto shared = shared_choices_.find(&choices);
+    if(shared != shared_choices_.end())
+      return shared->second;
+
+    // Only the choices with the same hash are compared
+    const CANChoiceTable* result = nullptr;
+    std::size_t hash = details::hash_choices(choices);
+    auto range = choice_index_.equal_range(hash);
+    for(auto ite = range.first; ite != range.second && result == nullptr; ++ite) {
+      if(ite->second.first->choices() == choices)
+        result = ite->second.second;
+    }
+
+    if(result == nullptr) {
+      choice_tables_.emplace_back(choices);
+      result = &choice_tables_.back();
+      choice_index_.insert(std::make_pair(hash, std::make_pair(&signal, result)));
+    }
+
+    shared_choices_.insert(std::make_pair(&choices, result));
+    return result;
+  }
+
+  std::size_t choice_count() const {
+    return choice_tables_.size();
+  }
+
+  const double* values(const SignalPlan& plan) {
+    ValueKey key(plan.length, plan.is_signed, plan.scale, plan.offset);
+    auto ite = value_index_.find(key);
+    if(ite != value_index_.end())
+      return ite->second;
+
+    std::size_t size = std::size_t(1) << plan.length;
+    if(!reserve(size * sizeof(double)))
+      return nullptr;
+
+    // std::deque never moves its elements so the pointers stay valid
+    values_.emplace_back(size);
+    std::vector<double>& table = values_.back();
+    for(uint64_t bits = 0; bits < size; bits++) {
+      int64_t raw = static_cast<int64_t>(bits);
+      if(plan.is_signed && (bits >> (plan.length - 1)) != 0)
+        raw -= static_cast<int64_t>(size);
+
+      table[bits] = plan.physical(raw);
+    }
+
+    value_index_.insert(std::make_pair(key, table.data()));
+    return table.data();
+  }
+
+  const std::string_view* labels(const SignalPlan& plan) {
+    if(plan.choices == nullptr)
+      return nullptr;
+
+    // The choice tables are already deduplicated
+    LabelKey key(plan.length, plan.is_signed, plan.choices);
+    auto ite = label_index_.find(key);
+    if(ite != label_index_.end())
+      return ite->second;
+
+    std::size_t size = std::size_t(1) << plan.length;
+    if(!reserve(size * sizeof(std::string_view)))
+      return nullptr;
+
+    labels_.emplace_back(size);
+    std::vector<std::string_view>& table = labels_.back();
+    for(const auto& choice : plan.signal->choices()) {
+      // Choices that do not fit in the signal would alias other entries
+      int64_t raw;
+      if(plan.choice_raw(choice.first, raw))
+        table[static_cast<uint64_t>(raw) & plan.mask] = plan.choices->label(choice.first);
+    }
+
+    label_index_.insert(std::make_pair(key, table.data()));
+    return table.data();
+  }
+
+  std::size_t count() const {
+    return values_.size() + labels_.size();
+  }
+
+  std::size_t memory() const {
+    return memory_;
+  }
+
+private:
+  bool reserve(std::size_t bytes) {
+    if(memory_ + bytes > memory_limit_)
+      return false;
+
+    memory_ += bytes;
+    return true;
+  }
+
+  std::size_t memory_limit_;
+  std::size_t memory_;
+
+  std::deque<std::vector<double>> values_;
+  std::deque<std::vector<std::string_view>> labels_;
+  std::deque<CANChoiceTable> choice_tables_;
+  std::map<ValueKey, const double*> value_index_;
+  std::map<LabelKey, const std::string_view*> label_index_;
+  std::unordered_multimap<std::size_t, std::pair<const CANSignal*, const CANChoiceTable*>> choice_index_;
+  std::unordered_map<const CANSignal::choices_type*, const CANChoiceTable*> shared_choices_;
+};
+
+CANDecoder::Options::Options()
+  : build_luts(false), lut_max_bits(8), lut_memory_limit(1 << 20) { }
+
+static std::string
+signal_error(const CANSignal& signal, const std::string& reason) {
+  return "Signal \"" + signal.name() + "\" cannot be decoded: " + reason;
+}
+
+CANDecoder::SignalKind
+CANDecoder::classify(double scale, double offset, int& exponent,
+                     int64_t& int_scale, int64_t& int_offset) {
+  for(int digits = 0; digits <= MAX_DECIMAL_DIGITS; digits++) {
+    int64_t s, o;
+    if(!to_mantissa(scale, digits, s) || !to_mantissa(offset, digits, o))
+      continue;
+
+    exponent = -digits;
+    int_scale = s;
+    int_offset = o;
+
+    if(digits > 0)
+      return RationalScale;
+    if(s == 1 && o == 0)
+      return Identity;
+    return IntegerOffset;
+  }
+
+  exponent = 0;
+  int_scale = 0;
+  int_offset = 0;
+  return General;
+}
+
+static unsigned
+bit_width(int64_t value) {
+  uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+  unsigned width = 0;
+  for(; magnitude != 0; magnitude >>= 1)
+    width++;
+  return width;
+}
+
+/**
+ * @return true if raw * int_scale + int_offset cannot overflow 64 bits for the
+ *         raw values of a signal of this length (|raw| <= 2^length)
+ */
+static bool
+fits_integer_path(unsigned length, int64_t int_scale, int64_t int_offset) {
+  return length + bit_width(int_scale) <= 62 && bit_width(int_offset) <= 62;
+}
+
+CANDecoder::SignalPlan
+CANDecoder::compile(const CANSignal& signal) {
+  const CANSignal::Layout& layout = signal.layout();
+
+  SignalPlan result;
+  result.signal = &signal;
+  result.is_signed = layout.signedness() == CANSignal::Signed;
+  result.big_endian = layout.endianness() == CANSignal::BigEndian;
+  result.scale = layout.scale;
+  result.offset = layout.offset;
+  result.kind = classify(layout.scale, layout.offset, result.exponent,
+                         result.int_scale, result.int_offset);
+
+  unsigned length = layout.length;
+  if(length == 0 || length > 64)
+    throw CANDatabaseException(signal_error(signal, "invalid length " + std::to_string(length)));
+
+  // The integer paths would overflow on the largest raw values: floating-point
+  // arithmetic is used instead
+  if((result.kind == IntegerOffset || result.kind == RationalScale) &&
+     !fits_integer_path(length, result.int_scale, result.int_offset)) {
+    result.kind = General;
+    result.exponent = 0;
+    result.int_scale = 0;
+    result.int_offset = 0;
+  }
+
+  if(layout.value_type() != CANSignal::Integer) {
+    unsigned expected_length = layout.value_type() == CANSignal::Float ? 32 : 64;
+    if(length != expected_length)
+      throw CANDatabaseException(signal_error(signal, "IEEE-754 signal of length " + std::to_string(length)));
+
+    // The bits are reinterpreted, never sign-extended
+    result.kind = IEEEFloat;
+    result.is_signed = false;
+  }
+
+  // The 64-bit words are read "MSB first" for BigEndian signals:
+  // bit 7 of byte 0 is the bit 63 of the word. In this representation, the
+  // start bit (which is the most significant bit of the signal) is at
+  // linear position (byte * 8 + 7 - bit) starting from the left.
+  // In both cases, the word is read at the byte of the signal's first bit
+  // and a signal that does not fit in this word is read from the two
+  // consecutive words (the shift is then relative to the second word for
+  // BigEndian signals).
+  unsigned start_bit = layout.start_bit;
+  unsigned first_bit = result.big_endian ? (start_bit / 8) * 8 + 7 - start_bit % 8 : start_bit;
+  if(first_bit + length > PAYLOAD_BITS)
+    throw CANDatabaseException(signal_error(signal, "signal exceeds the 64-byte payload"));
+
+  unsigned end = first_bit % 8 + length;
+  result.byte_offset = static_cast<uint8_t>(first_bit / 8);
+  result.wide = end > 64;
+
+  if(result.big_endian)
+    result.shift = static_cast<uint8_t>((result.wide ? 128 : 64) - end);
+  else
+    result.shift = static_cast<uint8_t>(first_bit % 8);
+
+  result.length = static_cast<uint8_t>(length);
+  result.mask = length == 64 ? ~uint64_t(0) : (uint64_t(1) << length) - 1;
+  result.lut_values = nullptr;
+  result.lut_labels = nullptr;
+  result.choices = nullptr;
+
+  return result;
+}
+
+/**
+ * Moves the 64-bit word of a signal back so that it ends within the payload of
+ * its frame when possible: the frames of at least 8 bytes can then be read in
+ * place (see FramePlan::load_length).
+ */
+static void
+fit_in_frame(CANDecoder::SignalPlan& plan, unsigned frame_length) {
+  if(plan.wide || frame_length < 8 || plan.byte_offset + 8u <= frame_length)
+    return;
+
+  // Little endian: the signal moves toward the most significant bits of the
+  // word. Big endian: the word starts earlier, the signal moves toward its
+  // least significant bits. The signal must still be inside the word.
+  unsigned moved = 8 * (plan.byte_offset + 8u - frame_length);
+  if(plan.big_endian ? plan.shift < moved : plan.shift + moved + plan.length > 64)
+    return;
+
+  plan.byte_offset = static_cast<uint8_t>(frame_length - 8);
+  plan.shift = static_cast<uint8_t>(plan.big_endian ? plan.shift - moved : plan.shift + moved);
+}
+
+/**
+ * Copies the fields read by the decoding loops. The lookup table is only used
+ * by the signals whose integer path is not exact: for the other ones, the
+ * integer arithmetic is cheaper than the table and gives the same values.
+ */
+static CANDecoder::PackedSignal
+pack(const CANDecoder::SignalPlan& plan) {
+  CANDecoder::PackedSignal result;
+  result.kind = static_cast<uint8_t>(plan.kind);
+  result.flags = (plan.is_signed ? CANDecoder::PackedSignal::Signed : 0) |
+                 (plan.big_endian ? CANDecoder::PackedSignal::BigEndian : 0) |
+                 (plan.wide ? CANDecoder::PackedSignal::Wide : 0);
+  result.byte_offset = plan.byte_offset;
+  result.shift = plan.shift;
+  result.length = plan.length;
+
+  if(plan.is_integer()) {
+    result.int_scale = plan.int_scale;
+    result.int_offset = plan.int_offset;
+  }
+  else if(plan.lut_values != nullptr) {
+    result.flags |= CANDecoder::PackedSignal::Lookup;
+    result.lut_values = plan.lut_values;
+    result.offset = 0;
+  }
+  else {
+    result.scale = plan.scale;
+    result.offset = plan.offset;
+  }
+
+  return result;
+}
+
+const std::size_t CANDecoder::Payload::PADDED_SIZE;
+
+CANDecoder::Payload::Payload(const uint8_t* data, std::size_t len) {
+  len = std::min<std::size_t>(len, CANFrame::MAX_PAYLOAD_LENGTH);
+  std::memcpy(bytes, data, len);
+  std::memset(bytes + len, 0, PADDED_SIZE - len);
+}
+
+uint64_t CANDecoder::load_le(const uint8_t* data, std::size_t len) {
+  uint64_t result = 0;
+  len = std::min<std::size_t>(len, 8);
+  for(std::size_t i = 0; i < len; i++)
+    result |= static_cast<uint64_t>(data[i]) << (8 * i);
+
+  return result;
+}
+
+uint64_t CANDecoder::load_be(const uint8_t* data, std::size_t len) {
+  uint64_t result = 0;
+  len = std::min<std::size_t>(len, 8);
+  for(std::size_t i = 0; i < len; i++)
+    result |= static_cast<uint64_t>(data[i]) << (56 - 8 * i);
+
+  return result;
+}
+
+CANDecoder::FixedPoint
+CANDecoder::SignalPlan::fixed(int64_t raw) const {
+  if(kind == General || kind == IEEEFloat)
+    return { fixed(raw, -MAX_DECIMAL_DIGITS), -MAX_DECIMAL_DIGITS };
+
+  return { raw * int_scale + int_offset, exponent };
+}
+
+int64_t CANDecoder::SignalPlan::fixed(int64_t raw, int target_exponent) const {
+  if(kind == General || kind == IEEEFloat) {
+    double value = physical(raw);
+    return static_cast<int64_t>(std::llround(value * std::pow(10.0, -target_exponent)));
+  }
+
+  int64_t mantissa = raw * int_scale + int_offset;
+  int diff = exponent - target_exponent;
+  if(diff >= 0)
+    return diff < POW10_SIZE ? mantissa * POW10[diff] : 0;
+
+  return -diff < POW10_SIZE ? mantissa / POW10[-diff] : 0;
+}
+
+std::string_view
+CANDecoder::SignalPlan::label(int64_t raw) const {
+  if(lut_labels != nullptr)
+    return lut_labels[static_cast<uint64_t>(raw) & mask];
+
+  if(choices == nullptr)
+    return std::string_view();
+
+  // The choices are indexed by unsigned int (negative values wrap around): raw
+  // values outside of the 32-bit range of the signal's signedness have no label
+  if(is_signed ? (raw < INT32_MIN || raw > INT32_MAX) : (raw < 0 || raw > UINT32_MAX))
+    return std::string_view();
+  return choices->label(static_cast<unsigned int>(raw));
+}
+
+bool
+CANDecoder::SignalPlan::choice_raw(unsigned int value, int64_t& raw) const {
+  raw = is_signed ? static_cast<int64_t>(static_cast<int32_t>(value)) : static_cast<int64_t>(value);
+  if(length > 32)
+    return true;
+
+  int64_t lowest = is_signed ? -(int64_t(1) << (length - 1)) : 0;
+  int64_t highest = is_signed ? (int64_t(1) << (length - 1)) - 1 : (int64_t(1) << length) - 1;
+  return raw >= lowest && raw <= highest;
+}
+
+const uint32_t SignalHandle::INVALID;
+const uint32_t CANDecoder::MuxTable::NO_SEGMENT;
+
+SignalHandle::SignalHandle()
+  : frame(INVALID), signal(INVALID), index(INVALID) { }
+
+SignalHandle::SignalHandle(uint32_t f, uint32_t s, uint32_t i)
+  : frame(f), signal(s), index(i) { }
+
+bool SignalHandle::valid() const {
+  return index != INVALID;
+}
+
+bool SignalHandle::operator==(const SignalHandle& other) const {
+  return index == other.index;
+}
+
+bool SignalHandle::operator!=(const SignalHandle& other) const {
+  return index != other.index;
+}
+
+static uint32_t
+find_switch(const CANDecoder::FramePlan& plan, const CANSignal& signal) {
+  const std::string& switch_name = signal.multiplexer_switch().empty() ? 
+                                   plan.frame->multiplexor() : signal.multiplexer_switch();
+
+  for(std::size_t i = 0; i < plan.signals.size(); i++) {
+    const CANSignal& candidate = *plan.signals[i].signal;
+    if(candidate.name() == switch_name && candidate.is_multiplexor())
+      return static_cast<uint32_t>(i);
+  }
+
+  throw CANDatabaseException(signal_error(signal, "the multiplexor \"" + switch_name +
+                                                  "\" does not exist in the frame"));
+}
+
+static CANDecoder::MuxTable
+build_mux_table(const CANDecoder::FramePlan& plan, uint32_t switch_signal, 
+                const std::vector<uint32_t>& multiplexed) {
+  CANDecoder::MuxTable table;
+  table.switch_signal = switch_signal;
+
+  // Every bound of every range starts a new segment: a signal that
+  // contains the first value of a segment thus contains the whole segment.
+  std::vector<uint64_t> points;
+  for(uint32_t i : multiplexed) {
+    for(const auto& range : plan.signals[i].signal->multiplexer_ranges()) {
+      points.push_back(range.min);
+      if(range.max != ~0ULL)
+        points.push_back(range.max + 1);
+    }
+  }
+
+  std::sort(points.begin(), points.end());
+  points.erase(std::unique(points.begin(), points.end()), points.end());
+
+  for(std::size_t k = 0; k < points.size(); k++) {
+    CANDecoder::MuxSegment segment;
+    segment.first = points[k];
+    segment.last = k + 1 < points.size() ? points[k + 1] - 1 : ~0ULL;
+    segment.begin = static_cast<uint32_t>(table.targets.size());
+
+    for(uint32_t i : multiplexed) {
+      for(const auto& range : plan.signals[i].signal->multiplexer_ranges()) {
+        if(range.min <= segment.first && segment.first <= range.max) {
+          table.targets.push_back(i);
+          break;
+        }
+      }
+    }
+
+    segment.end = static_cast<uint32_t>(table.targets.size());
+    if(segment.end > segment.begin)
+      table.segments.push_back(segment);
+  }
+
+  if(!table.segments.empty() && table.segments.back().last < MAX_DENSE_MUX_VALUE) {
+    table.dense.assign(table.segments.back().last + 1, CANDecoder::MuxTable::NO_SEGMENT);
+    for(std::size_t k = 0; k < table.segments.size(); k++) {
+      for(uint64_t v = table.segments[k].first; v <= table.segments[k].last; v++)
+        table.dense[v] = static_cast<uint32_t>(k);
+    }
+  }
+
+  return table;
+}
+
+static void
+build_mux_tables(CANDecoder::FramePlan& plan) {
+  std::map<uint32_t, std::vector<uint32_t>> by_switch;
+  std::vector<uint32_t> parent_switch(plan.signals.size(), CANDecoder::MuxTable::NO_SEGMENT);
+
+  for(std::size_t i = 0; i < plan.signals.size(); i++) {
+    const CANSignal& signal = *plan.signals[i].signal;
+    if(!signal.is_multiplexed()) {
+      plan.static_signals.push_back(static_cast<uint32_t>(i));
+      continue;
+    }
+
+    uint32_t switch_signal = find_switch(plan, signal);
+    by_switch[switch_signal].push_back(static_cast<uint32_t>(i));
+    parent_switch[i] = switch_signal;
+  }
+
+  if(by_switch.empty()) {
+    plan.static_signals.clear();
+    return;
+  }
+
+  // A chain of switches longer than the number of switches is a cycle:
+  // the decoding would never end
+  for(const auto& entry : by_switch) {
+    uint32_t current = entry.first;
+    for(std::size_t depth = 0; parent_switch[current] != CANDecoder::MuxTable::NO_SEGMENT; depth++) {
+      if(depth > by_switch.size()) {
+        throw CANDatabaseException(signal_error(*plan.signals[entry.first].signal, 
+                                                "cyclic multiplexing"));
+      }
+      current = parent_switch[current];
+    }
+  }
+
+  plan.switch_tables.assign(plan.signals.size(), -1);
+  for(const auto& entry : by_switch) {
+    plan.switch_tables[entry.first] = static_cast<int32_t>(plan.mux_tables.size());
+    if(!plan.signals[entry.first].signal->is_multiplexed())
+      plan.root_tables.push_back(static_cast<uint32_t>(plan.mux_tables.size()));
+
+    plan.mux_tables.push_back(build_mux_table(plan, entry.first, entry.second));
+  }
+}
+
+/**
+ * Calls f with the index of every signal present in the frame.
+ */
+template<typename F>
+static void
+visit_mux_table(const CANDecoder::FramePlan& plan, const CANDecoder::MuxTable& table,
+                const uint8_t* data, F& f) {
+  uint64_t value = plan.packed[table.switch_signal].bits(data);
+  const CANDecoder::MuxSegment* segment = table.find(value);
+  if(segment == nullptr)
+    return;
+
+  for(uint32_t k = segment->begin; k < segment->end; k++) {
+    uint32_t i = table.targets[k];
+    f(i);
+
+    if(plan.switch_tables[i] >= 0)
+      visit_mux_table(plan, plan.mux_tables[plan.switch_tables[i]], data, f);
+  }
+}
+
+template<typename F>
+static inline void
+for_each_active(const CANDecoder::FramePlan& plan, const uint8_t* data, F f) {
+  if(!plan.is_multiplexed()) {
+    for(uint32_t i = 0; i < plan.signals.size(); i++)
+      f(i);
+    return;
+  }
+
+  for(uint32_t i : plan.static_signals)
+    f(i);
+
+  for(uint32_t t : plan.root_tables)
+    visit_mux_table(plan, plan.mux_tables[t], data, f);
+}
+
+/**
+ * Calls f with the payload: the caller's buffer if every signal can be read
+ * from it, a zero-padded copy otherwise.
+ */
+template<typename F>
+static inline void
+with_payload(const CANDecoder::FramePlan& plan, const uint8_t* data, std::size_t len, F f) {
+  if(len >= plan.load_length) {
+    f(data);
+    return;
+  }
+
+  CANDecoder::Payload payload(data, len);
+  f(static_cast<const uint8_t*>(payload.bytes));
+}
+
+CANDecoder::CANDecoder(const CANDatabase& db, const Options& options)
+  : signal_count_(0) {
+  std::shared_ptr<LookupTables> luts = std::make_shared<LookupTables>(
+    options.build_luts ? options.lut_memory_limit : 0);
+  frames_.reserve(db.size());
+
+  // The database is ordered by DBC ID so frames_ is already sorted
+  for(const auto& frame : db) {
+    FramePlan plan;
+    plan.frame = &frame.second;
+    plan.index = frames_.size();
+    plan.first_signal = signal_count_;
+    plan.can_id = frame.second.can_id();
+    plan.dbc_id = frame.second.dbc_id();
+    plan.extended = frame.second.is_extended();
+    plan.load_length = 0;
+    plan.signals.reserve(frame.second.size());
+    plan.packed.reserve(frame.second.size());
+
+    for(const auto& signal : frame.second) {
+      SignalPlan sig = compile(signal.second);
+      fit_in_frame(sig, frame.second.length());
+      plan.load_length = std::max<std::size_t>(plan.load_length, sig.byte_offset + (sig.wide ? 16u : 8u));
+      sig.choices = luts->choices(signal.second);
+
+      if(options.build_luts && sig.length <= std::min(options.lut_max_bits, MAX_LUT_BITS)) {
+        sig.lut_values = luts->values(sig);
+        sig.lut_labels = luts->labels(sig);
+      }
+
+      plan.signals.push_back(sig);
+      plan.packed.push_back(pack(sig));
+    }
+
+    build_mux_tables(plan);
+    signal_count_ += plan.signals.size();
+
+    frames_.push_back(std::move(plan));
+  }
+
+  luts_ = luts;
+}
+
+const CANDecoder::FramePlan*
+CANDecoder::find(unsigned long long can_id, bool extended) const {
+  unsigned long long dbc_id = extended ? can_id | CANFrame::EXTENDED_ID_FLAG : can_id;
+  auto ite = std::lower_bound(frames_.begin(), frames_.end(), dbc_id,
+                              [](const FramePlan& plan, unsigned long long id) {
+                                return plan.dbc_id < id;
+                              });
+
+  if(ite == frames_.end() || ite->dbc_id != dbc_id)
+    return nullptr;
+
+  return &(*ite);
+}
+
+const CANDecoder::FramePlan*
+CANDecoder::find(unsigned long long can_id) const {
+  const FramePlan* result = find(can_id, false);
+  if(result == nullptr && (can_id & CANFrame::EXTENDED_ID_FLAG) == 0)
+    result = find(can_id, true);
+
+  return result;
+}
+
+const CANDecoder::FramePlan&
+CANDecoder::at(unsigned long long can_id) const {
+  const FramePlan* result = find(can_id);
+  if(result == nullptr)
+    throw std::out_of_range("No decoding plan for CAN ID " + std::to_string(can_id));
+
+  return *result;
+}
+
+const std::vector<CANDecoder::FramePlan>&
+CANDecoder::frames() const {
+  return frames_;
+}
+
+std::size_t CANDecoder::active_signals(const FramePlan& plan, const uint8_t* data, std::size_t len, uint32_t* out) const {
+  std::size_t count = 0;
+  with_payload(plan, data, len, [&](const uint8_t* bytes) {
+    for_each_active(plan, bytes, [&](uint32_t i) {
+      out[count++] = i;
+    });
+  });
+
+  return count;
+}
+
+void CANDecoder::decode_raw(const FramePlan& plan, const uint8_t* data, std::size_t len, int64_t* out) const {
+  with_payload(plan, data, len, [&](const uint8_t* bytes) {
+    for_each_active(plan, bytes, [&](uint32_t i) {
+      out[i] = plan.packed[i].raw(bytes);
+    });
+  });
+}
+
+void CANDecoder::decode(const FramePlan& plan, const uint8_t* data, std::size_t len, double* out) const {
+  with_payload(plan, data, len, [&](const uint8_t* bytes) {
+    for_each_active(plan, bytes, [&](uint32_t i) {
+      out[i] = plan.packed[i].physical(bytes);
+    });
+  });
+}
+
+void CANDecoder::decode_integer(const FramePlan& plan, const uint8_t* data, std::size_t len, int64_t* out) const {
+  with_payload(plan, data, len, [&](const uint8_t* bytes) {
+    for_each_active(plan, bytes, [&](uint32_t i) {
+      out[i] = plan.packed[i].integer(bytes);
+    });
+  });
+}
+
+std::size_t CANDecoder::lut_count() const {
+  return luts_->count();
+}
+
+std::size_t CANDecoder::choice_table_count() const {
+  return luts_->choice_count();
+}
+
+std::size_t CANDecoder::lut_memory() const {
+  return luts_->memory();
+}
+
+SignalHandle CANDecoder::find_handle(unsigned long long can_id, const std::string& signal_name) const {
+  const FramePlan* plan = find(can_id);
+  if(plan == nullptr)
+    return SignalHandle();
+
+  // The signals of a plan are ordered by name (like in CANFrame)
+  auto ite = std::lower_bound(plan->signals.begin(), plan->signals.end(), signal_name,
+                              [](const SignalPlan& sig, const std::string& name) {
+                                return sig.signal->name() < name;
+                              });
+
+  if(ite == plan->signals.end() || ite->signal->name() != signal_name)
+    return SignalHandle();
+
+  return handle(*plan, ite - plan->signals.begin());
+}
+
+SignalHandle CANDecoder::handle(unsigned long long can_id, const std::string& signal_name) const {
+  SignalHandle result = find_handle(can_id, signal_name);
+  if(!result.valid()) {
+    throw std::out_of_range("No signal \"" + signal_name + "\" in frame with CAN ID " +
+                            std::to_string(can_id));
+  }
+
+  return result;
+}
+
+SignalHandle CANDecoder::handle(const FramePlan& plan, std::size_t i) const {
+  return SignalHandle(static_cast<uint32_t>(plan.index), static_cast<uint32_t>(i),
+                      static_cast<uint32_t>(plan.first_signal + i));
+}
+
+std::size_t CANDecoder::signal_count() const {
+  return signal_count_;
+}
+
+SignalValueCache::SignalValueCache(const CANDecoder& decoder)
+  : decoder_(&decoder), values_(decoder.signal_count(), 0.) { }
+
+void SignalValueCache::update(const CANDecoder::FramePlan& plan, const uint8_t* data, std::size_t len) {
+  decoder_->decode(plan, data, len, values_.data() + plan.first_signal);
+}
+
+bool SignalValueCache::update(unsigned long long can_id, const uint8_t* data, std::size_t len) {
+  const CANDecoder::FramePlan* plan = decoder_->find(can_id);
+  if(plan == nullptr)
+    return false;
+
+  update(*plan, data, len);
+  return true;
+}
+
+const double* SignalValueCache::values(const CANDecoder::FramePlan& plan) const {
+  return values_.data() + plan.first_signal;
+}
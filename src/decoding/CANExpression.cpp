@@ -0,0 +1,654 @@
+#include "CANExpression.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+using namespace CppCAN;
+
+const std::size_t CANExpression::MAX_STACK;
+
+// Maximum nesting of parentheses and unary operators and maximum height of the
+// syntax tree: bounds the recursion of the parser and of the code generation
+static const std::size_t MAX_NESTING = 256;
+
+static double apply_unary(CANExpression::OpCode op, double a) {
+  if(op == CANExpression::Negate)
+    return -a;
+  return a == 0. ? 1. : 0.; // Not
+}
+
+static double apply_binary(CANExpression::OpCode op, double a, double b) {
+  switch(op) {
+  case CANExpression::Add:          return a + b;
+  case CANExpression::Subtract:     return a - b;
+  case CANExpression::Multiply:     return a * b;
+  case CANExpression::Divide:       return a / b;
+  case CANExpression::Equal:        return a == b ? 1. : 0.;
+  case CANExpression::NotEqual:     return a != b ? 1. : 0.;
+  case CANExpression::Less:         return a < b ? 1. : 0.;
+  case CANExpression::LessEqual:    return a <= b ? 1. : 0.;
+  case CANExpression::Greater:      return a > b ? 1. : 0.;
+  case CANExpression::GreaterEqual: return a >= b ? 1. : 0.;
+  default:                          return 0.;
+  }
+}
+
+static double fold_and(double a, double b) {
+  return (a != 0. && b != 0.) ? 1. : 0.;
+}
+
+static double fold_or(double a, double b) {
+  return (a != 0. || b != 0.) ? 1. : 0.;
+}
+
+/**
+ * @brief Recursive descent parser that builds a syntax tree, checks the types
+ *        on the way and emits the bytecode of the tree
+ */
+class CANExpression::Compiler {
+public:
+  Compiler(const CANDecoder& decoder, const std::string& text)
+    : decoder_(decoder), text_(text), pos_(0), nesting_(0), depth_(0) { }
+
+  void compile(CANExpression& expression) {
+    next();
+    int root = parse_or();
+    if(current_.type != End)
+      fail("Unexpected \"" + current_.image + "\"", current_.position);
+    if(nodes_[root].type == Label)
+      fail("A label can only be compared with a signal", nodes_[root].position);
+
+    code_ = &expression.code_;
+    emit(root);
+
+    expression.type_ = nodes_[root].type == Bool ? Boolean : Number;
+
+    std::sort(signals_.begin(), signals_.end(), [](const SignalHandle& a, const SignalHandle& b) {
+      return a.index < b.index;
+    });
+    signals_.erase(std::unique(signals_.begin(), signals_.end()), signals_.end());
+    for(const SignalHandle& handle : signals_)
+      expression.frames_.push_back(handle.frame);
+    expression.frames_.erase(std::unique(expression.frames_.begin(), expression.frames_.end()),
+                             expression.frames_.end());
+    expression.signals_ = signals_;
+  }
+
+private:
+  enum TokenType {
+    End, NumberToken, StringToken, Identifier, Operator
+  };
+
+  struct Token {
+    TokenType type;
+    std::string image;
+    double number;
+    std::size_t position;
+  };
+
+  // Types of the nodes (labels only exist until they are compared with a signal)
+  enum NodeType {
+    Num, Bool, Label
+  };
+
+  enum NodeKind {
+    ConstantNode, SignalNode, LabelNode, UnaryNode, BinaryNode, LogicalNode
+  };
+
+  struct Node {
+    NodeKind kind;
+    NodeType type;
+    OpCode op; // LogicalNode: the jump that short-circuits the right operand
+    double constant;
+    SignalHandle signal;
+    std::string label;
+    std::size_t position;
+    int left;
+    int right;
+  };
+
+  [[noreturn]] void fail(const std::string& message, std::size_t position) const {
+    throw CANExpressionException(message + " at character " + std::to_string(position + 1) +
+                                 " of \"" + text_ + "\"");
+  }
+
+  void next() {
+    while(pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_])))
+      pos_++;
+
+    current_ = Token{ End, "end of expression", 0., pos_ };
+    if(pos_ >= text_.size())
+      return;
+
+    char c = text_[pos_];
+    char following = pos_ + 1 < text_.size() ? text_[pos_ + 1] : '\0';
+
+    if(std::isdigit(static_cast<unsigned char>(c)) ||
+       (c == '.' && std::isdigit(static_cast<unsigned char>(following)))) {
+      const char* begin = text_.c_str() + pos_;
+      char* end = nullptr;
+      current_.type = NumberToken;
+      current_.number = std::strtod(begin, &end);
+      current_.image.assign(begin, static_cast<std::size_t>(end - begin));
+      pos_ += end - begin;
+    }
+    else if(c == '"') {
+      std::size_t close = text_.find('"', pos_ + 1);
+      if(close == std::string::npos)
+        fail("Unterminated label", pos_);
+      current_.type = StringToken;
+      current_.image = text_.substr(pos_ + 1, close - pos_ - 1);
+      pos_ = close + 1;
+    }
+    else if(std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+      std::size_t start = pos_;
+      while(pos_ < text_.size() && (std::isalnum(static_cast<unsigned char>(text_[pos_])) || text_[pos_] == '_'))
+        pos_++;
+      current_.type = Identifier;
+      current_.image = text_.substr(start, pos_ - start);
+    }
+    else {
+      static const char* const TWO_CHARS[] = { "&&", "||", "==", "!=", "<=", ">=" };
+      static const char ONE_CHAR[] = "!<>+-*/().";
+
+      current_.type = Operator;
+      for(const char* op : TWO_CHARS) {
+        if(c == op[0] && following == op[1]) {
+          current_.image = op;
+          pos_ += 2;
+          return;
+        }
+      }
+      if(std::strchr(ONE_CHAR, c) == nullptr)
+        fail(std::string("Unexpected character '") + c + "'", pos_);
+      current_.image = std::string(1, c);
+      pos_++;
+    }
+  }
+
+  /**
+   * @brief Enters a nested expression (parentheses or unary operator)
+   */
+  void enter(std::size_t position) {
+    if(++nesting_ > MAX_NESTING)
+      fail("The expression is too deeply nested", position);
+  }
+
+  void leave() {
+    nesting_--;
+  }
+
+  bool accept(const char* op) {
+    if(current_.type != Operator || current_.image != op)
+      return false;
+    next();
+    return true;
+  }
+
+  void expect(const char* op) {
+    if(!accept(op))
+      fail(std::string("Expected \"") + op + "\" instead of \"" + current_.image + "\"", current_.position);
+  }
+
+  int add_node(const Node& node) {
+    std::size_t height = 1;
+    for(int child : { node.left, node.right }) {
+      if(child >= 0)
+        height = std::max(height, heights_[child] + 1);
+    }
+    if(height > MAX_NESTING)
+      fail("The expression is too deeply nested", node.position);
+
+    nodes_.push_back(node);
+    heights_.push_back(height);
+    return static_cast<int>(nodes_.size() - 1);
+  }
+
+  int make_constant(double value, NodeType type, std::size_t position) {
+    return add_node(Node{ ConstantNode, type, Constant, value, SignalHandle(), std::string(), position, -1, -1 });
+  }
+
+  static const char* type_name(NodeType type) {
+    return type == Num ? "a number" : type == Bool ? "a boolean" : "a label";
+  }
+
+  void check_type(int node, NodeType expected, const std::string& op) const {
+    if(nodes_[node].type == Label)
+      fail("A label can only be compared with a signal", nodes_[node].position);
+    if(nodes_[node].type != expected) {
+      fail("The operand of \"" + op + "\" must be " + type_name(expected) + ", not " + type_name(nodes_[node].type),
+           nodes_[node].position);
+    }
+  }
+
+  int make_unary(OpCode op, int operand, const std::string& image, std::size_t position) {
+    NodeType type = op == Negate ? Num : Bool;
+    check_type(operand, type, image);
+
+    if(nodes_[operand].kind == ConstantNode)
+      return make_constant(apply_unary(op, nodes_[operand].constant), type, position);
+    return add_node(Node{ UnaryNode, type, op, 0., SignalHandle(), std::string(), position, operand, -1 });
+  }
+
+  int make_binary(OpCode op, int left, int right, const std::string& image, std::size_t position) {
+    NodeType operands = Num;
+    NodeType result = Bool;
+    if(op == Add || op == Subtract || op == Multiply || op == Divide) {
+      result = Num;
+    }
+    else if(op == Equal || op == NotEqual) {
+      if(nodes_[left].type == Label)
+        left = resolve_label(left, right, position);
+      else if(nodes_[right].type == Label)
+        right = resolve_label(right, left, position);
+      operands = nodes_[left].type;
+    }
+
+    check_type(left, operands, image);
+    check_type(right, operands, image);
+
+    if(nodes_[left].kind == ConstantNode && nodes_[right].kind == ConstantNode)
+      return make_constant(apply_binary(op, nodes_[left].constant, nodes_[right].constant), result, position);
+    return add_node(Node{ BinaryNode, result, op, 0., SignalHandle(), std::string(), position, left, right });
+  }
+
+  /**
+   * @brief Makes a && (and is true) or || node
+   */
+  int make_logical(bool is_and, int left, int right, std::size_t position) {
+    const char* image = is_and ? "&&" : "||";
+    check_type(left, Bool, image);
+    check_type(right, Bool, image);
+
+    if(nodes_[left].kind == ConstantNode && nodes_[right].kind == ConstantNode) {
+      double a = nodes_[left].constant;
+      double b = nodes_[right].constant;
+      return make_constant(is_and ? fold_and(a, b) : fold_or(a, b), Bool, position);
+    }
+    return add_node(Node{ LogicalNode, Bool, is_and ? JumpIfFalse : JumpIfTrue, 0., SignalHandle(), std::string(),
+                          position, left, right });
+  }
+
+  /**
+   * @return A constant node with the physical value of the label for the signal
+   */
+  int resolve_label(int label, int signal, std::size_t position) {
+    if(nodes_[signal].kind != SignalNode)
+      fail("The label \"" + nodes_[label].label + "\" must be compared with a signal", position);
+
+    const CANDecoder::SignalPlan& plan = decoder_.plan(nodes_[signal].signal);
+    unsigned int value = 0;
+    if(plan.choices == nullptr || !plan.choices->find(nodes_[label].label, value)) {
+      fail("No choice \"" + nodes_[label].label + "\" for the signal \"" + plan.signal->name() + "\"",
+           nodes_[label].position);
+    }
+
+    int64_t raw;
+    if(!plan.choice_raw(value, raw)) {
+      fail("The choice \"" + nodes_[label].label + "\" does not fit in the signal \"" + plan.signal->name() + "\"",
+           nodes_[label].position);
+    }
+    return make_constant(plan.physical(raw), Num, nodes_[label].position);
+  }
+
+  int parse_or() {
+    int left = parse_and();
+    while(current_.type == Operator && current_.image == "||") {
+      std::size_t position = current_.position;
+      next();
+      left = make_logical(false, left, parse_and(), position);
+    }
+    return left;
+  }
+
+  int parse_and() {
+    int left = parse_compare();
+    while(current_.type == Operator && current_.image == "&&") {
+      std::size_t position = current_.position;
+      next();
+      left = make_logical(true, left, parse_compare(), position);
+    }
+    return left;
+  }
+
+  int parse_compare() {
+    static const struct { const char* image; OpCode op; } COMPARISONS[] = {
+      { "==", Equal }, { "!=", NotEqual }, { "<", Less }, { "<=", LessEqual },
+      { ">", Greater }, { ">=", GreaterEqual }
+    };
+
+    int left = parse_sum();
+    if(current_.type != Operator)
+      return left;
+
+    for(const auto& comparison : COMPARISONS) {
+      if(current_.image == comparison.image) {
+        std::size_t position = current_.position;
+        next();
+        return make_binary(comparison.op, left, parse_sum(), comparison.image, position);
+      }
+    }
+    return left;
+  }
+
+  int parse_sum() {
+    int left = parse_product();
+    while(current_.type == Operator && (current_.image == "+" || current_.image == "-")) {
+      std::string image = current_.image;
+      std::size_t position = current_.position;
+      next();
+      left = make_binary(image == "+" ? Add : Subtract, left, parse_product(), image, position);
+    }
+    return left;
+  }
+
+  int parse_product() {
+    int left = parse_unary();
+    while(current_.type == Operator && (current_.image == "*" || current_.image == "/")) {
+      std::string image = current_.image;
+      std::size_t position = current_.position;
+      next();
+      left = make_binary(image == "*" ? Multiply : Divide, left, parse_unary(), image, position);
+    }
+    return left;
+  }
+
+  int parse_unary() {
+    std::size_t position = current_.position;
+    OpCode op = Negate;
+    if(accept("!"))
+      op = Not;
+    else if(!accept("-"))
+      return parse_primary();
+
+    enter(position);
+    int operand = parse_unary();
+    leave();
+    return make_unary(op, operand, op == Not ? "!" : "-", position);
+  }
+
+  int parse_primary() {
+    Token token = current_;
+
+    if(token.type == NumberToken) {
+      next();
+      return make_constant(token.number, Num, token.position);
+    }
+    if(token.type == StringToken) {
+      next();
+      return add_node(Node{ LabelNode, Label, Constant, 0., SignalHandle(), token.image, token.position, -1, -1 });
+    }
+    if(token.type == Identifier) {
+      next();
+      if(token.image == "true" || token.image == "false")
+        return make_constant(token.image == "true" ? 1. : 0., Bool, token.position);
+
+      std::string frame;
+      std::string signal = token.image;
+      if(accept(".")) {
+        if(current_.type != Identifier)
+          fail("Expected a signal name after \"" + token.image + ".\"", current_.position);
+        frame = token.image;
+        signal = current_.image;
+        next();
+      }
+      return make_signal(frame, signal, token.position);
+    }
+    if(accept("(")) {
+      enter(token.position);
+      int node = parse_or();
+      expect(")");
+      leave();
+      return node;
+    }
+
+    fail("Unexpected \"" + token.image + "\"", token.position);
+  }
+
+  int make_signal(const std::string& frame, const std::string& signal, std::size_t position) {
+    SignalHandle handle;
+    bool frame_found = false;
+
+    for(const CANDecoder::FramePlan& plan : decoder_.frames()) {
+      if(!frame.empty() && plan.frame->name() != frame)
+        continue;
+
+      frame_found = true;
+      SignalHandle candidate = decoder_.find_handle(plan.dbc_id, signal);
+      if(!candidate.valid())
+        continue;
+      if(handle.valid())
+        fail("The signal \"" + signal + "\" is in several frames, use Frame." + signal, position);
+      handle = candidate;
+    }
+
+    if(!frame_found)
+      fail("Unknown frame \"" + frame + "\"", position);
+    if(!handle.valid())
+      fail("Unknown signal \"" + (frame.empty() ? signal : frame + "." + signal) + "\"", position);
+
+    signals_.push_back(handle);
+    return add_node(Node{ SignalNode, Num, Load, 0., handle, std::string(), position, -1, -1 });
+  }
+
+  void push(const Instruction& instruction, int delta, std::size_t position) {
+    code_->push_back(instruction);
+    depth_ += delta;
+    if(depth_ > MAX_STACK)
+      fail("The expression is too deeply nested", position);
+  }
+
+  void emit(int index) {
+    const Node& node = nodes_[index];
+    switch(node.kind) {
+    case ConstantNode:
+      push(Instruction{ Constant, 0, node.constant }, 1, node.position);
+      break;
+    case SignalNode:
+      push(Instruction{ Load, node.signal.index, 0. }, 1, node.position);
+      break;
+    case UnaryNode:
+      emit(node.left);
+      push(Instruction{ node.op, 0, 0. }, 0, node.position);
+      break;
+    case BinaryNode:
+      emit(node.left);
+      emit(node.right);
+      push(Instruction{ node.op, 0, 0. }, -1, node.position);
+      break;
+    case LogicalNode: {
+      // The left operand stays on the stack when the jump is taken
+      emit(node.left);
+      std::size_t jump = code_->size();
+      push(Instruction{ node.op, 0, 0. }, -1, node.position);
+      emit(node.right);
+      (*code_)[jump].index = static_cast<uint32_t>(code_->size());
+      break;
+    }
+    case LabelNode:
+      fail("A label can only be compared with a signal", node.position);
+    }
+  }
+
+  const CANDecoder& decoder_;
+  const std::string& text_;
+  std::size_t pos_;
+  std::size_t nesting_; // Nesting of the expression being parsed
+  Token current_;
+  std::vector<Node> nodes_;
+  std::vector<std::size_t> heights_; // Height of the subtree of each node
+  std::vector<SignalHandle> signals_;
+  std::vector<Instruction>* code_;
+  std::size_t depth_;
+};
+
+CANExpression::CANExpression(const CANDecoder& decoder, const std::string& text)
+  : decoder_(&decoder), text_(text), type_(Number) {
+  Compiler(decoder, text_).compile(*this);
+}
+
+double CANExpression::value(const double* values) const {
+  double stack[MAX_STACK];
+  std::size_t top = 0; // Number of values on the stack
+  const Instruction* code = code_.data();
+  std::size_t size = code_.size();
+
+  for(std::size_t pc = 0; pc < size; pc++) {
+    const Instruction& instruction = code[pc];
+    switch(instruction.op) {
+    case Constant:
+      stack[top++] = instruction.constant;
+      break;
+    case Load:
+      stack[top++] = values[instruction.index];
+      break;
+    case Negate:
+    case Not:
+      stack[top - 1] = apply_unary(instruction.op, stack[top - 1]);
+      break;
+    case JumpIfFalse:
+      if(stack[top - 1] == 0.)
+        pc = instruction.index - 1;
+      else
+        top--;
+      break;
+    case JumpIfTrue:
+      if(stack[top - 1] != 0.)
+        pc = instruction.index - 1;
+      else
+        top--;
+      break;
+    default:
+      top--;
+      stack[top - 1] = apply_binary(instruction.op, stack[top - 1], stack[top]);
+      break;
+    }
+  }
+
+  return stack[0];
+}
+
+bool CANExpression::evaluate(const double* values) const {
+  return value(values) != 0.;
+}
+
+CANExpression::Type CANExpression::type() const {
+  return type_;
+}
+
+const std::string& CANExpression::text() const {
+  return text_;
+}
+
+const std::vector<SignalHandle>& CANExpression::signals() const {
+  return signals_;
+}
+
+const std::vector<uint32_t>& CANExpression::frames() const {
+  return frames_;
+}
+
+const std::vector<CANExpression::Instruction>& CANExpression::code() const {
+  return code_;
+}
+
+const CANDecoder& CANExpression::decoder() const {
+  return *decoder_;
+}
+
+CANTriggerSet::CANTriggerSet(const CANDecoder& decoder, const Callback& callback)
+  : decoder_(&decoder), callback_(callback),
+    values_(decoder.signal_count(), std::numeric_limits<double>::quiet_NaN()),
+    rule_offsets_(decoder.frames().size() + 1, 0) {
+  std::size_t largest = 0;
+  for(const CANDecoder::FramePlan& plan : decoder.frames())
+    largest = std::max(largest, plan.signals.size());
+  decoded_.resize(largest);
+}
+
+std::size_t CANTriggerSet::add(const std::string& text) {
+  CANExpression rule(*decoder_, text);
+  if(rule.type() != CANExpression::Boolean)
+    throw CANExpressionException("The rule \"" + text + "\" is not a boolean expression");
+
+  rules_.push_back(std::move(rule));
+  active_.push_back(0);
+
+  // Rebuilds the rules of each frame (counting sort by frame)
+  std::fill(rule_offsets_.begin(), rule_offsets_.end(), 0);
+  for(const CANExpression& expression : rules_) {
+    for(uint32_t frame : expression.frames())
+      rule_offsets_[frame + 1]++;
+  }
+  for(std::size_t i = 1; i < rule_offsets_.size(); i++)
+    rule_offsets_[i] += rule_offsets_[i - 1];
+
+  rule_indices_.resize(rule_offsets_.back());
+  std::vector<uint32_t> cursors(rule_offsets_.begin(), rule_offsets_.end() - 1);
+  for(std::size_t r = 0; r < rules_.size(); r++) {
+    for(uint32_t frame : rules_[r].frames())
+      rule_indices_[cursors[frame]++] = static_cast<uint32_t>(r);
+  }
+
+  return rules_.size() - 1;
+}
+
+std::size_t CANTriggerSet::update(const CANDecoder::FramePlan& plan, const uint8_t* data, std::size_t len,
+                                  int64_t timestamp) {
+  std::size_t count = plan.signals.size();
+  std::fill(decoded_.begin(), decoded_.begin() + count, std::numeric_limits<double>::quiet_NaN());
+  decoder_->decode(plan, data, len, decoded_.data());
+
+  double* values = values_.data() + plan.first_signal;
+  for(std::size_t i = 0; i < count; i++) {
+    // Signals absent from a multiplexed frame are NaN
+    if(plan.is_multiplexed() && std::isnan(decoded_[i]))
+      continue;
+    values[i] = decoded_[i];
+  }
+
+  uint32_t begin = rule_offsets_[plan.index];
+  uint32_t end = rule_offsets_[plan.index + 1];
+  for(uint32_t i = begin; i < end; i++) {
+    uint32_t rule = rule_indices_[i];
+    bool active = rules_[rule].evaluate(values_.data());
+    if(active == (active_[rule] != 0))
+      continue;
+
+    active_[rule] = active;
+    if(callback_)
+      callback_(Event{ rule, active, timestamp });
+  }
+
+  return end - begin;
+}
+
+std::size_t CANTriggerSet::update(const LogFrame& frame) {
+  if(frame.flags & (LogFrame::Remote | LogFrame::ErrorFrame))
+    return 0;
+
+  const CANDecoder::FramePlan* plan = decoder_->find(frame.can_id, frame.is_extended());
+  if(plan == nullptr)
+    return 0;
+
+  return update(*plan, frame.data, frame.length, frame.timestamp);
+}
+
+bool CANTriggerSet::active(std::size_t rule) const {
+  return active_[rule] != 0;
+}
+
+const CANExpression& CANTriggerSet::rule(std::size_t rule) const {
+  return rules_[rule];
+}
+
+std::size_t CANTriggerSet::size() const {
+  return rules_.size();
+}
+
+const double* CANTriggerSet::values() const {
+  return values_.data();
+}
@@ -0,0 +1,219 @@
+#include "CANIdFilter.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+using namespace CppCAN;
+
+const std::size_t CANIdFilter::STANDARD_IDS;
+const uint32_t CANIdFilter::MAX_EXTENDED_ID;
+const uint32_t CANIdFilter::EXPAND_LIMIT;
+const uint32_t CANIdFilter::EMPTY_SLOT;
+
+static const uint32_t MAX_STANDARD_ID = 0x7FF;
+static const std::size_t MIN_SLOTS = 16;
+
+static unsigned count_bits(uint64_t word) {
+  unsigned count = 0;
+  for(; word != 0; word &= word - 1)
+    count++;
+  return count;
+}
+
+static void check_id(uint32_t id, bool extended) {
+  if(id > (extended ? CANIdFilter::MAX_EXTENDED_ID : MAX_STANDARD_ID)) {
+    throw std::out_of_range("CAN ID " + std::to_string(id) + " does not fit in " +
+                            (extended ? "29" : "11") + " bits");
+  }
+}
+
+CANIdFilter::CANIdFilter()
+  : standard_(), shift_(32), extended_ids_(0) { }
+
+CANIdFilter CANIdFilter::from_database(const CANDatabase& database) {
+  CANIdFilter filter;
+  filter.add_database(database);
+  return filter;
+}
+
+CANIdFilter& CANIdFilter::add_id(uint32_t id, bool extended) {
+  check_id(id, extended);
+
+  if(extended)
+    insert(id);
+  else
+    set_standard(id);
+  return *this;
+}
+
+CANIdFilter& CANIdFilter::add_range(uint32_t first, uint32_t last, bool extended) {
+  check_id(last, extended);
+  if(first > last)
+    throw std::invalid_argument("Invalid range of CAN IDs: " + std::to_string(first) + " > " + std::to_string(last));
+
+  if(!extended) {
+    for(uint32_t id = first; id <= last; id++)
+      set_standard(id);
+    return *this;
+  }
+
+  if(last - first < EXPAND_LIMIT) {
+    for(uint32_t id = first; id <= last; id++)
+      insert(id);
+    return *this;
+  }
+
+  // Merges the overlapping and adjacent ranges
+  ranges_.emplace_back(first, last);
+  std::sort(ranges_.begin(), ranges_.end());
+  std::size_t merged = 0;
+  for(std::size_t i = 1; i < ranges_.size(); i++) {
+    if(ranges_[i].first <= ranges_[merged].second + 1)
+      ranges_[merged].second = std::max(ranges_[merged].second, ranges_[i].second);
+    else
+      ranges_[++merged] = ranges_[i];
+  }
+  ranges_.resize(merged + 1);
+  return *this;
+}
+
+CANIdFilter& CANIdFilter::add_mask(uint32_t value, uint32_t mask, bool extended) {
+  if(!extended) {
+    for(uint32_t id = 0; id < STANDARD_IDS; id++) {
+      if((id & mask) == (value & mask))
+        set_standard(id);
+    }
+    return *this;
+  }
+
+  mask &= MAX_EXTENDED_ID;
+  value &= mask;
+  uint32_t free_bits = ~mask & MAX_EXTENDED_ID;
+
+  if((uint64_t(1) << count_bits(free_bits)) <= EXPAND_LIMIT) {
+    // Enumerates the subsets of the free bits
+    uint32_t subset = 0;
+    do {
+      insert(value | subset);
+      subset = (subset - free_bits) & free_bits;
+    } while(subset != 0);
+    return *this;
+  }
+
+  std::pair<uint32_t, uint32_t> pair(value, mask);
+  if(std::find(masks_.begin(), masks_.end(), pair) == masks_.end())
+    masks_.push_back(pair);
+  return *this;
+}
+
+CANIdFilter& CANIdFilter::add_database(const CANDatabase& database) {
+  for(const auto& entry : database) {
+    const CANFrame& frame = entry.second;
+    // Pseudo-messages (eg. VECTOR__INDEPENDENT_SIG_MSG) can never be received
+    if(frame.can_id() > (frame.is_extended() ? MAX_EXTENDED_ID : MAX_STANDARD_ID))
+      continue;
+    add_id(static_cast<uint32_t>(frame.can_id()), frame.is_extended());
+  }
+  return *this;
+}
+
+bool CANIdFilter::matches_extended(uint32_t id) const {
+  if(id > MAX_EXTENDED_ID)
+    return false;
+
+  if(!slots_.empty()) {
+    std::size_t mask = slots_.size() - 1;
+    for(std::size_t i = slot(id); ; i = (i + 1) & mask) {
+      uint32_t entry = slots_[i];
+      if(entry == id)
+        return true;
+      if(entry == EMPTY_SLOT)
+        break;
+    }
+  }
+
+  if(!ranges_.empty()) {
+    auto it = std::upper_bound(ranges_.begin(), ranges_.end(), id,
+                               [](uint32_t value, const std::pair<uint32_t, uint32_t>& range) {
+                                 return value < range.first;
+                               });
+    if(it != ranges_.begin() && id <= std::prev(it)->second)
+      return true;
+  }
+
+  for(const auto& pair : masks_) {
+    if((id & pair.second) == pair.first)
+      return true;
+  }
+  return false;
+}
+
+std::size_t CANIdFilter::scan(const LogFrame* frames, std::size_t count, uint32_t* indices) const {
+  std::size_t found = 0;
+  for(std::size_t i = 0; i < count; i++) {
+    indices[found] = static_cast<uint32_t>(i);
+    found += matches(frames[i]) ? 1 : 0;
+  }
+  return found;
+}
+
+uint32_t CANIdFilter::slot(uint32_t id) const {
+  // Fibonacci hashing: the high bits of the product are well mixed
+  return static_cast<uint32_t>(id * 2654435769u) >> shift_;
+}
+
+void CANIdFilter::set_standard(uint32_t id) {
+  standard_[id >> 6] |= uint64_t(1) << (id & 63);
+}
+
+void CANIdFilter::insert(uint32_t id) {
+  if(!slots_.empty()) {
+    std::size_t mask = slots_.size() - 1;
+    for(std::size_t i = slot(id); slots_[i] != EMPTY_SLOT; i = (i + 1) & mask) {
+      if(slots_[i] == id)
+        return;
+    }
+  }
+
+  // Keeps the load factor under 1/2 so that the probe sequences stay short
+  if(2 * (extended_ids_ + 1) > slots_.size()) {
+    std::vector<uint32_t> old(std::max(MIN_SLOTS, 2 * slots_.size()), EMPTY_SLOT);
+    old.swap(slots_);
+    shift_ = 32;
+    for(std::size_t size = slots_.size(); size > 1; size >>= 1)
+      shift_--;
+
+    extended_ids_ = 0;
+    for(uint32_t entry : old) {
+      if(entry != EMPTY_SLOT)
+        insert(entry);
+    }
+  }
+
+  std::size_t mask = slots_.size() - 1;
+  std::size_t i = slot(id);
+  while(slots_[i] != EMPTY_SLOT)
+    i = (i + 1) & mask;
+  slots_[i] = id;
+  extended_ids_++;
+}
+
+std::size_t CANIdFilter::standard_count() const {
+  std::size_t count = 0;
+  for(uint64_t word : standard_)
+    count += count_bits(word);
+  return count;
+}
+
+std::size_t CANIdFilter::extended_id_count() const {
+  return extended_ids_;
+}
+
+const std::vector<std::pair<uint32_t, uint32_t>>& CANIdFilter::extended_ranges() const {
+  return ranges_;
+}
+
+const std::vector<std::pair<uint32_t, uint32_t>>& CANIdFilter::extended_masks() const {
+  return masks_;
+}
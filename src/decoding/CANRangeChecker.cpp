@@ -0,0 +1,200 @@
+#include "CANRangeChecker.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace CppCAN;
+
+static const int64_t INT64_LOWEST = std::numeric_limits<int64_t>::min();
+static const int64_t INT64_HIGHEST = std::numeric_limits<int64_t>::max();
+
+static void
+signal_raw_limits(const CANDecoder::SignalPlan& plan, int64_t& min, int64_t& max) {
+  if(plan.length >= 64) {
+    min = INT64_LOWEST;
+    max = INT64_HIGHEST;
+  }
+  else if(plan.is_signed) {
+    min = -(int64_t(1) << (plan.length - 1));
+    max = (int64_t(1) << (plan.length - 1)) - 1;
+  }
+  else {
+    min = 0;
+    max = (int64_t(1) << plan.length) - 1;
+  }
+}
+
+static int64_t
+to_raw(double value, int64_t lowest, int64_t highest) {
+  // The comparisons are done in the floating-point domain so that the
+  // conversion never overflows
+  if(value <= static_cast<double>(lowest))
+    return lowest;
+  if(value >= static_cast<double>(highest))
+    return highest;
+  return static_cast<int64_t>(value);
+}
+
+bool CANRangeChecker::raw_bounds(const CANDecoder::SignalPlan& plan, int64_t& min, int64_t& max) {
+  // The raw values of IEEEFloat signals are bit patterns: there is no raw-domain range
+  const CANSignal::Range& range = plan.signal->range();
+  if(!range.defined || (range.min == 0 && range.max == 0) || plan.kind == CANDecoder::IEEEFloat) {
+    min = INT64_LOWEST;
+    max = INT64_HIGHEST;
+    return false;
+  }
+
+  int64_t lowest, highest;
+  signal_raw_limits(plan, lowest, highest);
+
+  if(plan.scale == 0) {
+    // Constant signal: either always in range or never
+    bool ok = plan.offset >= range.min && plan.offset <= range.max;
+    min = ok ? INT64_LOWEST : INT64_HIGHEST;
+    max = ok ? INT64_HIGHEST : INT64_LOWEST;
+    return true;
+  }
+
+  double lo = (range.min - plan.offset) / plan.scale;
+  double hi = (range.max - plan.offset) / plan.scale;
+  if(plan.scale < 0)
+    std::swap(lo, hi);
+
+  // (max - offset) / scale may be slightly below an integer (eg. 9.9999999 instead of 10)
+  // because of the decimal scale factors: the tolerance keeps such bounds inclusive.
+  lo = std::ceil(lo - 1e-9 * std::max(1.0, std::fabs(lo)));
+  hi = std::floor(hi + 1e-9 * std::max(1.0, std::fabs(hi)));
+
+  if(lo > hi) {
+    // Empty range: every value is a violation
+    min = INT64_HIGHEST;
+    max = INT64_LOWEST;
+    return true;
+  }
+
+  min = to_raw(lo, lowest, highest);
+  max = to_raw(hi, lowest, highest);
+  return true;
+}
+
+std::size_t CANRangeChecker::mask_words(const CANDecoder::FramePlan& plan) {
+  return std::max<std::size_t>(1, (plan.signals.size() + 63) / 64);
+}
+
+CANRangeChecker::CANRangeChecker(const CANDecoder& decoder) {
+  bounds_.reserve(decoder.frames().size());
+
+  for(const CANDecoder::FramePlan& plan : decoder.frames()) {
+    FrameBounds frame_bounds;
+    frame_bounds.min.resize(plan.signals.size());
+    frame_bounds.max.resize(plan.signals.size());
+    frame_bounds.static_mask.resize(mask_words(plan));
+
+    for(std::size_t i = 0; i < plan.signals.size(); i++) {
+      raw_bounds(plan.signals[i], frame_bounds.min[i], frame_bounds.max[i]);
+      if(!plan.signals[i].signal->is_multiplexed())
+        frame_bounds.static_mask[i / 64] |= uint64_t(1) << (i % 64);
+    }
+
+    bounds_.push_back(std::move(frame_bounds));
+  }
+}
+
+const CANRangeChecker::FrameBounds&
+CANRangeChecker::bounds(const CANDecoder::FramePlan& plan) const {
+  return bounds_.at(plan.index);
+}
+
+/**
+ * Branchless comparison of at most 64 values: the loop is vectorized by the compiler.
+ */
+static inline uint64_t
+check_word(const int64_t* raw, const int64_t* min, const int64_t* max, std::size_t n) {
+  uint64_t mask = 0;
+  for(std::size_t i = 0; i < n; i++) {
+    uint64_t violation = static_cast<uint64_t>(raw[i] < min[i]) |
+                         static_cast<uint64_t>(raw[i] > max[i]);
+    mask |= violation << i;
+  }
+
+  return mask;
+}
+
+/**
+ * Checks the multiplexed signals selected by the switch of the table (like
+ * CANDecoder::active_signals() but from the raw value of the switch). The
+ * signals beyond limit are ignored.
+ */
+static void
+check_mux_table(const CANDecoder::FramePlan& plan, const CANDecoder::MuxTable& table,
+                const CANRangeChecker::FrameBounds& b, const int64_t* raw,
+                std::size_t limit, uint64_t* mask) {
+  uint64_t value = static_cast<uint64_t>(raw[table.switch_signal]) & plan.signals[table.switch_signal].mask;
+  const CANDecoder::MuxSegment* segment = table.find(value);
+  if(segment == nullptr)
+    return;
+
+  for(uint32_t k = segment->begin; k < segment->end; k++) {
+    uint32_t i = table.targets[k];
+    if(i < limit && (raw[i] < b.min[i] || raw[i] > b.max[i]))
+      mask[i / 64] |= uint64_t(1) << (i % 64);
+
+    if(plan.switch_tables[i] >= 0)
+      check_mux_table(plan, plan.mux_tables[plan.switch_tables[i]], b, raw, limit, mask);
+  }
+}
+
+bool CANRangeChecker::check(const CANDecoder::FramePlan& plan, const int64_t* raw, uint64_t* mask) const {
+  const FrameBounds& b = bounds(plan);
+  std::size_t n = plan.signals.size();
+  std::size_t words = mask_words(plan);
+
+  for(std::size_t w = 0; w < words; w++) {
+    std::size_t first = w * 64;
+    std::size_t count = std::min<std::size_t>(64, n - std::min(n, first));
+
+    mask[w] = check_word(raw + first, b.min.data() + first, b.max.data() + first, count);
+  }
+
+  // The raw values of the multiplexed signals are only meaningful if they are selected
+  if(plan.is_multiplexed()) {
+    for(std::size_t w = 0; w < words; w++)
+      mask[w] &= b.static_mask[w];
+    for(uint32_t t : plan.root_tables)
+      check_mux_table(plan, plan.mux_tables[t], b, raw, n, mask);
+  }
+
+  uint64_t any = 0;
+  for(std::size_t w = 0; w < words; w++)
+    any |= mask[w];
+
+  return any == 0;
+}
+
+uint64_t CANRangeChecker::check(const CANDecoder::FramePlan& plan, const int64_t* raw) const {
+  const FrameBounds& b = bounds(plan);
+  std::size_t n = std::min<std::size_t>(64, plan.signals.size());
+
+  uint64_t mask = check_word(raw, b.min.data(), b.max.data(), n);
+  if(plan.is_multiplexed()) {
+    mask &= b.static_mask[0];
+    for(uint32_t t : plan.root_tables)
+      check_mux_table(plan, plan.mux_tables[t], b, raw, n, &mask);
+  }
+
+  return mask;
+}
+
+std::size_t CANRangeChecker::check_batch(const CANDecoder::FramePlan& plan, const int64_t* raw,
+                                         std::size_t count, uint64_t* masks) const {
+  std::size_t n = plan.signals.size();
+  std::size_t words = mask_words(plan);
+  std::size_t violations = 0;
+
+  for(std::size_t i = 0; i < count; i++) {
+    if(!check(plan, raw + i * n, masks + i * words))
+      violations++;
+  }
+
+  return violations;
+}
@@ -0,0 +1,290 @@
+#include "CANRawFilter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+using namespace CppCAN;
+
+// Relative tolerance used to check that a physical value is the image of a raw value
+static const double PHYSICAL_TOLERANCE = 1e-9;
+
+static void
+raw_limits(const CANDecoder::SignalPlan& plan, double& lowest, double& highest) {
+  if(plan.length >= 64) {
+    lowest = plan.is_signed ? static_cast<double>(std::numeric_limits<int64_t>::min()) : 0;
+    highest = static_cast<double>(std::numeric_limits<int64_t>::max());
+  }
+  else if(plan.is_signed) {
+    lowest = -std::ldexp(1.0, plan.length - 1);
+    highest = std::ldexp(1.0, plan.length - 1) - 1;
+  }
+  else {
+    lowest = 0;
+    highest = std::ldexp(1.0, plan.length) - 1;
+  }
+}
+
+/**
+ * @brief Converts a physical value into the bits of the signal
+ * @return false if no raw value of the signal has this physical value
+ */
+static bool
+physical_to_bits(const CANDecoder::SignalPlan& plan, double value, uint64_t& bits) {
+  if(std::isnan(value))
+    return false;
+
+  double raw = (value - plan.offset) / plan.scale;
+
+  if(plan.kind == CANDecoder::IEEEFloat) {
+    if(!std::isfinite(raw))
+      return false;
+
+    if(plan.length == 32) {
+      // The value is rounded to single precision, like the values stored in the frames
+      float single = static_cast<float>(raw);
+      uint32_t single_bits;
+      std::memcpy(&single_bits, &single, sizeof(single_bits));
+      bits = single_bits;
+    }
+    else {
+      std::memcpy(&bits, &raw, sizeof(bits));
+    }
+    return true;
+  }
+
+  double lowest, highest;
+  raw_limits(plan, lowest, highest);
+
+  raw = std::nearbyint(raw);
+  if(!(raw >= lowest && raw <= highest))
+    return false;
+
+  int64_t integer = static_cast<int64_t>(raw);
+  if(std::fabs(plan.physical(integer) - value) > PHYSICAL_TOLERANCE * std::max(1.0, std::fabs(value)))
+    return false;
+
+  bits = static_cast<uint64_t>(integer) & plan.mask;
+  return true;
+}
+
+/**
+ * @brief Ors the 8 bytes of a word into the buffer
+ */
+static void
+store(uint8_t* bytes, uint64_t word, bool big_endian) {
+  for(unsigned i = 0; i < 8; i++)
+    bytes[i] |= static_cast<uint8_t>(big_endian ? word >> (56 - 8 * i) : word >> (8 * i));
+}
+
+const std::size_t CANRawFilter::WORDS;
+const std::size_t CANRawFilter::BATCH_SIZE;
+
+CANRawFilter::CANRawFilter(const CANFrame& frame)
+  : frame_(&frame), mask_(), expected_(), words_(0), satisfiable_(true), exact_(true) { }
+
+CANRawFilter& CANRawFilter::equals(const std::string& signal, double value) {
+  const CANSignal& sig = frame_->at(signal);
+  CANDecoder::SignalPlan plan = CANDecoder::compile(sig);
+
+  if(plan.scale == 0 && plan.kind != CANDecoder::IEEEFloat) {
+    // Constant signal: only its presence can be checked
+    if(value != plan.offset)
+      satisfiable_ = false;
+    add_switch(sig);
+    return *this;
+  }
+
+  uint64_t bits;
+  if(physical_to_bits(plan, value, bits))
+    add(sig, bits);
+  else
+    satisfiable_ = false;
+
+  return *this;
+}
+
+CANRawFilter& CANRawFilter::equals(const std::string& signal, const std::string& label) {
+  const CANSignal& sig = frame_->at(signal);
+  CANDecoder::SignalPlan plan = CANDecoder::compile(sig);
+
+  // The choices are sorted by value: the first match is the smallest value,
+  // like in CANChoiceTable::find(). The choices that do not fit in the signal
+  // would alias other raw values: they are skipped.
+  bool found = false;
+  for(const auto& choice : sig.choices()) {
+    if(choice.second != label)
+      continue;
+
+    found = true;
+    int64_t raw;
+    if(plan.choice_raw(choice.first, raw)) {
+      add(sig, static_cast<uint64_t>(raw));
+      return *this;
+    }
+  }
+
+  if(!found)
+    throw std::out_of_range("No choice \"" + label + "\" for the signal \"" + signal + "\"");
+
+  satisfiable_ = false;
+  return *this;
+}
+
+CANRawFilter& CANRawFilter::equals_raw(const std::string& signal, uint64_t raw) {
+  add(frame_->at(signal), raw);
+  return *this;
+}
+
+void CANRawFilter::add(const CANSignal& signal, uint64_t bits) {
+  CANDecoder::SignalPlan plan = CANDecoder::compile(signal);
+
+  uint64_t mask[WORDS] = {};
+  uint64_t expected[WORDS] = {};
+  place(plan, plan.mask, mask);
+  place(plan, bits & plan.mask, expected);
+
+  for(std::size_t i = 0; i < WORDS; i++) {
+    // Two conditions on the same bits must agree
+    if((mask_[i] & mask[i] & (expected_[i] ^ expected[i])) != 0)
+      satisfiable_ = false;
+
+    mask_[i] |= mask[i];
+    expected_[i] |= expected[i];
+    if(mask_[i] != 0)
+      words_ = std::max(words_, i + 1);
+  }
+
+  add_switch(signal);
+}
+
+void CANRawFilter::add_switch(const CANSignal& signal) {
+  if(!signal.is_multiplexed())
+    return;
+
+  const std::string& name = signal.multiplexer_switch().empty() ? frame_->multiplexor()
+                                                                : signal.multiplexer_switch();
+  const std::vector<CANSignal::MultiplexerRange>& ranges = signal.multiplexer_ranges();
+
+  if(ranges.size() == 1 && ranges[0].min == ranges[0].max && frame_->contains(name))
+    add(frame_->at(name), ranges[0].min);
+  else
+    exact_ = false;
+}
+
+void CANRawFilter::place(const CANDecoder::SignalPlan& plan, uint64_t bits, uint64_t* words) {
+  // Inverse of SignalPlan::bits(): the bits are written where they are read from
+  uint8_t bytes[CANDecoder::Payload::PADDED_SIZE] = {};
+  uint8_t* data = bytes + plan.byte_offset;
+
+  if(plan.big_endian) {
+    store(data + (plan.wide ? 8 : 0), bits << plan.shift, true);
+    if(plan.wide)
+      store(data, bits >> (64 - plan.shift), true);
+  }
+  else {
+    store(data, bits << plan.shift, false);
+    if(plan.wide)
+      store(data + 8, bits >> (64 - plan.shift), false);
+  }
+
+  // compile() guarantees that the signal lies in the first 64 bytes
+  for(std::size_t i = 0; i < WORDS; i++)
+    words[i] |= CANDecoder::load_le(bytes + 8 * i);
+}
+
+bool CANRawFilter::satisfiable() const {
+  return satisfiable_;
+}
+
+bool CANRawFilter::exact() const {
+  return exact_;
+}
+
+unsigned long long CANRawFilter::dbc_id() const {
+  return frame_->dbc_id();
+}
+
+const CANFrame& CANRawFilter::frame() const {
+  return *frame_;
+}
+
+std::size_t CANRawFilter::word_count() const {
+  return words_;
+}
+
+uint64_t CANRawFilter::mask(std::size_t i) const {
+  return mask_[i];
+}
+
+uint64_t CANRawFilter::expected(std::size_t i) const {
+  return expected_[i];
+}
+
+bool CANRawFilter::matches(const LogFrame& frame) const {
+  return frame.dbc_id() == frame_->dbc_id() &&
+         !(frame.flags & (LogFrame::Remote | LogFrame::ErrorFrame)) &&
+         matches(frame.data, frame.length);
+}
+
+std::size_t CANRawFilter::scan(const uint8_t* payloads, std::size_t stride, std::size_t count,
+                               uint32_t* indices) const {
+  if(!satisfiable_)
+    return 0;
+
+  std::size_t found = 0;
+  if(words_ == 0) {
+    for(std::size_t i = 0; i < count; i++)
+      indices[found++] = static_cast<uint32_t>(i);
+    return found;
+  }
+
+  // First pass: one byte per payload, without any branch (vectorized).
+  // Second pass: the indices of the matches are appended without branch either.
+  uint8_t hits[BATCH_SIZE];
+  for(std::size_t base = 0; base < count; base += BATCH_SIZE) {
+    std::size_t size = std::min(BATCH_SIZE, count - base);
+    const uint8_t* batch = payloads + base * stride;
+
+    if(words_ == 1 && stride == 8) {
+      // Packed classic payloads: contiguous loads
+      uint64_t mask = mask_[0];
+      uint64_t expected = expected_[0];
+      for(std::size_t i = 0; i < size; i++)
+        hits[i] = (CANDecoder::load_le(batch + 8 * i) & mask) == expected;
+    }
+    else if(words_ == 1) {
+      uint64_t mask = mask_[0];
+      uint64_t expected = expected_[0];
+      for(std::size_t i = 0; i < size; i++)
+        hits[i] = (CANDecoder::load_le(batch + i * stride) & mask) == expected;
+    }
+    else {
+      for(std::size_t i = 0; i < size; i++) {
+        uint64_t diff = 0;
+        for(std::size_t w = 0; w < words_; w++)
+          diff |= (CANDecoder::load_le(batch + i * stride + 8 * w) & mask_[w]) ^ expected_[w];
+        hits[i] = diff == 0;
+      }
+    }
+
+    for(std::size_t i = 0; i < size; i++) {
+      indices[found] = static_cast<uint32_t>(base + i);
+      found += hits[i];
+    }
+  }
+
+  return found;
+}
+
+std::size_t CANRawFilter::scan(const LogFrame* frames, std::size_t count, uint32_t* indices) const {
+  std::size_t found = 0;
+
+  for(std::size_t i = 0; i < count; i++) {
+    indices[found] = static_cast<uint32_t>(i);
+    found += matches(frames[i]);
+  }
+
+  return found;
+}
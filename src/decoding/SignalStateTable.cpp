@@ -0,0 +1,120 @@
+#include "SignalStateTable.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace CppCAN;
+
+static uint64_t to_bits(double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static double from_bits(uint64_t bits) {
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+SignalStateTable::SignalStateTable(const CANDecoder& decoder)
+  : decoder_(&decoder), frames_(new FrameState[std::max<std::size_t>(decoder.frames().size(), 1)]),
+    values_(new std::atomic<uint64_t>[std::max<std::size_t>(decoder.signal_count(), 1)]),
+    timestamps_(new std::atomic<int64_t>[std::max<std::size_t>(decoder.signal_count(), 1)]) {
+  for(std::size_t i = 0; i < decoder.signal_count(); i++) {
+    values_[i].store(to_bits(0.), std::memory_order_relaxed);
+    timestamps_[i].store(-1, std::memory_order_relaxed);
+  }
+
+  std::size_t largest = 0;
+  for(const CANDecoder::FramePlan& plan : decoder.frames())
+    largest = std::max(largest, plan.signals.size());
+  decoded_.resize(largest);
+}
+
+void SignalStateTable::update(const CANDecoder::FramePlan& plan, const uint8_t* data, std::size_t len,
+                              int64_t timestamp) {
+  // Decoded outside of the critical section: readers only retry while the values are copied
+  std::size_t count = plan.signals.size();
+  std::fill(decoded_.begin(), decoded_.begin() + count, std::numeric_limits<double>::quiet_NaN());
+  decoder_->decode(plan, data, len, decoded_.data());
+
+  FrameState& state = frames_[plan.index];
+  uint64_t sequence = state.sequence.load(std::memory_order_relaxed);
+  state.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  for(std::size_t i = 0; i < count; i++) {
+    // Signals absent from a multiplexed frame are NaN
+    if(plan.is_multiplexed() && std::isnan(decoded_[i]))
+      continue;
+
+    values_[plan.first_signal + i].store(to_bits(decoded_[i]), std::memory_order_relaxed);
+    timestamps_[plan.first_signal + i].store(timestamp, std::memory_order_relaxed);
+  }
+  state.timestamp.store(timestamp, std::memory_order_relaxed);
+  state.updates.store(state.updates.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+  state.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool SignalStateTable::update(const LogFrame& frame) {
+  if(frame.flags & (LogFrame::Remote | LogFrame::ErrorFrame))
+    return false;
+
+  const CANDecoder::FramePlan* plan = decoder_->find(frame.can_id, frame.is_extended());
+  if(plan == nullptr)
+    return false;
+
+  update(*plan, frame.data, frame.length, frame.timestamp);
+  return true;
+}
+
+SignalSample SignalStateTable::get(SignalHandle handle) const {
+  const FrameState& state = frames_[handle.frame];
+  std::size_t index = handle.index;
+  SignalSample sample;
+
+  while(true) {
+    uint64_t sequence = state.sequence.load(std::memory_order_acquire);
+    if(sequence & 1)
+      continue;
+
+    sample.value = from_bits(values_[index].load(std::memory_order_relaxed));
+    sample.timestamp = timestamps_[index].load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(state.sequence.load(std::memory_order_relaxed) == sequence)
+      return sample;
+  }
+}
+
+int64_t SignalStateTable::snapshot(const CANDecoder::FramePlan& plan, SignalSample* samples) const {
+  const FrameState& state = frames_[plan.index];
+  std::size_t count = plan.signals.size();
+
+  while(true) {
+    uint64_t sequence = state.sequence.load(std::memory_order_acquire);
+    if(sequence & 1)
+      continue;
+
+    for(std::size_t i = 0; i < count; i++) {
+      samples[i].value = from_bits(values_[plan.first_signal + i].load(std::memory_order_relaxed));
+      samples[i].timestamp = timestamps_[plan.first_signal + i].load(std::memory_order_relaxed);
+    }
+    int64_t timestamp = state.timestamp.load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(state.sequence.load(std::memory_order_relaxed) == sequence)
+      return timestamp;
+  }
+}
+
+uint64_t SignalStateTable::updates(const CANDecoder::FramePlan& plan) const {
+  return frames_[plan.index].updates.load(std::memory_order_relaxed);
+}
+
+const CANDecoder& SignalStateTable::decoder() const {
+  return *decoder_;
+}
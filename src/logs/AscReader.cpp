@@ -0,0 +1,388 @@
+#include "CANLogReader.h"
+#include "LogParsingUtils.h"
+
+using namespace CppCAN;
+using namespace CppCAN::logs::details;
+
+static const uint32_t MAX_STANDARD_ID = 0x7FF;
+static const uint32_t MAX_EXTENDED_ID = 0x1FFFFFFF;
+static const uint32_t MAX_CHANNEL = 256;
+static const unsigned CLASSIC_MAX_LENGTH = 8;
+
+// Flags field of the CANFD events
+static const uint32_t ASC_FLAG_REMOTE = 0x0010;
+static const uint32_t ASC_FLAG_EDL = 0x1000;
+
+static const int64_t NS_PER_SECOND = 1000000000;
+
+AscReader::AscReader(const char* begin, const char* end)
+  : CANLogReader(begin, end), start_time_(-1), last_time_(0),
+    hex_(true), relative_(false) { }
+
+AscReader::AscReader(const char* begin, const char* end, const AscReader& header, int64_t time)
+  : CANLogReader(begin, end), start_time_(header.start_time_), last_time_(time),
+    hex_(header.hex_), relative_(header.relative_) { }
+
+void AscReader::read_header() {
+  const char* line;
+  const char* line_end;
+
+  for(const char* start = cursor_; next_line(line, line_end); start = cursor_) {
+    const char* c = skip_blanks(line, line_end);
+    if(c != line_end && *c >= '0' && *c <= '9') {
+      // First event: it is left to next()
+      cursor_ = start;
+      lines_--;
+      return;
+    }
+
+    parse_header(c, line_end);
+  }
+}
+
+int64_t AscReader::start_time() const {
+  return start_time_;
+}
+
+int64_t AscReader::last_event_time() const {
+  return last_time_;
+}
+
+bool AscReader::is_hex() const {
+  return hex_;
+}
+
+bool AscReader::has_relative_timestamps() const {
+  return relative_;
+}
+
+bool AscReader::next(LogFrame& frame) {
+  const char* line;
+  const char* line_end;
+
+  while(next_line(line, line_end)) {
+    switch(parse_event(line, line_end, frame)) {
+      case Frame:
+        return true;
+      case Invalid:
+        skipped_++;
+        break;
+      case OtherEvent:
+        break;
+    }
+  }
+
+  return false;
+}
+
+void AscReader::parse_header(const char* c, const char* end) {
+  const char* token;
+  const char* token_end;
+  if(!next_token(c, end, token, token_end))
+    return;
+
+  if(token_equals(token, token_end, "date")) {
+    if(!logs::parse_asc_date(skip_blanks(c, end), end, start_time_))
+      start_time_ = -1;
+  }
+  else if(token_equals(token, token_end, "base")) {
+    // base <hex|dec> timestamps <absolute|relative>
+    while(next_token(c, end, token, token_end)) {
+      if(token_equals(token, token_end, "hex"))
+        hex_ = true;
+      else if(token_equals(token, token_end, "dec"))
+        hex_ = false;
+      else if(token_equals(token, token_end, "relative"))
+        relative_ = true;
+      else if(token_equals(token, token_end, "absolute"))
+        relative_ = false;
+    }
+  }
+  else if(token_equals(token, token_end, "Begin")) {
+    last_time_ = 0;
+  }
+}
+
+bool AscReader::parse_id(const char* begin, const char* end, LogFrame& frame) const {
+  bool extended = begin != end && (end[-1] == 'x' || end[-1] == 'X');
+  if(extended)
+    end--;
+
+  uint32_t id;
+  if(!(hex_ ? logs::parse_hex(begin, end, id) : parse_decimal(begin, end, id)))
+    return false;
+
+  if(id > (extended ? MAX_EXTENDED_ID : MAX_STANDARD_ID))
+    return false;
+
+  frame.can_id = id;
+  frame.flags = extended ? LogFrame::Extended : 0;
+  return true;
+}
+
+static bool
+parse_channel(const char* begin, const char* end, uint8_t& channel) {
+  uint32_t number;
+  if(!parse_decimal(begin, end, number) || number == 0 || number > MAX_CHANNEL)
+    return false;
+
+  channel = static_cast<uint8_t>(number - 1);
+  return true;
+}
+
+static bool
+parse_direction(const char* begin, const char* end, uint8_t& flags) {
+  if(token_equals(begin, end, "Rx"))
+    return true;
+
+  if(token_equals(begin, end, "Tx") || token_equals(begin, end, "TxRq")) {
+    flags |= LogFrame::Tx;
+    return true;
+  }
+
+  return false;
+}
+
+static bool
+is_bit(const char* begin, const char* end) {
+  return end - begin == 1 && (*begin == '0' || *begin == '1');
+}
+
+static bool
+parse_bytes(const char*& c, const char* end, unsigned length, uint8_t* data) {
+  const char* token;
+  const char* token_end;
+  for(unsigned i = 0; i < length; i++) {
+    if(!next_token(c, end, token, token_end) || token_end - token != 2 ||
+       !parse_hex_byte(token, data[i]))
+      return false;
+  }
+
+  return true;
+}
+
+AscReader::LineResult AscReader::parse_event(const char* c, const char* end, LogFrame& frame) {
+  c = skip_blanks(c, end);
+  if(c == end)
+    return OtherEvent;
+
+  // Header lines, comments and trigger blocks' delimiters
+  if(*c < '0' || *c > '9') {
+    parse_header(c, end);
+    return OtherEvent;
+  }
+
+  const char* token;
+  const char* token_end;
+  next_token(c, end, token, token_end);
+
+  int64_t time;
+  if(!logs::parse_timestamp(token, token_end, time))
+    return Invalid;
+
+  if(relative_)
+    time += last_time_;
+  last_time_ = time;
+
+  if(!next_token(c, end, token, token_end))
+    return OtherEvent;
+
+  if(token_equals(token, token_end, "CANFD")) {
+    frame.timestamp = time;
+    return parse_fd(c, end, frame);
+  }
+
+  // Classic CAN events start with the channel number. Any other kind of
+  // event (system variables, J1939, LIN...) is skipped here.
+  uint8_t channel;
+  if(!parse_channel(token, token_end, channel))
+    return OtherEvent;
+
+  frame.timestamp = time;
+  frame.channel = channel;
+
+  const char* id = skip_blanks(c, end);
+  if(token_equals(id, skip_token(id, end), "ErrorFrame")) {
+    frame.can_id = 0;
+    frame.length = 0;
+    frame.flags = LogFrame::ErrorFrame;
+    return Frame;
+  }
+
+  return parse_classic(c, end, frame);
+}
+
+AscReader::LineResult AscReader::parse_classic(const char* c, const char* end, LogFrame& frame) {
+  const char* token;
+  const char* token_end;
+
+  // Channel events that are not frames (statistics, chip states...) are
+  // recognized by the lack of a valid ID followed by a direction
+  if(!next_token(c, end, token, token_end) || !parse_id(token, token_end, frame))
+    return OtherEvent;
+
+  if(!next_token(c, end, token, token_end) || !parse_direction(token, token_end, frame.flags))
+    return OtherEvent;
+
+  if(!next_token(c, end, token, token_end) || token_end - token != 1)
+    return Invalid;
+
+  if(*token == 'r') {
+    // Remote frame, optionally followed by the requested DLC
+    frame.flags |= LogFrame::Remote;
+    frame.length = 0;
+
+    const char* dlc = skip_blanks(c, end);
+    if(skip_token(dlc, end) - dlc == 1 && hex_digit(*dlc) <= CLASSIC_MAX_LENGTH)
+      frame.length = hex_digit(*dlc);
+    return Frame;
+  }
+
+  if(*token != 'd' || !next_token(c, end, token, token_end) || token_end - token != 1)
+    return Invalid;
+
+  uint8_t dlc = hex_digit(*token);
+  if(dlc > 0xF)
+    return Invalid;
+
+  // DLCs 9 to 15 mean 8 bytes for classic frames
+  frame.length = dlc > CLASSIC_MAX_LENGTH ? CLASSIC_MAX_LENGTH : dlc;
+  return parse_bytes(c, end, frame.length, frame.data) ? Frame : Invalid;
+}
+
+AscReader::LineResult AscReader::parse_fd(const char* c, const char* end, LogFrame& frame) {
+  const char* token;
+  const char* token_end;
+
+  // <channel> <dir> <id> [<name>] <brs> <esi> <dlc> <data length> <data>
+  // [<duration> <message length> <flags> ...]
+  if(!next_token(c, end, token, token_end) || !parse_channel(token, token_end, frame.channel))
+    return Invalid;
+
+  uint8_t direction = 0;
+  if(!next_token(c, end, token, token_end) || !parse_direction(token, token_end, direction))
+    return Invalid;
+
+  if(!next_token(c, end, token, token_end) || !parse_id(token, token_end, frame))
+    return Invalid;
+  frame.flags |= direction;
+
+  // The symbolic name of the frame is optional: without a name, the ID
+  // is followed by the BRS and ESI bits
+  const char* lookahead = c;
+  const char* brs_token;
+  const char* esi_token;
+  bool has_name = !next_token(lookahead, end, brs_token, token_end) || !is_bit(brs_token, token_end) ||
+                  !next_token(lookahead, end, esi_token, token_end) || !is_bit(esi_token, token_end);
+  if(has_name)
+    next_token(c, end, token, token_end);
+
+  uint32_t brs, esi, dlc, length;
+  if(!next_token(c, end, token, token_end) || !parse_decimal(token, token_end, brs) || brs > 1 ||
+     !next_token(c, end, token, token_end) || !parse_decimal(token, token_end, esi) || esi > 1 ||
+     !next_token(c, end, token, token_end) || !logs::parse_hex(token, token_end, dlc) || dlc > 0xF ||
+     !next_token(c, end, token, token_end) || !parse_decimal(token, token_end, length) ||
+     length > CANFrame::MAX_PAYLOAD_LENGTH)
+    return Invalid;
+
+  frame.length = static_cast<uint8_t>(length);
+  if(!parse_bytes(c, end, length, frame.data))
+    return Invalid;
+
+  // The flags tell if the frame is really a CAN FD frame (EDL)
+  uint32_t asc_flags = ASC_FLAG_EDL;
+  const char* trailing = c;
+  if(next_token(trailing, end, token, token_end) && next_token(trailing, end, token, token_end) &&
+     next_token(trailing, end, token, token_end)) {
+    if(!logs::parse_hex(token, token_end, asc_flags))
+      asc_flags = ASC_FLAG_EDL;
+  }
+
+  if(asc_flags & ASC_FLAG_EDL) {
+    frame.flags |= LogFrame::FD;
+    if(brs)
+      frame.flags |= LogFrame::BitRateSwitch;
+    if(esi)
+      frame.flags |= LogFrame::ErrorStateIndicator;
+  }
+  else {
+    if(length > CLASSIC_MAX_LENGTH)
+      return Invalid;
+    if(asc_flags & ASC_FLAG_REMOTE) {
+      frame.flags |= LogFrame::Remote;
+      frame.length = static_cast<uint8_t>(dlc > CLASSIC_MAX_LENGTH ? CLASSIC_MAX_LENGTH : dlc);
+    }
+  }
+
+  return Frame;
+}
+
+// Number of days between 01/01/1970 and the given date (proleptic Gregorian calendar)
+static int64_t
+days_from_civil(int64_t year, unsigned month, unsigned day) {
+  year -= month <= 2;
+  int64_t era = (year >= 0 ? year : year - 399) / 400;
+  unsigned year_of_era = static_cast<unsigned>(year - era * 400);
+  unsigned day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+  return era * 146097 + static_cast<int64_t>(day_of_era) - 719468;
+}
+
+bool logs::parse_asc_date(const char* c, const char* end, int64_t& nanoseconds) {
+  static const char* MONTHS[] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+  };
+
+  const char* token;
+  const char* token_end;
+
+  // Week day (ignored) and month
+  if(!next_token(c, end, token, token_end) || !next_token(c, end, token, token_end) ||
+     token_end - token != 3)
+    return false;
+
+  unsigned month = 0;
+  while(month < 12 && std::memcmp(token, MONTHS[month], 3) != 0)
+    month++;
+  if(month == 12)
+    return false;
+
+  uint32_t day;
+  if(!next_token(c, end, token, token_end) || !parse_decimal(token, token_end, day) ||
+     day == 0 || day > 31)
+    return false;
+
+  // hh:mm:ss with an optional fractional part
+  if(!next_token(c, end, token, token_end) || token_end - token < 8 ||
+     token[2] != ':' || token[5] != ':')
+    return false;
+
+  uint32_t hours, minutes;
+  int64_t seconds;
+  if(!parse_decimal(token, token + 2, hours) || !parse_decimal(token + 3, token + 5, minutes) ||
+     !logs::parse_timestamp(token + 6, token_end, seconds) || hours > 23 || minutes > 59)
+    return false;
+
+  if(!next_token(c, end, token, token_end))
+    return false;
+
+  // 12-hour clock
+  bool am = token_equals(token, token_end, "am");
+  bool pm = token_equals(token, token_end, "pm");
+  if(am || pm) {
+    if(hours == 0 || hours > 12)
+      return false;
+    hours = hours % 12 + (pm ? 12 : 0);
+
+    if(!next_token(c, end, token, token_end))
+      return false;
+  }
+
+  uint32_t year;
+  if(!parse_decimal(token, token_end, year))
+    return false;
+
+  int64_t days = days_from_civil(year, month + 1, day);
+  nanoseconds = ((days * 24 + hours) * 60 + minutes) * 60 * NS_PER_SECOND + seconds;
+  return true;
+}
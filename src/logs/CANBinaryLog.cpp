@@ -0,0 +1,527 @@
+#include "CANBinaryLog.h"
+#include "LogParsingUtils.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+using namespace CppCAN;
+using namespace CppCAN::logs::details;
+
+static const char FILE_MAGIC[8] = { 'C', 'P', 'P', 'C', 'A', 'N', 'B', 'L' };
+static const char BLOCK_MAGIC[4] = { 'C', 'B', 'L', 'K' };
+static const char FOOTER_MAGIC[8] = { 'C', 'P', 'C', 'B', 'L', 'I', 'D', 'X' };
+
+static const std::size_t DEFAULT_BLOCK_SIZE = 1 << 16;
+
+// The length of the names of the channels is stored in a byte
+static const std::size_t MAX_CHANNEL_NAME = 255;
+
+// Largest record: timestamp and ID varints, header, extra and channel bytes, payload
+static const std::size_t MAX_RECORD_SIZE = 10 + 3 + 5 + CANFrame::MAX_PAYLOAD_LENGTH;
+
+// Record header byte
+static const uint8_t REC_DLC_MASK = 0x0F;
+static const uint8_t REC_EXTENDED = 0x10;
+static const uint8_t REC_FD = 0x20;
+static const uint8_t REC_REMOTE = 0x40;
+static const uint8_t REC_EXTRA = 0x80;
+
+// Record extra byte
+static const uint8_t EXTRA_BRS = 0x01;
+static const uint8_t EXTRA_ESI = 0x02;
+static const uint8_t EXTRA_TX = 0x04;
+static const uint8_t EXTRA_ERROR = 0x08;
+static const uint8_t EXTRA_CHANNEL = 0x10;
+
+static uint8_t*
+put_varint(uint8_t* out, uint64_t value) {
+  while(value >= 0x80) {
+    *out++ = static_cast<uint8_t>(value | 0x80);
+    value >>= 7;
+  }
+  *out++ = static_cast<uint8_t>(value);
+  return out;
+}
+
+/**
+ * @return false if the varint is truncated or longer than 64 bits
+ */
+static bool
+get_varint(const uint8_t*& in, const uint8_t* end, uint64_t& value) {
+  value = 0;
+  for(unsigned shift = 0; shift < 64 && in != end; shift += 7) {
+    uint8_t byte = *in++;
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if(!(byte & 0x80))
+      return true;
+  }
+
+  return false;
+}
+
+static uint64_t
+zigzag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t
+unzigzag(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+/*
+ * CRC-32 (reflected polynomial 0xEDB88320), table-driven
+ */
+static const struct CrcTable {
+  CrcTable() {
+    for(uint32_t i = 0; i < 256; i++) {
+      uint32_t crc = i;
+      for(int bit = 0; bit < 8; bit++)
+        crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1)));
+      values[i] = crc;
+    }
+  }
+
+  uint32_t values[256];
+} CRC_TABLE;
+
+uint32_t binlog::crc32(const uint8_t* data, std::size_t size) {
+  uint32_t crc = 0xFFFFFFFFU;
+  for(std::size_t i = 0; i < size; i++)
+    crc = CRC_TABLE.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+bool binlog::is_binary_log(const char* begin, const char* end) {
+  return static_cast<std::size_t>(end - begin) >= FILE_HEADER_SIZE &&
+         std::memcmp(begin, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0;
+}
+
+/*
+ * Writer
+ */
+BinaryLogWriter::Options::Options()
+  : block_size(DEFAULT_BLOCK_SIZE) { }
+
+BinaryLogWriter::BinaryLogWriter(const std::string& path, const Options& options)
+  : file_(nullptr), options_(options), offset_(0), block_frames_(0),
+    first_timestamp_(0), min_timestamp_(0), max_timestamp_(0), last_timestamp_(0),
+    frame_count_(0) {
+  file_ = std::fopen(path.c_str(), "wb");
+  if(file_ == nullptr)
+    throw CANLogException("Cannot create " + path + ": " + std::strerror(errno));
+
+  // Blocks are written with a single call: the stdio buffer is not needed
+  std::setvbuf(file_, nullptr, _IONBF, 0);
+  records_.reserve(options_.block_size + MAX_RECORD_SIZE);
+
+  uint8_t header[binlog::FILE_HEADER_SIZE] = { 0 };
+  std::memcpy(header, FILE_MAGIC, sizeof(FILE_MAGIC));
+  store_u32(header + 8, binlog::VERSION);
+  write_bytes(header, sizeof(header));
+}
+
+BinaryLogWriter::~BinaryLogWriter() {
+  try {
+    close();
+  }
+  catch(const CANLogException&) {
+    // Nothing to do: errors can only be reported by an explicit close()
+  }
+}
+
+std::size_t BinaryLogWriter::frame_count() const {
+  return frame_count_;
+}
+
+std::size_t BinaryLogWriter::block_count() const {
+  return index_.size();
+}
+
+void BinaryLogWriter::set_channels(const std::vector<std::string>& names) {
+  channels_ = names;
+}
+
+void BinaryLogWriter::write_bytes(const void* data, std::size_t size) {
+  if(std::fwrite(data, 1, size, file_) != size)
+    throw CANLogException(std::string("Cannot write the binary log: ") + std::strerror(errno));
+  offset_ += size;
+}
+
+void BinaryLogWriter::write(const LogFrame& frame) {
+  if(file_ == nullptr)
+    throw CANLogException("The binary log is closed");
+
+  if(block_frames_ == 0) {
+    first_timestamp_ = min_timestamp_ = max_timestamp_ = last_timestamp_ = frame.timestamp;
+  }
+  else {
+    min_timestamp_ = std::min(min_timestamp_, frame.timestamp);
+    max_timestamp_ = std::max(max_timestamp_, frame.timestamp);
+  }
+
+  std::size_t size = records_.size();
+  records_.resize(size + MAX_RECORD_SIZE);
+  uint8_t* out = records_.data() + size;
+
+  out = put_varint(out, zigzag(frame.timestamp - last_timestamp_));
+  last_timestamp_ = frame.timestamp;
+
+  bool remote = (frame.flags & LogFrame::Remote) != 0;
+  unsigned length = std::min<unsigned>(frame.length, CANFrame::MAX_PAYLOAD_LENGTH);
+  unsigned dlc = CANFrame::length_to_dlc(length);
+
+  uint8_t header = static_cast<uint8_t>(dlc);
+  if(frame.flags & LogFrame::Extended)
+    header |= REC_EXTENDED;
+  if(frame.flags & LogFrame::FD)
+    header |= REC_FD;
+  if(remote)
+    header |= REC_REMOTE;
+
+  uint8_t extra = 0;
+  if(frame.flags & LogFrame::BitRateSwitch)
+    extra |= EXTRA_BRS;
+  if(frame.flags & LogFrame::ErrorStateIndicator)
+    extra |= EXTRA_ESI;
+  if(frame.flags & LogFrame::Tx)
+    extra |= EXTRA_TX;
+  if(frame.flags & LogFrame::ErrorFrame)
+    extra |= EXTRA_ERROR;
+  if(frame.channel != 0)
+    extra |= EXTRA_CHANNEL;
+
+  if(extra != 0)
+    header |= REC_EXTRA;
+
+  *out++ = header;
+  if(extra != 0)
+    *out++ = extra;
+  if(extra & EXTRA_CHANNEL)
+    *out++ = frame.channel;
+  out = put_varint(out, frame.can_id);
+
+  if(!remote) {
+    unsigned padded = CANFrame::dlc_to_length(dlc);
+    std::memcpy(out, frame.data, length);
+    std::memset(out + length, 0, padded - length);
+    out += padded;
+  }
+
+  records_.resize(static_cast<std::size_t>(out - records_.data()));
+  block_frames_++;
+  frame_count_++;
+
+  if(records_.size() >= options_.block_size)
+    flush_block();
+}
+
+void BinaryLogWriter::flush_block() {
+  if(block_frames_ == 0)
+    return;
+
+  uint8_t header[binlog::BLOCK_HEADER_SIZE];
+  std::memcpy(header, BLOCK_MAGIC, sizeof(BLOCK_MAGIC));
+  store_u32(header + 4, static_cast<uint32_t>(records_.size()));
+  store_u32(header + 8, block_frames_);
+  store_u32(header + 12, binlog::crc32(records_.data(), records_.size()));
+  store_u64(header + 16, static_cast<uint64_t>(first_timestamp_));
+  store_u64(header + 24, static_cast<uint64_t>(min_timestamp_));
+  store_u64(header + 32, static_cast<uint64_t>(max_timestamp_));
+
+  index_.push_back({ offset_, min_timestamp_, max_timestamp_, block_frames_ });
+
+  write_bytes(header, sizeof(header));
+  write_bytes(records_.data(), records_.size());
+
+  records_.clear();
+  block_frames_ = 0;
+}
+
+void BinaryLogWriter::close() {
+  if(file_ == nullptr)
+    return;
+
+  try {
+    flush_block();
+
+    std::vector<uint8_t> index(index_.size() * binlog::INDEX_ENTRY_SIZE);
+    for(std::size_t i = 0; i < index_.size(); i++) {
+      uint8_t* entry = index.data() + i * binlog::INDEX_ENTRY_SIZE;
+      store_u64(entry, index_[i].offset);
+      store_u64(entry + 8, static_cast<uint64_t>(index_[i].min_timestamp));
+      store_u64(entry + 16, static_cast<uint64_t>(index_[i].max_timestamp));
+      store_u32(entry + 24, index_[i].frame_count);
+      store_u32(entry + 28, 0);
+    }
+
+    if(!channels_.empty()) {
+      std::size_t table = index.size();
+      index.resize(table + 4);
+      store_u32(index.data() + table, static_cast<uint32_t>(channels_.size()));
+      for(const std::string& name : channels_) {
+        std::size_t length = std::min(name.size(), MAX_CHANNEL_NAME);
+        index.push_back(static_cast<uint8_t>(length));
+        index.insert(index.end(), name.begin(), name.begin() + static_cast<std::ptrdiff_t>(length));
+      }
+    }
+
+    uint8_t footer[binlog::FOOTER_SIZE];
+    store_u64(footer, offset_);
+    store_u32(footer + 8, static_cast<uint32_t>(index_.size()));
+    store_u32(footer + 12, binlog::crc32(index.data(), index.size()));
+    std::memcpy(footer + 16, FOOTER_MAGIC, sizeof(FOOTER_MAGIC));
+
+    write_bytes(index.data(), index.size());
+    write_bytes(footer, sizeof(footer));
+  }
+  catch(const CANLogException&) {
+    std::fclose(file_);
+    file_ = nullptr;
+    throw;
+  }
+
+  bool closed = std::fclose(file_) == 0;
+  file_ = nullptr;
+  if(!closed)
+    throw CANLogException(std::string("Cannot close the binary log: ") + std::strerror(errno));
+}
+
+/*
+ * Block reader
+ */
+BinaryBlockReader::BinaryBlockReader(const char* begin, const char* end)
+  : block_(reinterpret_cast<const uint8_t*>(begin)), end_(reinterpret_cast<const uint8_t*>(end)),
+    cursor_(nullptr), records_end_(nullptr), remaining_(0), timestamp_(0), frames_(0) { }
+
+std::size_t BinaryBlockReader::frame_count() const {
+  return frames_;
+}
+
+bool BinaryBlockReader::next_block() {
+  if(block_ == end_)
+    return false;
+
+  if(static_cast<std::size_t>(end_ - block_) < binlog::BLOCK_HEADER_SIZE ||
+     std::memcmp(block_, BLOCK_MAGIC, sizeof(BLOCK_MAGIC)) != 0)
+    throw CANLogException("Invalid block header in the binary log");
+
+  uint32_t size = load_u32(block_ + 4);
+  const uint8_t* records = block_ + binlog::BLOCK_HEADER_SIZE;
+  if(size > static_cast<std::size_t>(end_ - records))
+    throw CANLogException("Truncated block in the binary log");
+
+  if(binlog::crc32(records, size) != load_u32(block_ + 12))
+    throw CANLogException("Corrupted block in the binary log (invalid checksum)");
+
+  remaining_ = load_u32(block_ + 8);
+  timestamp_ = static_cast<int64_t>(load_u64(block_ + 16));
+  cursor_ = records;
+  records_end_ = records + size;
+  block_ = records_end_;
+  return true;
+}
+
+bool BinaryBlockReader::next(LogFrame& frame) {
+  while(remaining_ == 0) {
+    if(!next_block())
+      return false;
+  }
+
+  uint64_t delta, id;
+  if(!get_varint(cursor_, records_end_, delta) || cursor_ == records_end_)
+    throw CANLogException("Invalid record in the binary log");
+
+  timestamp_ += unzigzag(delta);
+  frame.timestamp = timestamp_;
+
+  uint8_t header = *cursor_++;
+  uint8_t extra = 0;
+  if(header & REC_EXTRA) {
+    if(cursor_ == records_end_)
+      throw CANLogException("Invalid record in the binary log");
+    extra = *cursor_++;
+  }
+
+  frame.channel = 0;
+  if(extra & EXTRA_CHANNEL) {
+    if(cursor_ == records_end_)
+      throw CANLogException("Invalid record in the binary log");
+    frame.channel = *cursor_++;
+  }
+
+  if(!get_varint(cursor_, records_end_, id) || id > 0x1FFFFFFF)
+    throw CANLogException("Invalid record in the binary log");
+  frame.can_id = static_cast<uint32_t>(id);
+
+  uint8_t flags = 0;
+  if(header & REC_EXTENDED)
+    flags |= LogFrame::Extended;
+  if(header & REC_FD)
+    flags |= LogFrame::FD;
+  if(header & REC_REMOTE)
+    flags |= LogFrame::Remote;
+  if(extra & EXTRA_BRS)
+    flags |= LogFrame::BitRateSwitch;
+  if(extra & EXTRA_ESI)
+    flags |= LogFrame::ErrorStateIndicator;
+  if(extra & EXTRA_TX)
+    flags |= LogFrame::Tx;
+  if(extra & EXTRA_ERROR)
+    flags |= LogFrame::ErrorFrame;
+  frame.flags = flags;
+
+  unsigned length = CANFrame::dlc_to_length(header & REC_DLC_MASK);
+  frame.length = static_cast<uint8_t>(length);
+
+  if(!(header & REC_REMOTE)) {
+    if(length > static_cast<std::size_t>(records_end_ - cursor_))
+      throw CANLogException("Invalid record in the binary log");
+    std::memcpy(frame.data, cursor_, length);
+    cursor_ += length;
+  }
+
+  remaining_--;
+  frames_++;
+  return true;
+}
+
+/*
+ * Log reader
+ */
+
+/**
+ * @brief Reads the channel table [in, end) written by BinaryLogWriter::close()
+ * @return false if the table is invalid (an empty range is an empty table)
+ */
+static bool
+read_channel_table(const uint8_t* in, const uint8_t* end, std::vector<std::string>& names) {
+  if(in == end)
+    return true;
+  if(end - in < 4)
+    return false;
+
+  uint32_t count = load_u32(in);
+  in += 4;
+  for(uint32_t i = 0; i < count; i++) {
+    if(in == end || *in >= end - in)
+      return false;
+
+    std::size_t length = *in++;
+    names.emplace_back(reinterpret_cast<const char*>(in), length);
+    in += length;
+  }
+
+  return in == end;
+}
+
+BinaryLogReader::BinaryLogReader(const char* begin, const char* end)
+  : begin_(begin), end_(end), has_index_(false), reader_(end, end) {
+  if(!binlog::is_binary_log(begin, end))
+    throw CANLogException("Not a binary log");
+
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(begin);
+  std::size_t size = static_cast<std::size_t>(end - begin);
+  if(load_u32(data + 8) != binlog::VERSION)
+    throw CANLogException("Unsupported version of the binary log");
+
+  // Index written by BinaryLogWriter::close()
+  if(size >= binlog::FILE_HEADER_SIZE + binlog::FOOTER_SIZE) {
+    const uint8_t* footer = data + size - binlog::FOOTER_SIZE;
+    uint64_t index_offset = load_u64(footer);
+    uint64_t block_count = load_u32(footer + 8);
+    uint64_t index_end = size - binlog::FOOTER_SIZE;
+
+    if(std::memcmp(footer + 16, FOOTER_MAGIC, sizeof(FOOTER_MAGIC)) == 0 &&
+       index_offset >= binlog::FILE_HEADER_SIZE && index_offset <= index_end &&
+       block_count * binlog::INDEX_ENTRY_SIZE <= index_end - index_offset &&
+       binlog::crc32(data + index_offset, index_end - index_offset) == load_u32(footer + 12)) {
+      // The channel table, if any, follows the block index
+      const uint8_t* table = data + index_offset + block_count * binlog::INDEX_ENTRY_SIZE;
+      has_index_ = read_channel_table(table, data + index_end, channels_);
+
+      for(uint64_t i = 0; i < block_count && has_index_; i++) {
+        const uint8_t* entry = data + index_offset + i * binlog::INDEX_ENTRY_SIZE;
+        BlockInfo info;
+        info.offset = load_u64(entry);
+        info.min_timestamp = static_cast<int64_t>(load_u64(entry + 8));
+        info.max_timestamp = static_cast<int64_t>(load_u64(entry + 16));
+        info.frame_count = load_u32(entry + 24);
+
+        uint64_t next = i + 1 < block_count ? load_u64(entry + binlog::INDEX_ENTRY_SIZE) : index_offset;
+        has_index_ = info.offset < next && next <= index_offset;
+        info.size = next - info.offset;
+        blocks_.push_back(info);
+      }
+
+      if(!has_index_) {
+        blocks_.clear();
+        channels_.clear();
+      }
+    }
+  }
+
+  // No (valid) index: the blocks are found through their headers. The walk
+  // stops at the first invalid or truncated block.
+  if(!has_index_) {
+    uint64_t offset = binlog::FILE_HEADER_SIZE;
+    while(size - offset >= binlog::BLOCK_HEADER_SIZE &&
+          std::memcmp(data + offset, BLOCK_MAGIC, sizeof(BLOCK_MAGIC)) == 0) {
+      const uint8_t* header = data + offset;
+      uint64_t block_size = binlog::BLOCK_HEADER_SIZE + static_cast<uint64_t>(load_u32(header + 4));
+      if(block_size > size - offset)
+        break;
+
+      BlockInfo info;
+      info.offset = offset;
+      info.size = block_size;
+      info.frame_count = load_u32(header + 8);
+      info.min_timestamp = static_cast<int64_t>(load_u64(header + 24));
+      info.max_timestamp = static_cast<int64_t>(load_u64(header + 32));
+      blocks_.push_back(info);
+      offset += block_size;
+    }
+  }
+
+  reader_ = blocks_reader(0, blocks_.size());
+}
+
+const std::vector<BinaryLogReader::BlockInfo>& BinaryLogReader::blocks() const {
+  return blocks_;
+}
+
+const std::vector<std::string>& BinaryLogReader::channels() const {
+  return channels_;
+}
+
+bool BinaryLogReader::has_index() const {
+  return has_index_;
+}
+
+std::size_t BinaryLogReader::frame_count() const {
+  std::size_t count = 0;
+  for(const BlockInfo& block : blocks_)
+    count += block.frame_count;
+  return count;
+}
+
+BinaryBlockReader BinaryLogReader::blocks_reader(std::size_t first, std::size_t last) const {
+  last = std::min(last, blocks_.size());
+  if(first >= last)
+    return BinaryBlockReader(end_, end_);
+
+  return BinaryBlockReader(begin_ + blocks_[first].offset,
+                           begin_ + blocks_[last - 1].offset + blocks_[last - 1].size);
+}
+
+bool BinaryLogReader::next(LogFrame& frame) {
+  return reader_.next(frame);
+}
+
+void BinaryLogReader::seek(int64_t timestamp) {
+  std::size_t first = 0;
+  while(first < blocks_.size() && blocks_[first].max_timestamp < timestamp)
+    first++;
+
+  reader_ = blocks_reader(first, blocks_.size());
+}
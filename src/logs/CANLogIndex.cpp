@@ -0,0 +1,408 @@
+#include "CANLogIndex.h"
+#include "LogParsingUtils.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+
+using namespace CppCAN;
+using namespace CppCAN::logs::details;
+
+static const std::size_t DEFAULT_REGION_SIZE = 1 << 18;
+
+// The fingerprint covers the beginning and the end of the log
+static const std::size_t FINGERPRINT_SIZE = 1 << 16;
+
+static const char INDEX_MAGIC[8] = { 'C', 'P', 'C', 'L', 'G', 'I', 'D', 'X' };
+static const uint32_t INDEX_VERSION = 1;
+static const std::size_t INDEX_HEADER_SIZE = 48;
+static const std::size_t REGION_SIZE = 44;
+
+/**
+ * @return The index of the lowest set bit of a non-zero word
+ */
+static unsigned lowest_bit(uint64_t word) {
+#if defined(__GNUC__)
+  return static_cast<unsigned>(__builtin_ctzll(word));
+#else
+  unsigned bit = 0;
+  for(; (word & 1) == 0; word >>= 1)
+    bit++;
+  return bit;
+#endif
+}
+
+CANLogIndex::Options::Options()
+  : region_size(DEFAULT_REGION_SIZE) { }
+
+CANLogIndex::CANLogIndex()
+  : format_(ParallelLogDecoder::Candump), log_size_(0), fingerprint_(0), bitmap_words_(0) { }
+
+uint32_t CANLogIndex::fingerprint(const char* begin, const char* end) {
+  std::size_t size = static_cast<std::size_t>(end - begin);
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(begin);
+  std::size_t head = std::min(size, FINGERPRINT_SIZE);
+  std::size_t tail = std::min(size - head, FINGERPRINT_SIZE);
+
+  return binlog::crc32(data, head) ^ binlog::crc32(data + size - tail, tail);
+}
+
+namespace {
+/**
+ * Accumulates the frames of the regions and the bitmaps of the IDs
+ */
+struct IndexBuilder {
+  std::vector<CANLogIndex::Region> regions;
+  std::map<unsigned long long, std::vector<uint64_t>> bitmaps;
+
+  void start(uint64_t begin, int64_t time) {
+    CANLogIndex::Region region = { begin, begin, time, 0, 0, 0 };
+    regions.push_back(region);
+  }
+
+  void add(const LogFrame& frame) {
+    CANLogIndex::Region& region = regions.back();
+    if(region.frame_count == 0) {
+      region.min_timestamp = region.max_timestamp = frame.timestamp;
+    }
+    else {
+      region.min_timestamp = std::min(region.min_timestamp, frame.timestamp);
+      region.max_timestamp = std::max(region.max_timestamp, frame.timestamp);
+    }
+    region.frame_count++;
+
+    std::size_t i = regions.size() - 1;
+    std::vector<uint64_t>& bitmap = bitmaps[frame.dbc_id()];
+    if(bitmap.size() <= i / 64)
+      bitmap.resize(i / 64 + 1, 0);
+    bitmap[i / 64] |= 1ULL << (i % 64);
+  }
+};
+}
+
+template<typename Reader>
+static void
+index_text(IndexBuilder& builder, Reader& reader, const char* begin, std::size_t region_size,
+           const std::function<int64_t(const Reader&)>& time) {
+  builder.start(static_cast<uint64_t>(reader.position() - begin), time(reader));
+
+  LogFrame frame;
+  while(reader.next(frame)) {
+    builder.add(frame);
+
+    // The regions end at line boundaries: position() is the start of the next line
+    uint64_t position = static_cast<uint64_t>(reader.position() - begin);
+    if(position - builder.regions.back().begin >= region_size) {
+      builder.regions.back().end = position;
+      builder.start(position, time(reader));
+    }
+  }
+
+  builder.regions.back().end = static_cast<uint64_t>(reader.position() - begin);
+  if(builder.regions.size() > 1 && builder.regions.back().frame_count == 0 &&
+     builder.regions.back().begin == builder.regions.back().end)
+    builder.regions.pop_back();
+}
+
+CANLogIndex CANLogIndex::build(ParallelLogDecoder::Format format, const char* begin, const char* end,
+                               const Options& options) {
+  CANLogIndex index;
+  index.format_ = format;
+  index.log_size_ = static_cast<uint64_t>(end - begin);
+  index.fingerprint_ = fingerprint(begin, end);
+
+  IndexBuilder builder;
+  std::size_t region_size = std::max<std::size_t>(options.region_size, 1);
+
+  if(format == ParallelLogDecoder::Candump) {
+    CandumpReader reader(begin, end);
+    index_text<CandumpReader>(builder, reader, begin, region_size,
+                              [](const CandumpReader&) { return int64_t(0); });
+    index.channels_ = reader.channels();
+  }
+  else if(format == ParallelLogDecoder::Asc) {
+    AscReader reader(begin, end);
+    reader.read_header();
+    index_text<AscReader>(builder, reader, begin, region_size,
+                          [](const AscReader& r) { return r.last_event_time(); });
+  }
+  else {
+    BinaryLogReader reader(begin, end);
+    for(std::size_t i = 0; i < reader.blocks().size(); i++) {
+      const BinaryLogReader::BlockInfo& block = reader.blocks()[i];
+      builder.start(block.offset, 0);
+      builder.regions.back().end = block.offset + block.size;
+
+      BinaryBlockReader blocks = reader.blocks_reader(i, i + 1);
+      LogFrame frame;
+      while(blocks.next(frame))
+        builder.add(frame);
+    }
+  }
+
+  index.regions_ = std::move(builder.regions);
+  index.bitmap_words_ = (index.regions_.size() + 63) / 64;
+  for(auto& id : builder.bitmaps) {
+    id.second.resize(index.bitmap_words_, 0);
+    index.ids_.push_back(id.first);
+    index.bitmaps_.insert(index.bitmaps_.end(), id.second.begin(), id.second.end());
+  }
+
+  return index;
+}
+
+bool CANLogIndex::matches(const char* begin, const char* end) const {
+  return static_cast<uint64_t>(end - begin) == log_size_ && fingerprint(begin, end) == fingerprint_;
+}
+
+ParallelLogDecoder::Format CANLogIndex::format() const {
+  return format_;
+}
+
+const std::vector<CANLogIndex::Region>& CANLogIndex::regions() const {
+  return regions_;
+}
+
+const std::vector<unsigned long long>& CANLogIndex::ids() const {
+  return ids_;
+}
+
+const std::vector<std::string>& CANLogIndex::channels() const {
+  return channels_;
+}
+
+bool CANLogIndex::contains(unsigned long long dbc_id, std::size_t region) const {
+  auto ite = std::lower_bound(ids_.begin(), ids_.end(), dbc_id);
+  if(ite == ids_.end() || *ite != dbc_id || region >= regions_.size())
+    return false;
+
+  const uint64_t* bitmap = bitmaps_.data() + (ite - ids_.begin()) * bitmap_words_;
+  return (bitmap[region / 64] >> (region % 64)) & 1;
+}
+
+std::vector<std::size_t> CANLogIndex::find_regions(int64_t from, int64_t to) const {
+  std::vector<std::size_t> result;
+  for(std::size_t i = 0; i < regions_.size(); i++) {
+    const Region& region = regions_[i];
+    if(region.frame_count != 0 && region.max_timestamp >= from && region.min_timestamp <= to)
+      result.push_back(i);
+  }
+
+  return result;
+}
+
+std::vector<std::size_t> CANLogIndex::find_regions(unsigned long long dbc_id, int64_t from, int64_t to) const {
+  std::vector<std::size_t> result;
+  auto ite = std::lower_bound(ids_.begin(), ids_.end(), dbc_id);
+  if(ite == ids_.end() || *ite != dbc_id)
+    return result;
+
+  // Only the regions whose bit is set are visited
+  const uint64_t* bitmap = bitmaps_.data() + (ite - ids_.begin()) * bitmap_words_;
+  for(std::size_t word = 0; word < bitmap_words_; word++) {
+    for(uint64_t bits = bitmap[word]; bits != 0; bits &= bits - 1) {
+      std::size_t i = word * 64 + lowest_bit(bits);
+      if(regions_[i].max_timestamp >= from && regions_[i].min_timestamp <= to)
+        result.push_back(i);
+    }
+  }
+
+  return result;
+}
+
+std::size_t CANLogIndex::read_regions(const char* begin, const std::vector<std::size_t>& regions,
+                                      const std::function<bool(const LogFrame&)>& filter,
+                                      const Callback& callback) const {
+  std::size_t count = 0;
+  LogFrame frame;
+
+  std::unique_ptr<AscReader> header;
+  if(format_ == ParallelLogDecoder::Asc) {
+    header.reset(new AscReader(begin, begin + log_size_));
+    header->read_header();
+  }
+
+  for(std::size_t i : regions) {
+    const char* region_begin = begin + regions_[i].begin;
+    const char* region_end = begin + regions_[i].end;
+
+    if(format_ == ParallelLogDecoder::Candump) {
+      CandumpReader reader(region_begin, region_end);
+      while(reader.next(frame)) {
+        if(!filter(frame))
+          continue;
+
+        // The channels are numbered in each region: they are renumbered as in channels()
+        const std::string& name = reader.channels()[frame.channel];
+        auto global = std::find(channels_.begin(), channels_.end(), name);
+        frame.channel = static_cast<uint8_t>(global == channels_.end() ? 0 : global - channels_.begin());
+
+        callback(frame);
+        count++;
+      }
+    }
+    else if(format_ == ParallelLogDecoder::Asc) {
+      AscReader reader(region_begin, region_end, *header, regions_[i].time);
+      while(reader.next(frame)) {
+        if(filter(frame)) {
+          callback(frame);
+          count++;
+        }
+      }
+    }
+    else {
+      BinaryBlockReader reader(region_begin, region_end);
+      while(reader.next(frame)) {
+        if(filter(frame)) {
+          callback(frame);
+          count++;
+        }
+      }
+    }
+  }
+
+  return count;
+}
+
+std::size_t CANLogIndex::query(const char* begin, const char* end, unsigned long long dbc_id,
+                               int64_t from, int64_t to, const Callback& callback) const {
+  if(!matches(begin, end))
+    throw CANLogException("The index was not built from this log");
+
+  return read_regions(begin, find_regions(dbc_id, from, to), [=](const LogFrame& frame) {
+    return frame.dbc_id() == dbc_id && frame.timestamp >= from && frame.timestamp <= to;
+  }, callback);
+}
+
+std::size_t CANLogIndex::query(const char* begin, const char* end, int64_t from, int64_t to,
+                               const Callback& callback) const {
+  if(!matches(begin, end))
+    throw CANLogException("The index was not built from this log");
+
+  return read_regions(begin, find_regions(from, to), [=](const LogFrame& frame) {
+    return frame.timestamp >= from && frame.timestamp <= to;
+  }, callback);
+}
+
+/*
+ * Sidecar file: header, regions, IDs, bitmaps, channels and the CRC-32 of
+ * everything before it (all the integers are little-endian)
+ */
+void CANLogIndex::save(const std::string& path) const {
+  std::vector<uint8_t> out(INDEX_HEADER_SIZE);
+  std::memcpy(out.data(), INDEX_MAGIC, sizeof(INDEX_MAGIC));
+  store_u32(out.data() + 8, INDEX_VERSION);
+  store_u32(out.data() + 12, static_cast<uint32_t>(format_));
+  store_u64(out.data() + 16, log_size_);
+  store_u32(out.data() + 24, fingerprint_);
+  store_u32(out.data() + 28, static_cast<uint32_t>(regions_.size()));
+  store_u32(out.data() + 32, static_cast<uint32_t>(ids_.size()));
+  store_u32(out.data() + 36, static_cast<uint32_t>(channels_.size()));
+  store_u64(out.data() + 40, 0);
+
+  auto append = [&out](std::size_t size) {
+    out.resize(out.size() + size);
+    return out.data() + out.size() - size;
+  };
+
+  for(const Region& region : regions_) {
+    uint8_t* p = append(REGION_SIZE);
+    store_u64(p, region.begin);
+    store_u64(p + 8, region.end);
+    store_u64(p + 16, static_cast<uint64_t>(region.time));
+    store_u64(p + 24, static_cast<uint64_t>(region.min_timestamp));
+    store_u64(p + 32, static_cast<uint64_t>(region.max_timestamp));
+    store_u32(p + 40, region.frame_count);
+  }
+
+  for(unsigned long long id : ids_)
+    store_u64(append(8), id);
+
+  for(uint64_t word : bitmaps_)
+    store_u64(append(8), word);
+
+  for(const std::string& channel : channels_) {
+    store_u32(append(4), static_cast<uint32_t>(channel.size()));
+    std::memcpy(append(channel.size()), channel.data(), channel.size());
+  }
+
+  uint32_t crc = binlog::crc32(out.data(), out.size());
+  store_u32(append(4), crc);
+
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+  if(!file)
+    throw CANLogException("Cannot write the index " + path);
+}
+
+CANLogIndex CANLogIndex::load(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if(!file)
+    throw CANLogException("Cannot open the index " + path);
+
+  std::vector<uint8_t> in((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  if(in.size() < INDEX_HEADER_SIZE + 4 || std::memcmp(in.data(), INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0)
+    throw CANLogException(path + " is not an index of a log");
+
+  if(load_u32(in.data() + 8) != INDEX_VERSION)
+    throw CANLogException("Unsupported version of the index " + path);
+
+  if(binlog::crc32(in.data(), in.size() - 4) != load_u32(in.data() + in.size() - 4))
+    throw CANLogException("Corrupted index " + path);
+
+  CANLogIndex index;
+  uint32_t format = load_u32(in.data() + 12);
+  if(format > ParallelLogDecoder::Binary)
+    throw CANLogException("Corrupted index " + path);
+
+  index.format_ = static_cast<ParallelLogDecoder::Format>(format);
+  index.log_size_ = load_u64(in.data() + 16);
+  index.fingerprint_ = load_u32(in.data() + 24);
+
+  std::size_t region_count = load_u32(in.data() + 28);
+  std::size_t id_count = load_u32(in.data() + 32);
+  std::size_t channel_count = load_u32(in.data() + 36);
+  index.bitmap_words_ = (region_count + 63) / 64;
+
+  const uint8_t* p = in.data() + INDEX_HEADER_SIZE;
+  const uint8_t* end = in.data() + in.size() - 4;
+  auto take = [&](std::size_t size) {
+    if(static_cast<std::size_t>(end - p) < size)
+      throw CANLogException("Corrupted index " + path);
+    const uint8_t* result = p;
+    p += size;
+    return result;
+  };
+
+  for(std::size_t i = 0; i < region_count; i++) {
+    const uint8_t* r = take(REGION_SIZE);
+    Region region;
+    region.begin = load_u64(r);
+    region.end = load_u64(r + 8);
+    region.time = static_cast<int64_t>(load_u64(r + 16));
+    region.min_timestamp = static_cast<int64_t>(load_u64(r + 24));
+    region.max_timestamp = static_cast<int64_t>(load_u64(r + 32));
+    region.frame_count = load_u32(r + 40);
+
+    if(region.begin > region.end || region.end > index.log_size_)
+      throw CANLogException("Corrupted index " + path);
+    index.regions_.push_back(region);
+  }
+
+  for(std::size_t i = 0; i < id_count; i++)
+    index.ids_.push_back(load_u64(take(8)));
+
+  for(std::size_t i = 0; i < id_count * index.bitmap_words_; i++)
+    index.bitmaps_.push_back(load_u64(take(8)));
+
+  for(std::size_t i = 0; i < channel_count; i++) {
+    uint32_t size = load_u32(take(4));
+    const uint8_t* name = take(size);
+    index.channels_.emplace_back(reinterpret_cast<const char*>(name), size);
+  }
+
+  return index;
+}
@@ -0,0 +1,110 @@
+#include "CANLogReader.h"
+#include "LogParsingUtils.h"
+#include <cstring>
+
+using namespace CppCAN;
+using CppCAN::logs::details::hex_digit;
+
+bool LogFrame::is_extended() const {
+  return (flags & Extended) != 0;
+}
+
+bool LogFrame::is_fd() const {
+  return (flags & FD) != 0;
+}
+
+unsigned long long LogFrame::dbc_id() const {
+  return is_extended() ? can_id | CANFrame::EXTENDED_ID_FLAG : can_id;
+}
+
+CANLogReader::CANLogReader(const char* begin, const char* end)
+  : cursor_(begin), end_(end), lines_(0), skipped_(0) { }
+
+CANLogReader::~CANLogReader() { }
+
+std::size_t CANLogReader::line_count() const {
+  return lines_;
+}
+
+std::size_t CANLogReader::skipped_lines() const {
+  return skipped_;
+}
+
+const char* CANLogReader::position() const {
+  return cursor_;
+}
+
+bool CANLogReader::next_line(const char*& line, const char*& line_end) {
+  if(cursor_ >= end_)
+    return false;
+
+  line = cursor_;
+  const char* eol = static_cast<const char*>(
+    std::memchr(cursor_, '\n', static_cast<std::size_t>(end_ - cursor_)));
+
+  if(eol == nullptr) {
+    line_end = end_;
+    cursor_ = end_;
+  }
+  else {
+    line_end = eol;
+    cursor_ = eol + 1;
+  }
+
+  if(line_end > line && line_end[-1] == '\r')
+    line_end--;
+
+  lines_++;
+  return true;
+}
+
+bool logs::parse_hex(const char* begin, const char* end, uint32_t& value) {
+  if(begin == end || end - begin > 8)
+    return false;
+
+  uint32_t result = 0;
+  for(const char* c = begin; c != end; c++) {
+    uint8_t digit = hex_digit(*c);
+    if(digit > 0xF)
+      return false;
+    result = (result << 4) | digit;
+  }
+
+  value = result;
+  return true;
+}
+
+bool logs::parse_timestamp(const char* begin, const char* end, int64_t& nanoseconds) {
+  bool negative = begin != end && *begin == '-';
+  if(negative)
+    begin++;
+
+  int64_t seconds = 0;
+  const char* c = begin;
+  for(; c != end && *c >= '0' && *c <= '9'; c++) {
+    if(c - begin >= 12) // Beyond ~30000 years: not a timestamp
+      return false;
+    seconds = seconds * 10 + (*c - '0');
+  }
+
+  if(c == begin)
+    return false;
+
+  int64_t fraction = 0;
+  if(c != end && *c == '.') {
+    c++;
+    int64_t unit = 100000000;
+    for(; c != end && *c >= '0' && *c <= '9'; c++) {
+      fraction += (*c - '0') * unit; // Digits beyond the nanosecond are ignored
+      unit /= 10;
+    }
+  }
+
+  if(c != end)
+    return false;
+
+  nanoseconds = seconds * 1000000000 + fraction;
+  if(negative)
+    nanoseconds = -nanoseconds;
+  return true;
+}
@@ -0,0 +1,175 @@
+#include "CANLogReader.h"
+#include "LogParsingUtils.h"
+#include <cstring>
+#include <string_view>
+
+using namespace CppCAN;
+using namespace CppCAN::logs::details;
+
+// Flags stored in the upper bits of the CAN IDs by SocketCAN (see linux/can.h)
+static const uint32_t CAN_EFF_FLAG = 0x80000000U;
+static const uint32_t CAN_RTR_FLAG = 0x40000000U;
+static const uint32_t CAN_ERR_FLAG = 0x20000000U;
+static const uint32_t CAN_EFF_MASK = 0x1FFFFFFFU;
+
+// Flags of the CAN FD frames (first digit after "##")
+static const uint8_t CANFD_BRS = 0x01;
+static const uint8_t CANFD_ESI = 0x02;
+
+// Number of hexadecimal digits of the standard and extended IDs
+static const std::size_t STANDARD_ID_DIGITS = 3;
+static const std::size_t EXTENDED_ID_DIGITS = 8;
+
+static const std::size_t MAX_CHANNELS = 256;
+
+CandumpReader::CandumpReader(const char* begin, const char* end)
+  : CANLogReader(begin, end) { }
+
+bool CandumpReader::next(LogFrame& frame) {
+  const char* line;
+  const char* line_end;
+
+  while(next_line(line, line_end)) {
+    if(parse_line(line, line_end, frame))
+      return true;
+
+    // Empty lines are not worth being reported
+    if(skip_blanks(line, line_end) != line_end)
+      skipped_++;
+  }
+
+  return false;
+}
+
+const std::vector<std::string>& CandumpReader::channels() const {
+  return channels_;
+}
+
+bool CandumpReader::channel(const char* name, std::size_t length, uint8_t& index) {
+  std::string_view view(name, length);
+
+  // Logs rarely contain more than a few interfaces
+  for(std::size_t i = 0; i < channels_.size(); i++) {
+    if(channels_[i] == view) {
+      index = static_cast<uint8_t>(i);
+      return true;
+    }
+  }
+
+  if(channels_.size() == MAX_CHANNELS)
+    return false;
+
+  index = static_cast<uint8_t>(channels_.size());
+  channels_.emplace_back(name, length);
+  return true;
+}
+
+bool CandumpReader::parse_line(const char* c, const char* end, LogFrame& frame) {
+  c = skip_blanks(c, end);
+  if(c == end || *c != '(')
+    return false;
+
+  const char* ts_end = static_cast<const char*>(std::memchr(c, ')', static_cast<std::size_t>(end - c)));
+  if(ts_end == nullptr || !logs::parse_timestamp(c + 1, ts_end, frame.timestamp))
+    return false;
+
+  const char* iface = skip_blanks(ts_end + 1, end);
+  const char* iface_end = skip_token(iface, end);
+  if(iface == iface_end)
+    return false;
+
+  c = skip_blanks(iface_end, end);
+  const char* token_end = skip_token(c, end);
+  const char* hash = static_cast<const char*>(std::memchr(c, '#', static_cast<std::size_t>(token_end - c)));
+  if(hash == nullptr)
+    return false;
+
+  uint32_t id;
+  std::size_t id_digits = static_cast<std::size_t>(hash - c);
+  if((id_digits != STANDARD_ID_DIGITS && id_digits != EXTENDED_ID_DIGITS) ||
+     !logs::parse_hex(c, hash, id))
+    return false;
+
+  frame.flags = 0;
+  if(id_digits == EXTENDED_ID_DIGITS) {
+    if(id & CAN_ERR_FLAG)
+      frame.flags |= LogFrame::ErrorFrame;
+    else
+      frame.flags |= LogFrame::Extended;
+    if(id & CAN_RTR_FLAG)
+      frame.flags |= LogFrame::Remote;
+    id &= CAN_EFF_MASK;
+  }
+  frame.can_id = id;
+  // Remote frames flagged in the ID only ("<id>#") have no DLC
+  frame.length = 0;
+
+  c = hash + 1;
+  unsigned max_length = 8;
+
+  if(c != token_end && *c == '#') {
+    // CAN FD: "##<flags><data>" (there are no remote CAN FD frames)
+    if(token_end - c < 2 || (frame.flags & LogFrame::Remote))
+      return false;
+
+    uint8_t fd_flags = hex_digit(c[1]);
+    if(fd_flags > 0xF)
+      return false;
+
+    frame.flags |= LogFrame::FD;
+    if(fd_flags & CANFD_BRS)
+      frame.flags |= LogFrame::BitRateSwitch;
+    if(fd_flags & CANFD_ESI)
+      frame.flags |= LogFrame::ErrorStateIndicator;
+
+    max_length = CANFrame::MAX_PAYLOAD_LENGTH;
+    c += 2;
+  }
+  else if(c != token_end && (*c == 'R' || *c == 'r')) {
+    // Remote frame: "#R" followed by an optional DLC
+    frame.flags |= LogFrame::Remote;
+    c++;
+
+    if(c != token_end) {
+      uint8_t dlc = hex_digit(*c);
+      if(dlc > 8)
+        return false;
+      frame.length = dlc;
+      c++;
+    }
+  }
+
+  if(!(frame.flags & LogFrame::Remote)) {
+    unsigned length = 0;
+    while(c != token_end && *c != '_') {
+      if(*c == '.') { // Optional separator between bytes
+        c++;
+        continue;
+      }
+
+      if(token_end - c < 2 || length == max_length || !parse_hex_byte(c, frame.data[length]))
+        return false;
+
+      length++;
+      c += 2;
+    }
+
+    if(frame.is_fd() && CANFrame::dlc_to_length(CANFrame::length_to_dlc(length)) != length)
+      return false;
+
+    frame.length = static_cast<uint8_t>(length);
+  }
+
+  // Classic frames may end with "_<DLC>" when the DLC is above 8 (len8_dlc)
+  if(c != token_end) {
+    if(*c != '_' || token_end - c != 2 || hex_digit(c[1]) > 0xF || frame.is_fd())
+      return false;
+  }
+
+  // Optional direction written by recent versions of candump ("R" or "T")
+  c = skip_blanks(token_end, end);
+  if(c != end && *c == 'T')
+    frame.flags |= LogFrame::Tx;
+
+  return channel(iface, static_cast<std::size_t>(iface_end - iface), frame.channel);
+}
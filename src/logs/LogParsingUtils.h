@@ -0,0 +1,144 @@
+#ifndef LogParsingUtils_H
+#define LogParsingUtils_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace CppCAN {
+namespace logs {
+namespace details {
+
+/**
+ * @brief Value of each character as a hexadecimal digit (0xFF if it is not one)
+ */
+struct HexTable {
+  constexpr HexTable() : values() {
+    for(int i = 0; i < 256; i++)
+      values[i] = 0xFF;
+    for(int i = 0; i < 10; i++)
+      values['0' + i] = static_cast<uint8_t>(i);
+    for(int i = 0; i < 6; i++) {
+      values['a' + i] = static_cast<uint8_t>(10 + i);
+      values['A' + i] = static_cast<uint8_t>(10 + i);
+    }
+  }
+
+  uint8_t values[256];
+};
+
+inline constexpr HexTable HEX_TABLE;
+
+inline uint8_t hex_digit(char c) {
+  return HEX_TABLE.values[static_cast<unsigned char>(c)];
+}
+
+/**
+ * @brief Parses a byte written as two hexadecimal digits
+ * @return false if one of the characters is not a hexadecimal digit
+ */
+inline bool parse_hex_byte(const char* c, uint8_t& byte) {
+  uint8_t high = hex_digit(c[0]);
+  uint8_t low = hex_digit(c[1]);
+  if((high | low) > 0xF)
+    return false;
+
+  byte = static_cast<uint8_t>((high << 4) | low);
+  return true;
+}
+
+/**
+ * @brief Parses decimal digits
+ * @return false if a character is not a decimal digit or if the value overflows
+ */
+inline bool parse_decimal(const char* begin, const char* end, uint32_t& value) {
+  if(begin == end || end - begin > 9)
+    return false;
+
+  uint32_t result = 0;
+  for(const char* c = begin; c != end; c++) {
+    if(*c < '0' || *c > '9')
+      return false;
+    result = result * 10 + static_cast<uint32_t>(*c - '0');
+  }
+
+  value = result;
+  return true;
+}
+
+inline bool is_blank(char c) {
+  return c == ' ' || c == '\t';
+}
+
+inline const char* skip_blanks(const char* c, const char* end) {
+  while(c != end && is_blank(*c))
+    c++;
+  return c;
+}
+
+inline const char* skip_token(const char* c, const char* end) {
+  while(c != end && !is_blank(*c))
+    c++;
+  return c;
+}
+
+/**
+ * @brief Reads the next blank-separated token and moves c after it
+ * @return false if there is no token left
+ */
+inline bool next_token(const char*& c, const char* end, const char*& token, const char*& token_end) {
+  token = skip_blanks(c, end);
+  token_end = skip_token(token, end);
+  c = token_end;
+  return token != token_end;
+}
+
+/**
+ * @brief Writes a 32-bit value in little-endian order (encoding of the binary files)
+ */
+inline void store_u32(uint8_t* out, uint32_t value) {
+  for(int i = 0; i < 4; i++)
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+/**
+ * @brief Writes a 64-bit value in little-endian order
+ */
+inline void store_u64(uint8_t* out, uint64_t value) {
+  for(int i = 0; i < 8; i++)
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+/**
+ * @return The 32-bit value stored in little-endian order at in
+ */
+inline uint32_t load_u32(const uint8_t* in) {
+  uint32_t value = 0;
+  for(int i = 3; i >= 0; i--)
+    value = (value << 8) | in[i];
+  return value;
+}
+
+/**
+ * @return The 64-bit value stored in little-endian order at in
+ */
+inline uint64_t load_u64(const uint8_t* in) {
+  uint64_t value = 0;
+  for(int i = 7; i >= 0; i--)
+    value = (value << 8) | in[i];
+  return value;
+}
+
+/**
+ * @return true if the token [begin, end) is equal to the given string
+ */
+template<std::size_t N>
+inline bool token_equals(const char* begin, const char* end, const char (&str)[N]) {
+  return static_cast<std::size_t>(end - begin) == N - 1 && std::memcmp(begin, str, N - 1) == 0;
+}
+
+}
+}
+}
+
+#endif
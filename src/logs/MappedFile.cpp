@@ -0,0 +1,107 @@
+#include "CANLogReader.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+using namespace CppCAN;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path)
+  : data_(nullptr), size_(0), file_(INVALID_HANDLE_VALUE), mapping_(nullptr) {
+  file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                      OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if(file_ == INVALID_HANDLE_VALUE)
+    throw CANLogException("Cannot open " + path);
+
+  LARGE_INTEGER size;
+  if(!GetFileSizeEx(file_, &size)) {
+    CloseHandle(file_);
+    throw CANLogException("Cannot get the size of " + path);
+  }
+
+  size_ = static_cast<std::size_t>(size.QuadPart);
+  if(size_ == 0)
+    return; // Empty files cannot be mapped
+
+  mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if(mapping_ == nullptr) {
+    CloseHandle(file_);
+    throw CANLogException("Cannot map " + path);
+  }
+
+  data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+  if(data_ == nullptr) {
+    CloseHandle(mapping_);
+    CloseHandle(file_);
+    throw CANLogException("Cannot map " + path);
+  }
+}
+
+MappedFile::~MappedFile() {
+  if(data_ != nullptr)
+    UnmapViewOfFile(data_);
+  if(mapping_ != nullptr)
+    CloseHandle(mapping_);
+  if(file_ != INVALID_HANDLE_VALUE)
+    CloseHandle(file_);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path)
+  : data_(nullptr), size_(0) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if(fd < 0)
+    throw CANLogException("Cannot open " + path + ": " + std::strerror(errno));
+
+  struct stat info;
+  if(fstat(fd, &info) != 0) {
+    close(fd);
+    throw CANLogException("Cannot get the size of " + path + ": " + std::strerror(errno));
+  }
+
+  size_ = static_cast<std::size_t>(info.st_size);
+  if(size_ == 0) {
+    close(fd); // Empty files cannot be mapped
+    return;
+  }
+
+  void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // The mapping keeps its own reference to the file
+
+  if(data == MAP_FAILED)
+    throw CANLogException("Cannot map " + path + ": " + std::strerror(errno));
+
+  // Logs are read from the beginning to the end: the kernel can read ahead
+  // aggressively and drop the pages once they have been read.
+  madvise(data, size_, MADV_SEQUENTIAL);
+  data_ = static_cast<const char*>(data);
+}
+
+MappedFile::~MappedFile() {
+  if(data_ != nullptr)
+    munmap(const_cast<char*>(data_), size_);
+}
+
+#endif
+
+const char* MappedFile::begin() const {
+  return data_;
+}
+
+const char* MappedFile::end() const {
+  return data_ + size_;
+}
+
+std::size_t MappedFile::size() const {
+  return size_;
+}
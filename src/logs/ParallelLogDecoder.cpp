@@ -0,0 +1,291 @@
+#include "ParallelLogDecoder.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace CppCAN;
+
+static const std::size_t DEFAULT_CHUNK_SIZE = 1 << 20;
+static const std::size_t PENDING_CHUNKS_PER_THREAD = 2;
+
+// LogFrame::channel is a byte
+static const std::size_t MAX_CHANNELS = 256;
+
+ParallelLogDecoder::Options::Options()
+  : threads(0), chunk_size(DEFAULT_CHUNK_SIZE), max_pending_chunks(0) { }
+
+ParallelLogDecoder::ParallelLogDecoder(const CANDecoder& decoder, Format format,
+                                       const char* begin, const char* end,
+                                       const Options& options)
+  : decoder_(&decoder), format_(format), options_(options), asc_header_(begin, end),
+    frame_count_(0), skipped_lines_(0) {
+  if(options_.threads == 0)
+    options_.threads = std::max(1u, std::thread::hardware_concurrency());
+  if(options_.max_pending_chunks == 0)
+    options_.max_pending_chunks = PENDING_CHUNKS_PER_THREAD * options_.threads;
+  options_.chunk_size = std::max<std::size_t>(options_.chunk_size, 1);
+
+  const char* position = begin;
+  std::size_t chunk_size = options_.chunk_size;
+
+  if(format_ == Binary) {
+    // Consecutive blocks are grouped until they reach the size of a chunk
+    BinaryLogReader reader(begin, end);
+    const std::vector<BinaryLogReader::BlockInfo>& blocks = reader.blocks();
+    binary_channels_ = reader.channels();
+
+    for(std::size_t i = 0; i < blocks.size(); i++) {
+      const char* block = begin + blocks[i].offset;
+      if(bounds_.empty() || static_cast<std::size_t>(block - bounds_.back()) >= chunk_size)
+        bounds_.push_back(block);
+    }
+
+    if(bounds_.empty())
+      bounds_.push_back(end);
+    bounds_.push_back(blocks.empty() ? end : begin + blocks.back().offset + blocks.back().size);
+    return;
+  }
+
+  if(format_ == Asc) {
+    // The header is needed by all the chunks
+    asc_header_.read_header();
+    position = asc_header_.position();
+
+    if(asc_header_.has_relative_timestamps())
+      chunk_size = std::numeric_limits<std::size_t>::max();
+  }
+
+  bounds_.push_back(position);
+  while(static_cast<std::size_t>(end - position) > chunk_size) {
+    const char* cut = static_cast<const char*>(
+      std::memchr(position + chunk_size, '\n', static_cast<std::size_t>(end - position) - chunk_size));
+    if(cut == nullptr || cut + 1 == end)
+      break;
+
+    position = cut + 1;
+    bounds_.push_back(position);
+  }
+  bounds_.push_back(end);
+}
+
+std::size_t ParallelLogDecoder::chunk_count() const {
+  return bounds_.size() - 1;
+}
+
+unsigned ParallelLogDecoder::thread_count() const {
+  return options_.threads;
+}
+
+const std::vector<std::string>& ParallelLogDecoder::channels() const {
+  return channels_;
+}
+
+std::size_t ParallelLogDecoder::frame_count() const {
+  return frame_count_;
+}
+
+std::size_t ParallelLogDecoder::skipped_lines() const {
+  return skipped_lines_;
+}
+
+template<typename Reader>
+static void
+decode_frames(const CANDecoder& decoder, const std::vector<CANRawFilter>& filters,
+              Reader& reader, ParallelLogDecoder::DecodedChunk& chunk) {
+  chunk.value_offsets.push_back(0);
+
+  LogFrame frame;
+  while(reader.next(frame)) {
+    // The filters only look at the raw payload: rejected frames are never decoded
+    if(!filters.empty() &&
+       std::none_of(filters.begin(), filters.end(),
+                    [&frame](const CANRawFilter& filter) { return filter.matches(frame); }))
+      continue;
+
+    const CANDecoder::FramePlan* plan = nullptr;
+    if(!(frame.flags & (LogFrame::Remote | LogFrame::ErrorFrame)))
+      plan = decoder.find(frame.can_id, frame.is_extended());
+
+    chunk.frames.push_back(frame);
+    chunk.plans.push_back(plan);
+
+    if(plan != nullptr) {
+      std::size_t offset = chunk.values.size();
+      chunk.values.resize(offset + plan->signals.size(), std::numeric_limits<double>::quiet_NaN());
+      decoder.decode(*plan, frame.data, frame.length, chunk.values.data() + offset);
+    }
+
+    chunk.value_offsets.push_back(static_cast<uint32_t>(chunk.values.size()));
+  }
+}
+
+void ParallelLogDecoder::decode_chunk(DecodedChunk& chunk) const {
+  // The buffers of the chunks are recycled: clear() keeps their capacity
+  chunk.frames.clear();
+  chunk.plans.clear();
+  chunk.value_offsets.clear();
+  chunk.values.clear();
+  chunk.channels.clear();
+  chunk.output.clear();
+
+  if(format_ == Candump) {
+    CandumpReader reader(chunk.begin, chunk.end);
+    decode_frames(*decoder_, options_.filters, reader, chunk);
+    chunk.channels = reader.channels();
+    chunk.line_count = reader.line_count();
+    chunk.skipped_lines = reader.skipped_lines();
+  }
+  else if(format_ == Asc) {
+    AscReader reader(chunk.begin, chunk.end, asc_header_);
+    decode_frames(*decoder_, options_.filters, reader, chunk);
+    chunk.line_count = reader.line_count();
+    chunk.skipped_lines = reader.skipped_lines();
+  }
+  else {
+    BinaryBlockReader reader(chunk.begin, chunk.end);
+    decode_frames(*decoder_, options_.filters, reader, chunk);
+    chunk.channels = binary_channels_;
+    chunk.line_count = 0;
+    chunk.skipped_lines = 0;
+  }
+}
+
+void ParallelLogDecoder::remap_channels(DecodedChunk& chunk) {
+  // The channels of binary logs are already numbered as in the whole log
+  if(chunk.channels.empty() || format_ == Binary)
+    return;
+
+  // The chunks are consumed in order: the interfaces are numbered
+  // as if the log had been read sequentially
+  uint8_t mapping[MAX_CHANNELS];
+  for(std::size_t i = 0; i < chunk.channels.size(); i++) {
+    auto ite = std::find(channels_.begin(), channels_.end(), chunk.channels[i]);
+    if(ite == channels_.end()) {
+      if(channels_.size() == MAX_CHANNELS)
+        throw CANLogException("The log has more than " + std::to_string(MAX_CHANNELS) + " interfaces");
+
+      channels_.push_back(chunk.channels[i]);
+      ite = channels_.end() - 1;
+    }
+
+    mapping[i] = static_cast<uint8_t>(ite - channels_.begin());
+  }
+
+  for(LogFrame& frame : chunk.frames)
+    frame.channel = mapping[frame.channel];
+}
+
+void ParallelLogDecoder::run(const Consumer& consumer) {
+  const std::size_t chunks = chunk_count();
+  const std::size_t window = options_.max_pending_chunks;
+
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::size_t next_chunk = 0; // Next chunk to decode
+  std::size_t consumed = 0;   // Number of chunks given to the consumer
+  bool stop = false;
+  std::exception_ptr error;
+
+  // Reorder buffer: the chunk n waits in slots[n % window]
+  std::vector<std::unique_ptr<DecodedChunk>> slots(window);
+  std::vector<std::unique_ptr<DecodedChunk>> free_chunks;
+
+  auto fail = [&](std::exception_ptr e) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if(!error)
+      error = e;
+    stop = true;
+    changed.notify_all();
+  };
+
+  auto worker = [&]() {
+    for(;;) {
+      std::unique_ptr<DecodedChunk> chunk;
+      std::size_t sequence;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() {
+          return stop || next_chunk >= chunks || next_chunk < consumed + window;
+        });
+
+        if(stop || next_chunk >= chunks)
+          return;
+
+        sequence = next_chunk++;
+        if(!free_chunks.empty()) {
+          chunk = std::move(free_chunks.back());
+          free_chunks.pop_back();
+        }
+      }
+
+      try {
+        if(!chunk)
+          chunk.reset(new DecodedChunk());
+
+        chunk->sequence = sequence;
+        chunk->begin = bounds_[sequence];
+        chunk->end = bounds_[sequence + 1];
+        decode_chunk(*chunk);
+        if(options_.worker_stage)
+          options_.worker_stage(*chunk);
+      }
+      catch(...) {
+        fail(std::current_exception());
+        return;
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      slots[sequence % window] = std::move(chunk);
+      changed.notify_all();
+    }
+  };
+
+  frame_count_ = 0;
+  skipped_lines_ = 0;
+  channels_ = format_ == Binary ? binary_channels_ : std::vector<std::string>();
+
+  std::vector<std::thread> workers;
+  std::size_t worker_count = std::min<std::size_t>(options_.threads, chunks);
+  for(std::size_t i = 0; i < worker_count; i++)
+    workers.emplace_back(worker);
+
+  for(std::size_t sequence = 0; sequence < chunks; sequence++) {
+    std::unique_ptr<DecodedChunk> chunk;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      changed.wait(lock, [&]() { return stop || slots[sequence % window]; });
+      if(stop)
+        break;
+
+      chunk = std::move(slots[sequence % window]);
+    }
+
+    try {
+      remap_channels(*chunk);
+      frame_count_ += chunk->frames.size();
+      skipped_lines_ += chunk->skipped_lines;
+      consumer(*chunk);
+    }
+    catch(...) {
+      fail(std::current_exception());
+      break;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    consumed = sequence + 1;
+    free_chunks.push_back(std::move(chunk));
+    changed.notify_all();
+  }
+
+  for(std::thread& thread : workers)
+    thread.join();
+
+  if(error)
+    std::rethrow_exception(error);
+}
@@ -1,7 +1,10 @@
 #include "CANDatabase.h"
 #include "DBCParser.h"
+#include "ChoicesHash.h"
 #include <utility>
 #include <iostream>
+#include <functional>
+#include <unordered_map>
 
 using namespace CppCAN;
 namespace dtl = CppCAN::parser::details;
@@ -23,10 +26,33 @@ public:
   }
 
   std::string filename_;
+  BitTiming bitTiming_ = BitTiming();
   container_type map_; // Index by CAN ID
 
   std::map<unsigned long long, IDKey> intKeyIndex_;
   std::map<std::string, IDKey> strKeyIndex_;
+
+  // Pool of value tables indexed by the hash of their content
+  std::unordered_multimap<std::size_t, CANSignal::shared_choices> choicesPool_;
+  std::map<std::string, CANSignal::shared_choices> valueTables_;
+
+  // Finds the key of the given DBC ID. If there is no such frame, the ID
+  // is looked up again as an extended ID.
+  std::map<unsigned long long, IDKey>::const_iterator findIntKey(unsigned long long id) const {
+    auto ite = intKeyIndex_.find(id);
+    if(ite == intKeyIndex_.end() && (id & CANFrame::EXTENDED_ID_FLAG) == 0)
+      ite = intKeyIndex_.find(id | CANFrame::EXTENDED_ID_FLAG);
+
+    return ite;
+  }
+
+  const IDKey& intKeyAt(unsigned long long id) const {
+    auto ite = findIntKey(id);
+    if(ite == intKeyIndex_.end())
+      throw std::out_of_range("No frame with CAN ID " + std::to_string(id));
+
+    return ite->second;
+  }
 };
 
 CANDatabase::CANDatabase()
@@ -39,16 +65,22 @@ CANDatabase::CANDatabase(const std::string& filename)
 CANDatabase::CANDatabase(const CANDatabase& other)
   : impl(new CANDatabaseImpl(other.impl->filename_)) {
 
+  impl->bitTiming_ = other.impl->bitTiming_;
   impl->map_ = other.impl->map_;
   impl->intKeyIndex_ = other.impl->intKeyIndex_;
   impl->strKeyIndex_ = other.impl->strKeyIndex_;
+  impl->choicesPool_ = other.impl->choicesPool_;
+  impl->valueTables_ = other.impl->valueTables_;
 }
 
 CANDatabase& CANDatabase::operator=(const CANDatabase& other) {
   impl->filename_ = other.impl->filename_;
+  impl->bitTiming_ = other.impl->bitTiming_;
   impl->map_ = other.impl->map_;
   impl->intKeyIndex_ = other.impl->intKeyIndex_;
   impl->strKeyIndex_ = other.impl->strKeyIndex_;
+  impl->choicesPool_ = other.impl->choicesPool_;
+  impl->valueTables_ = other.impl->valueTables_;
   return *this;
 }
 
@@ -71,6 +103,14 @@ const std::string& CANDatabase::filename() const {
   return impl->filename_;
 }
 
+const CANDatabase::BitTiming& CANDatabase::bit_timing() const {
+  return impl->bitTiming_;
+}
+
+void CANDatabase::set_bit_timing(const BitTiming& timing) {
+  impl->bitTiming_ = timing;
+}
+
 std::size_t CANDatabase::size() const {
   return impl->map_.size();
 }
@@ -101,21 +141,21 @@ CANFrame& CANDatabase::at(const std::string& name) {
 }
 
 const CANFrame& CANDatabase::at(unsigned long long id) const {
-  const IDKey& map_key = impl->intKeyIndex_.at(id);
+  const IDKey& map_key = impl->intKeyAt(id);
   return impl->map_.at(map_key);
 }
 
 CANFrame& CANDatabase::at(unsigned long long id) {
-  const IDKey& map_key = impl->intKeyIndex_.at(id);
+  const IDKey& map_key = impl->intKeyAt(id);
   return impl->map_.at(map_key);
 }
 
 void CANDatabase::addFrame(const CANFrame& frame) {
-  IDKey map_key = { frame.name(), frame.can_id() };
+  IDKey map_key = { frame.name(), frame.dbc_id() };
 
   impl->map_.insert(std::make_pair(map_key, frame));
   impl->strKeyIndex_.insert(std::make_pair(frame.name(), map_key));
-  impl->intKeyIndex_.insert(std::make_pair(frame.can_id(), map_key));
+  impl->intKeyIndex_.insert(std::make_pair(frame.dbc_id(), map_key));
 }
 
 void CANDatabase::removeFrame(const std::string& name) {
@@ -134,7 +174,7 @@ void CANDatabase::removeFrame(const std::string& name) {
 
 void CANDatabase::removeFrame(unsigned int can_id) {
   try {
-    const IDKey& map_key = impl->intKeyIndex_.at(can_id);
+    const IDKey& map_key = impl->intKeyAt(can_id);
 
     impl->map_.erase(impl->map_.find(map_key));
     impl->strKeyIndex_.erase(impl->strKeyIndex_.find(map_key.str_key));
@@ -148,7 +188,7 @@ void CANDatabase::removeFrame(unsigned int can_id) {
 }
 
 bool CANDatabase::contains(unsigned long long can_id) const {
-  return impl->intKeyIndex_.find(can_id) != impl->intKeyIndex_.end();
+  return impl->findIntKey(can_id) != impl->intKeyIndex_.end();
 }
 
 bool CANDatabase::contains(const std::string& name) const {
@@ -216,9 +256,38 @@ CANDatabase::crend() const {
 }
 
 void CANDatabase::clear() {
+  impl->bitTiming_ = BitTiming();
   impl->map_.clear();
   impl->intKeyIndex_.clear();
   impl->strKeyIndex_.clear();
+  impl->choicesPool_.clear();
+  impl->valueTables_.clear();
+}
+
+CANSignal::shared_choices CANDatabase::internChoices(const CANSignal::choices_type& choices) {
+  std::size_t hash = details::hash_choices(choices);
+
+  auto range = impl->choicesPool_.equal_range(hash);
+  for(auto ite = range.first; ite != range.second; ++ite) {
+    if(*ite->second == choices)
+      return ite->second;
+  }
+
+  auto result = std::make_shared<const CANSignal::choices_type>(choices);
+  impl->choicesPool_.insert(std::make_pair(hash, result));
+  return result;
+}
+
+void CANDatabase::addValueTable(const std::string& name, const CANSignal::choices_type& choices) {
+  impl->valueTables_[name] = internChoices(choices);
+}
+
+const std::map<std::string, CANSignal::shared_choices>& CANDatabase::value_tables() const {
+  return impl->valueTables_;
+}
+
+std::size_t CANDatabase::value_table_pool_size() const {
+  return impl->choicesPool_.size();
 }
 
 void CppCAN::swap(CANDatabase & first, CANDatabase & second) {
@@ -226,12 +295,12 @@ void CppCAN::swap(CANDatabase & first, CANDatabase & second) {
 }
 
 const CANFrame& CANDatabase::operator[](unsigned long long can_id) const {
-  const IDKey& map_key = impl->intKeyIndex_.at(can_id);
+  const IDKey& map_key = impl->intKeyAt(can_id);
   return impl->map_.at(map_key);
 }
 
 CANFrame& CANDatabase::operator[](unsigned long long can_id) {
-  const IDKey& map_key = impl->intKeyIndex_.at(can_id);
+  const IDKey& map_key = impl->intKeyAt(can_id);
   return impl->map_.at(map_key);
 }
 
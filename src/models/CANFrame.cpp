@@ -4,10 +4,31 @@
 
 using namespace CppCAN;
 
+static const unsigned int FD_DLC_LENGTHS[16] = {
+  0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64
+};
+
+const unsigned long long CANFrame::EXTENDED_ID_FLAG;
+const unsigned int CANFrame::MAX_PAYLOAD_LENGTH;
+
+unsigned int CANFrame::dlc_to_length(unsigned int dlc) {
+  return dlc < 16 ? FD_DLC_LENGTHS[dlc] : MAX_PAYLOAD_LENGTH;
+}
+
+unsigned int CANFrame::length_to_dlc(unsigned int length) {
+  unsigned int dlc = 0;
+  while(dlc < 15 && FD_DLC_LENGTHS[dlc] < length)
+    dlc++;
+
+  return dlc;
+}
+
 CANFrame::CANFrame(const std::string& name, unsigned long long can_id, 
                    unsigned int dlc, unsigned int period, 
                    const std::string& comment)
-  : name_(name), can_id_(can_id), dlc_(dlc), period_(0), comment_(comment) {}
+  : name_(name), can_id_(can_id & ~EXTENDED_ID_FLAG), dlc_(dlc), 
+    extended_((can_id & EXTENDED_ID_FLAG) != 0),
+    fd_(false), period_(0), comment_(comment) {}
 
 const std::string& CANFrame::name() const {
   return name_;
@@ -17,10 +38,43 @@ unsigned long long CANFrame::can_id() const {
   return can_id_;
 }
 
+unsigned long long CANFrame::dbc_id() const {
+  return extended_ ? can_id_ | EXTENDED_ID_FLAG : can_id_;
+}
+
 unsigned int CANFrame::dlc() const {
   return dlc_;
 }
 
+unsigned int CANFrame::length() const {
+  // DBC files give the payload length of CAN FD frames (eg. 64) but
+  // the CAN FD DLC codes are also accepted when they are not a valid
+  // length themselves (12 is a length, not the DLC of 24 bytes).
+  if(fd_ && dlc_ > 8 && dlc_ < 16 && dlc_ != 12)
+    return dlc_to_length(dlc_);
+
+  return dlc_;
+}
+
+CANFrame::FrameFormat CANFrame::frame_format() const {
+  if(fd_)
+    return extended_ ? ExtendedCAN_FD : StandardCAN_FD;
+
+  return extended_ ? ExtendedCAN : StandardCAN;
+}
+
+bool CANFrame::is_extended() const {
+  return extended_;
+}
+
+bool CANFrame::is_fd() const {
+  return fd_;
+}
+
+void CANFrame::setFD(bool fd) {
+  fd_ = fd;
+}
+
 unsigned int CANFrame::period() const {
   return period_;
 }
@@ -29,6 +83,26 @@ const std::string& CANFrame::comment() const {
   return comment_;
 }
 
+bool CANFrame::is_multiplexed() const {
+  for(const auto& signal : map_) {
+    if(signal.second.is_multiplexed())
+      return true;
+  }
+
+  return false;
+}
+
+const std::string& CANFrame::multiplexor() const {
+  static const std::string NO_MULTIPLEXOR;
+
+  for(const auto& signal : map_) {
+    if(signal.second.multiplexing() == CANSignal::Multiplexor)
+      return signal.second.name();
+  }
+
+  return NO_MULTIPLEXOR;
+}
+
 void CANFrame::setPeriod(unsigned int val) {
   period_ = val;
 }
@@ -144,6 +218,8 @@ void CppCAN::swap(CANFrame & first, CANFrame & second) {
   std::swap(first.name_, second.name_);
   std::swap(first.can_id_, second.can_id_);
   std::swap(first.dlc_, second.dlc_);
+  std::swap(first.extended_, second.extended_);
+  std::swap(first.fd_, second.fd_);
   std::swap(first.period_, second.period_);
   std::swap(first.map_, second.map_);
   std::swap(first.comment_, second.comment_);
@@ -2,6 +2,25 @@
 
 using namespace CppCAN;
 
+static_assert(sizeof(CANSignal::Layout) == 24, "CANSignal::Layout must stay packed");
+
+static const uint8_t SIGNED_FLAG = 0x01;
+static const uint8_t LITTLE_ENDIAN_FLAG = 0x02;
+static const unsigned VALUE_TYPE_SHIFT = 2;
+static const uint8_t VALUE_TYPE_MASK = 0x0C;
+
+CANSignal::Signedness CANSignal::Layout::signedness() const {
+  return (flags & SIGNED_FLAG) != 0 ? Signed : Unsigned;
+}
+
+CANSignal::Endianness CANSignal::Layout::endianness() const {
+  return (flags & LITTLE_ENDIAN_FLAG) != 0 ? LittleEndian : BigEndian;
+}
+
+CANSignal::ValueType CANSignal::Layout::value_type() const {
+  return static_cast<ValueType>((flags & VALUE_TYPE_MASK) >> VALUE_TYPE_SHIFT);
+}
+
 CANSignal::Range CANSignal::Range::fromString(const std::string & minstr, const std::string & maxstr) {
   long min = std::stol(minstr);
   long max = std::stol(maxstr);
@@ -15,20 +34,25 @@ CANSignal::Range::Range(long m, long mm)
 }
 
 CANSignal::CANSignal(const std::string & name, unsigned int start_bit, unsigned int length, double scale, double offset, Signedness signedness, Endianness endianness, Range range) :
-  name_(name), start_bit_(start_bit), length_(length),
-  scale_(scale), offset_(offset), signedness_(signedness), endianness_(endianness),
-  range_(range) { }
+  name_(name), range_(range), multiplexing_(NotMultiplexed) {
+  layout_.scale = scale;
+  layout_.offset = offset;
+  layout_.start_bit = start_bit;
+  layout_.length = static_cast<uint16_t>(length);
+  layout_.flags = (signedness == Signed ? SIGNED_FLAG : 0) |
+                  (endianness == LittleEndian ? LITTLE_ENDIAN_FLAG : 0);
+}
 
 const std::string & CANSignal::name() const {
   return name_;
 }
 
 unsigned int CANSignal::start_bit() const {
-  return start_bit_;
+  return layout_.start_bit;
 }
 
 unsigned int CANSignal::length() const {
-  return length_;
+  return layout_.length;
 }
 
 const std::string & CANSignal::comment() const {
@@ -36,11 +60,11 @@ const std::string & CANSignal::comment() const {
 }
 
 double CANSignal::scale() const {
-  return scale_;
+  return layout_.scale;
 }
 
 double CANSignal::offset() const {
-  return offset_;
+  return layout_.offset;
 }
 
 const CANSignal::Range & CANSignal::range() const {
@@ -48,14 +72,27 @@ const CANSignal::Range & CANSignal::range() const {
 }
 
 CANSignal::Signedness CANSignal::signedness() const {
-  return signedness_;
+  return layout_.signedness();
 }
 
 CANSignal::Endianness CANSignal::endianness() const {
-  return endianness_;
+  return layout_.endianness();
+}
+
+CANSignal::ValueType CANSignal::value_type() const {
+  return layout_.value_type();
+}
+
+const CANSignal::Layout& CANSignal::layout() const {
+  return layout_;
 }
 
 const std::map<unsigned int, std::string>& CANSignal::choices() const {
+  static const choices_type NO_CHOICES;
+  return choices_ ? *choices_ : NO_CHOICES;
+}
+
+const CANSignal::shared_choices& CANSignal::shared_choices_ptr() const {
   return choices_;
 }
 
@@ -64,5 +101,55 @@ void CANSignal::setComment(const std::string & comment) {
 }
 
 void CANSignal::setChoices(const std::map<unsigned int, std::string>& choices) {
+  if(choices.empty())
+    choices_.reset();
+  else
+    choices_ = std::make_shared<const choices_type>(choices);
+}
+
+void CANSignal::setChoices(const shared_choices& choices) {
   choices_ = choices;
 }
+
+void CANSignal::setValueType(ValueType value_type) {
+  layout_.flags = static_cast<uint8_t>((layout_.flags & ~VALUE_TYPE_MASK) |
+                                       (static_cast<unsigned>(value_type) << VALUE_TYPE_SHIFT));
+}
+
+CANSignal::Multiplexing CANSignal::multiplexing() const {
+  return multiplexing_;
+}
+
+bool CANSignal::is_multiplexor() const {
+  return multiplexing_ == Multiplexor || multiplexing_ == MultiplexedMultiplexor;
+}
+
+bool CANSignal::is_multiplexed() const {
+  return multiplexing_ == Multiplexed || multiplexing_ == MultiplexedMultiplexor;
+}
+
+const std::string& CANSignal::multiplexer_switch() const {
+  return multiplexer_switch_;
+}
+
+const std::vector<CANSignal::MultiplexerRange>& CANSignal::multiplexer_ranges() const {
+  return multiplexer_ranges_;
+}
+
+void CANSignal::setMultiplexing(Multiplexing multiplexing, unsigned long long value) {
+  multiplexing_ = multiplexing;
+  multiplexer_switch_.clear();
+  multiplexer_ranges_.clear();
+
+  if(is_multiplexed())
+    multiplexer_ranges_.push_back({ value, value });
+}
+
+void CANSignal::setMultiplexerSwitch(const std::string& switch_name, 
+                                     const std::vector<MultiplexerRange>& ranges) {
+  if(!is_multiplexed())
+    multiplexing_ = multiplexing_ == Multiplexor ? MultiplexedMultiplexor : Multiplexed;
+
+  multiplexer_switch_ = switch_name;
+  multiplexer_ranges_ = ranges;
+}
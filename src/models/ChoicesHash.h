@@ -0,0 +1,30 @@
+#ifndef ChoicesHash_H
+#define ChoicesHash_H
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <string>
+
+namespace CppCAN {
+namespace details {
+
+/**
+ * @brief Hash of a choice table, shared by the pool of CANDatabase::internChoices()
+ *        and the lookup tables of CANDecoder
+ */
+inline std::size_t
+hash_choices(const std::map<unsigned int, std::string>& choices) {
+  std::size_t result = choices.size();
+  for(const auto& choice : choices) {
+    result = result * 31 + choice.first;
+    result = result * 31 + std::hash<std::string>()(choice.second);
+  }
+
+  return result;
+}
+
+}
+}
+
+#endif
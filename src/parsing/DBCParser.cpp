@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <iterator>
 #include <iomanip>
+#include <cctype>
 #include "ParsingUtils.h"
 #include "DBCParser.h"
 
@@ -23,13 +24,17 @@ static std::string COMMENT_TOKEN = "CM_";
 static std::string ATTR_DEF_TOKEN = "BA_DEF_";
 static std::string ATTR_DEF_DEFAULT_TOKEN = "BA_DEF_DEF_";
 static std::string ATTR_VAL_TOKEN = "BA_";
+static std::string SIG_MUL_VAL_TOKEN = "SG_MUL_VAL_";
+static std::string SIG_VALTYPE_TOKEN = "SIG_VALTYPE_";
+static std::string VAL_TABLE_TOKEN = "VAL_TABLE_";
 
 // Duplicates but I don't think it demands so much memory
 // anyway...
 static std::set<std::string> SUPPORTED_DBC_TOKENS = {
   VERSION_TOKEN, BIT_TIMING_TOKEN, NODE_DEF_TOKEN, MESSAGE_DEF_TOKEN,
   SIG_DEF_TOKEN, SIG_VAL_DEF_TOKEN, ENV_VAR_TOKEN, COMMENT_TOKEN,
-  ATTR_DEF_TOKEN, ATTR_DEF_DEFAULT_TOKEN, ATTR_VAL_TOKEN
+  ATTR_DEF_TOKEN, ATTR_DEF_DEFAULT_TOKEN, ATTR_VAL_TOKEN, SIG_MUL_VAL_TOKEN,
+  SIG_VALTYPE_TOKEN, VAL_TABLE_TOKEN
 };
 
 static std::set<std::string> NS_TOKENS = {
@@ -41,7 +46,7 @@ static std::set<std::string> NS_TOKENS = {
 };
 
 static std::set<std::string> UNSUPPORTED_DBC_TOKENS = {
-  "VAL_TABLE_", "BO_TX_BU_", "ENVVAR_DATA_",
+  "BO_TX_BU_", "ENVVAR_DATA_",
   "SGTYPE_", "SIG_GROUP_"
 }; 
 
@@ -86,7 +91,7 @@ parseNSSection(dtl::Tokenizer& tokenizer) {
 }
 
 static void
-parseBitTimingSection(dtl::Tokenizer& tokenizer) {
+parseBitTimingSection(dtl::Tokenizer& tokenizer, CppCAN::CANDatabase& db) {
   assert_token(tokenizer, BIT_TIMING_TOKEN);
   assert_token(tokenizer, ":");
 
@@ -96,6 +101,9 @@ parseBitTimingSection(dtl::Tokenizer& tokenizer) {
     dtl::Token btr1 = assert_token(tokenizer, dtl::Token::PositiveNumber);
     dtl::assert_token(tokenizer, ",");
     dtl::Token btr2 = assert_token(tokenizer, dtl::Token::PositiveNumber);
+
+    db.set_bit_timing({ static_cast<unsigned int>(baudrate.toUInt()), static_cast<unsigned int>(btr1.toUInt()),
+                      static_cast<unsigned int>(btr2.toUInt()) });
   }
 }
 
@@ -131,6 +139,39 @@ parseNodesSection(dtl::Tokenizer& tokenizer, CppCAN::CANDatabase& db,
   tokenizer.saveTokenIfNotEof(currentToken);
 }
 
+/**
+ * Parses a list of (value, label) pairs until the semi-colon
+ */
+static CppCAN::CANSignal::choices_type
+parseValueDescriptions(dtl::Tokenizer& tokenizer) {
+  CppCAN::CANSignal::choices_type result;
+
+  while(!dtl::peek_token(tokenizer, ";")) {
+    dtl::Token value = dtl::assert_token(tokenizer, dtl::Token::Number);
+    dtl::Token desc = dtl::assert_token(tokenizer, dtl::Token::StringLiteral);
+
+    result.insert(std::make_pair(value.toUInt(), desc.image));
+  }
+
+  return result;
+}
+
+static void
+parseValTableSection(dtl::Tokenizer& tokenizer, CppCAN::CANDatabase& db, 
+                     std::vector<CppCAN::CANDatabase::parsing_warning>* warnings) {
+  while(dtl::peek_token(tokenizer, VAL_TABLE_TOKEN)) {
+    dtl::Token name = dtl::assert_token(tokenizer, dtl::Token::Identifier);
+    CppCAN::CANSignal::choices_type choices = parseValueDescriptions(tokenizer);
+
+    if(db.value_tables().count(name.image) > 0) {
+      dtl::warning(warnings, "Double declaration of the value table \"" + name.image + "\"", 
+                   tokenizer.lineCount());
+    }
+
+    db.addValueTable(name.image, choices);
+  }
+}
+
 static void
 parseUnsupportedCommandSection(dtl::Tokenizer& tokenizer, const std::string& command, 
                                std::vector<CppCAN::CANDatabase::parsing_warning>* warnings) {
@@ -146,12 +187,48 @@ parseUnsupportedCommandSection(dtl::Tokenizer& tokenizer, const std::string& com
   }
 }
 
+/**
+ * Parses the multiplexer indicator of a signal: M, m<N> or m<N>M
+ */
+static void
+parseMultiplexerIndicator(dtl::Tokenizer& tokenizer, const dtl::Token& indicator,
+                          CppCAN::CANSignal::Multiplexing& multiplexing, 
+                          unsigned long long& value) {
+  const std::string& image = indicator.image;
+
+  if(image == "M") {
+    multiplexing = CppCAN::CANSignal::Multiplexor;
+    return;
+  }
+
+  bool is_switch = image.size() > 2 && image.back() == 'M';
+  std::string digits = image.substr(1, image.size() - (is_switch ? 2 : 1));
+
+  if(image[0] != 'm' || digits.empty() || 
+     !std::all_of(digits.begin(), digits.end(), [](char c) { return std::isdigit((unsigned char)c); })) {
+    dtl::throw_error("Syntax error", "Invalid multiplexer indicator \"" + image + "\"", 
+                     tokenizer.lineCount());
+  }
+
+  multiplexing = is_switch ? CppCAN::CANSignal::MultiplexedMultiplexor : 
+                             CppCAN::CANSignal::Multiplexed;
+  value = std::stoull(digits);
+}
+
 static void
 parseSigDefInstruction(dtl::Tokenizer& tokenizer, CppCAN::CANFrame& frame, 
                        std::vector<CppCAN::CANDatabase::parsing_warning>* warnings ) {
   dtl::assert_current_token(tokenizer, SIG_DEF_TOKEN);
 
   dtl::Token name = dtl::assert_token(tokenizer, dtl::Token::Identifier);
+
+  CppCAN::CANSignal::Multiplexing multiplexing = CppCAN::CANSignal::NotMultiplexed;
+  unsigned long long multiplexer_value = 0;
+  if(dtl::peek_token(tokenizer, dtl::Token::Identifier)) {
+    parseMultiplexerIndicator(tokenizer, tokenizer.getCurrentToken(), 
+                              multiplexing, multiplexer_value);
+  }
+
   dtl::assert_token(tokenizer, ":");
   dtl::Token startBit = dtl::assert_token(tokenizer, dtl::Token::PositiveNumber);
   dtl::assert_token(tokenizer, "|");
@@ -184,18 +261,19 @@ parseSigDefInstruction(dtl::Tokenizer& tokenizer, CppCAN::CANFrame& frame,
     dtl::warning(warnings, ss.str(), tokenizer.lineCount());
   }
 
-  frame.addSignal(
-    CppCAN::CANSignal(
-      name.image,
-      startBit.toUInt(),
-      length.toUInt(),
-      scale.toDouble(),
-      offset.toDouble(),
-      signedness == "-" ? CppCAN::CANSignal::Signed : CppCAN::CANSignal::Unsigned,
-      endianess == "0" ? CppCAN::CANSignal::BigEndian : CppCAN::CANSignal::LittleEndian,
-      CppCAN::CANSignal::Range::fromString(min.image, max.image)
-    )
+  CppCAN::CANSignal signal(
+    name.image,
+    startBit.toUInt(),
+    length.toUInt(),
+    scale.toDouble(),
+    offset.toDouble(),
+    signedness == "-" ? CppCAN::CANSignal::Signed : CppCAN::CANSignal::Unsigned,
+    endianess == "0" ? CppCAN::CANSignal::BigEndian : CppCAN::CANSignal::LittleEndian,
+    CppCAN::CANSignal::Range::fromString(min.image, max.image)
   );
+  signal.setMultiplexing(multiplexing, multiplexer_value);
+
+  frame.addSignal(signal);
 }
 
 static void
@@ -210,7 +288,11 @@ parseMsgDefSection(dtl::Tokenizer& tokenizer, CppCAN::CANDatabase& db,
     dtl::Token dlc = assert_token(tokenizer, dtl::Token::PositiveNumber);
     dtl::Token ecu = assert_token(tokenizer, dtl::Token::Identifier);
 
-    if(db.contains(id.toUInt())) {
+    CppCAN::CANFrame new_frame(
+      name.image, id.toUInt(), dlc.toUInt());
+
+    // CANDatabase::contains() also finds extended frames by their bare ID
+    if(db.contains(new_frame.dbc_id()) && db.at(new_frame.dbc_id()).dbc_id() == new_frame.dbc_id()) {
       dtl::throw_error("Database error", "Double declaration of frame with CAN ID " + id.image, tokenizer.lineCount());
     }
 
@@ -220,9 +302,6 @@ parseMsgDefSection(dtl::Tokenizer& tokenizer, CppCAN::CANDatabase& db,
       dtl::warning(warnings, ss.str(), tokenizer.lineCount());
     }
 
-    CppCAN::CANFrame new_frame(
-      name.image, id.toUInt(), dlc.toUInt());
-
     while(dtl::peek_token(tokenizer, SIG_DEF_TOKEN)) {
       parseSigDefInstruction(tokenizer, new_frame, warnings);
     }
@@ -305,12 +384,124 @@ parseCommentSection(dtl::Tokenizer& tokenizer, CppCAN::CANDatabase& db,
   }
 }
 
+/**
+ * Tells if a value of the VFrameFormat attribute is a CAN FD format
+ * ("StandardCAN_FD" or "ExtendedCAN_FD").
+ */
+static bool
+is_fd_frame_format(const std::string& format) {
+  static const std::string FD_SUFFIX = "_FD";
+  return format.size() >= FD_SUFFIX.size() &&
+         format.compare(format.size() - FD_SUFFIX.size(), FD_SUFFIX.size(), FD_SUFFIX) == 0;
+}
+
+static void
+parseAttrDefSection(dtl::Tokenizer& tokenizer, std::vector<std::string>& frameFormats,
+                    std::vector<CppCAN::CANDatabase::parsing_warning>* warnings) {
+  while(dtl::peek_token(tokenizer, ATTR_DEF_TOKEN)) {
+    // The object type (BU_, BO_, SG_, EV_) is omitted for global attributes:
+    // peek_token() skips it if it is present.
+    dtl::peek_token(tokenizer, dtl::Token::Identifier);
+
+    dtl::Token attrName = dtl::assert_token(tokenizer, dtl::Token::StringLiteral);
+    if(attrName != "VFrameFormat") {
+      dtl::warning(
+        warnings, 
+        "Skipped \"" + ATTR_DEF_TOKEN + "\" instruction "
+        "because it is not supported", 
+        tokenizer.lineCount()); 
+      tokenizer.skipUntil(";");
+      continue;
+    }
+
+    dtl::assert_token(tokenizer, "ENUM");
+    frameFormats.clear();
+    do {
+      frameFormats.push_back(dtl::assert_token(tokenizer, dtl::Token::StringLiteral).image);
+    } while(dtl::peek_token(tokenizer, ","));
+    dtl::assert_token(tokenizer, ";");
+  }
+}
+
+static void
+parseAttrDefDefaultSection(dtl::Tokenizer& tokenizer, CppCAN::CANDatabase& db,
+                           std::vector<CppCAN::CANDatabase::parsing_warning>* warnings) {
+  while(dtl::peek_token(tokenizer, ATTR_DEF_DEFAULT_TOKEN)) {
+    dtl::Token attrName = dtl::assert_token(tokenizer, dtl::Token::StringLiteral);
+    if(attrName != "VFrameFormat") {
+      dtl::warning(
+        warnings, 
+        "Skipped \"" + ATTR_DEF_DEFAULT_TOKEN + "\" instruction "
+        "because it is not supported", 
+        tokenizer.lineCount()); 
+      tokenizer.skipUntil(";");
+      continue;
+    }
+
+    // The frames are all declared at this point: the default value is applied to
+    // all of them and the BA_ instructions override it.
+    dtl::Token format = dtl::assert_token(tokenizer, dtl::Token::StringLiteral);
+    dtl::assert_token(tokenizer, ";");
+
+    for(auto& frame : db) {
+      frame.second.setFD(is_fd_frame_format(format.image));
+    }
+  }
+}
+
+static void
+parseFrameFormatInstruction(dtl::Tokenizer& tokenizer, CppCAN::CANDatabase& db, 
+                            const std::vector<std::string>& frameFormats,
+                            std::vector<CppCAN::CANDatabase::parsing_warning>* warnings) {
+  // Values of the VFrameFormat enumeration when BA_DEF_ is missing
+  static const std::vector<std::string> DEFAULT_FRAME_FORMATS = {
+    "StandardCAN", "ExtendedCAN", "reserved", "reserved", "reserved", "reserved",
+    "reserved", "reserved", "reserved", "reserved", "reserved", "reserved", 
+    "reserved", "reserved", "StandardCAN_FD", "ExtendedCAN_FD"
+  };
+
+  dtl::assert_token(tokenizer, "BO_");
+  dtl::Token frameId = dtl::assert_token(tokenizer, dtl::Token::PositiveNumber);
+  dtl::Token value = dtl::assert_token(tokenizer, dtl::Token::PositiveNumber);
+  dtl::assert_token(tokenizer, ";");
+
+  const std::vector<std::string>& formats = frameFormats.empty() ? DEFAULT_FRAME_FORMATS : frameFormats;
+  if(value.toUInt() >= formats.size()) {
+    dtl::warning(warnings, "Invalid VFrameFormat value " + value.image, tokenizer.lineCount());
+    return;
+  }
+
+  if(!db.contains(frameId.toUInt())) {
+    dtl::warning(warnings, frameId.image + " does not exist", tokenizer.lineCount());
+    return;
+  }
+
+  const std::string& format = formats[value.toUInt()];
+  CppCAN::CANFrame& frame = db[frameId.toUInt()];
+  frame.setFD(is_fd_frame_format(format));
+
+  bool extended = format.compare(0, 8, "Extended") == 0;
+  if(extended != frame.is_extended()) {
+    dtl::warning(
+      warnings, 
+      "VFrameFormat of frame " + frameId.image + " is " + format + 
+      " but its CAN ID is " + (frame.is_extended() ? "extended" : "standard"), 
+      tokenizer.lineCount());
+  }
+}
+
 static void
 parseAttrValSection(dtl::Tokenizer& tokenizer, CppCAN::CANDatabase& db, 
+                    const std::vector<std::string>& frameFormats,
                     std::vector<CppCAN::CANDatabase::parsing_warning>* warnings) {
   while(dtl::peek_token(tokenizer, ATTR_VAL_TOKEN)) {
     dtl::Token attrType = dtl::assert_token(tokenizer, dtl::Token::StringLiteral);
 
+    if(attrType == "VFrameFormat") {
+      parseFrameFormatInstruction(tokenizer, db, frameFormats, warnings);
+      continue;
+    }
+
     if(attrType != "GenMsgCycleTime" && attrType != "CycleTime") {
       tokenizer.skipUntil(";");
       dtl::warning(warnings, "Unsupported BA_ operation", tokenizer.lineCount());
@@ -338,13 +529,25 @@ parseValDescSection(dtl::Tokenizer& tokenizer, CppCAN::CANDatabase& db,
     dtl::Token targetFrame = dtl::assert_token(tokenizer, dtl::Token::PositiveNumber);
     dtl::Token targetSignal = dtl::assert_token(tokenizer, dtl::Token::Identifier);
     
-    std::map<unsigned int, std::string> targetChoices;
-
-    while(!dtl::peek_token(tokenizer, ";")) {
-      dtl::Token value = dtl::assert_token(tokenizer, dtl::Token::Number);
-      dtl::Token desc = dtl::assert_token(tokenizer, dtl::Token::StringLiteral);
+    // The choices are either listed or given by the name of a value table.
+    // In both cases, identical tables are shared through the database's pool.
+    CppCAN::CANSignal::shared_choices targetChoices;
+    if(dtl::peek_token(tokenizer, dtl::Token::Identifier)) {
+      dtl::Token tableName = tokenizer.getCurrentToken();
+      dtl::assert_token(tokenizer, ";");
 
-      targetChoices.insert(std::make_pair(value.toUInt(), desc.image));
+      auto ite = db.value_tables().find(tableName.image);
+      if(ite == db.value_tables().end()) {
+        dtl::warning(
+          warnings, 
+          "Invalid VAL_ instruction: the value table \"" + tableName.image + "\" does not exist", 
+          tokenizer.lineCount());
+        continue;
+      }
+      targetChoices = ite->second;
+    }
+    else {
+      targetChoices = db.internChoices(parseValueDescriptions(tokenizer));
     }
 
     if(!db.contains(targetFrame.toUInt())) {
@@ -370,26 +573,145 @@ parseValDescSection(dtl::Tokenizer& tokenizer, CppCAN::CANDatabase& db,
   }
 }
 
+static void
+parseSigValTypeSection(dtl::Tokenizer& tokenizer, CppCAN::CANDatabase& db, 
+                       std::vector<CppCAN::CANDatabase::parsing_warning>* warnings) {
+  while(dtl::peek_token(tokenizer, SIG_VALTYPE_TOKEN)) {
+    dtl::Token targetFrame = dtl::assert_token(tokenizer, dtl::Token::PositiveNumber);
+    dtl::Token targetSignal = dtl::assert_token(tokenizer, dtl::Token::Identifier);
+    dtl::peek_token(tokenizer, ":"); // The colon is omitted by some tools
+    dtl::Token valueType = dtl::assert_token(tokenizer, dtl::Token::PositiveNumber);
+    dtl::assert_token(tokenizer, ";");
+
+    // 0: integer, 1: IEEE float, 2: IEEE double
+    static const CppCAN::CANSignal::ValueType VALUE_TYPES[] = {
+      CppCAN::CANSignal::Integer, CppCAN::CANSignal::Float, CppCAN::CANSignal::Double
+    };
+    static const unsigned VALUE_TYPE_LENGTHS[] = { 0, 32, 64 };
+
+    if(valueType.toUInt() > 2) {
+      dtl::warning(
+        warnings, 
+        "Invalid SIG_VALTYPE_ instruction: unknown value type " + valueType.image, 
+        tokenizer.lineCount());
+      continue;
+    }
+
+    if(!db.contains(targetFrame.toUInt())) {
+      dtl::warning(
+        warnings, 
+        "Invalid SIG_VALTYPE_ instruction: Frame with id " + 
+        targetFrame.image + " does not exist", 
+        tokenizer.lineCount());
+      continue;
+    }
+
+    CppCAN::CANFrame& frame = db[targetFrame.toUInt()];
+    if(!frame.contains(targetSignal.image)) {
+      dtl::warning(
+        warnings, 
+        "Invalid SIG_VALTYPE_ instruction: Frame " + targetFrame.image + 
+        " does not have a signal named \"" + targetSignal.image + "\"", 
+        tokenizer.lineCount());
+      continue;
+    }
+
+    CppCAN::CANSignal& signal = frame[targetSignal.image];
+    unsigned expected_length = VALUE_TYPE_LENGTHS[valueType.toUInt()];
+    if(expected_length != 0 && signal.length() != expected_length) {
+      dtl::warning(
+        warnings, 
+        "Invalid SIG_VALTYPE_ instruction: signal \"" + targetSignal.image + 
+        "\" must be " + std::to_string(expected_length) + "-bit long", 
+        tokenizer.lineCount());
+      continue;
+    }
+
+    signal.setValueType(VALUE_TYPES[valueType.toUInt()]);
+  }
+}
+
+static void
+parseSigMulValSection(dtl::Tokenizer& tokenizer, CppCAN::CANDatabase& db, 
+                      std::vector<CppCAN::CANDatabase::parsing_warning>* warnings) {
+  while(dtl::peek_token(tokenizer, SIG_MUL_VAL_TOKEN)) {
+    dtl::Token targetFrame = dtl::assert_token(tokenizer, dtl::Token::PositiveNumber);
+    dtl::Token targetSignal = dtl::assert_token(tokenizer, dtl::Token::Identifier);
+    dtl::Token switchSignal = dtl::assert_token(tokenizer, dtl::Token::Identifier);
+
+    std::vector<CppCAN::CANSignal::MultiplexerRange> ranges;
+    do {
+      // "3-5" is tokenized as the numbers 3 and -5, while "3 - 5" gives 3, "-" and 5
+      dtl::Token from = dtl::assert_token(tokenizer, dtl::Token::PositiveNumber);
+      dtl::Token to = tokenizer.getNextToken();
+      if(to == "-") {
+        to = dtl::assert_token(tokenizer, dtl::Token::PositiveNumber);
+      }
+      else if(to == dtl::Token::NegativeNumber) {
+        to.image = to.image.substr(1);
+      }
+      else {
+        dtl::throw_error("Syntax error", "Expected a multiplexer value range but got \"" + 
+                         to.image + "\"", tokenizer.lineCount());
+      }
+
+      ranges.push_back({ from.toUInt(), to.toUInt() });
+    } while(dtl::peek_token(tokenizer, ","));
+    dtl::assert_token(tokenizer, ";");
+
+    if(!db.contains(targetFrame.toUInt())) {
+      dtl::warning(
+        warnings, 
+        "Invalid SG_MUL_VAL_ instruction: Frame with id " + 
+        targetFrame.image + " does not exist", 
+        tokenizer.lineCount());
+      continue;
+    }
+
+    CppCAN::CANFrame& frame = db[targetFrame.toUInt()];
+    if(!frame.contains(targetSignal.image) || !frame.contains(switchSignal.image)) {
+      dtl::warning(
+        warnings, 
+        "Invalid SG_MUL_VAL_ instruction: Frame " + targetFrame.image + 
+        " does not have the signals \"" + targetSignal.image + "\" and \"" + 
+        switchSignal.image + "\"", 
+        tokenizer.lineCount());
+    }
+    else if(!frame[switchSignal.image].is_multiplexor()) {
+      dtl::warning(
+        warnings, 
+        "Invalid SG_MUL_VAL_ instruction: \"" + switchSignal.image + 
+        "\" is not a multiplexor", 
+        tokenizer.lineCount());
+    }
+    else {
+      frame[targetSignal.image].setMultiplexerSwitch(switchSignal.image, ranges);
+    }
+  }
+}
 
 CppCAN::CANDatabase
 CppCAN::parser::dbc::fromTokenizer(const std::string& name, dtl::Tokenizer& tokenizer, std::vector<CppCAN::CANDatabase::parsing_warning>* warnings) {
   CANDatabase result(name);
+  std::vector<std::string> frameFormats; // Values of the VFrameFormat enumeration
 
   parseVersionSection(tokenizer);
   parseNSSection(tokenizer);
-  parseBitTimingSection(tokenizer);
+  parseBitTimingSection(tokenizer, result);
   parseNodesSection(tokenizer, result, warnings);
-  parseUnsupportedCommandSection(tokenizer, "VAL_TABLE_", warnings);
+  parseValTableSection(tokenizer, result, warnings);
   parseMsgDefSection(tokenizer, result, warnings);
   parseUnsupportedCommandSection(tokenizer, "BO_TX_BU_", warnings);
   parseUnsupportedCommandSection(tokenizer, "EV_", warnings);
   parseUnsupportedCommandSection(tokenizer, "SGTYPE_", warnings);
   parseCommentSection(tokenizer, result, warnings);
-  parseUnsupportedCommandSection(tokenizer, "BA_DEF_", warnings);
-  parseUnsupportedCommandSection(tokenizer, "SIG_VALTYPE_", warnings);
-  parseUnsupportedCommandSection(tokenizer, "BA_DEF_DEF_", warnings);
-  parseAttrValSection(tokenizer, result, warnings);
+  parseAttrDefSection(tokenizer, frameFormats, warnings);
+  parseSigValTypeSection(tokenizer, result, warnings);
+  parseAttrDefDefaultSection(tokenizer, result, warnings);
+  parseAttrValSection(tokenizer, result, frameFormats, warnings);
   parseValDescSection(tokenizer, result, warnings);
+  parseSigValTypeSection(tokenizer, result, warnings); // Usually found after VAL_
+  parseSigMulValSection(tokenizer, result, warnings);
 
   while(!dtl::is_token(tokenizer, dtl::Token::Eof)) {
     // We have a syntax error because we have a token which does not
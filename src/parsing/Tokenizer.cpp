@@ -243,16 +243,15 @@ std::string Tokenizer::parseNumber(bool& is_float) {
   char currentChar = getNextChar();
   is_float = false;
 
-  while (isDigit(currentChar) && !isEOF(currentChar)) {
-    result += currentChar;
-    currentChar = getNextChar();
-
+  // The decimal point and the exponent are checked before the digits so
+  // that numbers with a single-digit integral part (eg. 0.25) are accepted.
+  while (!isEOF(currentChar)) {
     if(currentChar == '.') {
       is_float = true;
       result += currentChar;
       currentChar = getNextChar();
     }
-    else if(currentChar == 'e') {
+    else if(currentChar == 'e' || currentChar == 'E') {
       result += currentChar;
       currentChar = getNextChar();
       
@@ -269,6 +268,13 @@ std::string Tokenizer::parseNumber(bool& is_float) {
         currentChar = getNextChar();
       }
     }
+    else if(isDigit(currentChar)) {
+      result += currentChar;
+      currentChar = getNextChar();
+    }
+    else {
+      break;
+    }
   }
 
   return result;
@@ -332,7 +338,7 @@ char StringTokenizer::doGetNextChar() {
     addLine = false;
   }
 
-  if (result = '\n') {
+  if (result == '\n') {
     addLine = true;
   }
 
@@ -0,0 +1,46 @@
+#ifndef Backoff_H
+#define Backoff_H
+
+#include <chrono>
+#include <thread>
+
+namespace CppCAN {
+namespace details {
+
+/**
+ * @brief Backoff of the threads that wait for a ring: they first spin, then yield
+ *        and finally sleep
+ */
+class Backoff {
+public:
+  Backoff() : rounds_(0) { }
+
+  void wait() {
+    if(rounds_ < SPIN_ROUNDS) {
+      rounds_++;
+    }
+    else if(rounds_ < YIELD_ROUNDS) {
+      rounds_++;
+      std::this_thread::yield();
+    }
+    else {
+      std::this_thread::sleep_for(std::chrono::microseconds(IDLE_SLEEP_US));
+    }
+  }
+
+  void reset() {
+    rounds_ = 0;
+  }
+
+private:
+  static constexpr unsigned SPIN_ROUNDS = 64;
+  static constexpr unsigned YIELD_ROUNDS = 128;
+  static constexpr unsigned IDLE_SLEEP_US = 50;
+
+  unsigned rounds_;
+};
+
+}
+}
+
+#endif
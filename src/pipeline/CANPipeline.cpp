@@ -0,0 +1,382 @@
+#include "CANPipeline.h"
+#include "CANRing.h"
+#include "Backoff.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+using namespace CppCAN;
+using details::Backoff;
+
+static const std::size_t DEFAULT_RING_SIZE = 4096;
+static const std::size_t DEFAULT_BATCH_SIZE = 64;
+
+CANPipeline::Options::Options()
+  : ring_size(DEFAULT_RING_SIZE), batch_size(DEFAULT_BATCH_SIZE), backpressure(Block) { }
+
+CANPipeline::Stage::~Stage() { }
+
+void CANPipeline::Stage::flush() { }
+
+struct alignas(CACHE_LINE_SIZE) CANPipeline::AtomicCounters {
+  AtomicCounters() : frames_in(0), frames_out(0), dropped(0), stalls(0) { }
+
+  Counters snapshot() const {
+    return { frames_in.load(std::memory_order_relaxed), frames_out.load(std::memory_order_relaxed),
+             dropped.load(std::memory_order_relaxed), stalls.load(std::memory_order_relaxed) };
+  }
+
+  std::atomic<uint64_t> frames_in;
+  std::atomic<uint64_t> frames_out;
+  std::atomic<uint64_t> dropped;
+  std::atomic<uint64_t> stalls;
+};
+
+/**
+ * @brief Ring between two threads. A single-producer ring is used whenever possible:
+ *        the ring of several sources and the rings whose producer drops the oldest
+ *        frames need MPSCRing.
+ */
+class CANPipeline::Link {
+public:
+  Link(std::size_t size, bool multi_producer)
+    : done(false) {
+    if(multi_producer)
+      mpsc_.reset(new MPSCRing<Entry>(size));
+    else
+      spsc_.reset(new SPSCRing<LogFrame>(size));
+  }
+
+  /**
+   * @param producer Counters of the caller, stored with the frames of a MPSCRing
+   */
+  std::size_t try_push(const LogFrame* frames, std::size_t count, AtomicCounters* producer) {
+    if(spsc_)
+      return spsc_->try_push(frames, count);
+
+    Entry entry;
+    entry.producer = producer;
+    std::size_t pushed = 0;
+    for(; pushed < count; pushed++) {
+      entry.frame = frames[pushed];
+      if(!mpsc_->try_push(entry))
+        break;
+    }
+    return pushed;
+  }
+
+  std::size_t try_pop(LogFrame* frames, std::size_t count) {
+    if(spsc_)
+      return spsc_->try_pop(frames, count);
+
+    Entry entry;
+    std::size_t popped = 0;
+    for(; popped < count && mpsc_->try_pop(entry); popped++)
+      frames[popped] = entry.frame;
+    return popped;
+  }
+
+  /**
+   * @brief Drops the oldest frame of a MPSCRing (DropOldest) and counts it against
+   *        the producer that pushed it, which may be another source
+   */
+  void drop_oldest() {
+    Entry entry;
+    if(mpsc_->try_pop(entry)) {
+      entry.producer->frames_out.fetch_sub(1, std::memory_order_relaxed);
+      entry.producer->dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  std::atomic<bool> done; // Set when no frame will be pushed anymore
+
+private:
+  struct Entry {
+    LogFrame frame;
+    AtomicCounters* producer;
+  };
+
+  std::unique_ptr<SPSCRing<LogFrame>> spsc_;
+  std::unique_ptr<MPSCRing<Entry>> mpsc_;
+};
+
+CANPipeline::CANPipeline(const Options& options)
+  : options_(options), stop_(false), abort_(false), running_sources_(0) {
+  options_.batch_size = std::max<std::size_t>(options_.batch_size, 1);
+  options_.ring_size = std::max(options_.ring_size, options_.batch_size);
+}
+
+CANPipeline::~CANPipeline() {
+  stop();
+  abort_ = true;
+  for(std::thread& thread : threads_) {
+    if(thread.joinable())
+      thread.join();
+  }
+}
+
+void CANPipeline::add_source(CANFrameSource& source) {
+  sources_.push_back(&source);
+}
+
+void CANPipeline::add_stage(Stage& stage) {
+  stages_.push_back(&stage);
+}
+
+void CANPipeline::start() {
+  if(sources_.empty() || stages_.empty())
+    throw std::logic_error("A pipeline needs at least one source and one stage");
+  if(!threads_.empty())
+    throw std::logic_error("The pipeline is already started");
+
+  bool drop_oldest = options_.backpressure == DropOldest;
+  for(std::size_t i = 0; i < stages_.size(); i++) {
+    bool multi_producer = drop_oldest || (i == 0 && sources_.size() > 1);
+    links_.emplace_back(new Link(options_.ring_size, multi_producer));
+    stage_counters_.emplace_back(new AtomicCounters());
+  }
+  for(std::size_t i = 0; i < sources_.size(); i++)
+    source_counters_.emplace_back(new AtomicCounters());
+
+  running_sources_ = sources_.size();
+  for(std::size_t i = 0; i < stages_.size(); i++)
+    threads_.emplace_back(&CANPipeline::stage_thread, this, i);
+  for(std::size_t i = 0; i < sources_.size(); i++)
+    threads_.emplace_back(&CANPipeline::source_thread, this, i);
+}
+
+void CANPipeline::stop() {
+  stop_ = true;
+}
+
+void CANPipeline::wait() {
+  for(std::thread& thread : threads_) {
+    if(thread.joinable())
+      thread.join();
+  }
+
+  if(error_)
+    std::rethrow_exception(error_);
+}
+
+void CANPipeline::run() {
+  start();
+  wait();
+}
+
+CANPipeline::Counters CANPipeline::source_counters(std::size_t source) const {
+  return source_counters_.at(source)->snapshot();
+}
+
+CANPipeline::Counters CANPipeline::stage_counters(std::size_t stage) const {
+  return stage_counters_.at(stage)->snapshot();
+}
+
+void CANPipeline::fail(std::exception_ptr error) {
+  {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    if(!error_)
+      error_ = error;
+  }
+  abort_ = true;
+}
+
+void CANPipeline::push(Link& link, const LogFrame* frames, std::size_t count, AtomicCounters& counters) {
+  // With DropOldest, another producer can drop the frames as soon as they are
+  // pushed: they are counted in frames_out beforehand
+  bool drop_oldest = options_.backpressure == DropOldest;
+  if(drop_oldest)
+    counters.frames_out.fetch_add(count, std::memory_order_relaxed);
+
+  std::size_t pushed = link.try_push(frames, count, &counters);
+  uint64_t dropped = 0;
+
+  if(pushed < count) {
+    switch(options_.backpressure) {
+    case Block: {
+      Backoff backoff;
+      counters.stalls.fetch_add(1, std::memory_order_relaxed);
+      while(pushed < count && !abort_) {
+        std::size_t n = link.try_push(frames + pushed, count - pushed, &counters);
+        if(n == 0)
+          backoff.wait();
+        else
+          backoff.reset();
+        pushed += n;
+      }
+      break;
+    }
+    case DropOldest:
+      while(pushed < count && !abort_) {
+        if(link.try_push(frames + pushed, 1, &counters) == 1)
+          pushed++;
+        else
+          link.drop_oldest();
+      }
+      break;
+    case DropNewest:
+      dropped = count - pushed;
+      break;
+    }
+  }
+
+  // The frames that could not be pushed before an abort are neither given nor dropped
+  if(drop_oldest)
+    counters.frames_out.fetch_sub(count - pushed, std::memory_order_relaxed);
+  else
+    counters.frames_out.fetch_add(pushed, std::memory_order_relaxed);
+  counters.dropped.fetch_add(dropped, std::memory_order_relaxed);
+}
+
+void CANPipeline::source_thread(std::size_t index) {
+  CANFrameSource& source = *sources_[index];
+  AtomicCounters& counters = *source_counters_[index];
+  std::vector<LogFrame> batch(options_.batch_size);
+
+  try {
+    while(!stop_ && !abort_ && !source.closed()) {
+      std::size_t count = source.read(batch.data(), batch.size());
+      counters.frames_in.fetch_add(count, std::memory_order_relaxed);
+      if(count > 0)
+        push(*links_[0], batch.data(), count, counters);
+    }
+  }
+  catch(...) {
+    fail(std::current_exception());
+  }
+
+  // The last source closes the first ring
+  if(running_sources_.fetch_sub(1) == 1)
+    links_[0]->done.store(true, std::memory_order_release);
+}
+
+void CANPipeline::stage_thread(std::size_t index) {
+  Stage& stage = *stages_[index];
+  Link& input = *links_[index];
+  Link* output = index + 1 < links_.size() ? links_[index + 1].get() : nullptr;
+  AtomicCounters& counters = *stage_counters_[index];
+  std::vector<LogFrame> batch(options_.batch_size);
+  Backoff backoff;
+
+  try {
+    while(!abort_) {
+      std::size_t count = input.try_pop(batch.data(), batch.size());
+      if(count == 0) {
+        // The frames pushed before done was set are visible once it is read
+        if(!input.done.load(std::memory_order_acquire)) {
+          backoff.wait();
+          continue;
+        }
+
+        count = input.try_pop(batch.data(), batch.size());
+        if(count == 0)
+          break;
+      }
+      backoff.reset();
+
+      counters.frames_in.fetch_add(count, std::memory_order_relaxed);
+      std::size_t kept = stage.process(batch.data(), count);
+      if(output != nullptr)
+        push(*output, batch.data(), kept, counters);
+      else
+        counters.frames_out.fetch_add(kept, std::memory_order_relaxed);
+    }
+
+    if(!abort_)
+      stage.flush();
+  }
+  catch(...) {
+    fail(std::current_exception());
+  }
+
+  if(output != nullptr)
+    output->done.store(true, std::memory_order_release);
+}
+
+DecodeStage::DecodeStage(const CANDecoder& decoder, const Callback& callback, bool drop_unknown)
+  : decoder_(&decoder), callback_(callback), drop_unknown_(drop_unknown), decoded_(0) {
+  std::size_t largest = 0;
+  for(const CANDecoder::FramePlan& plan : decoder.frames())
+    largest = std::max(largest, plan.signals.size());
+  values_.resize(largest);
+}
+
+std::size_t DecodeStage::process(LogFrame* frames, std::size_t count) {
+  std::size_t kept = 0;
+
+  for(std::size_t i = 0; i < count; i++) {
+    const LogFrame& frame = frames[i];
+    const CANDecoder::FramePlan* plan = nullptr;
+    if(!(frame.flags & (LogFrame::Remote | LogFrame::ErrorFrame)))
+      plan = decoder_->find(frame.can_id, frame.is_extended());
+
+    if(plan != nullptr) {
+      std::fill(values_.begin(), values_.begin() + plan->signals.size(),
+                std::numeric_limits<double>::quiet_NaN());
+      decoder_->decode(*plan, frame.data, frame.length, values_.data());
+      callback_(frame, *plan, values_.data());
+      decoded_++;
+    }
+
+    if(plan != nullptr || !drop_unknown_)
+      frames[kept++] = frame;
+  }
+
+  return kept;
+}
+
+std::size_t DecodeStage::decoded() const {
+  return decoded_;
+}
+
+FilterStage::FilterStage(const std::vector<CANRawFilter>& filters)
+  : filters_(filters) { }
+
+std::size_t FilterStage::process(LogFrame* frames, std::size_t count) {
+  std::size_t kept = 0;
+
+  for(std::size_t i = 0; i < count; i++) {
+    const LogFrame& frame = frames[i];
+    bool match = std::any_of(filters_.begin(), filters_.end(),
+                             [&frame](const CANRawFilter& filter) { return filter.matches(frame); });
+    if(match)
+      frames[kept++] = frame;
+  }
+
+  return kept;
+}
+
+IdFilterStage::IdFilterStage(const CANIdFilter& filter)
+  : filter_(&filter) { }
+
+std::size_t IdFilterStage::process(LogFrame* frames, std::size_t count) {
+  std::size_t kept = 0;
+
+  for(std::size_t i = 0; i < count; i++) {
+    if(filter_->matches(frames[i]))
+      frames[kept++] = frames[i];
+  }
+
+  return kept;
+}
+
+BinaryLogStage::BinaryLogStage(BinaryLogWriter& writer)
+  : writer_(&writer) { }
+
+std::size_t BinaryLogStage::process(LogFrame* frames, std::size_t count) {
+  for(std::size_t i = 0; i < count; i++)
+    writer_->write(frames[i]);
+  return count;
+}
+
+void BinaryLogStage::flush() {
+  writer_->close();
+}
+
+CallbackStage::CallbackStage(const Callback& callback)
+  : callback_(callback) { }
+
+std::size_t CallbackStage::process(LogFrame* frames, std::size_t count) {
+  callback_(frames, count);
+  return count;
+}
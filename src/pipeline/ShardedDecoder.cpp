@@ -0,0 +1,291 @@
+#include "ShardedDecoder.h"
+#include "CANRing.h"
+#include "Backoff.h"
+#include <algorithm>
+#include <limits>
+
+using namespace CppCAN;
+using details::Backoff;
+
+static const std::size_t SHARDS_PER_THREAD = 16;
+static const std::size_t DEFAULT_SHARD_QUEUE_SIZE = 1024;
+static const std::size_t DEFAULT_BATCH_SIZE = 64;
+static const uint64_t DEFAULT_REBALANCE_INTERVAL = 1 << 16;
+
+// Expected rate (frames per second) of the frames without period
+static const double DEFAULT_FRAME_RATE = 10.;
+
+ShardedDecoder::Options::Options()
+  : threads(0), shards(0), shard_queue_size(DEFAULT_SHARD_QUEUE_SIZE), batch_size(DEFAULT_BATCH_SIZE),
+    assignment(LoadAware), rebalance_interval(DEFAULT_REBALANCE_INTERVAL), work_stealing(true) { }
+
+struct ShardedDecoder::Item {
+  const CANDecoder::FramePlan* plan;
+  LogFrame frame;
+};
+
+struct alignas(CACHE_LINE_SIZE) ShardedDecoder::Shard {
+  explicit Shard(std::size_t size, unsigned owner)
+    : queue(size), owner(owner), busy(false), frames(0), recent(0) { }
+
+  SPSCRing<Item> queue;
+  std::atomic<unsigned> owner;
+  std::atomic<bool> busy;     // Set while a worker consumes the queue
+  std::atomic<uint64_t> frames;
+  uint64_t recent;            // Frames pushed since the last rebalancing (pushing thread only)
+};
+
+struct alignas(CACHE_LINE_SIZE) ShardedDecoder::Worker {
+  Worker(unsigned index, std::size_t batch_size, std::size_t value_count)
+    : index(index), batch(batch_size), values(value_count), frames(0), batches(0), steals(0) { }
+
+  unsigned index;
+  std::vector<Item> batch;
+  std::vector<double> values; // Sized for the largest frame of the decoder
+  std::atomic<uint64_t> frames;
+  std::atomic<uint64_t> batches;
+  std::atomic<uint64_t> steals;
+};
+
+/**
+ * @brief Mixes the bits of a CAN ID: consecutive IDs end up in different shards
+ */
+static std::size_t hash_id(unsigned long long dbc_id, std::size_t shards) {
+  return static_cast<std::size_t>((dbc_id * 0x9E3779B97F4A7C15ULL) >> 32) % shards;
+}
+
+/**
+ * @brief Longest processing time first: the heaviest items are given one by one
+ *        to the least loaded bin
+ * @return The bin of each item
+ */
+static std::vector<uint32_t> balance(const std::vector<double>& weights, std::size_t bins) {
+  std::vector<std::size_t> order(weights.size());
+  for(std::size_t i = 0; i < order.size(); i++)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(),
+                   [&weights](std::size_t a, std::size_t b) { return weights[a] > weights[b]; });
+
+  std::vector<double> loads(bins, 0.);
+  std::vector<uint32_t> result(weights.size(), 0);
+  for(std::size_t item : order) {
+    std::size_t bin = std::min_element(loads.begin(), loads.end()) - loads.begin();
+    result[item] = static_cast<uint32_t>(bin);
+    loads[bin] += weights[item];
+  }
+
+  return result;
+}
+
+ShardedDecoder::ShardedDecoder(const CANDecoder& decoder, const Callback& callback, const Options& options)
+  : decoder_(&decoder), callback_(callback), options_(options), queued_(0), next_rebalance_(0),
+    decoded_(0), abort_(false) {
+  if(options_.threads == 0)
+    options_.threads = std::max(1u, std::thread::hardware_concurrency());
+  if(options_.shards == 0)
+    options_.shards = SHARDS_PER_THREAD * options_.threads;
+  options_.shard_queue_size = ring_capacity(options_.shard_queue_size);
+  options_.batch_size = std::min(std::max<std::size_t>(options_.batch_size, 1), options_.shard_queue_size);
+  next_rebalance_ = options_.rebalance_interval;
+
+  for(std::size_t i = 0; i < options_.shards; i++)
+    shards_.emplace_back(new Shard(options_.shard_queue_size, static_cast<unsigned>(i % options_.threads)));
+
+  std::size_t largest = 0;
+  for(const CANDecoder::FramePlan& plan : decoder.frames())
+    largest = std::max(largest, plan.signals.size());
+  for(unsigned i = 0; i < options_.threads; i++)
+    workers_.emplace_back(new Worker(i, options_.batch_size, largest));
+
+  if(options_.assignment == LoadAware)
+    assign_frames();
+
+  for(unsigned i = 0; i < options_.threads; i++)
+    threads_.emplace_back(&ShardedDecoder::worker_thread, this, i);
+}
+
+ShardedDecoder::~ShardedDecoder() {
+  abort_ = true;
+  for(std::thread& thread : threads_)
+    thread.join();
+}
+
+void ShardedDecoder::assign_frames() {
+  const std::vector<CANDecoder::FramePlan>& plans = decoder_->frames();
+  std::vector<double> rates(plans.size());
+
+  for(std::size_t i = 0; i < plans.size(); i++) {
+    unsigned int period = plans[i].frame->period(); // Milliseconds
+    rates[i] = period > 0 ? 1000. / period : DEFAULT_FRAME_RATE;
+  }
+
+  frame_shards_ = balance(rates, shards_.size());
+}
+
+void ShardedDecoder::rebalance() {
+  std::vector<double> loads(shards_.size());
+  for(std::size_t i = 0; i < shards_.size(); i++) {
+    loads[i] = static_cast<double>(shards_[i]->recent);
+    shards_[i]->recent = 0;
+  }
+
+  // The queue of a shard is consumed by one worker at a time (see drain()): its
+  // frames stay in order when it changes owner
+  std::vector<uint32_t> owners = balance(loads, workers_.size());
+  for(std::size_t i = 0; i < shards_.size(); i++)
+    shards_[i]->owner.store(owners[i], std::memory_order_relaxed);
+}
+
+std::size_t ShardedDecoder::shard(unsigned long long can_id, bool extended) const {
+  const CANDecoder::FramePlan* plan = decoder_->find(can_id, extended);
+  if(plan != nullptr && !frame_shards_.empty())
+    return frame_shards_[plan->index];
+
+  unsigned long long dbc_id = extended ? can_id | CANFrame::EXTENDED_ID_FLAG : can_id;
+  return hash_id(dbc_id, shards_.size());
+}
+
+void ShardedDecoder::push(const LogFrame* frames, std::size_t count) {
+  for(std::size_t i = 0; i < count && !abort_; i++) {
+    const LogFrame& frame = frames[i];
+    if(frame.flags & (LogFrame::Remote | LogFrame::ErrorFrame))
+      continue;
+
+    Item item;
+    item.plan = decoder_->find(frame.can_id, frame.is_extended());
+    if(item.plan == nullptr)
+      continue;
+    item.frame = frame;
+
+    Shard& shard = *shards_[frame_shards_.empty() ? hash_id(item.plan->dbc_id, shards_.size())
+                                                  : frame_shards_[item.plan->index]];
+    Backoff backoff;
+    while(!shard.queue.try_push(item)) {
+      if(abort_)
+        return;
+      backoff.wait();
+    }
+
+    shard.frames.fetch_add(1, std::memory_order_relaxed);
+    shard.recent++;
+    queued_++;
+
+    if(options_.assignment == LoadAware && options_.rebalance_interval > 0 && queued_ >= next_rebalance_) {
+      rebalance();
+      next_rebalance_ = queued_ + options_.rebalance_interval;
+    }
+  }
+}
+
+void ShardedDecoder::finish() {
+  Backoff backoff;
+  while(decoded_.load(std::memory_order_acquire) < queued_ && !abort_)
+    backoff.wait();
+
+  std::lock_guard<std::mutex> lock(error_mutex_);
+  if(error_)
+    std::rethrow_exception(error_);
+}
+
+std::size_t ShardedDecoder::process(LogFrame* frames, std::size_t count) {
+  push(frames, count);
+  return count;
+}
+
+void ShardedDecoder::flush() {
+  finish();
+}
+
+bool ShardedDecoder::drain(Shard& shard, Worker& worker) {
+  if(shard.busy.load(std::memory_order_relaxed) || shard.busy.exchange(true, std::memory_order_acquire))
+    return false;
+
+  // The previous consumer of the queue released it after its last pop
+  std::size_t count = shard.queue.try_pop(worker.batch.data(), worker.batch.size());
+
+  try {
+    for(std::size_t i = 0; i < count; i++) {
+      const Item& item = worker.batch[i];
+      std::fill(worker.values.begin(), worker.values.begin() + item.plan->signals.size(),
+                std::numeric_limits<double>::quiet_NaN());
+      decoder_->decode(*item.plan, item.frame.data, item.frame.length, worker.values.data());
+      callback_(item.frame, *item.plan, worker.values.data(), worker.index);
+    }
+  }
+  catch(...) {
+    {
+      std::lock_guard<std::mutex> lock(error_mutex_);
+      if(!error_)
+        error_ = std::current_exception();
+    }
+    abort_ = true;
+  }
+
+  shard.busy.store(false, std::memory_order_release);
+
+  if(count > 0) {
+    worker.frames.fetch_add(count, std::memory_order_relaxed);
+    worker.batches.fetch_add(1, std::memory_order_relaxed);
+    decoded_.fetch_add(count, std::memory_order_release);
+  }
+  return count > 0;
+}
+
+void ShardedDecoder::worker_thread(unsigned index) {
+  Worker& worker = *workers_[index];
+  std::size_t shard_count = shards_.size();
+  Backoff backoff;
+
+  while(!abort_) {
+    bool busy = false;
+    for(std::size_t i = 0; i < shard_count; i++) {
+      Shard& shard = *shards_[(index + i) % shard_count];
+      if(shard.owner.load(std::memory_order_relaxed) == index)
+        busy = drain(shard, worker) || busy;
+    }
+
+    // Idle: takes over a shard whose backlog is waiting for a busy owner
+    if(!busy && options_.work_stealing) {
+      for(std::size_t i = 0; i < shard_count && !busy; i++) {
+        Shard& shard = *shards_[(index + i) % shard_count];
+        if(shard.owner.load(std::memory_order_relaxed) != index &&
+           shard.queue.size() >= options_.batch_size && drain(shard, worker)) {
+          shard.owner.store(index, std::memory_order_relaxed);
+          worker.steals.fetch_add(1, std::memory_order_relaxed);
+          busy = true;
+        }
+      }
+    }
+
+    if(busy)
+      backoff.reset();
+    else
+      backoff.wait();
+  }
+}
+
+unsigned ShardedDecoder::owner(std::size_t shard) const {
+  return shards_.at(shard)->owner.load(std::memory_order_relaxed);
+}
+
+uint64_t ShardedDecoder::shard_frames(std::size_t shard) const {
+  return shards_.at(shard)->frames.load(std::memory_order_relaxed);
+}
+
+ShardedDecoder::WorkerCounters ShardedDecoder::worker_counters(unsigned worker) const {
+  const Worker& counters = *workers_.at(worker);
+  return { counters.frames.load(std::memory_order_relaxed), counters.batches.load(std::memory_order_relaxed),
+           counters.steals.load(std::memory_order_relaxed) };
+}
+
+unsigned ShardedDecoder::thread_count() const {
+  return options_.threads;
+}
+
+std::size_t ShardedDecoder::shard_count() const {
+  return shards_.size();
+}
+
+uint64_t ShardedDecoder::decoded() const {
+  return decoded_.load(std::memory_order_relaxed);
+}
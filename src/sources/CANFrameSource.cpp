@@ -0,0 +1,155 @@
+#include "CANFrameSource.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace CppCAN;
+
+// Flags of the CAN ID and of the CAN FD frames (see linux/can.h)
+static const uint32_t CAN_EFF_FLAG = 0x80000000U;
+static const uint32_t CAN_RTR_FLAG = 0x40000000U;
+static const uint32_t CAN_ERR_FLAG = 0x20000000U;
+static const uint32_t CAN_EFF_MASK = 0x1FFFFFFFU;
+static const uint32_t CAN_SFF_MASK = 0x000007FFU;
+static const uint8_t CANFD_BRS = 0x01;
+static const uint8_t CANFD_ESI = 0x02;
+
+// Layout of struct can_frame and struct canfd_frame
+static const std::size_t LENGTH_OFFSET = 4;
+static const std::size_t FLAGS_OFFSET = 5;
+static const std::size_t DATA_OFFSET = 8;
+
+CANFrameSource::~CANFrameSource() { }
+
+bool socketcan::parse_frame(const uint8_t* data, std::size_t size, LogFrame& frame) {
+  if(size != CLASSIC_MTU && size != FD_MTU)
+    return false;
+
+  uint32_t id;
+  std::memcpy(&id, data, sizeof(id));
+  uint8_t length = data[LENGTH_OFFSET];
+
+  frame.flags = 0;
+  if(id & CAN_ERR_FLAG) {
+    frame.flags |= LogFrame::ErrorFrame;
+    frame.can_id = id & CAN_EFF_MASK;
+  }
+  else if(id & CAN_EFF_FLAG) {
+    frame.flags |= LogFrame::Extended;
+    frame.can_id = id & CAN_EFF_MASK;
+  }
+  else {
+    frame.can_id = id & CAN_SFF_MASK;
+  }
+
+  if(size == FD_MTU) {
+    if(length > CANFrame::MAX_PAYLOAD_LENGTH ||
+       CANFrame::dlc_to_length(CANFrame::length_to_dlc(length)) != length)
+      return false;
+
+    uint8_t fd_flags = data[FLAGS_OFFSET];
+    frame.flags |= LogFrame::FD;
+    if(fd_flags & CANFD_BRS)
+      frame.flags |= LogFrame::BitRateSwitch;
+    if(fd_flags & CANFD_ESI)
+      frame.flags |= LogFrame::ErrorStateIndicator;
+  }
+  else {
+    if(length > 8)
+      return false;
+
+    // Like in candump logs, the length of a remote frame is its DLC
+    if(id & CAN_RTR_FLAG)
+      frame.flags |= LogFrame::Remote;
+  }
+
+  frame.length = length;
+  std::memcpy(frame.data, data + DATA_OFFSET, size - DATA_OFFSET);
+  return true;
+}
+
+FakeCANSource::FakeCANSource(std::size_t capacity, int timeout, const std::vector<std::string>& channels)
+  : ring_(std::max<std::size_t>(capacity, 1)), head_(0), size_(0), timeout_(timeout),
+    closed_(false), channels_(channels) { }
+
+std::size_t FakeCANSource::read(LogFrame* frames, std::size_t capacity) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  auto ready = [this]() { return size_ > 0 || closed_; };
+  if(timeout_ < 0)
+    readable_.wait(lock, ready);
+  else if(!readable_.wait_for(lock, std::chrono::milliseconds(timeout_), ready))
+    return 0;
+
+  std::size_t count = std::min(capacity, size_);
+  for(std::size_t i = 0; i < count; i++)
+    frames[i] = ring_[(head_ + i) % ring_.size()];
+
+  head_ = (head_ + count) % ring_.size();
+  size_ -= count;
+  lock.unlock();
+
+  if(count > 0)
+    writable_.notify_all();
+  return count;
+}
+
+bool FakeCANSource::closed() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return closed_ && size_ == 0;
+}
+
+const std::vector<std::string>& FakeCANSource::channels() const {
+  return channels_;
+}
+
+bool FakeCANSource::push(const LogFrame& frame) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  writable_.wait(lock, [this]() { return size_ < ring_.size() || closed_; });
+  if(closed_)
+    return false;
+
+  ring_[(head_ + size_) % ring_.size()] = frame;
+  size_++;
+  lock.unlock();
+
+  readable_.notify_one();
+  return true;
+}
+
+void FakeCANSource::close() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+  }
+
+  readable_.notify_all();
+  writable_.notify_all();
+}
+
+LogReaderSource::LogReaderSource(CANLogReader& reader)
+  : next_([&reader](LogFrame& frame) { return reader.next(frame); }),
+    candump_(dynamic_cast<const CandumpReader*>(&reader)), closed_(false) { }
+
+LogReaderSource::LogReaderSource(const NextFrame& next, const std::vector<std::string>& channels)
+  : next_(next), candump_(nullptr), channels_(channels), closed_(false) { }
+
+std::size_t LogReaderSource::read(LogFrame* frames, std::size_t capacity) {
+  std::size_t count = 0;
+  while(!closed_ && count < capacity) {
+    if(next_(frames[count]))
+      count++;
+    else
+      closed_ = true;
+  }
+  return count;
+}
+
+bool LogReaderSource::closed() const {
+  return closed_;
+}
+
+const std::vector<std::string>& LogReaderSource::channels() const {
+  // The interfaces of a candump log are found while it is read
+  return candump_ != nullptr ? candump_->channels() : channels_;
+}
@@ -0,0 +1,303 @@
+#include "CANFrameSource.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+using namespace CppCAN;
+
+static const std::size_t DEFAULT_BATCH_SIZE = 64;
+static const std::size_t MAX_CHANNELS = 256;
+
+SocketCANSource::Options::Options()
+  : batch_size(DEFAULT_BATCH_SIZE), fd(true), error_frames(false), hardware_timestamps(true),
+    receive_own(false), timeout(-1), receive_buffer(0) { }
+
+#ifdef __linux__
+
+static std::string
+system_error(const std::string& what) {
+  return what + ": " + std::strerror(errno);
+}
+
+/**
+ * @brief Room for the control messages of a frame: timestamps and drop counter
+ */
+static const std::size_t CONTROL_SIZE =
+  CMSG_SPACE(sizeof(scm_timestamping)) + CMSG_SPACE(sizeof(timespec)) + CMSG_SPACE(sizeof(uint32_t));
+
+/**
+ * @brief Buffers of recvmmsg(), allocated once
+ */
+class SocketCANSource::Buffers {
+public:
+  explicit Buffers(std::size_t size)
+    : headers(size), vectors(size), frames(size), addresses(size), control(size * CONTROL_SIZE) {
+    for(std::size_t i = 0; i < size; i++) {
+      vectors[i].iov_base = &frames[i];
+      vectors[i].iov_len = sizeof(canfd_frame);
+    }
+  }
+
+  /**
+   * @brief Resets the headers of the first count messages before a call to recvmmsg()
+   */
+  void prepare(std::size_t count) {
+    for(std::size_t i = 0; i < count; i++) {
+      msghdr& header = headers[i].msg_hdr;
+      header.msg_name = &addresses[i];
+      header.msg_namelen = sizeof(sockaddr_can);
+      header.msg_iov = &vectors[i];
+      header.msg_iovlen = 1;
+      header.msg_control = &control[i * CONTROL_SIZE];
+      header.msg_controllen = CONTROL_SIZE;
+      header.msg_flags = 0;
+    }
+  }
+
+  std::vector<mmsghdr> headers;
+  std::vector<iovec> vectors;
+  std::vector<canfd_frame> frames;
+  std::vector<sockaddr_can> addresses;
+  std::vector<uint8_t> control;
+};
+
+SocketCANSource::SocketCANSource(const std::string& interface_name, const Options& options)
+  : socket_(-1), wakeup_(-1), closed_(false), options_(options), dropped_(0) {
+  options_.batch_size = std::max<std::size_t>(options_.batch_size, 1);
+
+  int ifindex = 0;
+  if(!interface_name.empty() && interface_name != "any") {
+    ifindex = static_cast<int>(if_nametoindex(interface_name.c_str()));
+    if(ifindex == 0)
+      throw CANLogException(system_error("Unknown CAN interface \"" + interface_name + "\""));
+  }
+
+  // Everything that can throw is done before the file descriptors are opened
+  buffers_.reset(new Buffers(options_.batch_size));
+  uint8_t index;
+  if(ifindex != 0)
+    channel(ifindex, index);
+
+  wakeup_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if(wakeup_ < 0)
+    throw CANLogException(system_error("Cannot create an eventfd"));
+
+  socket_ = ::socket(PF_CAN, SOCK_RAW, CAN_RAW);
+  if(socket_ < 0) {
+    std::string error = system_error("Cannot open a CAN socket");
+    ::close(wakeup_);
+    throw CANLogException(error);
+  }
+
+  int enable = 1;
+  // The options below are optional: a failure only disables the feature
+  if(options_.fd)
+    options_.fd = setsockopt(socket_, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable)) == 0;
+  if(options_.receive_own)
+    setsockopt(socket_, SOL_CAN_RAW, CAN_RAW_RECV_OWN_MSGS, &enable, sizeof(enable));
+  if(options_.error_frames) {
+    can_err_mask_t mask = CAN_ERR_MASK;
+    setsockopt(socket_, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &mask, sizeof(mask));
+  }
+  if(options_.receive_buffer > 0)
+    setsockopt(socket_, SOL_SOCKET, SO_RCVBUF, &options_.receive_buffer, sizeof(options_.receive_buffer));
+  setsockopt(socket_, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable));
+
+  // Timestamps: SO_TIMESTAMPING gives both the software and the hardware ones,
+  // older kernels only have SO_TIMESTAMPNS
+  int timestamping = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+  if(options_.hardware_timestamps)
+    timestamping |= SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+  if(setsockopt(socket_, SOL_SOCKET, SO_TIMESTAMPING, &timestamping, sizeof(timestamping)) != 0)
+    setsockopt(socket_, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable));
+
+  sockaddr_can address;
+  std::memset(&address, 0, sizeof(address));
+  address.can_family = AF_CAN;
+  address.can_ifindex = ifindex;
+  if(bind(socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+    std::string error = system_error("Cannot bind the CAN socket to \"" + interface_name + "\"");
+    ::close(socket_);
+    ::close(wakeup_);
+    throw CANLogException(error);
+  }
+}
+
+SocketCANSource::~SocketCANSource() {
+  ::close(socket_);
+  ::close(wakeup_);
+}
+
+static int64_t
+to_nanoseconds(const timespec& ts) {
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+std::size_t SocketCANSource::read(LogFrame* frames, std::size_t capacity) {
+  if(closed_.load(std::memory_order_acquire))
+    return 0;
+
+  std::size_t count = std::min(capacity, options_.batch_size);
+  buffers_->prepare(count);
+
+  // The frames already queued are taken without waiting: poll() is only
+  // needed when the queue is empty
+  int received = recvmmsg(socket_, buffers_->headers.data(), static_cast<unsigned>(count), MSG_DONTWAIT, nullptr);
+  if(received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    pollfd fds[2] = { { socket_, POLLIN, 0 }, { wakeup_, POLLIN, 0 } };
+    int ready = poll(fds, 2, options_.timeout < 0 ? -1 : options_.timeout);
+    if(ready < 0 && errno != EINTR)
+      throw CANLogException(system_error("Cannot wait for the CAN socket"));
+    // Errors of the socket (eg. interface down) are reported by recvmmsg()
+    if(ready <= 0 || fds[0].revents == 0 || closed_.load(std::memory_order_acquire))
+      return 0;
+
+    buffers_->prepare(count);
+    received = recvmmsg(socket_, buffers_->headers.data(), static_cast<unsigned>(count), MSG_DONTWAIT, nullptr);
+  }
+
+  if(received < 0) {
+    if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+      return 0;
+    throw CANLogException(system_error("Cannot read the CAN socket"));
+  }
+
+  std::size_t out = 0;
+  for(int i = 0; i < received; i++) {
+    const mmsghdr& message = buffers_->headers[i];
+    LogFrame& frame = frames[out];
+    if(!socketcan::parse_frame(reinterpret_cast<const uint8_t*>(&buffers_->frames[i]), message.msg_len, frame))
+      continue;
+
+    int64_t software = -1, hardware = -1;
+    for(cmsghdr* cmsg = CMSG_FIRSTHDR(&message.msg_hdr); cmsg != nullptr;
+        cmsg = CMSG_NXTHDR(const_cast<msghdr*>(&message.msg_hdr), cmsg)) {
+      if(cmsg->cmsg_level != SOL_SOCKET)
+        continue;
+
+      if(cmsg->cmsg_type == SO_TIMESTAMPING) {
+        scm_timestamping stamps;
+        std::memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+        if(stamps.ts[0].tv_sec != 0 || stamps.ts[0].tv_nsec != 0)
+          software = to_nanoseconds(stamps.ts[0]);
+        if(stamps.ts[2].tv_sec != 0 || stamps.ts[2].tv_nsec != 0)
+          hardware = to_nanoseconds(stamps.ts[2]);
+      }
+      else if(cmsg->cmsg_type == SO_TIMESTAMPNS) {
+        timespec stamp;
+        std::memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+        software = to_nanoseconds(stamp);
+      }
+      else if(cmsg->cmsg_type == SO_RXQ_OVFL) {
+        std::memcpy(&dropped_, CMSG_DATA(cmsg), sizeof(dropped_));
+      }
+    }
+
+    if(options_.hardware_timestamps && hardware >= 0) {
+      frame.timestamp = hardware;
+    }
+    else if(software >= 0) {
+      frame.timestamp = software;
+    }
+    else {
+      timespec now;
+      clock_gettime(CLOCK_REALTIME, &now);
+      frame.timestamp = to_nanoseconds(now);
+    }
+
+    if(!channel(buffers_->addresses[i].can_ifindex, frame.channel))
+      continue;
+
+    // MSG_DONTROUTE: the frame was sent by this host
+    if(message.msg_hdr.msg_flags & MSG_DONTROUTE)
+      frame.flags |= LogFrame::Tx;
+    out++;
+  }
+
+  return out;
+}
+
+void SocketCANSource::close() {
+  // The descriptors stay open: a read() running in another thread may still use them
+  if(!closed_.exchange(true, std::memory_order_acq_rel)) {
+    uint64_t one = 1;
+    ssize_t written = ::write(wakeup_, &one, sizeof(one));
+    (void) written;
+  }
+}
+
+bool SocketCANSource::channel(int ifindex, uint8_t& index) {
+  for(const auto& entry : ifindexes_) {
+    if(entry.first == ifindex) {
+      index = entry.second;
+      return true;
+    }
+  }
+
+  // Like CandumpReader: LogFrame::channel cannot index more interfaces
+  if(channels_.size() == MAX_CHANNELS)
+    return false;
+
+  char name[IF_NAMESIZE + 1] = {};
+  if(if_indextoname(static_cast<unsigned>(ifindex), name) == nullptr)
+    std::snprintf(name, sizeof(name), "if%d", ifindex);
+
+  index = static_cast<uint8_t>(channels_.size());
+  ifindexes_.emplace_back(ifindex, index);
+  channels_.push_back(name);
+  return true;
+}
+
+#else
+
+class SocketCANSource::Buffers { };
+
+SocketCANSource::SocketCANSource(const std::string&, const Options& options)
+  : socket_(-1), wakeup_(-1), closed_(true), options_(options), dropped_(0) {
+  throw CANLogException("SocketCAN is only available on Linux");
+}
+
+SocketCANSource::~SocketCANSource() { }
+
+std::size_t SocketCANSource::read(LogFrame*, std::size_t) {
+  return 0;
+}
+
+void SocketCANSource::close() { }
+
+bool SocketCANSource::channel(int, uint8_t&) {
+  return false;
+}
+
+#endif
+
+bool SocketCANSource::closed() const {
+  return closed_.load(std::memory_order_acquire);
+}
+
+const std::vector<std::string>& SocketCANSource::channels() const {
+  return channels_;
+}
+
+uint32_t SocketCANSource::dropped() const {
+  return dropped_;
+}
+
+int SocketCANSource::native_handle() const {
+  return socket_;
+}
@@ -0,0 +1,912 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "cpp-can-parser/CANDatabase.h"
+#include "cpp-can-parser/CANDatabaseAnalysis.h"
+#include "cpp-can-parser/CANDecoder.h"
+#include "cpp-can-parser/CANExpression.h"
+#include "cpp-can-parser/CANRangeChecker.h"
+#include "cpp-can-parser/CANRawFilter.h"
+
+using namespace CppCAN;
+
+static std::vector<std::string> errors;
+
+static void check(bool condition, const std::string& description) {
+    if(!condition) {
+        std::cerr << "Check failed: " << description << std::endl;
+        errors.push_back(description);
+    }
+}
+
+static const std::string TEST_DBC =
+    "VERSION \"\"\n"
+    "BS_:\n"
+    "BU_: TestNode\n"
+    "BO_ 100 INTEL_FRAME: 8 TestNode\n"
+    " SG_ IDENTITY : 0|16@1+ (1,0) [0|0] \"\" TestNode\n"
+    " SG_ OFFSET : 16|8@1+ (1,-40) [0|0] \"\" TestNode\n"
+    " SG_ DECIMAL : 24|16@1+ (0.01,-5.5) [0|0] \"\" TestNode\n"
+    " SG_ GENERAL : 40|8@1- (0.333333333333,0) [0|0] \"\" TestNode\n"
+    " SG_ INT_SCALE : 48|8@1+ (4,1) [0|0] \"\" TestNode\n"
+    "BO_ 200 MOTOROLA_FRAME: 8 TestNode\n"
+    " SG_ BE_16 : 7|16@0+ (1,0) [0|0] \"\" TestNode\n"
+    " SG_ BE_12 : 19|12@0- (1,0) [0|0] \"\" TestNode\n"
+    "BO_ 300 RANGE_FRAME: 8 TestNode\n"
+    " SG_ NO_RANGE : 0|8@1+ (1,0) [0|0] \"\" TestNode\n"
+    " SG_ PERCENT : 8|8@1+ (0.5,0) [0|100] \"%\" TestNode\n"
+    " SG_ TEMPERATURE : 16|8@1+ (1,-40) [-20|80] \"C\" TestNode\n"
+    " SG_ TORQUE : 24|16@1- (-0.1,0) [-1000|1000] \"Nm\" TestNode\n"
+    "VAL_ 100 INT_SCALE 0 \"Zero\" 2 \"Two\" ;\n";
+
+static void test_classification() {
+    int e;
+    int64_t s, o;
+
+    check(CANDecoder::classify(1, 0, e, s, o) == CANDecoder::Identity, "classify(1, 0)");
+    check(CANDecoder::classify(1, -40, e, s, o) == CANDecoder::IntegerOffset && o == -40, "classify(1, -40)");
+    check(CANDecoder::classify(4, 1, e, s, o) == CANDecoder::IntegerOffset && s == 4, "classify(4, 1)");
+    check(CANDecoder::classify(0.01, -5.5, e, s, o) == CANDecoder::RationalScale &&
+          e == -2 && s == 1 && o == -550, "classify(0.01, -5.5)");
+    check(CANDecoder::classify(0.333333333333, 0, e, s, o) == CANDecoder::General, "classify(1/3, 0)");
+
+    // The integer paths must not overflow for the largest raw values
+    CANSignal wide("WIDE", 0, 64, 2, 0, CANSignal::Unsigned, CANSignal::LittleEndian);
+    CANSignal narrow("NARROW", 0, 32, 2, 0, CANSignal::Unsigned, CANSignal::LittleEndian);
+    CANSignal wide_decimal("WIDE_DECIMAL", 0, 60, 0.25, 0, CANSignal::Signed, CANSignal::LittleEndian);
+    CANSignal wide_identity("WIDE_IDENTITY", 0, 64, 1, 0, CANSignal::Unsigned, CANSignal::LittleEndian);
+    check(CANDecoder::compile(wide).kind == CANDecoder::General &&
+          CANDecoder::compile(narrow).kind == CANDecoder::IntegerOffset &&
+          CANDecoder::compile(wide_decimal).kind == CANDecoder::General &&
+          CANDecoder::compile(wide_identity).kind == CANDecoder::Identity, "Wide signals use the General path");
+}
+
+static void test_intel_frame(const CANDecoder& decoder) {
+    const CANDecoder::FramePlan& plan = decoder.at(100);
+    check(plan.signals.size() == 5, "INTEL_FRAME has 5 signal plans");
+
+    // DECIMAL, GENERAL, IDENTITY, INT_SCALE, OFFSET (signals are ordered by name)
+    const uint8_t data[8] = { 0x34, 0x12, 0x50, 0xE8, 0x03, 0xFD, 0x02, 0x00 };
+
+    std::vector<int64_t> raw(plan.signals.size());
+    decoder.decode_raw(plan, data, 8, raw.data());
+    check(raw[0] == 1000, "DECIMAL raw value");
+    check(raw[1] == -3, "GENERAL raw value (signed)");
+    check(raw[2] == 0x1234, "IDENTITY raw value");
+    check(raw[3] == 2, "INT_SCALE raw value");
+    check(raw[4] == 0x50, "OFFSET raw value");
+
+    std::vector<int64_t> ints(plan.signals.size());
+    decoder.decode_integer(plan, data, 8, ints.data());
+    check(ints[2] == 0x1234, "IDENTITY integer value");
+    check(ints[3] == 9, "INT_SCALE integer value");
+    check(ints[4] == 0x50 - 40, "OFFSET integer value");
+
+    CANDecoder::FixedPoint fp = plan.signals[0].fixed(raw[0]);
+    check(fp.mantissa == 450 && fp.exponent == -2, "DECIMAL fixed-point value");
+    check(plan.signals[0].fixed(raw[0], -3) == 4500, "DECIMAL fixed-point value with exponent -3");
+    check(plan.signals[0].fixed(raw[0], 0) == 4, "DECIMAL fixed-point value with exponent 0");
+
+    std::vector<double> phys(plan.signals.size());
+    decoder.decode(plan, data, 8, phys.data());
+    check(std::fabs(phys[0] - 4.5) < 1e-9, "DECIMAL physical value");
+    check(std::fabs(phys[1] + 1.0) < 1e-9, "GENERAL physical value");
+    check(phys[4] == 40.0, "OFFSET physical value");
+}
+
+static void test_motorola_frame(const CANDecoder& decoder) {
+    const CANDecoder::FramePlan& plan = decoder.at(200);
+
+    // BE_12 (start bit 19 => bits 19..16 of byte 2 then byte 3), BE_16
+    const uint8_t data[8] = { 0x12, 0x34, 0x0F, 0xFE, 0, 0, 0, 0 };
+    std::vector<int64_t> raw(plan.signals.size());
+    decoder.decode_raw(plan, data, 4, raw.data());
+
+    check(raw[0] == -2, "BE_12 raw value");
+    check(raw[1] == 0x1234, "BE_16 raw value");
+    check(decoder.find(400) == nullptr, "Unknown CAN ID has no plan");
+}
+
+static void test_lookup_tables(const CANDatabase& db) {
+    CANDecoder::Options options;
+    options.build_luts = true;
+    CANDecoder decoder(db, options);
+
+    const CANDecoder::FramePlan& plan = decoder.at(100);
+    check(plan.signals[1].lut_values != nullptr, "GENERAL (8 bits) has a value table");
+    check(plan.signals[2].lut_values == nullptr, "IDENTITY (16 bits) has no value table");
+    check(plan.signals[3].lut_labels != nullptr, "INT_SCALE has a label table");
+    check(plan.signals[4].lut_labels == nullptr, "OFFSET has no label table");
+
+    const uint8_t data[8] = { 0x34, 0x12, 0x50, 0xE8, 0x03, 0xFD, 0x02, 0x00 };
+    CANDecoder::Payload payload(data, 8);
+    for(const CANDecoder::SignalPlan& sig : plan.signals) {
+        check(sig.physical(payload) == sig.physical(sig.raw(payload)),
+              "Lookup table of " + sig.signal->name() + " matches the arithmetic path");
+    }
+
+    check(sizeof(CANDecoder::PackedSignal) == 24, "PackedSignal is 24-byte long");
+    check(plan.packed.size() == plan.signals.size(), "One packed signal per signal");
+    for(std::size_t i = 0; i < plan.signals.size(); i++) {
+        const CANDecoder::SignalPlan& sig = plan.signals[i];
+        const CANDecoder::PackedSignal& packed = plan.packed[i];
+        int64_t raw = sig.raw(payload);
+        check(packed.raw(payload.bytes) == raw && packed.physical(payload.bytes) == sig.physical(payload) &&
+              packed.integer(payload.bytes) == sig.integer(raw),
+              "Packed " + sig.signal->name() + " matches its plan");
+    }
+
+    check(plan.signals[3].label(2) == "Two", "INT_SCALE label of raw value 2");
+    check(plan.signals[3].label(1).data() == nullptr, "INT_SCALE has no label for raw value 1");
+
+    // 16-bit signals are too long, TEMPERATURE shares the table of OFFSET
+    check(decoder.lut_count() == 6, "Number of lookup tables");
+
+    options.lut_memory_limit = 256 * sizeof(double);
+    CANDecoder bounded(db, options);
+    check(bounded.lut_memory() <= options.lut_memory_limit, "Lookup tables respect the memory limit");
+}
+
+static void test_range_checker(const CANDecoder& decoder) {
+    CANRangeChecker checker(decoder);
+    const CANDecoder::FramePlan& plan = decoder.at(300);
+
+    // NO_RANGE, PERCENT, TEMPERATURE, TORQUE
+    const CANRangeChecker::FrameBounds& bounds = checker.bounds(plan);
+    check(bounds.min[1] == 0 && bounds.max[1] == 200, "PERCENT raw bounds");
+    check(bounds.min[2] == 20 && bounds.max[2] == 120, "TEMPERATURE raw bounds");
+    check(bounds.min[3] == -10000 && bounds.max[3] == 10000, "TORQUE raw bounds (negative scale)");
+
+    const int64_t valid[4] = { 255, 200, 20, -10000 };
+    check(checker.check(plan, valid) == 0, "No violation for valid values");
+
+    const int64_t invalid[8] = {
+        0, 201, 19, 10000,
+        0, 0, 121, -10001
+    };
+    uint64_t masks[2];
+    check(checker.check_batch(plan, invalid, 2, masks) == 2, "Two frames with violations in the batch");
+    check(masks[0] == 0x6, "Violations of the first frame of the batch");
+    check(masks[1] == 0xC, "Violations of the second frame of the batch");
+
+    // decode_raw() leaves the raw values of the absent multiplexed signals untouched
+    CANDatabase mux_db = CANDatabase::fromString(
+        "VERSION \"\"\n"
+        "BS_:\n"
+        "BU_: TestNode\n"
+        "BO_ 500 MUX_RANGES: 8 TestNode\n"
+        " SG_ MODE M : 0|8@1+ (1,0) [0|0] \"\" TestNode\n"
+        " SG_ LOW m1 : 8|8@1+ (1,0) [0|10] \"\" TestNode\n"
+        " SG_ HIGH m2 : 8|8@1+ (1,0) [100|200] \"\" TestNode\n"
+        " SG_ LEVEL : 16|8@1+ (1,0) [0|50] \"\" TestNode\n");
+    CANDecoder mux_decoder(mux_db);
+    CANRangeChecker mux_checker(mux_decoder);
+    const CANDecoder::FramePlan& mux_plan = mux_decoder.at(500);
+
+    // HIGH, LEVEL, LOW, MODE
+    int64_t raw[4] = { 0, 0, 0, 0 };
+    const uint8_t mode_1[8] = { 1, 5, 60 };
+    mux_decoder.decode_raw(mux_plan, mode_1, 8, raw);
+    check(mux_checker.check(mux_plan, raw) == 0x2, "Unselected multiplexed signals are not checked");
+
+    const uint8_t mode_2[8] = { 2, 50, 10 };
+    mux_decoder.decode_raw(mux_plan, mode_2, 8, raw);
+    uint64_t mux_mask;
+    check(!mux_checker.check(mux_plan, raw, &mux_mask) && mux_mask == 0x1, "Selected multiplexed signal out of range");
+
+    const uint8_t mode_3[8] = { 3, 50, 10 };
+    mux_decoder.decode_raw(mux_plan, mode_3, 8, raw);
+    check(mux_checker.check_batch(mux_plan, raw, 1, &mux_mask) == 0, "No multiplexed signal selected");
+}
+
+static void test_signal_handles(const CANDecoder& decoder) {
+    SignalHandle percent = decoder.handle(300, "PERCENT");
+    SignalHandle be16 = decoder.handle(200, "BE_16");
+
+    check(percent.valid() && decoder.plan(percent).signal->name() == "PERCENT", "Handle of PERCENT");
+    check(decoder.frame(be16).can_id == 200, "Frame of the BE_16 handle");
+    check(!decoder.find_handle(300, "UNKNOWN").valid(), "Handle of an unknown signal");
+    check(!decoder.find_handle(400, "PERCENT").valid(), "Handle of a signal of an unknown frame");
+    check(decoder.signal_count() == 11, "Total number of signals");
+
+    SignalValueCache cache(decoder);
+    const uint8_t frame_200[8] = { 0x12, 0x34, 0, 0, 0, 0, 0, 0 };
+    const uint8_t frame_300[8] = { 0, 0x10, 0, 0, 0, 0, 0, 0 };
+    cache.update(200, frame_200, 8);
+    cache.update(300, frame_300, 8);
+    check(cache[be16] == 0x1234, "Cached value of BE_16");
+    check(cache[percent] == 8, "Cached value of PERCENT");
+    check(!cache.update(400, frame_300, 8), "Update with an unknown CAN ID");
+}
+
+static std::vector<std::string> active_names(const CANDecoder& decoder, unsigned long long can_id,
+                                             const uint8_t* data) {
+    const CANDecoder::FramePlan& plan = decoder.at(can_id);
+    std::vector<uint32_t> indices(plan.signals.size());
+    std::size_t count = decoder.active_signals(plan, data, 8, indices.data());
+
+    std::vector<std::string> result;
+    for(std::size_t i = 0; i < count; i++)
+        result.push_back(plan.signals[indices[i]].signal->name());
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+static void test_multiplexing() {
+    CANDatabase db = CANDatabase::fromFile("dbc-files/multiplexed-1.dbc");
+    CANDecoder decoder(db);
+
+    const CANFrame& simple = db.at(1000);
+    check(simple.is_multiplexed() && simple.multiplexor() == "MODE", "SIMPLE_MUX multiplexor");
+    check(simple.at("MODE_2_A").multiplexing() == CANSignal::Multiplexed &&
+          simple.at("MODE_2_A").multiplexer_ranges()[0].min == 2, "MODE_2_A multiplexing");
+
+    const CANSignal& session = db.at(1001).at("SESSION");
+    check(session.multiplexer_switch() == "SERVICE" && session.multiplexer_ranges().size() == 2 &&
+          session.multiplexer_ranges()[1].min == 8, "SESSION extended multiplexing");
+    check(db.at(1001).at("SUB_FUNCTION").multiplexing() == CANSignal::MultiplexedMultiplexor,
+          "SUB_FUNCTION is a multiplexed multiplexor");
+
+    const uint8_t mode_1[8] = { 1, 0x34, 0x12, 0x78, 0x56, 0, 0, 0xAA };
+    const uint8_t mode_2[8] = { 2, 0x34, 0x12, 0x78, 0x56, 0, 0, 0xAA };
+    const uint8_t mode_3[8] = { 3, 0, 0, 0, 0, 0, 0, 0 };
+    check(active_names(decoder, 1000, mode_1) == std::vector<std::string>({ "COMMON", "MODE", "MODE_1_A", "MODE_1_B" }),
+          "Active signals of SIMPLE_MUX in mode 1");
+    check(active_names(decoder, 1000, mode_2) == std::vector<std::string>({ "COMMON", "MODE", "MODE_2_A" }),
+          "Active signals of SIMPLE_MUX in mode 2");
+    check(active_names(decoder, 1000, mode_3) == std::vector<std::string>({ "COMMON", "MODE" }),
+          "Active signals of SIMPLE_MUX in mode 3");
+
+    const uint8_t service_1_low[8] = { 1, 5, 0, 0, 0, 0, 0, 0 };
+    const uint8_t service_1_high[8] = { 1, 200, 0, 0, 0, 0, 0, 0 };
+    const uint8_t service_8[8] = { 8, 0, 0, 0, 0, 0, 0, 0 };
+    check(active_names(decoder, 1001, service_1_low) == std::vector<std::string>({ "DATA_LOW", "SERVICE", "SUB_FUNCTION" }),
+          "Active signals of EXTENDED_MUX for service 1, sub-function 5");
+    check(active_names(decoder, 1001, service_1_high) == std::vector<std::string>({ "DATA_HIGH", "SERVICE", "SUB_FUNCTION" }),
+          "Active signals of EXTENDED_MUX for service 1, sub-function 200");
+    check(active_names(decoder, 1001, service_8) == std::vector<std::string>({ "SERVICE", "SESSION" }),
+          "Active signals of EXTENDED_MUX for service 8");
+
+    const CANDecoder::FramePlan& plan = decoder.at(1000);
+    std::vector<double> values(plan.signals.size(), -1);
+    decoder.decode(plan, mode_2, 8, values.data());
+    SignalHandle mode_1_a = decoder.handle(1000, "MODE_1_A");
+    SignalHandle mode_2_a = decoder.handle(1000, "MODE_2_A");
+    check(values[mode_2_a.signal] == 0x56781234, "MODE_2_A value");
+    check(values[mode_1_a.signal] == -1, "MODE_1_A is not decoded in mode 2");
+}
+
+static const std::string FD_DBC =
+    "VERSION \"\"\n"
+    "BS_:\n"
+    "BU_: TestNode\n"
+    "BO_ 291 CLASSIC_FRAME: 8 TestNode\n"
+    " SG_ COUNTER : 0|8@1+ (1,0) [0|0] \"\" TestNode\n"
+    "BO_ 2175520239 FD_FRAME: 64 TestNode\n"
+    " SG_ TAIL : 496|16@1+ (1,0) [0|0] \"\" TestNode\n"
+    " SG_ MOTOROLA : 327|16@0+ (1,0) [0|0] \"\" TestNode\n"
+    " SG_ WIDE_LE : 4|64@1+ (1,0) [0|0] \"\" TestNode\n"
+    " SG_ WIDE_BE : 83|64@0- (1,0) [0|0] \"\" TestNode\n"
+    " SG_ SIGNED_LE : 203|61@1- (1,0) [0|0] \"\" TestNode\n"
+    "BA_DEF_ BO_ \"VFrameFormat\" ENUM \"StandardCAN\",\"ExtendedCAN\",\"StandardCAN_FD\",\"ExtendedCAN_FD\";\n"
+    "BA_DEF_ BO_ \"GenMsgCycleTime\" INT 0 65535;\n"
+    "BA_DEF_DEF_ \"VFrameFormat\" \"StandardCAN\";\n"
+    "BA_ \"VFrameFormat\" BO_ 2175520239 3;\n";
+
+/**
+ * Bit-by-bit extraction used as a reference for the word-based decoding
+ */
+static uint64_t reference_bits(const uint8_t* data, unsigned start_bit, unsigned length, bool big_endian) {
+    uint64_t value = 0;
+    unsigned pos = start_bit;
+
+    for(unsigned i = 0; i < length; i++) {
+        uint64_t bit = (data[pos / 8] >> (pos % 8)) & 1;
+
+        if(big_endian) {
+            // MSB first: the next bit is on the right, or at bit 7 of the next byte
+            value = (value << 1) | bit;
+            pos = pos % 8 == 0 ? pos + 15 : pos - 1;
+        }
+        else {
+            value |= bit << i;
+            pos++;
+        }
+    }
+
+    return value;
+}
+
+static void test_can_fd() {
+    check(CANFrame::dlc_to_length(8) == 8 && CANFrame::dlc_to_length(9) == 12 &&
+          CANFrame::dlc_to_length(13) == 32 && CANFrame::dlc_to_length(15) == 64, "dlc_to_length()");
+    check(CANFrame::length_to_dlc(8) == 8 && CANFrame::length_to_dlc(10) == 9 &&
+          CANFrame::length_to_dlc(33) == 14 && CANFrame::length_to_dlc(64) == 15, "length_to_dlc()");
+
+    CANDatabase db = CANDatabase::fromString(FD_DBC);
+    const CANFrame& fd_frame = db.at("FD_FRAME");
+    check(fd_frame.can_id() == 0x1ABCDEF && fd_frame.dbc_id() == 2175520239ULL, "FD_FRAME IDs");
+    check(fd_frame.frame_format() == CANFrame::ExtendedCAN_FD, "FD_FRAME is an extended CAN FD frame");
+    check(fd_frame.length() == 64, "FD_FRAME has a 64-byte payload");
+    check(db.at("CLASSIC_FRAME").frame_format() == CANFrame::StandardCAN, "CLASSIC_FRAME is a classic frame");
+    check(db.contains(0x1ABCDEF) && db.contains(2175520239ULL), "Extended frame found by bare and DBC IDs");
+    check(analysis::is_frame_layout_ok(fd_frame), "FD_FRAME signals fit in 64 bytes");
+
+    // 12 is a CAN FD length, 13 is the DLC of 32 bytes
+    CANDatabase fd_lengths = CANDatabase::fromString(
+        "VERSION \"\"\n"
+        "BS_:\n"
+        "BU_: TestNode\n"
+        "BO_ 300 FD_12: 12 TestNode\n"
+        " SG_ LAST : 88|8@1+ (1,0) [0|0] \"\" TestNode\n"
+        "BO_ 301 FD_DLC_13: 13 TestNode\n"
+        " SG_ LAST : 248|8@1+ (1,0) [0|0] \"\" TestNode\n"
+        "BA_DEF_ BO_ \"VFrameFormat\" ENUM \"StandardCAN\",\"ExtendedCAN\",\"StandardCAN_FD\",\"ExtendedCAN_FD\";\n"
+        "BA_DEF_DEF_ \"VFrameFormat\" \"StandardCAN\";\n"
+        "BA_ \"VFrameFormat\" BO_ 300 2;\n"
+        "BA_ \"VFrameFormat\" BO_ 301 2;\n");
+    check(fd_lengths.at(300).is_fd() && fd_lengths.at(300).length() == 12, "FD BO_ length of 12 is a byte count");
+    check(fd_lengths.at(301).length() == 32, "FD BO_ length of 13 is a DLC");
+    CANDecoder fd_lengths_decoder(fd_lengths);
+    check(fd_lengths_decoder.at(300).load_length == 12, "12-byte FD frame is read in place");
+
+    CANFrame unflagged("UNFLAGGED", 0x800, 8);
+    check(!unflagged.is_extended() && unflagged.dbc_id() == 0x800, "Only EXTENDED_ID_FLAG makes an ID extended");
+
+    CANFrame too_short("TOO_SHORT", 10, 8);
+    too_short.addSignal(CANSignal("BEYOND_DLC", 60, 8, 1, 0, CANSignal::Unsigned, CANSignal::LittleEndian));
+    check(!analysis::is_frame_layout_ok(too_short), "Signal beyond the DLC is reported");
+
+    CANDecoder decoder(db);
+    check(decoder.find(0x1ABCDEF) != nullptr && decoder.find(0x1ABCDEF, true) != nullptr,
+          "Extended plan found by bare ID");
+    check(decoder.find(0x1ABCDEF, false) == nullptr, "No standard frame with the extended ID");
+    check(decoder.find(291, true) == nullptr && decoder.find(291) != nullptr, "Standard plan lookup");
+
+    const CANDecoder::FramePlan& plan = decoder.at(0x1ABCDEF);
+    check(plan.extended && plan.can_id == 0x1ABCDEF, "FD_FRAME plan is extended");
+
+    // Pseudo-random payloads compared against the bit-by-bit extraction
+    uint8_t data[64];
+    uint32_t state = 12345;
+    std::vector<int64_t> raw(plan.signals.size());
+    for(int round = 0; round < 100; round++) {
+        for(uint8_t& byte : data) {
+            state = state * 1103515245 + 12345;
+            byte = static_cast<uint8_t>(state >> 16);
+        }
+
+        CANDecoder::Payload payload(data, sizeof(data));
+        for(std::size_t i = 0; i < plan.signals.size(); i++) {
+            const CANDecoder::SignalPlan& sig = plan.signals[i];
+            const CANSignal& signal = *sig.signal;
+            uint64_t expected = reference_bits(data, signal.start_bit(), signal.length(),
+                                               signal.endianness() == CANSignal::BigEndian);
+            if(sig.bits(payload) != expected || plan.packed[i].raw(data) != sig.raw(payload)) {
+                check(false, "Extraction of " + signal.name() + " in a 64-byte payload");
+                return;
+            }
+        }
+    }
+
+    std::fill(std::begin(data), std::end(data), 0);
+    data[40] = 0xAB; data[41] = 0xCD; data[62] = 0x34; data[63] = 0x12;
+    data[25] = 0xF8; data[26] = 0xFF; data[27] = 0xFF; data[28] = 0xFF; 
+    data[29] = 0xFF; data[30] = 0xFF; data[31] = 0xFF; data[32] = 0xFF;
+    decoder.decode_raw(plan, data, sizeof(data), raw.data());
+
+    // MOTOROLA, SIGNED_LE, TAIL, WIDE_BE, WIDE_LE
+    check(raw[0] == 0xABCD, "MOTOROLA at byte 40");
+    check(raw[1] == -1, "SIGNED_LE is sign-extended");
+    check(raw[2] == 0x1234, "TAIL in the last two bytes");
+
+    // A classic payload is zero-padded
+    decoder.decode_raw(plan, data, 8, raw.data());
+    check(raw[2] == 0, "TAIL is 0 in a truncated payload");
+
+    // The loads of the signals at the end of a frame are moved back into the payload
+    check(plan.load_length == 64, "FD_FRAME payloads are read in place");
+    check(decoder.at(291).load_length == 8, "CLASSIC_FRAME payloads are read in place");
+
+    CANDatabase tail_db = CANDatabase::fromString(
+        "VERSION \"\"\n"
+        "BS_:\n"
+        "BU_: TestNode\n"
+        "BO_ 300 TAIL_FRAME: 8 TestNode\n"
+        " SG_ LAST_LE : 52|12@1+ (1,0) [0|0] \"\" TestNode\n"
+        " SG_ LAST_BE : 51|12@0+ (1,0) [0|0] \"\" TestNode\n"
+        " SG_ LAST_BIT : 63|1@1+ (1,0) [0|0] \"\" TestNode\n");
+    CANDecoder tail_decoder(tail_db);
+    const CANDecoder::FramePlan& tail_plan = tail_decoder.at(300);
+    check(tail_plan.load_length == 8, "TAIL_FRAME payloads are read in place");
+
+    std::vector<uint8_t> exact(8);
+    std::vector<int64_t> tail_raw(tail_plan.signals.size());
+    for(int round = 0; round < 100; round++) {
+        for(uint8_t& byte : exact) {
+            state = state * 1103515245 + 12345;
+            byte = static_cast<uint8_t>(state >> 16);
+        }
+
+        tail_decoder.decode_raw(tail_plan, exact.data(), exact.size(), tail_raw.data());
+        for(std::size_t i = 0; i < tail_plan.signals.size(); i++) {
+            const CANSignal& signal = *tail_plan.signals[i].signal;
+            uint64_t expected = reference_bits(exact.data(), signal.start_bit(), signal.length(),
+                                               signal.endianness() == CANSignal::BigEndian);
+            if(static_cast<uint64_t>(tail_raw[i]) != expected) {
+                check(false, "In-place extraction of " + signal.name() + " in an 8-byte payload");
+                return;
+            }
+        }
+    }
+}
+
+static const std::string FLOAT_DBC =
+    "VERSION \"\"\n"
+    "BS_:\n"
+    "BU_: TestNode\n"
+    "BO_ 500 FLOAT_FRAME: 8 TestNode\n"
+    " SG_ FLOAT_LE : 0|32@1- (2,1) [0|0] \"\" TestNode\n"
+    " SG_ FLOAT_BE : 39|32@0- (1,0) [0|0] \"\" TestNode\n"
+    "BO_ 501 DOUBLE_LE_FRAME: 8 TestNode\n"
+    " SG_ DOUBLE_LE : 0|64@1- (1,0) [0|0] \"\" TestNode\n"
+    "BO_ 502 DOUBLE_BE_FRAME: 8 TestNode\n"
+    " SG_ DOUBLE_BE : 7|64@0- (1,0) [0|0] \"\" TestNode\n"
+    " SG_ WRONG_LENGTH : 7|16@0- (1,0) [0|0] \"\" TestNode\n"
+    "SIG_VALTYPE_ 500 FLOAT_LE : 1;\n"
+    "SIG_VALTYPE_ 500 FLOAT_BE : 1;\n"
+    "SIG_VALTYPE_ 501 DOUBLE_LE : 2;\n"
+    "SIG_VALTYPE_ 502 DOUBLE_BE : 2;\n"
+    "SIG_VALTYPE_ 502 WRONG_LENGTH : 1;\n";
+
+static void test_ieee_float() {
+    std::vector<CANDatabase::parsing_warning> warnings;
+    CANDatabase db = CANDatabase::fromString(FLOAT_DBC, &warnings);
+    check(db[500]["FLOAT_LE"].value_type() == CANSignal::Float, "FLOAT_LE is a float");
+    const CANSignal& float_le = db[500]["FLOAT_LE"];
+    check(float_le.signedness() == CANSignal::Signed && float_le.endianness() == CANSignal::LittleEndian &&
+          float_le.layout().length == 32 && float_le.layout().scale == 2,
+          "Packed layout of FLOAT_LE");
+    check(db[501]["DOUBLE_LE"].value_type() == CANSignal::Double, "DOUBLE_LE is a double");
+    check(db[502]["WRONG_LENGTH"].value_type() == CANSignal::Integer && warnings.size() == 1,
+          "SIG_VALTYPE_ of a 16-bit signal is rejected");
+
+    CANDecoder decoder(db);
+    const CANDecoder::FramePlan& float_plan = decoder.at(500);
+    check(float_plan.signals[0].kind == CANDecoder::IEEEFloat, "FLOAT_BE plan kind");
+
+    // FLOAT_BE, FLOAT_LE
+    // 1.5f == 0x3FC00000, -2.25f == 0xC0100000
+    const uint8_t float_data[8] = { 0x00, 0x00, 0xC0, 0x3F, 0xC0, 0x10, 0x00, 0x00 };
+    double values[2];
+    decoder.decode(float_plan, float_data, 8, values);
+    check(values[0] == -2.25, "Big-endian float");
+    check(values[1] == 1.5 * 2 + 1, "Little-endian float with scale and offset");
+
+    // 3.14159 == 0x400921F9F01B866E
+    const uint8_t double_le[8] = { 0x6E, 0x86, 0x1B, 0xF0, 0xF9, 0x21, 0x09, 0x40 };
+    const uint8_t double_be[8] = { 0x40, 0x09, 0x21, 0xF9, 0xF0, 0x1B, 0x86, 0x6E };
+    decoder.decode(decoder.at(501), double_le, 8, values);
+    check(values[0] == 3.14159, "Little-endian double");
+    decoder.decode(decoder.at(502), double_be, 8, values);
+    check(values[0] == 3.14159, "Big-endian double");
+
+    const CANDecoder::SignalPlan& double_plan = decoder.at(502).signals[0];
+    CANDecoder::FixedPoint fp = double_plan.fixed(double_plan.raw(CANDecoder::Payload(double_be, 8)));
+    check(fp.mantissa == 3141590000LL && fp.exponent == -9, "Fixed-point value of a double");
+}
+
+static void test_choice_tables() {
+    CANChoiceTable dense({ { 0, "Off" }, { 1, "On" }, { 3, "Error" }, { 4, "" } });
+    check(dense.is_dense() && dense.size() == 4, "Compact choices give a dense table");
+    check(dense.label(1) == "On" && dense.label(3) == "Error", "Dense table labels");
+    check(dense.label(2).data() == nullptr && dense.label(100).data() == nullptr, "Dense table holes");
+    check(dense.label(4).data() != nullptr && dense.label(4).empty(), "Empty label is found");
+
+    CANChoiceTable sparse({ { 5, "Low" }, { 1000, "High" }, { 70000, "Fault" }, { 4000000000u, "Off" } });
+    check(!sparse.is_dense(), "Spread choices give a sparse table");
+    check(sparse.label(70000) == "Fault" && sparse.label(4000000000u) == "Off", "Sparse table labels");
+    check(sparse.label(6).data() == nullptr && sparse.label(0).data() == nullptr, "Sparse table misses");
+
+    unsigned int value = 0;
+    check(sparse.find("High", value) && value == 1000, "Reverse lookup in a sparse table");
+    check(dense.find("Error", value) && value == 3, "Reverse lookup in a dense table");
+    check(!dense.find("Unknown", value), "Reverse lookup of an unknown label");
+
+    CANChoiceTable duplicates({ { 7, "Same" }, { 2, "Same" } });
+    check(duplicates.find("Same", value) && value == 2, "Duplicate labels give the smallest value");
+
+    CANChoiceTable empty;
+    check(empty.empty() && empty.label(0).data() == nullptr && !empty.find("", value), "Empty table");
+
+    // Both signals of RANGE_FRAME share the choice table
+    CANDatabase db = CANDatabase::fromString(TEST_DBC +
+        "VAL_ 300 NO_RANGE 0 \"Zero\" 2 \"Two\" ;\n");
+    CANDecoder decoder(db);
+    const CANDecoder::SignalPlan& no_range = decoder.at(300).signals[0];
+    check(decoder.choice_table_count() == 1 &&
+          no_range.choices == decoder.at(100).signals[3].choices, "Identical choices are shared");
+    check(no_range.label(2) == "Two", "Label of a signal without lookup table");
+
+    // Negative choices are sign-extended and choices that do not fit are ignored,
+    // with or without lookup tables
+    CANDatabase signed_db = CANDatabase::fromString(
+        "VERSION \"\"\n"
+        "BS_:\n"
+        "BU_: TestNode\n"
+        "BO_ 400 SIGNED_FRAME: 8 TestNode\n"
+        " SG_ SIGNED : 0|8@1- (1,0) [0|0] \"\" TestNode\n"
+        " SG_ UNSIGNED : 8|8@1+ (1,0) [0|0] \"\" TestNode\n"
+        "VAL_ 400 SIGNED -1 \"Invalid\" 0 \"Zero\" 200 \"TooLarge\" ;\n"
+        "VAL_ 400 UNSIGNED 0 \"Zero\" 255 \"Max\" 256 \"Aliased\" ;\n");
+    CANDecoder::Options lut_options;
+    lut_options.build_luts = true;
+    CANDecoder plain(signed_db);
+    CANDecoder with_luts(signed_db, lut_options);
+
+    bool consistent = true;
+    for(const CANDecoder* dec : { &plain, &with_luts }) {
+        const CANDecoder::FramePlan& plan = dec->at(400);
+        const CANDecoder::SignalPlan& sig = plan.signals[0];
+        const CANDecoder::SignalPlan& uns = plan.signals[1];
+        consistent = consistent && sig.label(-1) == "Invalid" && sig.label(0) == "Zero" &&
+                     sig.label(-56).data() == nullptr && uns.label(0) == "Zero" && uns.label(255) == "Max";
+    }
+    check(with_luts.at(400).signals[0].lut_labels != nullptr && consistent,
+          "Signed choices give the same labels with and without lookup tables");
+
+    int64_t raw = 0;
+    const CANDecoder::SignalPlan& sig = plain.at(400).signals[0];
+    check(sig.choice_raw(static_cast<unsigned int>(-1), raw) && raw == -1 && !sig.choice_raw(200, raw) &&
+          !plain.at(400).signals[1].choice_raw(256, raw), "Raw values of choices");
+}
+
+static void test_value_tables() {
+    const std::string dbc =
+        "VERSION \"\"\n"
+        "BS_:\n"
+        "BU_: TestNode\n"
+        "VAL_TABLE_ FaultCodes 0 \"NoFault\" 1 \"OverVoltage\" 2 \"UnderVoltage\" ;\n"
+        "VAL_TABLE_ Switch 0 \"Off\" 1 \"On\" ;\n"
+        "BO_ 10 FRAME_A: 8 TestNode\n"
+        " SG_ FAULT_A : 0|8@1+ (1,0) [0|0] \"\" TestNode\n"
+        " SG_ SWITCH_A : 8|1@1+ (1,0) [0|0] \"\" TestNode\n"
+        "BO_ 11 FRAME_B: 8 TestNode\n"
+        " SG_ FAULT_B : 0|8@1+ (1,0) [0|0] \"\" TestNode\n"
+        " SG_ SWITCH_B : 8|1@1+ (1,0) [0|0] \"\" TestNode\n"
+        " SG_ OTHER_B : 9|1@1+ (1,0) [0|0] \"\" TestNode\n"
+        "VAL_ 10 FAULT_A 0 \"NoFault\" 1 \"OverVoltage\" 2 \"UnderVoltage\" ;\n"
+        "VAL_ 10 SWITCH_A 0 \"Off\" 1 \"On\" ;\n"
+        "VAL_ 11 FAULT_B FaultCodes ;\n"
+        "VAL_ 11 SWITCH_B 0 \"Off\" 1 \"On\" ;\n"
+        "VAL_ 11 OTHER_B 0 \"Closed\" 1 \"Open\" ;\n";
+
+    CANDatabase db = CANDatabase::fromString(dbc);
+    check(db.value_tables().size() == 2, "Named value tables are parsed");
+    check(db.value_table_pool_size() == 3, "Identical value tables are stored once");
+
+    const CANSignal& fault_a = db[10]["FAULT_A"];
+    check(fault_a.shared_choices_ptr() == db[11]["FAULT_B"].shared_choices_ptr() &&
+          fault_a.shared_choices_ptr() == db.value_tables().at("FaultCodes"),
+          "Listed and named choices share the same table");
+    check(db[10]["SWITCH_A"].shared_choices_ptr() == db[11]["SWITCH_B"].shared_choices_ptr(),
+          "Anonymous identical choices share the same table");
+    check(fault_a.choices().at(2) == "UnderVoltage", "Choices of a shared table");
+
+    CANDecoder decoder(db);
+    check(decoder.choice_table_count() == 3, "One choice table per distinct value table");
+}
+
+static int popcount(uint64_t value) {
+    int count = 0;
+    for(; value != 0; value &= value - 1)
+        count++;
+    return count;
+}
+
+static void test_raw_filter() {
+    // The mask covers exactly the bits of the signal, whatever its layout
+    CANDatabase fd_db = CANDatabase::fromString(FD_DBC);
+    const CANFrame& fd_frame = fd_db.at("FD_FRAME");
+    uint8_t data[64];
+    uint32_t state = 4321;
+    for(uint8_t& byte : data) {
+        state = state * 1103515245 + 12345;
+        byte = static_cast<uint8_t>(state >> 16);
+    }
+
+    for(const auto& entry : fd_frame) {
+        const CANSignal& signal = entry.second;
+        bool big_endian = signal.endianness() == CANSignal::BigEndian;
+        uint64_t bits = reference_bits(data, signal.start_bit(), signal.length(), big_endian);
+
+        CANRawFilter filter(fd_frame);
+        filter.equals_raw(signal.name(), bits);
+        int mask_bits = 0;
+        for(std::size_t i = 0; i < CANRawFilter::WORDS; i++)
+            mask_bits += popcount(filter.mask(i));
+        check(mask_bits == static_cast<int>(signal.length()), "Raw filter mask of " + signal.name());
+        check(filter.matches(data, sizeof(data)), "Raw filter matches " + signal.name());
+
+        CANRawFilter other(fd_frame);
+        other.equals_raw(signal.name(), bits ^ 1);
+        check(!other.matches(data, sizeof(data)), "Raw filter rejects " + signal.name());
+    }
+
+    uint8_t truncated[8] = {};
+    CANRawFilter tail(fd_frame);
+    tail.equals("TAIL", 0.0);
+    check(tail.word_count() == 8 && tail.matches(truncated, 8), "Missing bytes are 0");
+
+    // Inverse scale/offset and labels
+    CANDatabase db = CANDatabase::fromString(TEST_DBC);
+    const CANFrame& intel = db.at(100);
+
+    CANRawFilter decimal(intel);
+    decimal.equals("DECIMAL", 41.14);
+    check(decimal.satisfiable() && decimal.exact() && decimal.word_count() == 1 &&
+          decimal.mask(0) == 0xFFFF000000ULL && decimal.expected(0) == (4664ULL << 24),
+          "DECIMAL == 41.14 is raw 4664");
+    check(!CANRawFilter(intel).equals("DECIMAL", 41.145).satisfiable(), "Value between two raw values");
+    check(!CANRawFilter(intel).equals("OFFSET", -50).satisfiable(), "Value out of the raw range");
+    check(CANRawFilter(intel).equals("GENERAL", -1.0 / 3).expected(0) == (0xFFULL << 40),
+          "Signed value with a general scale");
+
+    const uint8_t two[8] = { 0, 0, 0, 0, 0, 0, 2, 0 };
+    const uint8_t zero[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    CANRawFilter label(intel);
+    label.equals("INT_SCALE", "Two");
+    check(label.matches(two, 8) && !label.matches(zero, 8), "Condition on a label");
+    check(CANRawFilter(intel).equals("INT_SCALE", 9.0).matches(two, 8), "Same condition on the physical value");
+
+    bool thrown = false;
+    try {
+        CANRawFilter(intel).equals("INT_SCALE", "Three");
+    }
+    catch(const std::out_of_range&) {
+        thrown = true;
+    }
+    check(thrown, "Unknown label");
+
+    CANDatabase choices_db = CANDatabase::fromString(
+        "VERSION \"\"\n"
+        "BS_:\n"
+        "BU_: TestNode\n"
+        "BO_ 400 CHOICES_FRAME: 8 TestNode\n"
+        " SG_ SIGNED : 0|8@1- (1,0) [0|0] \"\" TestNode\n"
+        " SG_ UNSIGNED : 8|8@1+ (1,0) [0|0] \"\" TestNode\n"
+        "VAL_ 400 SIGNED -1 \"Invalid\" ;\n"
+        "VAL_ 400 UNSIGNED 0 \"Zero\" 256 \"Aliased\" ;\n");
+    const CANFrame& choices_frame = choices_db.at(400);
+    const uint8_t invalid[8] = { 0xFF, 0 };
+    check(CANRawFilter(choices_frame).equals("SIGNED", "Invalid").matches(invalid, 8), "Negative choice");
+    CANRawFilter aliased(choices_frame);
+    aliased.equals("UNSIGNED", "Aliased");
+    check(!aliased.satisfiable() && !aliased.matches(zero, 8), "Choice that does not fit is skipped");
+
+    CANRawFilter both(intel);
+    both.equals_raw("IDENTITY", 0x1234).equals("OFFSET", -40.0);
+    const uint8_t both_data[8] = { 0x34, 0x12, 0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    check(both.matches(both_data, 8), "Conjunction of two conditions");
+    both.equals_raw("IDENTITY", 0x1235);
+    check(!both.satisfiable() && !both.matches(both_data, 8), "Contradictory conditions");
+
+    CANRawFilter motorola(db.at(200));
+    motorola.equals("BE_12", -2.0);
+    const uint8_t be_data[8] = { 0, 0, 0x0F, 0xFE, 0, 0, 0, 0 };
+    check(motorola.matches(be_data, 8), "Big-endian signed signal");
+
+    // Multiplexed signals also check their switch
+    CANDatabase mux_db = CANDatabase::fromFile("dbc-files/multiplexed-1.dbc");
+    CANRawFilter mode_2(mux_db.at(1000));
+    mode_2.equals("MODE_2_A", 0x56781234);
+    const uint8_t mode_1_data[8] = { 1, 0x34, 0x12, 0x78, 0x56, 0, 0, 0xAA };
+    const uint8_t mode_2_data[8] = { 2, 0x34, 0x12, 0x78, 0x56, 0, 0, 0xAA };
+    check(mode_2.exact() && mode_2.matches(mode_2_data, 8) && !mode_2.matches(mode_1_data, 8),
+          "Multiplexed signal and its switch");
+    check(!CANRawFilter(mux_db.at(1001)).equals("SESSION", 1.0).exact(), "Switch ranges are not checked");
+
+    CANDatabase float_db = CANDatabase::fromString(FLOAT_DBC);
+    const uint8_t float_data[8] = { 0x00, 0x00, 0xC0, 0x3F, 0xC0, 0x10, 0x00, 0x00 };
+    check(CANRawFilter(float_db.at(500)).equals("FLOAT_LE", 4.0).equals("FLOAT_BE", -2.25).matches(float_data, 8),
+          "Float signals");
+
+    // Batches: same result as one payload at a time
+    const std::size_t COUNT = 1000;
+    std::vector<uint8_t> payloads(COUNT * 8);
+    std::vector<LogFrame> frames(COUNT);
+    for(std::size_t i = 0; i < COUNT; i++) {
+        state = state * 1103515245 + 12345;
+        uint8_t* payload = &payloads[i * 8];
+        std::fill(payload, payload + 8, static_cast<uint8_t>(state >> 16));
+        payload[6] = static_cast<uint8_t>(i % 3);
+
+        frames[i].can_id = i % 5 == 0 ? 200 : 100;
+        frames[i].flags = i % 11 == 0 ? LogFrame::Remote : 0;
+        frames[i].length = 8;
+        std::copy(payload, payload + 8, frames[i].data);
+    }
+
+    std::vector<uint32_t> indices(COUNT);
+    std::vector<uint32_t> expected;
+    for(std::size_t i = 0; i < COUNT; i++) {
+        if(label.matches(&payloads[i * 8], 8))
+            expected.push_back(static_cast<uint32_t>(i));
+    }
+    std::size_t found = label.scan(payloads.data(), 8, COUNT, indices.data());
+    check(found == expected.size() && std::equal(expected.begin(), expected.end(), indices.begin()),
+          "Scan of a batch of payloads");
+
+    expected.clear();
+    for(std::size_t i = 0; i < COUNT; i++) {
+        if(frames[i].can_id == 100 && frames[i].flags == 0 && frames[i].data[6] == 2)
+            expected.push_back(static_cast<uint32_t>(i));
+    }
+    found = label.scan(frames.data(), COUNT, indices.data());
+    check(found == expected.size() && !expected.empty() &&
+          std::equal(expected.begin(), expected.end(), indices.begin()), "Scan of a batch of frames");
+}
+
+static bool expression_fails(const CANDecoder& decoder, const std::string& text) {
+    try {
+        CANExpression expression(decoder, text);
+    }
+    catch(const CANExpressionException&) {
+        return true;
+    }
+    return false;
+}
+
+static void test_expressions(const CANDecoder& decoder) {
+    std::vector<double> values(decoder.signal_count(), 0.);
+    SignalHandle identity = decoder.handle(100, "IDENTITY");
+    SignalHandle offset = decoder.handle(100, "OFFSET");
+    SignalHandle int_scale = decoder.handle(100, "INT_SCALE");
+
+    CANExpression rule(decoder, "INTEL_FRAME.IDENTITY > 1000 && OFFSET >= 0 && INT_SCALE == \"Two\"");
+    check(rule.type() == CANExpression::Boolean && rule.signals().size() == 3 && rule.frames().size() == 1 &&
+          rule.signals()[0].index < rule.signals()[1].index, "Expression: signals and frames");
+
+    values[identity.index] = 2000.;
+    values[offset.index] = 0.;
+    values[int_scale.index] = 9.; // Physical value of "Two" (scale 4, offset 1)
+    check(rule.evaluate(values.data()), "Expression: true");
+    values[offset.index] = -1.;
+    check(!rule.evaluate(values.data()), "Expression: false");
+    values[offset.index] = 0.;
+    values[int_scale.index] = 1.;
+    check(!rule.evaluate(values.data()), "Expression: label");
+
+    CANExpression folded(decoder, "2 * 3 + 1 == 7 && !(1 > 2)");
+    check(folded.code().size() == 1 && folded.evaluate(values.data()), "Expression: constant folding");
+
+    CANExpression arithmetic(decoder, "-(1 + 2) * IDENTITY / 4 - .5");
+    check(arithmetic.type() == CANExpression::Number && arithmetic.code().size() == 7 &&
+          arithmetic.value(values.data()) == -1500.5, "Expression: arithmetic");
+
+    CANExpression shortcut(decoder, "IDENTITY == 2000 || IDENTITY / OFFSET > 1 && (RANGE_FRAME.PERCENT != 3)");
+    check(shortcut.evaluate(values.data()), "Expression: short-circuit");
+    values[identity.index] = 0.;
+    check(!shortcut.evaluate(values.data()), "Expression: short-circuit false");
+
+    check(expression_fails(decoder, "IDENTITY >"), "Expression: syntax error");
+    check(expression_fails(decoder, "(IDENTITY > 1"), "Expression: missing parenthesis");
+    check(expression_fails(decoder, "IDENTITY > 1 1"), "Expression: trailing tokens");
+    check(expression_fails(decoder, "IDENTITY && true"), "Expression: type error");
+    check(expression_fails(decoder, "(IDENTITY > 1) + 1"), "Expression: boolean arithmetic");
+    check(expression_fails(decoder, "UNKNOWN > 1"), "Expression: unknown signal");
+    check(expression_fails(decoder, "NO_FRAME.IDENTITY > 1"), "Expression: unknown frame");
+    check(expression_fails(decoder, "INT_SCALE == \"Three\""), "Expression: unknown label");
+    check(expression_fails(decoder, "IDENTITY == \"Two\""), "Expression: signal without choices");
+    check(expression_fails(decoder, "\"Two\" == 1"), "Expression: label without signal");
+    check(expression_fails(decoder, "IDENTITY > 1 ? 1"), "Expression: unexpected character");
+
+    std::string nested = "IDENTITY";
+    for(int i = 0; i < 40; i++)
+        nested = "(1 + " + nested + ")";
+    check(expression_fails(decoder, nested), "Expression: too deep");
+    check(expression_fails(decoder, std::string(100000, '(') + "1" + std::string(100000, ')')) &&
+          expression_fails(decoder, std::string(100000, '!') + "true") &&
+          expression_fails(decoder, std::string(100000, '-') + "1 > 0"), "Expression: nesting limit");
+    std::string chain = "IDENTITY";
+    for(int i = 0; i < 1000; i++)
+        chain += " + IDENTITY";
+    check(expression_fails(decoder, chain + " > 0"), "Expression: tree height limit");
+
+    // ! binds tighter than the comparisons, like in C
+    check(CANExpression(decoder, "!(IDENTITY > 1) == true").evaluate(values.data()), "Expression: ! before ==");
+    check(expression_fails(decoder, "!IDENTITY > 1"), "Expression: ! only applies to the left operand");
+
+    CANExpression logical(decoder, "false || !(1 > 2) && true");
+    check(logical.code().size() == 1 && logical.evaluate(values.data()), "Expression: logical folding");
+
+    CANDatabase signed_db = CANDatabase::fromString(
+        "VERSION \"\"\n"
+        "BS_:\n"
+        "BU_: TestNode\n"
+        "BO_ 400 SIGNED_FRAME: 8 TestNode\n"
+        " SG_ SIGNED : 0|8@1- (1,0) [0|0] \"\" TestNode\n"
+        "VAL_ 400 SIGNED -1 \"Invalid\" 200 \"TooLarge\" ;\n");
+    CANDecoder signed_decoder(signed_db);
+    std::vector<double> signed_values(signed_decoder.signal_count(), -1.);
+    check(CANExpression(signed_decoder, "SIGNED == \"Invalid\"").evaluate(signed_values.data()) &&
+          expression_fails(signed_decoder, "SIGNED == \"TooLarge\""), "Expression: signed labels");
+
+    CANDatabase duplicates = CANDatabase::fromString(
+        "VERSION \"\"\n"
+        "BS_:\n"
+        "BU_: TestNode\n"
+        "BO_ 1 FIRST: 8 TestNode\n"
+        " SG_ SPEED : 0|8@1+ (1,0) [0|0] \"\" TestNode\n"
+        "BO_ 2 SECOND: 8 TestNode\n"
+        " SG_ SPEED : 0|8@1+ (1,0) [0|0] \"\" TestNode\n");
+    CANDecoder duplicates_decoder(duplicates);
+    check(expression_fails(duplicates_decoder, "SPEED > 1") &&
+          !expression_fails(duplicates_decoder, "SECOND.SPEED > FIRST.SPEED"), "Expression: ambiguous signal");
+
+    // Only the rules that read the signals of a frame are evaluated
+    std::vector<CANTriggerSet::Event> events;
+    CANTriggerSet triggers(decoder, [&events](const CANTriggerSet::Event& event) { events.push_back(event); });
+    std::size_t hot = triggers.add("TEMPERATURE > 60");
+    std::size_t both = triggers.add("IDENTITY > 1000 && TEMPERATURE > 60");
+    check(expression_fails(decoder, "IDENTITY + 1") == false, "Expression: numeric expression");
+    bool numeric_rule = false;
+    try {
+        triggers.add("IDENTITY + 1");
+    }
+    catch(const CANExpressionException&) {
+        numeric_rule = true;
+    }
+    check(numeric_rule && triggers.size() == 2, "Trigger set: rules must be boolean");
+
+    uint8_t intel[8] = { 0xD0, 0x07 }; // IDENTITY = 2000
+    uint8_t range[8] = { 0, 0, 110 };  // TEMPERATURE = 70
+    check(triggers.update(decoder.at(200), intel, 8, 0) == 0, "Trigger set: no rule for the frame");
+    check(triggers.update(decoder.at(100), intel, 8, 1) == 1 && events.empty() && !triggers.active(both),
+          "Trigger set: signal not received yet");
+    check(triggers.update(decoder.at(300), range, 8, 2) == 2 && events.size() == 2 &&
+          events[0].rule == hot && events[0].active && events[1].rule == both && events[1].timestamp == 2,
+          "Trigger set: rules raised");
+    check(triggers.update(decoder.at(300), range, 8, 3) == 2 && events.size() == 2, "Trigger set: no change");
+    range[2] = 50;
+    triggers.update(decoder.at(300), range, 8, 4);
+    check(events.size() == 4 && !events[3].active && !triggers.active(hot) &&
+          triggers.values()[decoder.handle(300, "TEMPERATURE").index] == 10., "Trigger set: rules cleared");
+}
+
+int main() {
+    try {
+        CANDatabase db = CANDatabase::fromString(TEST_DBC);
+        CANDecoder decoder(db);
+
+        test_classification();
+        test_intel_frame(decoder);
+        test_motorola_frame(decoder);
+        test_lookup_tables(db);
+        test_range_checker(decoder);
+        test_signal_handles(decoder);
+        test_multiplexing();
+        test_can_fd();
+        test_ieee_float();
+        test_choice_tables();
+        test_value_tables();
+        test_raw_filter();
+        test_expressions(decoder);
+    }
+    catch(const std::exception& e) {
+        std::cerr << "An unexpected exception happened: " << e.what() << std::endl;
+        errors.push_back(e.what());
+    }
+
+    std::cout << "-----------" << std::endl;
+    if(errors.size() == 0) {
+        std::cout << "Success. All tests passed." << std::endl;
+    }
+    else {
+        std::cout << "Failure. " << errors.size() << " check(s) failed." << std::endl;
+    }
+
+    return static_cast<int>(errors.size() != 0);
+}
@@ -0,0 +1,1085 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "cpp-can-parser/CANBinaryLog.h"
+#include "cpp-can-parser/CANBusStatistics.h"
+#include "cpp-can-parser/CANDatabase.h"
+#include "cpp-can-parser/CANDecoder.h"
+#include "cpp-can-parser/CANLogIndex.h"
+#include "cpp-can-parser/CANLogReader.h"
+#include "cpp-can-parser/CANPeriodMonitor.h"
+#include "cpp-can-parser/CANRawFilter.h"
+#include "cpp-can-parser/ParallelLogDecoder.h"
+#include "cpp-can-parser/SignalAggregator.h"
+
+using namespace CppCAN;
+
+static std::vector<std::string> errors;
+
+static void check(bool condition, const std::string& description) {
+    if(!condition) {
+        std::cerr << "Check failed: " << description << std::endl;
+        errors.push_back(description);
+    }
+}
+
+// Files written by the tests, removed when the tests end
+static std::vector<std::string> temp_files;
+
+static std::string temp_file(const std::string& name) {
+    std::string path = (std::filesystem::temp_directory_path() / ("cpc-test-logs-" + name)).string();
+    temp_files.push_back(path);
+    return path;
+}
+
+static void write_file(const std::string& path, const std::string& content) {
+    std::ofstream file(path, std::ios::binary);
+    file << content;
+}
+
+static const std::string LOG_DBC =
+    "VERSION \"\"\n"
+    "BS_:\n"
+    "BU_: TestNode\n"
+    "BO_ 291 STANDARD_FRAME: 8 TestNode\n"
+    " SG_ SPEED : 0|16@1+ (0.01,0) [0|0] \"km/h\" TestNode\n"
+    " SG_ GEAR : 16|8@1+ (1,0) [0|0] \"\" TestNode\n"
+    "BO_ 2166598605 EXTENDED_FRAME: 8 TestNode\n"
+    " SG_ COUNTER : 0|8@1+ (1,0) [0|0] \"\" TestNode\n"
+    "VAL_ 291 GEAR 0 \"Park\" 1 \"Drive\" ;\n";
+
+static const std::string CANDUMP_LOG =
+    "(1436509052.249713) can0 123#E803010000000000\n"
+    "(1436509052.250000) can0 0123ABCD#2A T\n"
+    "\n"
+    "(1436509052.260000) can1 123#R\n"
+    "(1436509052.270000) vcan0 456##3000102030405060708090A0B\r\n"
+    "this is not a frame\n"
+    "(1436509052.280000) can0 20000080#0000000000000000\n"
+    "(1436509052.290000) can0 12#00\n"
+    "(1436509052.300000) can0 123#0011223344556677_C\n"
+    "(1436509052.310000) can0 456##1000102030405060708090A\n"
+    "(1436509052.320000) can0 123#E8.03.00";
+
+static const std::string ASC_LOG =
+    "date Mon Sep 18 10:12:13.456 pm 2023\n"
+    "base hex  timestamps absolute\n"
+    "internal events logged\n"
+    "// version 9.0.0\n"
+    "Begin Triggerblock Mon Sep 18 10:12:13.456 pm 2023\n"
+    "   0.000000 Start of measurement\n"
+    "   0.010000 1  123             Rx   d 8 E8 03 01 00 00 00 00 00  Length = 272000 BitCount = 140 ID = 291\n"
+    "   0.020000 2  123ABCDx        Tx   d 1 2A\n"
+    "   0.030000 1  123             Rx   r\n"
+    "   0.040000 1  Statistic: D 0 R 0 XD 0 XR 0 E 0 O 0 B 0.00%\n"
+    "   0.050000 CANFD   3 Rx        456  FD_FRAME    1 0 9 12 00 01 02 03 04 05 06 07 08 09 0a 0b   1000 150 3000 1234 0 0 0 0 0\n"
+    "   0.060000 CANFD   1 Tx        7ff                                1 1 8 8 11 22 33 44 55 66 77 88   1000 150 0 1234\n"
+    "   0.070000 1  ErrorFrame\n"
+    "   0.080000 1  123             Rx   d 8 E8 03\n"
+    "   0.090000 CANFD   1 Rx        123 0 0 3 3 01 02 03 0 0 1000\n"
+    "End TriggerBlock\n";
+
+static const std::string ASC_RELATIVE_LOG =
+    "date Tue Jan 02 00:30:00 2024\n"
+    "base dec  timestamps relative\n"
+    "Begin Triggerblock\n"
+    "   0.500000 1  291  Rx   d 2 10 27\n"
+    "   0.250000 1  Statistic: D 0 R 0\n"
+    "   0.250000 1  291  Rx   d 2 20 4E\n"
+    "End TriggerBlock\n";
+
+static void test_parsing_helpers() {
+    uint32_t value = 0;
+    const char* hex = "1aF";
+    check(logs::parse_hex(hex, hex + 3, value) && value == 0x1AF, "parse_hex: mixed case");
+    check(!logs::parse_hex(hex, hex, value), "parse_hex: empty");
+    const char* bad_hex = "12G";
+    check(!logs::parse_hex(bad_hex, bad_hex + 3, value), "parse_hex: invalid digit");
+
+    int64_t ns = 0;
+    std::string ts = "1436509052.249713";
+    check(logs::parse_timestamp(ts.data(), ts.data() + ts.size(), ns) && ns == 1436509052249713000LL,
+          "parse_timestamp: microseconds");
+    ts = "12.3456789019";
+    check(logs::parse_timestamp(ts.data(), ts.data() + ts.size(), ns) && ns == 12345678901LL,
+          "parse_timestamp: digits beyond the nanosecond are ignored");
+    ts = "7";
+    check(logs::parse_timestamp(ts.data(), ts.data() + ts.size(), ns) && ns == 7000000000LL,
+          "parse_timestamp: no fractional part");
+    ts = "1.2x";
+    check(!logs::parse_timestamp(ts.data(), ts.data() + ts.size(), ns), "parse_timestamp: trailing characters");
+}
+
+static void test_candump_reader() {
+    CandumpReader reader(CANDUMP_LOG.data(), CANDUMP_LOG.data() + CANDUMP_LOG.size());
+    std::vector<LogFrame> frames;
+    LogFrame frame;
+    while(reader.next(frame))
+        frames.push_back(frame);
+
+    check(frames.size() == 7, "candump: number of frames");
+    check(reader.line_count() == 11, "candump: number of lines");
+    check(reader.skipped_lines() == 3, "candump: invalid lines are counted (empty lines excluded)");
+    check(reader.channels().size() == 3 && reader.channels()[1] == "can1" &&
+          reader.channels()[2] == "vcan0", "candump: channels in order of appearance");
+    if(frames.size() != 7)
+        return;
+
+    const LogFrame& classic = frames[0];
+    check(classic.timestamp == 1436509052249713000LL, "candump: timestamp");
+    check(classic.can_id == 0x123 && !classic.is_extended() && !classic.is_fd(), "candump: standard ID");
+    check(classic.length == 8 && classic.data[0] == 0xE8 && classic.data[1] == 0x03 &&
+          classic.data[2] == 0x01, "candump: classic payload");
+    check(classic.channel == 0 && !(classic.flags & LogFrame::Tx), "candump: channel of the first frame");
+
+    const LogFrame& extended = frames[1];
+    check(extended.can_id == 0x0123ABCD && extended.is_extended(), "candump: extended ID");
+    check(extended.dbc_id() == (0x0123ABCDULL | CANFrame::EXTENDED_ID_FLAG), "candump: DBC ID of extended frames");
+    check(extended.length == 1 && extended.data[0] == 0x2A, "candump: extended payload");
+    check((extended.flags & LogFrame::Tx) != 0, "candump: transmitted frame");
+
+    const LogFrame& remote = frames[2];
+    check((remote.flags & LogFrame::Remote) && remote.length == 0 && remote.channel == 1, "candump: remote frame");
+
+    const LogFrame& fd = frames[3];
+    check(fd.is_fd() && fd.can_id == 0x456 && fd.length == 12 && fd.channel == 2, "candump: CAN FD frame");
+    check((fd.flags & LogFrame::BitRateSwitch) && (fd.flags & LogFrame::ErrorStateIndicator), "candump: CAN FD flags");
+    check(fd.data[0] == 0x00 && fd.data[11] == 0x0B, "candump: CAN FD payload");
+
+    const LogFrame& error = frames[4];
+    check((error.flags & LogFrame::ErrorFrame) && !error.is_extended() && error.can_id == 0x80, "candump: error frame");
+
+    check(frames[5].length == 8 && frames[5].data[7] == 0x77, "candump: len8_dlc suffix");
+
+    // The two invalid frames (2-digit ID, 11-byte FD payload) were skipped
+    check(frames[6].length == 3 && frames[6].data[0] == 0xE8 && frames[6].data[2] == 0x00,
+          "candump: separators between bytes and no final end-of-line");
+
+    // RTR flag set in the ID without "#R": remote frame without payload
+    const std::string rtr_log =
+        "(1.000000) can0 4000ABCD#\n"
+        "(2.000000) can0 4000ABCD#1122\n"
+        "(3.000000) can0 4000ABCD##1\n";
+    CandumpReader rtr(rtr_log.data(), rtr_log.data() + rtr_log.size());
+    frame.length = 0xFF;
+    check(rtr.next(frame) && (frame.flags & LogFrame::Remote) && frame.is_extended() &&
+          frame.can_id == 0xABCD && frame.length == 0, "candump: RTR flag of the ID");
+    check(!rtr.next(frame) && rtr.skipped_lines() == 2, "candump: RTR flag with a payload is rejected");
+}
+
+static void test_asc_reader() {
+    AscReader reader(ASC_LOG.data(), ASC_LOG.data() + ASC_LOG.size());
+    std::vector<LogFrame> frames;
+    LogFrame frame;
+    while(reader.next(frame))
+        frames.push_back(frame);
+
+    check(frames.size() == 7, "asc: number of frames");
+    check(reader.skipped_lines() == 1, "asc: truncated payload is reported");
+    check(reader.is_hex() && !reader.has_relative_timestamps(), "asc: base and timestamps");
+
+    // 2023-09-18 22:12:13.456 is 1695075133.456 seconds after the epoch
+    check(reader.start_time() == 1695075133456000000LL, "asc: date of the measurement");
+    if(frames.size() != 7)
+        return;
+
+    const LogFrame& classic = frames[0];
+    check(classic.timestamp == 10000000 && classic.channel == 0 && classic.can_id == 0x123, "asc: classic frame");
+    check(classic.length == 8 && classic.data[0] == 0xE8 && classic.data[1] == 0x03 && !(classic.flags & LogFrame::Tx),
+          "asc: classic payload");
+
+    const LogFrame& extended = frames[1];
+    check(extended.is_extended() && extended.can_id == 0x123ABCD && extended.channel == 1, "asc: extended frame");
+    check((extended.flags & LogFrame::Tx) && extended.length == 1 && extended.data[0] == 0x2A, "asc: Tx frame");
+
+    check((frames[2].flags & LogFrame::Remote) && frames[2].length == 0, "asc: remote frame");
+
+    const LogFrame& fd = frames[3];
+    check(fd.is_fd() && (fd.flags & LogFrame::BitRateSwitch) && !(fd.flags & LogFrame::ErrorStateIndicator),
+          "asc: CAN FD flags");
+    check(fd.can_id == 0x456 && fd.channel == 2 && fd.length == 12 && fd.data[11] == 0x0B, "asc: CAN FD frame with a name");
+
+    // The flags (0) tell that this frame is a classic frame
+    const LogFrame& classic_fd = frames[4];
+    check(!classic_fd.is_fd() && classic_fd.can_id == 0x7FF && classic_fd.length == 8 && classic_fd.data[7] == 0x88 &&
+          (classic_fd.flags & LogFrame::Tx), "asc: classic frame in a CANFD event without a name");
+
+    check((frames[5].flags & LogFrame::ErrorFrame) && frames[5].timestamp == 70000000, "asc: error frame");
+
+    // No flags after the payload: CAN FD by default
+    check(frames[6].is_fd() && frames[6].length == 3 && frames[6].data[2] == 0x03, "asc: CAN FD frame without flags");
+
+    AscReader relative(ASC_RELATIVE_LOG.data(), ASC_RELATIVE_LOG.data() + ASC_RELATIVE_LOG.size());
+    check(relative.next(frame) && frame.can_id == 291 && frame.timestamp == 500000000, "asc: decimal IDs");
+    check(relative.next(frame) && frame.timestamp == 1000000000 && frame.data[1] == 0x4E, "asc: relative timestamps");
+    check(!relative.next(frame) && relative.skipped_lines() == 0, "asc: end of the relative log");
+    check(relative.start_time() == 1704155400000000000LL, "asc: date with a 24-hour clock");
+}
+
+static void test_asc_file() {
+    // Large generated log, read through a mapping and decoded
+    const int FRAME_COUNT = 20000;
+    std::string log = "date Mon Sep 18 10:12:13.456 am 2023\nbase hex  timestamps absolute\nBegin Triggerblock\n";
+    for(int i = 0; i < FRAME_COUNT; i++) {
+        char line[128];
+        std::snprintf(line, sizeof(line), "%d.%06d 1  123  Rx   d 3 %02X %02X %02X\n",
+                      i / 1000, (i % 1000) * 1000, i & 0xFF, (i >> 8) & 0xFF, i & 1);
+        log += line;
+        if(i % 100 == 0)
+            log += "   1.000000 1  Statistic: D 0 R 0\n";
+    }
+    log += "End TriggerBlock\n";
+    const std::string path = temp_file("generated.asc");
+    write_file(path, log);
+
+    CANDatabase db = CANDatabase::fromString(LOG_DBC);
+    CANDecoder decoder(db);
+    MappedFile file(path);
+    AscReader reader(file.begin(), file.end());
+
+    int count = 0;
+    bool values_ok = true;
+    LogFrame frame;
+    while(reader.next(frame)) {
+        const CANDecoder::FramePlan* plan = decoder.find(frame.can_id, frame.is_extended());
+        if(plan == nullptr) {
+            values_ok = false;
+            break;
+        }
+
+        CANDecoder::Payload payload(frame.data, frame.length);
+        for(const CANDecoder::SignalPlan& signal : plan->signals) {
+            if(signal.signal->name() == "SPEED")
+                values_ok = values_ok && signal.raw(payload) == (count & 0xFFFF);
+            else
+                values_ok = values_ok && signal.raw(payload) == (count & 1);
+        }
+        values_ok = values_ok && frame.timestamp == static_cast<int64_t>(count) * 1000000;
+        count++;
+    }
+
+    check(count == FRAME_COUNT && reader.skipped_lines() == 0, "asc: all the generated frames are read");
+    check(values_ok, "asc: generated frames are decoded");
+}
+
+static std::string generate_candump_log(int frame_count) {
+    std::string log;
+    for(int i = 0; i < frame_count; i++) {
+        char line[128];
+        // can1 first appears in the middle of the log, can2 near its end
+        const char* iface = i < frame_count / 2 ? "can0" : (i % 3 == 0 ? "can1" : "can0");
+        if(i == frame_count - 10)
+            iface = "can2";
+
+        if(i % 7 == 0)
+            std::snprintf(line, sizeof(line), "(%d.%06d) %s 0123ABCD#%02X\n", 1000 + i / 1000, i % 1000, iface, i & 0xFF);
+        else
+            std::snprintf(line, sizeof(line), "(%d.%06d) %s 123#%02X%02X%02X\n", 1000 + i / 1000, i % 1000, iface,
+                          i & 0xFF, (i >> 8) & 0xFF, i & 1);
+        log += line;
+        if(i % 1000 == 999)
+            log += "garbage\n";
+    }
+    return log;
+}
+
+static void test_parallel_decoding() {
+    CANDatabase db = CANDatabase::fromString(LOG_DBC);
+    CANDecoder decoder(db);
+
+    const int FRAME_COUNT = 30000;
+    std::string log = generate_candump_log(FRAME_COUNT);
+
+    // Reference: sequential reading
+    CandumpReader reader(log.data(), log.data() + log.size());
+    std::vector<LogFrame> expected;
+    LogFrame frame;
+    while(reader.next(frame))
+        expected.push_back(frame);
+
+    ParallelLogDecoder::Options options;
+    options.threads = 4;
+    options.chunk_size = 4096;
+    options.max_pending_chunks = 3;
+    ParallelLogDecoder parallel(decoder, ParallelLogDecoder::Candump, log.data(), log.data() + log.size(), options);
+    check(parallel.chunk_count() > 100, "parallel: the log is split");
+
+    std::size_t index = 0;
+    std::size_t next_sequence = 0;
+    bool ordered = true;
+    bool same_frames = true;
+    bool same_values = true;
+    parallel.run([&](const ParallelLogDecoder::DecodedChunk& chunk) {
+        ordered = ordered && chunk.sequence == next_sequence++;
+        for(std::size_t f = 0; f < chunk.frames.size(); f++, index++) {
+            const LogFrame& actual = chunk.frames[f];
+            if(index >= expected.size() || actual.timestamp != expected[index].timestamp ||
+               actual.can_id != expected[index].can_id || actual.channel != expected[index].channel ||
+               actual.length != expected[index].length ||
+               std::memcmp(actual.data, expected[index].data, actual.length) != 0) {
+                same_frames = false;
+                continue;
+            }
+
+            const CANDecoder::FramePlan* plan = chunk.plans[f];
+            if(plan == nullptr) {
+                same_values = false;
+                continue;
+            }
+
+            std::vector<double> values(plan->signals.size());
+            decoder.decode(*plan, actual.data, actual.length, values.data());
+            same_values = same_values &&
+                chunk.value_offsets[f + 1] - chunk.value_offsets[f] == values.size() &&
+                std::equal(values.begin(), values.end(), chunk.values.begin() + chunk.value_offsets[f]);
+        }
+    });
+
+    check(ordered, "parallel: chunks are consumed in order");
+    check(same_frames && index == expected.size(), "parallel: same frames as the sequential reader");
+    check(same_values, "parallel: decoded values");
+    check(parallel.frame_count() == expected.size(), "parallel: frame count");
+    check(parallel.skipped_lines() == reader.skipped_lines() && parallel.skipped_lines() == FRAME_COUNT / 1000,
+          "parallel: skipped lines");
+    check(parallel.channels() == reader.channels(), "parallel: channels numbered as in a sequential reading");
+
+    // Worker stage and exceptions
+    options.worker_stage = [](ParallelLogDecoder::DecodedChunk& chunk) {
+        chunk.output = std::to_string(chunk.frames.size());
+    };
+    ParallelLogDecoder staged(decoder, ParallelLogDecoder::Candump, log.data(), log.data() + log.size(), options);
+    std::size_t total = 0;
+    bool thrown = false;
+    try {
+        staged.run([&](const ParallelLogDecoder::DecodedChunk& chunk) {
+            total += std::stoul(chunk.output);
+            if(chunk.sequence == 10)
+                throw std::runtime_error("stop");
+        });
+    }
+    catch(const std::runtime_error&) {
+        thrown = true;
+    }
+    check(thrown && total > 0 && total < expected.size(), "parallel: the consumer's exceptions stop the decoding");
+
+    // Vector logs with relative timestamps are not split
+    ParallelLogDecoder relative(decoder, ParallelLogDecoder::Asc, ASC_RELATIVE_LOG.data(),
+                                ASC_RELATIVE_LOG.data() + ASC_RELATIVE_LOG.size(), options);
+    check(relative.chunk_count() == 1, "parallel: relative timestamps are not split");
+
+    std::string asc = ASC_LOG;
+    for(int i = 0; i < 200; i++)
+        asc += "   1.000000 1  123             Rx   d 8 E8 03 01 00 00 00 00 00\n";
+    ParallelLogDecoder absolute(decoder, ParallelLogDecoder::Asc, asc.data(), asc.data() + asc.size(), options);
+    std::size_t asc_frames = 0;
+    absolute.run([&](const ParallelLogDecoder::DecodedChunk& chunk) { asc_frames += chunk.frames.size(); });
+    check(absolute.chunk_count() > 1 && asc_frames == 207, "parallel: Vector logs");
+
+    // Only the frames that match a raw filter are decoded
+    ParallelLogDecoder::Options filtered_options = options;
+    filtered_options.worker_stage = nullptr;
+    filtered_options.filters.push_back(CANRawFilter(db.at(291)).equals("GEAR", "Drive"));
+    ParallelLogDecoder filtered(decoder, ParallelLogDecoder::Candump, log.data(), log.data() + log.size(),
+                                filtered_options);
+    std::size_t drive_frames = std::count_if(expected.begin(), expected.end(), [](const LogFrame& f) {
+        return !f.is_extended() && f.can_id == 291 && f.data[2] == 1;
+    });
+    std::size_t kept = 0;
+    bool all_drive = true;
+    filtered.run([&](const ParallelLogDecoder::DecodedChunk& chunk) {
+        kept += chunk.frames.size();
+        for(std::size_t f = 0; f < chunk.frames.size(); f++) {
+            const CANDecoder::FramePlan* plan = chunk.plans[f];
+            const CANDecoder::SignalPlan* gear = plan ? &plan->signals[0] : nullptr;
+            all_drive = all_drive && gear != nullptr && gear->signal->name() == "GEAR" &&
+                        chunk.values[chunk.value_offsets[f]] == 1;
+        }
+    });
+    check(kept == drive_frames && drive_frames > 0 && all_drive && filtered.frame_count() == kept,
+          "parallel: raw filters");
+
+    // LogFrame::channel cannot index more than 256 interfaces
+    std::string many_channels;
+    for(int i = 0; i < 300; i++)
+        many_channels += "(1.000000) vcan" + std::to_string(i) + " 123#00\n";
+    ParallelLogDecoder overflow(decoder, ParallelLogDecoder::Candump, many_channels.data(),
+                                many_channels.data() + many_channels.size(), options);
+    thrown = false;
+    try {
+        overflow.run([](const ParallelLogDecoder::DecodedChunk&) {});
+    }
+    catch(const CANLogException&) {
+        thrown = true;
+    }
+    check(thrown && overflow.chunk_count() > 1 && overflow.channels().size() == 256,
+          "parallel: too many interfaces");
+}
+
+static std::vector<LogFrame> generate_frames(std::size_t count) {
+    std::vector<LogFrame> frames(count);
+    uint32_t state = 12345;
+    auto random = [&state]() {
+        state = state * 1103515245 + 12345;
+        return state >> 8;
+    };
+
+    int64_t timestamp = 1600000000000000000LL;
+    for(std::size_t i = 0; i < count; i++) {
+        LogFrame& frame = frames[i];
+        std::memset(&frame, 0, sizeof(frame));
+
+        // Mostly increasing timestamps, sometimes slightly out of order
+        timestamp += (i % 50 == 49) ? -3000 : static_cast<int64_t>(random() % 2000000);
+        frame.timestamp = timestamp;
+        frame.channel = static_cast<uint8_t>(i % 9 == 0 ? random() % 4 : 0);
+
+        switch(i % 5) {
+        case 0: // Extended
+            frame.flags = LogFrame::Extended;
+            frame.can_id = random() & 0x1FFFFFFF;
+            frame.length = static_cast<uint8_t>(random() % 9);
+            break;
+        case 1: // CAN FD
+            frame.flags = LogFrame::FD | ((random() & 1) ? LogFrame::BitRateSwitch : 0);
+            frame.can_id = random() & 0x7FF;
+            frame.length = static_cast<uint8_t>(CANFrame::dlc_to_length(random() % 16));
+            break;
+        case 2: // Remote
+            frame.flags = LogFrame::Remote | LogFrame::Tx;
+            frame.can_id = random() & 0x7FF;
+            frame.length = static_cast<uint8_t>(random() % 9);
+            break;
+        default:
+            frame.can_id = random() & 0x7FF;
+            frame.length = 8;
+            break;
+        }
+
+        if(!(frame.flags & LogFrame::Remote)) {
+            for(unsigned b = 0; b < frame.length; b++)
+                frame.data[b] = static_cast<uint8_t>(random());
+        }
+    }
+
+    return frames;
+}
+
+static bool same_frame(const LogFrame& lhs, const LogFrame& rhs) {
+    bool remote = (lhs.flags & LogFrame::Remote) != 0;
+    return lhs.timestamp == rhs.timestamp && lhs.can_id == rhs.can_id && lhs.flags == rhs.flags &&
+           lhs.channel == rhs.channel && lhs.length == rhs.length &&
+           (remote || std::memcmp(lhs.data, rhs.data, lhs.length) == 0);
+}
+
+static void test_binary_log() {
+    const std::size_t FRAME_COUNT = 20000;
+    std::vector<LogFrame> frames = generate_frames(FRAME_COUNT);
+
+    const std::string path = temp_file("binary.cbl");
+    BinaryLogWriter::Options options;
+    options.block_size = 4096;
+    {
+        BinaryLogWriter writer(path, options);
+        for(const LogFrame& frame : frames)
+            writer.write(frame);
+        writer.close();
+        check(writer.frame_count() == FRAME_COUNT && writer.block_count() > 10, "binary: blocks written");
+    }
+
+    MappedFile file(path);
+    check(binlog::is_binary_log(file.begin(), file.end()), "binary: header");
+
+    BinaryLogReader reader(file.begin(), file.end());
+    check(reader.has_index() && reader.frame_count() == FRAME_COUNT, "binary: index");
+
+    std::size_t index = 0;
+    bool same = true;
+    LogFrame frame;
+    while(reader.next(frame))
+        same = same && index < frames.size() && same_frame(frame, frames[index++]);
+    check(same && index == FRAME_COUNT, "binary: frames read back");
+
+    // Seek to the middle of the log
+    const BinaryLogReader::BlockInfo& middle = reader.blocks()[reader.blocks().size() / 2];
+    reader.seek(middle.min_timestamp);
+    check(reader.next(frame) && frame.timestamp >= reader.blocks()[reader.blocks().size() / 2 - 1].min_timestamp &&
+          frame.timestamp <= middle.max_timestamp, "binary: seek");
+
+    // Parallel decoding of the blocks
+    CANDatabase db = CANDatabase::fromString(LOG_DBC);
+    CANDecoder decoder(db);
+    ParallelLogDecoder::Options parallel_options;
+    parallel_options.threads = 3;
+    parallel_options.chunk_size = 10000;
+    ParallelLogDecoder parallel(decoder, ParallelLogDecoder::Binary, file.begin(), file.end(), parallel_options);
+    index = 0;
+    same = true;
+    parallel.run([&](const ParallelLogDecoder::DecodedChunk& chunk) {
+        for(const LogFrame& decoded : chunk.frames)
+            same = same && index < frames.size() && same_frame(decoded, frames[index++]);
+    });
+    check(parallel.chunk_count() > 1 && same && index == FRAME_COUNT, "binary: parallel decoding");
+
+    // Without the index (interrupted writer), the blocks are found by walking through them
+    std::string content(file.begin(), file.size());
+    std::size_t last_block_end = reader.blocks().back().offset + reader.blocks().back().size;
+    std::string truncated = content.substr(0, last_block_end + 10);
+    BinaryLogReader recovered(truncated.data(), truncated.data() + truncated.size());
+    check(!recovered.has_index() && recovered.blocks().size() == reader.blocks().size() &&
+          recovered.frame_count() == FRAME_COUNT, "binary: recovery without index");
+
+    // Corrupted block
+    std::string corrupted = content;
+    corrupted[reader.blocks()[1].offset + binlog::BLOCK_HEADER_SIZE + 5] ^= 0x40;
+    BinaryLogReader corrupted_reader(corrupted.data(), corrupted.data() + corrupted.size());
+    bool thrown = false;
+    std::size_t read = 0;
+    try {
+        while(corrupted_reader.next(frame))
+            read++;
+    }
+    catch(const CANLogException&) {
+        thrown = true;
+    }
+    check(thrown && read == reader.blocks()[0].frame_count, "binary: checksum of the blocks");
+
+    // Size compared to candump
+    std::size_t text_size = 0;
+    for(const LogFrame& f : frames)
+        text_size += 30 + (f.is_extended() ? 8 : 3) + 2 * f.length;
+    check(file.size() * 2 < text_size, "binary: compact");
+
+    bool not_binary = false;
+    try {
+        BinaryLogReader invalid(CANDUMP_LOG.data(), CANDUMP_LOG.data() + CANDUMP_LOG.size());
+    }
+    catch(const CANLogException&) {
+        not_binary = true;
+    }
+    check(not_binary, "binary: text logs are rejected");
+}
+
+static void test_binary_channels() {
+    // Conversion of a candump log: the names of the interfaces are kept
+    CandumpReader candump(CANDUMP_LOG.data(), CANDUMP_LOG.data() + CANDUMP_LOG.size());
+    std::vector<LogFrame> frames;
+    LogFrame frame;
+    while(candump.next(frame))
+        frames.push_back(frame);
+
+    const std::string path = temp_file("channels.cbl");
+    {
+        BinaryLogWriter writer(path);
+        for(const LogFrame& f : frames)
+            writer.write(f);
+        writer.set_channels(candump.channels());
+        writer.close();
+    }
+
+    MappedFile file(path);
+    BinaryLogReader reader(file.begin(), file.end());
+    check(reader.has_index() && reader.channels() == candump.channels(), "binary: channel table");
+
+    std::size_t index = 0;
+    bool same = true;
+    while(reader.next(frame))
+        same = same && index < frames.size() && same_frame(frame, frames[index++]);
+    check(same && index == frames.size(), "binary: frames of a log with a channel table");
+
+    CANDatabase db = CANDatabase::fromString(LOG_DBC);
+    CANDecoder decoder(db);
+    ParallelLogDecoder parallel(decoder, ParallelLogDecoder::Binary, file.begin(), file.end());
+    bool named = true;
+    parallel.run([&](const ParallelLogDecoder::DecodedChunk& chunk) {
+        for(const LogFrame& decoded : chunk.frames)
+            named = named && decoded.channel < chunk.channels.size();
+    });
+    check(named && parallel.channels() == candump.channels(), "binary: channels of the parallel decoder");
+
+    // The table is stored after the index: it is lost with it
+    std::string truncated(file.begin(), file.size() - binlog::FOOTER_SIZE);
+    BinaryLogReader recovered(truncated.data(), truncated.data() + truncated.size());
+    check(!recovered.has_index() && recovered.channels().empty() && recovered.frame_count() == frames.size(),
+          "binary: channel table without index");
+}
+
+static void test_log_index() {
+    const int FRAME_COUNT = 30000;
+    std::string log = generate_candump_log(FRAME_COUNT);
+    const char* begin = log.data();
+    const char* end = log.data() + log.size();
+
+    CANLogIndex::Options options;
+    options.region_size = 8192;
+    CANLogIndex index = CANLogIndex::build(ParallelLogDecoder::Candump, begin, end, options);
+    check(index.regions().size() > 50 && index.matches(begin, end), "index: regions");
+    check(index.ids().size() == 2 && index.ids()[0] == 0x123 &&
+          index.ids()[1] == (0x0123ABCDULL | CANFrame::EXTENDED_ID_FLAG), "index: IDs");
+
+    // Reference: sequential reading
+    CandumpReader reader(begin, end);
+    std::vector<LogFrame> frames;
+    LogFrame frame;
+    while(reader.next(frame))
+        frames.push_back(frame);
+
+    const int64_t from = frames[12000].timestamp;
+    const int64_t to = frames[12500].timestamp;
+    const unsigned long long extended_id = 0x0123ABCDULL | CANFrame::EXTENDED_ID_FLAG;
+
+    std::vector<LogFrame> expected;
+    for(const LogFrame& f : frames) {
+        if(f.dbc_id() == extended_id && f.timestamp >= from && f.timestamp <= to)
+            expected.push_back(f);
+    }
+
+    std::vector<LogFrame> found;
+    index.query(begin, end, extended_id, from, to, [&found](const LogFrame& f) { found.push_back(f); });
+    bool same = found.size() == expected.size() && !found.empty();
+    for(std::size_t i = 0; same && i < found.size(); i++)
+        same = same_frame(found[i], expected[i]);
+    check(same, "index: query by ID and time");
+    check(index.find_regions(extended_id, from, to).size() <= 3, "index: only a few regions are read");
+    check(index.find_regions(0x7FF, frames.front().timestamp, frames.back().timestamp).empty(), "index: unknown ID");
+
+    // Channels are numbered as in the whole log
+    std::vector<LogFrame> late;
+    index.query(begin, end, frames[FRAME_COUNT - 20].timestamp, frames.back().timestamp,
+                [&late](const LogFrame& f) { late.push_back(f); });
+    same = late.size() == 20;
+    for(std::size_t i = 0; same && i < late.size(); i++)
+        same = same_frame(late[i], frames[FRAME_COUNT - 20 + i]);
+    check(same && index.channels() == reader.channels(), "index: query by time");
+
+    // Sidecar file
+    const std::string index_path = temp_file("index.idx");
+    index.save(index_path);
+    CANLogIndex loaded = CANLogIndex::load(index_path);
+    check(loaded.matches(begin, end) && loaded.regions().size() == index.regions().size() &&
+          loaded.ids() == index.ids() && loaded.channels() == index.channels(), "index: saved and loaded");
+    std::size_t loaded_count = loaded.query(begin, end, extended_id, from, to, [](const LogFrame&) {});
+    check(loaded_count == expected.size(), "index: query of a loaded index");
+
+    std::string modified = log;
+    modified[10] = modified[10] == '1' ? '2' : '1';
+    check(!loaded.matches(modified.data(), modified.data() + modified.size()), "index: stale index detected");
+
+    // Vector logs with relative timestamps: the regions start from the checkpoint
+    std::string asc = "date Tue Jan 02 00:30:00 2024\nbase hex  timestamps relative\nBegin Triggerblock\n";
+    for(int i = 0; i < 5000; i++)
+        asc += i % 2 ? "   0.001000 1  123  Rx   d 2 10 27\n" : "   0.001000 1  456  Rx   d 1 01\n";
+    CANLogIndex asc_index = CANLogIndex::build(ParallelLogDecoder::Asc, asc.data(), asc.data() + asc.size(), options);
+    std::vector<int64_t> timestamps;
+    asc_index.query(asc.data(), asc.data() + asc.size(), 0x123, 4000000000LL, 4010000000LL,
+                    [&timestamps](const LogFrame& f) { timestamps.push_back(f.timestamp); });
+    check(asc_index.regions().size() > 10 && timestamps.size() == 6 && timestamps[0] == 4000000000LL &&
+          timestamps[5] == 4010000000LL, "index: relative timestamps");
+
+    // Binary logs: one region per block
+    const std::string binary_path = temp_file("index.cbl");
+    BinaryLogWriter::Options binary_options;
+    binary_options.block_size = 4096;
+    BinaryLogWriter writer(binary_path, binary_options);
+    for(const LogFrame& f : generate_frames(5000))
+        writer.write(f);
+    writer.close();
+
+    MappedFile binary(binary_path);
+    CANLogIndex binary_index = CANLogIndex::build(ParallelLogDecoder::Binary, binary.begin(), binary.end());
+    BinaryLogReader binary_reader(binary.begin(), binary.end());
+    std::size_t binary_frames = binary_index.query(binary.begin(), binary.end(), INT64_MIN, INT64_MAX,
+                                                   [](const LogFrame&) {});
+    check(binary_index.regions().size() == binary_reader.blocks().size() &&
+          binary_frames == binary_reader.frame_count(), "index: binary logs");
+}
+
+static void test_mapped_file() {
+    const std::string candump_path = temp_file("candump.log");
+    write_file(candump_path, CANDUMP_LOG);
+
+    MappedFile file(candump_path);
+    check(file.size() == CANDUMP_LOG.size(), "MappedFile: size");
+    check(std::memcmp(file.begin(), CANDUMP_LOG.data(), file.size()) == 0, "MappedFile: content");
+
+    const std::string empty_path = temp_file("empty.log");
+    write_file(empty_path, "");
+    MappedFile empty(empty_path);
+    CandumpReader reader(empty.begin(), empty.end());
+    LogFrame frame;
+    check(empty.size() == 0 && !reader.next(frame), "MappedFile: empty file");
+
+    bool thrown = false;
+    try {
+        MappedFile missing("this-file-does-not-exist.log");
+    }
+    catch(const CANLogException&) {
+        thrown = true;
+    }
+    check(thrown, "MappedFile: missing file");
+}
+
+static void test_decoding_log() {
+    CANDatabase db = CANDatabase::fromString(LOG_DBC);
+    CANDecoder decoder(db);
+    CandumpReader reader(CANDUMP_LOG.data(), CANDUMP_LOG.data() + CANDUMP_LOG.size());
+
+    LogFrame frame;
+    check(reader.next(frame), "decoding: first frame");
+    const CANDecoder::FramePlan* plan = decoder.find(frame.can_id, frame.is_extended());
+    check(plan != nullptr && plan->frame->name() == "STANDARD_FRAME", "decoding: standard frame found");
+    if(plan != nullptr) {
+        CANDecoder::Payload payload(frame.data, frame.length);
+        for(const CANDecoder::SignalPlan& signal : plan->signals) {
+            int64_t raw = signal.raw(payload);
+            if(signal.signal->name() == "SPEED") {
+                check(signal.physical(raw) == 10.0, "decoding: standard frame value");
+            }
+            else {
+                check(signal.physical(raw) == 1.0 && signal.label(raw) == "Drive", "decoding: label");
+            }
+        }
+    }
+
+    check(reader.next(frame), "decoding: second frame");
+    plan = decoder.find(frame.can_id, frame.is_extended());
+    check(plan != nullptr && plan->frame->name() == "EXTENDED_FRAME", "decoding: extended frame found");
+}
+
+static void test_period_monitor() {
+    const int64_t MS = 1000000;
+    CANDatabase db = CANDatabase::fromString(
+        "VERSION \"\"\n"
+        "BS_:\n"
+        "BU_: TestNode\n"
+        "BO_ 100 FAST_FRAME: 8 TestNode\n"
+        "BO_ 2166598605 SLOW_FRAME: 8 TestNode\n"
+        "BO_ 200 EVENT_FRAME: 8 TestNode\n"
+        "BA_DEF_ BO_ \"GenMsgCycleTime\" INT 0 65535;\n"
+        "BA_ \"GenMsgCycleTime\" BO_ 100 10;\n"
+        "BA_ \"GenMsgCycleTime\" BO_ 2166598605 100;\n");
+
+    std::vector<CANPeriodMonitor::Event> events;
+    CANPeriodMonitor monitor(db, [&events](const CANPeriodMonitor::Event& event) { events.push_back(event); });
+    check(monitor.frames().size() == 2 && monitor.stats(200) == nullptr, "Period monitor: monitored frames");
+
+    // Fast frame: on time, early (4 ms), late (15 ms), then missing for 100 ms
+    for(int64_t t : { 0, 10, 20, 24, 39, 49 })
+        monitor.receive(100, 1000 * MS + t * MS);
+    LogFrame slow;
+    slow.timestamp = 1000 * MS;
+    slow.can_id = 0x0123ABCD;
+    slow.length = 8;
+    slow.channel = 0;
+    slow.flags = LogFrame::Extended;
+    check(monitor.receive(slow) && !monitor.receive(200, 1000 * MS), "Period monitor: receive");
+
+    monitor.advance(1060 * MS);
+    check(events.size() == 2 && events[0].type == CANPeriodMonitor::Early && events[0].interval == 4 * MS &&
+          events[1].type == CANPeriodMonitor::Late && events[1].interval == 15 * MS, "Period monitor: jitter events");
+
+    monitor.advance(1080 * MS);
+    check(events.size() == 3 && events[2].type == CANPeriodMonitor::Timeout && events[2].frame->can_id() == 100 &&
+          events[2].timestamp == 1079 * MS && monitor.stats(100)->missing, "Period monitor: timeout");
+
+    monitor.receive(100, 1149 * MS);
+    const CANPeriodMonitor::FrameStats* fast = monitor.stats(100);
+    check(events.size() == 4 && events[3].type == CANPeriodMonitor::Recovered && events[3].interval == 100 * MS &&
+          !fast->missing && fast->received == 7 && fast->timeouts == 1 && fast->early == 1 && fast->late == 1,
+          "Period monitor: recovery");
+    check(fast->min_interval == 4 * MS && fast->max_interval == 100 * MS && fast->histogram[3] == 1 &&
+          fast->histogram[8] == 3 && fast->histogram[12] == 1 && fast->histogram[15] == 1, "Period monitor: histogram");
+
+    // The slow frame times out after 300 ms without any frame (the fast one after 30 ms)
+    monitor.advance(1299 * MS);
+    check(events.size() == 5 && events[4].frame->can_id() == 100 && events[4].timestamp == 1179 * MS,
+          "Period monitor: no early timeout");
+    monitor.advance(1300 * MS);
+    check(events.size() == 6 && events[5].frame->dbc_id() == 2166598605ULL &&
+          monitor.stats(2166598605ULL)->timeouts == 1, "Period monitor: extended frame timeout");
+
+    // Replay of 3000 frames with periods from 10 ms to 3 s: frame 7 stops for 5 s
+    std::string dbc = "VERSION \"\"\nBS_:\nBU_: TestNode\n";
+    for(int id = 0; id < 3000; id++)
+        dbc += "BO_ " + std::to_string(id + 0x80000000U) + " FRAME_" + std::to_string(id) + ": 8 TestNode\n";
+    dbc += "BA_DEF_ BO_ \"GenMsgCycleTime\" INT 0 65535;\n";
+    for(int id = 0; id < 3000; id++) {
+        dbc += "BA_ \"GenMsgCycleTime\" BO_ " + std::to_string(id + 0x80000000U) + " " +
+               std::to_string(10 * (1 + id % 300)) + ";\n";
+    }
+    CANDatabase large = CANDatabase::fromString(dbc);
+    uint64_t timeouts = 0;
+    uint64_t recovered = 0;
+    CANPeriodMonitor replay(large, [&](const CANPeriodMonitor::Event& event) {
+        timeouts += event.type == CANPeriodMonitor::Timeout;
+        recovered += event.type == CANPeriodMonitor::Recovered;
+    });
+
+    for(int64_t t = 0; t < 20000; t++) {
+        for(int id = 0; id < 3000; id++) {
+            int64_t period = 10 * (1 + id % 300);
+            if(t % period == 0 && !(id == 7 && t >= 5000 && t < 10000))
+                replay.receive(0x80000000ULL + id, t * MS);
+        }
+    }
+    check(timeouts == 1 && recovered == 1 && replay.stats(0x80000007ULL)->timeouts == 1,
+          "Period monitor: replay with 3000 frames");
+
+    // A long gap expires all the frames at once
+    replay.advance(3600000 * MS);
+    check(timeouts == 3001, "Period monitor: timeouts after a long gap");
+}
+
+static void test_bus_statistics() {
+    const int64_t MS = 1000000;
+    CANDatabase db = CANDatabase::fromString(
+        "VERSION \"\"\n"
+        "BS_: 500 : 12,34\n"
+        "BU_: TestNode\n"
+        "BO_ 291 STANDARD_FRAME: 8 TestNode\n"
+        "BO_ 2166598605 EXTENDED_FRAME: 8 TestNode\n"
+        "BA_DEF_ BO_ \"GenMsgCycleTime\" INT 0 65535;\n"
+        "BA_ \"GenMsgCycleTime\" BO_ 291 10;\n");
+    check(db.bit_timing().baudrate == 500 && db.bit_timing().btr1 == 12 && db.bit_timing().btr2 == 34,
+          "Bit timing of the database");
+
+    LogFrame frame;
+    frame.timestamp = 0;
+    frame.can_id = 291;
+    frame.length = 8;
+    frame.channel = 0;
+    frame.flags = 0;
+    std::memset(frame.data, 0xAA, sizeof(frame.data));
+
+    // Classic frames: 111 bits (standard) and 131 bits (extended) without stuffing
+    check(CANBusStatistics::frame_bits(frame, CANBusStatistics::NoStuffing).nominal == 111 &&
+          CANBusStatistics::frame_bits(frame, CANBusStatistics::WorstCase).nominal == 135, "Standard frame bits");
+    CANBusStatistics::FrameBits exact = CANBusStatistics::frame_bits(frame, CANBusStatistics::Exact);
+    std::memset(frame.data, 0, sizeof(frame.data));
+    CANBusStatistics::FrameBits zeros = CANBusStatistics::frame_bits(frame, CANBusStatistics::Exact);
+    check(exact.nominal >= 111 && exact.nominal < 120 && zeros.nominal > exact.nominal + 10 && zeros.nominal <= 135 &&
+          exact.data == 0, "Exact stuffing");
+
+    LogFrame extended = frame;
+    extended.can_id = 0x0123ABCD;
+    extended.flags = LogFrame::Extended;
+    check(CANBusStatistics::frame_bits(extended, CANBusStatistics::NoStuffing).nominal == 131 &&
+          CANBusStatistics::frame_bits(extended, CANBusStatistics::WorstCase).nominal == 160, "Extended frame bits");
+
+    LogFrame remote = frame;
+    remote.flags = LogFrame::Remote;
+    check(CANBusStatistics::frame_bits(remote, CANBusStatistics::NoStuffing).nominal == 47, "Remote frame bits");
+
+    // CAN FD: 17 arbitration bits, then ESI, DLC, data, stuff count and CRC-21 with fixed stuff bits
+    LogFrame fd = frame;
+    fd.length = 64;
+    fd.flags = LogFrame::FD | LogFrame::BitRateSwitch;
+    CANBusStatistics::FrameBits fd_bits = CANBusStatistics::frame_bits(fd, CANBusStatistics::NoStuffing);
+    check(fd_bits.nominal == 30 && fd_bits.data == 5 + 512 + 4 + 21 + 7, "CAN FD frame bits");
+    fd.flags = LogFrame::FD;
+    fd_bits = CANBusStatistics::frame_bits(fd, CANBusStatistics::NoStuffing);
+    check(fd_bits.nominal == 30 + 5 + 512 + 4 + 21 + 7 && fd_bits.data == 0, "CAN FD frame bits without bit rate switch");
+
+    // 291 every millisecond on channel 0 (111 bits at 500 kbit/s: 22.2% of the bus), the
+    // extended frame every 10 ms on channel 1
+    CANBusStatistics::Options options;
+    options.stuffing = CANBusStatistics::NoStuffing;
+    CANBusStatistics statistics(db, options);
+    check(statistics.nominal_bitrate() == 500000, "Bitrate from the database");
+    for(int64_t t = 0; t < 3000; t++) {
+        frame.timestamp = t * MS;
+        statistics.add(frame);
+        if(t % 10 == 0) {
+            extended.timestamp = t * MS;
+            extended.channel = 1;
+            statistics.add(extended);
+        }
+    }
+    LogFrame error = frame;
+    error.flags = LogFrame::ErrorFrame;
+    statistics.add(error);
+
+    CANBusStatistics::Load load = statistics.channel_load(0);
+    CANBusStatistics::Load total = statistics.channel_total(0);
+    check(load.frames == 1000 && load.bytes == 8000 && std::abs(load.load - 0.222) < 0.001, "Rolling bus load");
+    check(total.frames == 3000 && total.bits == 333000 && std::abs(total.load - 0.222) < 0.001, "Total bus load");
+    check(std::abs(statistics.channel_load(1).load - 0.0262) < 0.001 && statistics.errors(0) == 1 &&
+          statistics.errors(1) == 0, "Bus load of channel 1");
+
+    std::vector<CANBusStatistics::Talker> talkers = statistics.top_talkers(5);
+    check(talkers.size() == 2 && talkers[0].dbc_id == 291 && talkers[0].frame == &db.at(291) &&
+          talkers[1].dbc_id == 2166598605ULL && talkers[1].channel == 1 && statistics.id_count() == 2,
+          "Top talkers");
+    check(statistics.top_talkers(5, 1).size() == 1, "Top talkers of a channel");
+
+    // The rolling window forgets the frames older than 1 s
+    frame.timestamp = 4500 * MS;
+    statistics.add(frame);
+    check(statistics.channel_load(0).frames == 1 && statistics.channel_load(1).frames == 0, "Rolling window");
+
+    // A late frame in the slot of the current bucket does not wipe it
+    frame.timestamp = 3500 * MS;
+    statistics.add(frame);
+    check(statistics.channel_load(0).frames == 1 && statistics.channel_total(0).frames == 3002,
+          "Late frame only counted in the totals");
+
+    // 135 bits (worst case) every 10 ms at 500 kbit/s
+    check(std::abs(CANBusStatistics::estimate(db) - 0.027) < 1e-9, "Estimated bus load");
+}
+
+struct AggregateWindow {
+    int64_t start;
+    int64_t end;
+    std::vector<SignalAggregate> aggregates;
+};
+
+static const SignalAggregate* find_aggregate(const AggregateWindow& window, SignalHandle handle) {
+    for(const SignalAggregate& aggregate : window.aggregates)
+        if(aggregate.signal == handle.index)
+            return &aggregate;
+    return nullptr;
+}
+
+static void test_signal_aggregator() {
+    const int64_t MS = 1000000;
+    CANDatabase db = CANDatabase::fromString(LOG_DBC);
+    CANDecoder decoder(db);
+    SignalHandle speed = decoder.handle(0x123, "SPEED");
+    SignalHandle gear = decoder.handle(0x123, "GEAR");
+    SignalHandle counter = decoder.handle(0x8123ABCD, "COUNTER");
+
+    std::vector<AggregateWindow> windows;
+    auto collect = [&windows](int64_t start, int64_t end, const SignalAggregate* aggregates, std::size_t count) {
+        windows.push_back(AggregateWindow{ start, end, std::vector<SignalAggregate>(aggregates, aggregates + count) });
+    };
+
+    // Tumbling windows of 1 s fed with frames
+    SignalAggregator tumbling(decoder, collect);
+    check(tumbling.window() == 1000 * MS && tumbling.hop() == 1000 * MS, "Signal aggregator: default options");
+    check(tumbling.handle(gear.index) == gear && !tumbling.handle(1000).valid(), "Signal aggregator: handles");
+
+    LogFrame frame;
+    frame.can_id = 0x123;
+    frame.length = 8;
+    frame.channel = 0;
+    frame.flags = 0;
+    std::memset(frame.data, 0, sizeof(frame.data));
+    const int64_t times[] = { 100, 500, 1200 };
+    const uint16_t speeds[] = { 1000, 2000, 3000 };
+    const uint8_t gears[] = { 1, 0, 1 };
+    for(int i = 0; i < 3; i++) {
+        frame.timestamp = times[i] * MS;
+        frame.data[0] = speeds[i] & 0xFF;
+        frame.data[1] = speeds[i] >> 8;
+        frame.data[2] = gears[i];
+        check(tumbling.add(frame), "Signal aggregator: add frame");
+        if(i == 0)
+            tumbling.add(counter, 42., 300 * MS);
+    }
+    frame.flags = LogFrame::Remote;
+    check(!tumbling.add(frame), "Signal aggregator: remote frame");
+
+    check(windows.size() == 1 && windows[0].start == 0 && windows[0].end == 1000 * MS &&
+          windows[0].aggregates.size() == 3, "Signal aggregator: tumbling window emitted");
+    if(windows.size() == 1 && windows[0].aggregates.size() == 3) {
+        const SignalAggregate* s = find_aggregate(windows[0], speed);
+        const SignalAggregate* g = find_aggregate(windows[0], gear);
+        const SignalAggregate* c = find_aggregate(windows[0], counter);
+        check(s && s->count == 2 && std::fabs(s->min - 10.) < 1e-9 && std::fabs(s->max - 20.) < 1e-9 &&
+              std::fabs(s->mean - 15.) < 1e-9 && std::fabs(s->last - 20.) < 1e-9, "Signal aggregator: speed");
+        check(g && g->count == 2 && g->min == 0. && g->max == 1. && g->mean == 0.5 && g->last == 0.,
+              "Signal aggregator: gear");
+        check(c && c->count == 1 && c->last == 42., "Signal aggregator: counter");
+    }
+
+    tumbling.flush();
+    check(windows.size() == 2 && windows[1].start == 1000 * MS && windows[1].aggregates.size() == 2 &&
+          find_aggregate(windows[1], speed) && std::fabs(find_aggregate(windows[1], speed)->last - 30.) < 1e-9,
+          "Signal aggregator: flush");
+
+    // Empty windows are skipped
+    windows.clear();
+    tumbling.add(speed, 1., 100 * MS);
+    tumbling.add(speed, 2., 10500 * MS);
+    tumbling.advance(10900 * MS);
+    check(windows.size() == 1 && windows[0].end == 1000 * MS, "Signal aggregator: gap");
+    tumbling.advance(11000 * MS);
+    check(windows.size() == 2 && windows[1].start == 10000 * MS && windows[1].aggregates[0].mean == 2.,
+          "Signal aggregator: advance");
+
+    // Sliding windows of 1 s every 250 ms
+    windows.clear();
+    SignalAggregator::Options options;
+    options.window = 1000 * MS;
+    options.hop = 250 * MS;
+    SignalAggregator sliding(decoder, collect, options);
+    sliding.add(speed, 1., 100 * MS);
+    sliding.add(speed, 2., 600 * MS);
+    sliding.add(speed, 3., 1100 * MS);
+    sliding.advance(1250 * MS);
+    check(windows.size() == 5 && windows[4].start == 250 * MS && windows[4].end == 1250 * MS,
+          "Signal aggregator: sliding windows emitted");
+    if(windows.size() == 5) {
+        const SignalAggregate& first = windows[0].aggregates[0];
+        const SignalAggregate& third = windows[2].aggregates[0];
+        const SignalAggregate& last = windows[4].aggregates[0];
+        check(first.count == 1 && first.last == 1. && third.count == 2 && third.mean == 1.5 &&
+              last.count == 2 && last.min == 2. && last.max == 3. && last.last == 3.,
+              "Signal aggregator: sliding aggregates");
+    }
+    sliding.flush();
+    check(windows.size() == 8 && windows[7].end == 2000 * MS && windows[7].aggregates[0].count == 1,
+          "Signal aggregator: sliding flush");
+
+    bool thrown = false;
+    try {
+        options.window = 0;
+        SignalAggregator invalid(decoder, collect, options);
+    }
+    catch(const std::invalid_argument&) {
+        thrown = true;
+    }
+    check(thrown, "Signal aggregator: invalid window");
+}
+
+int main() {
+    try {
+        test_parsing_helpers();
+        test_candump_reader();
+        test_asc_reader();
+        test_asc_file();
+        test_parallel_decoding();
+        test_binary_log();
+        test_binary_channels();
+        test_log_index();
+        test_mapped_file();
+        test_decoding_log();
+        test_period_monitor();
+        test_bus_statistics();
+        test_signal_aggregator();
+    }
+    catch(const std::exception& e) {
+        std::cerr << "An unexpected exception happened: " << e.what() << std::endl;
+        errors.push_back(e.what());
+    }
+
+    for(const std::string& path : temp_files)
+        std::remove(path.c_str());
+
+    std::cout << "-----------" << std::endl;
+    if(errors.size() == 0) {
+        std::cout << "Success. All tests passed." << std::endl;
+    }
+    else {
+        std::cout << "Failure. " << errors.size() << " check(s) failed." << std::endl;
+    }
+
+    return static_cast<int>(errors.size() != 0);
+}
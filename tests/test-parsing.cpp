@@ -1,11 +1,12 @@
 #include <iostream>
-#include "CANDatabase.h"
+#include "cpp-can-parser/CANDatabase.h"
 
 int main(int argc, char** argv) {
     using namespace CppCAN;
     
     std::vector<std::string> successParseFile = {
-        "dbc-files/empty.dbc", "dbc-files/single-frame-1.dbc"
+        "dbc-files/empty.dbc", "dbc-files/single-frame-1.dbc",
+        "dbc-files/multiplexed-1.dbc"
     };
 
     std::vector<size_t> errors;
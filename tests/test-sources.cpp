@@ -0,0 +1,754 @@
+#include <iostream>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cpp-can-parser/CANDatabase.h"
+#include "cpp-can-parser/CANDecoder.h"
+#include "cpp-can-parser/CANFrameSource.h"
+#include "cpp-can-parser/CANIdFilter.h"
+#include "cpp-can-parser/CANPipeline.h"
+#include "cpp-can-parser/CANRing.h"
+#include "cpp-can-parser/ShardedDecoder.h"
+#include "cpp-can-parser/SignalStateTable.h"
+
+#ifdef __linux__
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace CppCAN;
+
+static std::vector<std::string> errors;
+
+static void check(bool condition, const std::string& description) {
+    if(!condition) {
+        std::cerr << "Check failed: " << description << std::endl;
+        errors.push_back(description);
+    }
+}
+
+static const std::string SOURCE_DBC =
+    "VERSION \"\"\n"
+    "BS_:\n"
+    "BU_: TestNode\n"
+    "BO_ 291 STANDARD_FRAME: 8 TestNode\n"
+    " SG_ SPEED : 0|16@1+ (0.01,0) [0|0] \"km/h\" TestNode\n"
+    " SG_ GEAR : 16|8@1+ (1,0) [0|0] \"\" TestNode\n";
+
+/**
+ * @brief Kernel frame (struct can_frame or struct canfd_frame) built byte by byte
+ */
+static std::vector<uint8_t> kernel_frame(uint32_t id, uint8_t length, uint8_t flags, bool fd) {
+    std::vector<uint8_t> frame(fd ? socketcan::FD_MTU : socketcan::CLASSIC_MTU, 0);
+    std::memcpy(frame.data(), &id, sizeof(id));
+    frame[4] = length;
+    frame[5] = flags;
+    for(std::size_t i = 8; i < frame.size(); i++)
+        frame[i] = static_cast<uint8_t>(i - 8);
+    return frame;
+}
+
+static void test_parse_frame() {
+    LogFrame frame;
+
+    std::vector<uint8_t> classic = kernel_frame(0x123, 3, 0, false);
+    check(socketcan::parse_frame(classic.data(), classic.size(), frame) && frame.can_id == 0x123 &&
+          frame.flags == 0 && frame.length == 3 && frame.data[2] == 2, "Classic kernel frame");
+
+    std::vector<uint8_t> extended = kernel_frame(0x80000000U | 0x1ABCDEF, 8, 0, false);
+    check(socketcan::parse_frame(extended.data(), extended.size(), frame) && frame.can_id == 0x1ABCDEF &&
+          frame.is_extended() && frame.dbc_id() == 0x81ABCDEFULL, "Extended kernel frame");
+
+    std::vector<uint8_t> remote = kernel_frame(0x40000000U | 0x7FF, 4, 0, false);
+    check(socketcan::parse_frame(remote.data(), remote.size(), frame) && frame.can_id == 0x7FF &&
+          frame.flags == LogFrame::Remote && frame.length == 4, "Remote kernel frame");
+
+    std::vector<uint8_t> error = kernel_frame(0x20000000U | 0x4, 8, 0, false);
+    check(socketcan::parse_frame(error.data(), error.size(), frame) &&
+          frame.flags == LogFrame::ErrorFrame && frame.can_id == 0x4, "Error kernel frame");
+
+    std::vector<uint8_t> fd = kernel_frame(0x456, 48, 0x01, true);
+    check(socketcan::parse_frame(fd.data(), fd.size(), frame) && frame.is_fd() &&
+          (frame.flags & LogFrame::BitRateSwitch) && !(frame.flags & LogFrame::ErrorStateIndicator) &&
+          frame.length == 48 && frame.data[47] == 47, "CAN FD kernel frame");
+
+    std::vector<uint8_t> bad_fd = kernel_frame(0x456, 13, 0, true);
+    std::vector<uint8_t> bad_classic = kernel_frame(0x123, 9, 0, false);
+    check(!socketcan::parse_frame(bad_fd.data(), bad_fd.size(), frame) &&
+          !socketcan::parse_frame(bad_classic.data(), bad_classic.size(), frame) &&
+          !socketcan::parse_frame(classic.data(), 8, frame), "Invalid kernel frames");
+}
+
+static void test_fake_source() {
+    CANDatabase db = CANDatabase::fromString(SOURCE_DBC);
+    CANDecoder decoder(db);
+    SignalValueCache cache(decoder);
+    SignalHandle speed = decoder.handle(291, "SPEED");
+
+    const int FRAME_COUNT = 20000;
+    FakeCANSource source(64, -1, { "vcan0" });
+    std::thread producer([&source]() {
+        for(int i = 0; i < FRAME_COUNT; i++) {
+            LogFrame frame;
+            frame.timestamp = i;
+            frame.can_id = 291;
+            frame.length = 8;
+            frame.channel = 0;
+            frame.flags = 0;
+            std::memset(frame.data, 0, sizeof(frame.data));
+            frame.data[0] = static_cast<uint8_t>(i);
+            frame.data[1] = static_cast<uint8_t>(i >> 8);
+            source.push(frame);
+        }
+        source.close();
+    });
+
+    // Batches are read into a fixed buffer and decoded in place
+    LogFrame batch[32];
+    int count = 0;
+    bool ordered = true;
+    bool decoded = true;
+    while(!source.closed()) {
+        std::size_t size = source.read(batch, 32);
+        for(std::size_t i = 0; i < size; i++, count++) {
+            ordered = ordered && batch[i].timestamp == count;
+            decoded = decoded && cache.update(batch[i].dbc_id(), batch[i].data, batch[i].length) &&
+                      cache[speed] == (count & 0xFFFF) * 0.01;
+        }
+    }
+    producer.join();
+
+    check(count == FRAME_COUNT && ordered, "Fake source: frames are read in order");
+    check(decoded, "Fake source: frames are decoded");
+    check(source.channels().size() == 1 && source.channels()[0] == "vcan0", "Fake source: channels");
+
+    LogFrame frame;
+    check(!source.push(frame) && source.read(batch, 32) == 0, "Fake source: closed");
+
+    FakeCANSource empty(16, 10);
+    check(empty.read(batch, 32) == 0 && !empty.closed(), "Fake source: timeout");
+}
+
+static void test_socketcan_source() {
+#ifdef __linux__
+    SocketCANSource::Options options;
+    options.timeout = 1000;
+    options.batch_size = 8;
+
+    // Needs a virtual interface: ip link add dev vcan0 type vcan && ip link set up vcan0
+    SocketCANSource* source = nullptr;
+    try {
+        source = new SocketCANSource("vcan0", options);
+    }
+    catch(const CANLogException& e) {
+        std::cout << "SocketCAN test skipped (" << e.what() << ")" << std::endl;
+        return;
+    }
+
+    int sender = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    int enable = 1;
+    setsockopt(sender, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable));
+    sockaddr_can address;
+    std::memset(&address, 0, sizeof(address));
+    address.can_family = AF_CAN;
+    address.can_ifindex = static_cast<int>(if_nametoindex("vcan0"));
+    check(bind(sender, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0, "SocketCAN: sender");
+
+    std::vector<uint8_t> classic = kernel_frame(0x123, 8, 0, false);
+    std::vector<uint8_t> fd = kernel_frame(0x80000000U | 0x456, 64, 0x01, true);
+    check(write(sender, classic.data(), classic.size()) == static_cast<ssize_t>(classic.size()) &&
+          write(sender, fd.data(), fd.size()) == static_cast<ssize_t>(fd.size()), "SocketCAN: frames sent");
+
+    LogFrame frames[8];
+    std::size_t count = 0;
+    for(int attempt = 0; attempt < 10 && count < 2; attempt++)
+        count += source->read(frames + count, 8 - count);
+
+    check(count == 2, "SocketCAN: frames received");
+    check(frames[0].can_id == 0x123 && frames[0].length == 8 && frames[0].timestamp > 0, "SocketCAN: classic frame");
+    check(frames[1].is_fd() && frames[1].is_extended() && frames[1].length == 64, "SocketCAN: CAN FD frame");
+    check(source->channels().size() == 1 && source->channels()[0] == "vcan0", "SocketCAN: channels");
+
+    close(sender);
+    source->close();
+    check(source->closed() && source->read(frames, 8) == 0, "SocketCAN: closed");
+    delete source;
+
+    // close() wakes up a reader that waits forever
+    options.timeout = -1;
+    SocketCANSource blocking("vcan0", options);
+    std::size_t blocked_count = 1;
+    std::thread reader([&]() { blocked_count = blocking.read(frames, 8); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    blocking.close();
+    reader.join();
+    check(blocked_count == 0 && blocking.closed(), "SocketCAN: close() wakes the reader up");
+#endif
+}
+
+static void test_rings() {
+    const uint64_t COUNT = 200000;
+
+    SPSCRing<uint64_t> spsc(100);
+    check(spsc.capacity() == 128, "SPSC ring: capacity is a power of two");
+    bool spsc_ordered = true;
+    std::thread consumer([&]() {
+        uint64_t expected = 0;
+        uint64_t values[16];
+        while(expected < COUNT) {
+            std::size_t count = spsc.try_pop(values, 16);
+            for(std::size_t i = 0; i < count; i++)
+                spsc_ordered = spsc_ordered && values[i] == expected++;
+            if(count == 0)
+                std::this_thread::yield();
+        }
+    });
+    for(uint64_t i = 0; i < COUNT; i++) {
+        while(!spsc.try_push(i))
+            std::this_thread::yield();
+    }
+    consumer.join();
+    check(spsc_ordered && spsc.size() == 0, "SPSC ring: values received in order");
+
+    // Each producer tags its values: the values of a producer must stay in order
+    const unsigned PRODUCERS = 4;
+    MPSCRing<uint64_t> mpsc(64);
+    std::vector<std::thread> producers;
+    for(uint64_t p = 0; p < PRODUCERS; p++) {
+        producers.emplace_back([&mpsc, p, COUNT]() {
+            for(uint64_t i = 0; i < COUNT / PRODUCERS; i++) {
+                while(!mpsc.try_push((p << 32) | i))
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    std::vector<uint64_t> next(PRODUCERS, 0);
+    bool mpsc_ordered = true;
+    uint64_t received = 0;
+    while(received < COUNT) {
+        uint64_t value;
+        if(!mpsc.try_pop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        uint64_t producer = value >> 32;
+        mpsc_ordered = mpsc_ordered && producer < PRODUCERS && (value & 0xFFFFFFFF) == next[producer]++;
+        received++;
+    }
+    for(std::thread& producer : producers)
+        producer.join();
+
+    uint64_t value;
+    check(mpsc_ordered && !mpsc.try_pop(value), "MPSC ring: values of each producer received in order");
+}
+
+static LogFrame speed_frame(int i) {
+    LogFrame frame;
+    frame.timestamp = i;
+    frame.can_id = 291;
+    frame.length = 8;
+    frame.channel = 0;
+    frame.flags = 0;
+    std::memset(frame.data, 0, sizeof(frame.data));
+    frame.data[0] = static_cast<uint8_t>(i);
+    frame.data[1] = static_cast<uint8_t>(i >> 8);
+    frame.data[2] = static_cast<uint8_t>(i % 4 == 0);
+    return frame;
+}
+
+static void test_pipeline() {
+    CANDatabase db = CANDatabase::fromString(SOURCE_DBC);
+    CANDecoder decoder(db);
+
+    // A candump log and a live source feed the same pipeline
+    std::string log;
+    for(int i = 0; i < 5000; i++) {
+        char line[64];
+        std::snprintf(line, sizeof(line), "(%d.000000) can0 123#%02X%02X%02X\n", i, i & 0xFF, (i >> 8) & 0xFF,
+                      i % 4 == 0 ? 1 : 0);
+        log += line;
+        if(i % 100 == 0)
+            log += "(1.000000) can0 456#00\n"; // Unknown frame
+    }
+    CandumpReader reader(log.data(), log.data() + log.size());
+    LogReaderSource log_source(reader);
+
+    const int LIVE_COUNT = 20000;
+    FakeCANSource live(256, 10);
+    std::thread producer([&live]() {
+        for(int i = 0; i < LIVE_COUNT; i++) {
+            LogFrame frame = speed_frame(i);
+            frame.channel = 1;
+            live.push(frame);
+        }
+        live.close();
+    });
+
+    std::vector<CANRawFilter> filters;
+    filters.push_back(CANRawFilter(db.at(291)).equals("GEAR", 1.0));
+    FilterStage filter(filters);
+
+    std::size_t gear_values = 0;
+    DecodeStage decode(decoder, [&gear_values](const LogFrame&, const CANDecoder::FramePlan& plan, const double* values) {
+        // GEAR, SPEED
+        gear_values += plan.signals[0].signal->name() == "GEAR" && values[0] == 1;
+    });
+
+    std::size_t received = 0;
+    bool live_ordered = true;
+    int64_t last_live = -1;
+    CallbackStage sink([&](const LogFrame* frames, std::size_t count) {
+        received += count;
+        for(std::size_t i = 0; i < count; i++) {
+            // The frames of a source stay in order
+            if(frames[i].channel == 1) {
+                live_ordered = live_ordered && frames[i].timestamp > last_live;
+                last_live = frames[i].timestamp;
+            }
+        }
+    });
+
+    CANPipeline::Options options;
+    options.ring_size = 128;
+    options.batch_size = 16;
+    CANPipeline pipeline(options);
+    pipeline.add_source(log_source);
+    pipeline.add_source(live);
+    pipeline.add_stage(filter);
+    pipeline.add_stage(decode);
+    pipeline.add_stage(sink);
+    pipeline.run();
+    producer.join();
+
+    std::size_t expected = 5000 / 4 + LIVE_COUNT / 4;
+    check(pipeline.source_counters(0).frames_in == 5050 && pipeline.source_counters(1).frames_in == LIVE_COUNT,
+          "Pipeline: frames read by the sources");
+    check(pipeline.stage_counters(0).frames_in == 5050 + LIVE_COUNT && pipeline.stage_counters(0).frames_out == expected,
+          "Pipeline: filter counters");
+    check(decode.decoded() == expected && gear_values == expected && received == expected, "Pipeline: decoded frames");
+    check(live_ordered, "Pipeline: order of the frames of a source");
+    check(log_source.channels().size() == 1 && log_source.channels()[0] == "can0", "Pipeline: log channels");
+
+    // A slow stage with drop policies: every frame is either forwarded or dropped
+    for(CANPipeline::Backpressure policy : { CANPipeline::DropNewest, CANPipeline::DropOldest }) {
+        FakeCANSource burst(LIVE_COUNT, 10);
+        for(int i = 0; i < LIVE_COUNT; i++)
+            burst.push(speed_frame(i));
+        burst.close();
+
+        CallbackStage forward([](const LogFrame*, std::size_t) { });
+        std::size_t slow_received = 0;
+        CallbackStage slow([&slow_received](const LogFrame*, std::size_t count) {
+            slow_received += count;
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+        });
+
+        CANPipeline::Options drop_options;
+        drop_options.ring_size = 64;
+        drop_options.batch_size = 8;
+        drop_options.backpressure = policy;
+        CANPipeline dropping(drop_options);
+        dropping.add_source(burst);
+        dropping.add_stage(forward);
+        dropping.add_stage(slow);
+        dropping.run();
+
+        CANPipeline::Counters counters = dropping.stage_counters(0);
+        CANPipeline::Counters source = dropping.source_counters(0);
+        check(source.frames_in == LIVE_COUNT && source.frames_out + source.dropped == LIVE_COUNT &&
+              counters.frames_in == source.frames_out && counters.frames_out + counters.dropped == counters.frames_in &&
+              slow_received == counters.frames_out && source.dropped + counters.dropped > 0,
+              "Pipeline: drop policy " + std::to_string(policy));
+    }
+
+    // Frames dropped by another source are counted against the source that pushed them
+    {
+        FakeCANSource small(64, 10);
+        for(int i = 0; i < 32; i++)
+            small.push(speed_frame(i));
+        small.close();
+        FakeCANSource flood(LIVE_COUNT, 10);
+        for(int i = 0; i < LIVE_COUNT; i++) {
+            LogFrame frame = speed_frame(i);
+            frame.channel = 1;
+            flood.push(frame);
+        }
+        flood.close();
+
+        uint64_t small_received = 0;
+        CallbackStage slow([&small_received](const LogFrame* frames, std::size_t count) {
+            for(std::size_t i = 0; i < count; i++)
+                small_received += frames[i].channel == 0;
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+        });
+
+        CANPipeline::Options drop_options;
+        drop_options.ring_size = 64;
+        drop_options.batch_size = 8;
+        drop_options.backpressure = CANPipeline::DropOldest;
+        CANPipeline shared(drop_options);
+        shared.add_source(small);
+        shared.add_source(flood);
+        shared.add_stage(slow);
+        shared.run();
+
+        CANPipeline::Counters first = shared.source_counters(0);
+        CANPipeline::Counters second = shared.source_counters(1);
+        check(first.frames_out == small_received && first.frames_out + first.dropped == 32 &&
+              second.frames_out + second.dropped == LIVE_COUNT &&
+              shared.stage_counters(0).frames_in == first.frames_out + second.frames_out,
+              "Pipeline: drops counted against their source");
+    }
+
+    // Exceptions stop the pipeline and are rethrown
+    FakeCANSource failing_source(64, 10);
+    for(int i = 0; i < 10; i++)
+        failing_source.push(speed_frame(i));
+    CallbackStage failing([](const LogFrame*, std::size_t) { throw std::runtime_error("stage failure"); });
+    CANPipeline failing_pipeline;
+    failing_pipeline.add_source(failing_source);
+    failing_pipeline.add_stage(failing);
+    bool thrown = false;
+    try {
+        failing_pipeline.run();
+    }
+    catch(const std::runtime_error&) {
+        thrown = true;
+    }
+    check(thrown, "Pipeline: exceptions are rethrown");
+}
+
+static std::string sharded_dbc() {
+    // Frames 256 and 257 are sent every millisecond, the others every 100 ms
+    std::string dbc = "VERSION \"\"\nBS_:\nBU_: TestNode\n";
+    for(int id = 256; id < 264; id++) {
+        dbc += "BO_ " + std::to_string(id) + " FRAME_" + std::to_string(id) + ": 8 TestNode\n";
+        dbc += " SG_ COUNTER : 0|32@1+ (1,0) [0|0] \"\" TestNode\n";
+    }
+    dbc += "BA_DEF_ BO_ \"GenMsgCycleTime\" INT 0 65535;\n";
+    for(int id = 256; id < 264; id++)
+        dbc += "BA_ \"GenMsgCycleTime\" BO_ " + std::to_string(id) + (id < 258 ? " 1;\n" : " 100;\n");
+    return dbc;
+}
+
+static void test_sharded_decoder() {
+    CANDatabase db = CANDatabase::fromString(sharded_dbc());
+    CANDecoder decoder(db);
+
+    const uint32_t FRAME_COUNT = 100000;
+    std::vector<LogFrame> frames;
+    std::vector<uint32_t> counters(0x800, 0);
+    for(uint32_t i = 0; i < FRAME_COUNT; i++) {
+        LogFrame frame;
+        frame.timestamp = i;
+        frame.can_id = i % 3 == 0 ? 256 + i % 8 : 256 + i % 2; // Mostly the fast frames
+        if(i % 1000 == 0)
+            frame.can_id = 0x700; // Unknown frame
+        frame.length = 8;
+        frame.channel = 0;
+        frame.flags = 0;
+        std::memset(frame.data, 0, sizeof(frame.data));
+        uint32_t counter = counters[frame.can_id]++;
+        std::memcpy(frame.data, &counter, sizeof(counter));
+        frames.push_back(frame);
+    }
+    uint64_t known = FRAME_COUNT - FRAME_COUNT / 1000;
+
+    for(ShardedDecoder::Assignment assignment : { ShardedDecoder::Hash, ShardedDecoder::LoadAware }) {
+        ShardedDecoder::Options options;
+        options.threads = 4;
+        options.shards = 4;
+        options.shard_queue_size = 64;
+        options.batch_size = 8;
+        options.assignment = assignment;
+        options.rebalance_interval = 1000;
+
+        // The frames of an ID are decoded one at a time, in order: no lock is needed
+        // for next[], but every worker may clear the shared flag
+        std::vector<int64_t> next(8, 0);
+        std::atomic<bool> ordered(true);
+        ShardedDecoder sharded(decoder, [&](const LogFrame& frame, const CANDecoder::FramePlan& plan,
+                                            const double* values, unsigned worker) {
+            int64_t& expected = next[plan.can_id - 256];
+            if(worker >= 4 || values[0] != expected || frame.can_id != plan.can_id)
+                ordered = false;
+            expected++;
+        }, options);
+
+        for(std::size_t i = 0; i < frames.size(); i += 100)
+            sharded.push(frames.data() + i, 100);
+        sharded.finish();
+
+        uint64_t decoded = 0;
+        uint64_t shard_frames = 0;
+        for(unsigned i = 0; i < sharded.thread_count(); i++)
+            decoded += sharded.worker_counters(i).frames;
+        for(std::size_t i = 0; i < sharded.shard_count(); i++)
+            shard_frames += sharded.shard_frames(i);
+
+        std::string name = assignment == ShardedDecoder::Hash ? "hash" : "load-aware";
+        check(ordered, "Sharded decoder (" + name + "): order of the frames of each ID");
+        check(decoded == known && sharded.decoded() == known && shard_frames == known,
+              "Sharded decoder (" + name + "): frame counts");
+        check(sharded.shard(256, false) == sharded.shard(256, false) && sharded.shard(256, false) < 4,
+              "Sharded decoder (" + name + "): shards");
+        if(assignment == ShardedDecoder::LoadAware) {
+            check(sharded.shard(256, false) != sharded.shard(257, false),
+                  "Sharded decoder: the fast frames are in different shards");
+        }
+    }
+
+    // Exceptions thrown by the callback are rethrown by finish()
+    ShardedDecoder failing(decoder, [](const LogFrame&, const CANDecoder::FramePlan&, const double*, unsigned) {
+        throw std::runtime_error("callback failure");
+    });
+    failing.push(frames.data(), 1000);
+    bool thrown = false;
+    try {
+        failing.finish();
+    }
+    catch(const std::runtime_error&) {
+        thrown = true;
+    }
+    check(thrown, "Sharded decoder: exceptions are rethrown");
+
+    // As a pipeline stage
+    FakeCANSource source(FRAME_COUNT, 10);
+    for(const LogFrame& frame : frames)
+        source.push(frame);
+    source.close();
+
+    std::vector<uint64_t> per_worker(2, 0);
+    ShardedDecoder::Options stage_options;
+    stage_options.threads = 2;
+    ShardedDecoder stage(decoder, [&per_worker](const LogFrame&, const CANDecoder::FramePlan&, const double*,
+                                                unsigned worker) { per_worker[worker]++; }, stage_options);
+    CANPipeline pipeline;
+    pipeline.add_source(source);
+    pipeline.add_stage(stage);
+    pipeline.run();
+    check(stage.decoded() == known && per_worker[0] + per_worker[1] == known, "Sharded decoder: pipeline stage");
+}
+
+static void test_signal_state_table() {
+    CANDatabase mux_db = CANDatabase::fromString(
+        "VERSION \"\"\n"
+        "BS_:\n"
+        "BU_: TestNode\n"
+        "BO_ 1000 MUX_FRAME: 8 TestNode\n"
+        " SG_ MODE M : 0|8@1+ (1,0) [0|0] \"\" TestNode\n"
+        " SG_ MODE_1 m1 : 8|16@1+ (1,0) [0|0] \"\" TestNode\n"
+        " SG_ MODE_2 m2 : 8|16@1+ (1,0) [0|0] \"\" TestNode\n"
+        "BO_ 1001 OTHER_FRAME: 8 TestNode\n"
+        " SG_ OTHER : 0|8@1+ (1,0) [0|0] \"\" TestNode\n");
+    CANDecoder mux_decoder(mux_db);
+    SignalStateTable mux_table(mux_decoder);
+
+    LogFrame frame;
+    frame.timestamp = 10;
+    frame.can_id = 1000;
+    frame.length = 8;
+    frame.channel = 0;
+    frame.flags = 0;
+    std::memset(frame.data, 0, sizeof(frame.data));
+    frame.data[0] = 1;
+    frame.data[1] = 5;
+    check(mux_table.update(frame), "State table: update");
+    frame.timestamp = 20;
+    frame.data[0] = 2;
+    frame.data[1] = 7;
+    mux_table.update(frame);
+
+    SignalSample mode_1 = mux_table.get(mux_decoder.handle(1000, "MODE_1"));
+    SignalSample mode_2 = mux_table.get(mux_decoder.handle(1000, "MODE_2"));
+    SignalSample mode = mux_table.get(mux_decoder.handle(1000, "MODE"));
+    SignalSample other = mux_table.get(mux_decoder.handle(1001, "OTHER"));
+    check(mode_1.value == 5 && mode_1.timestamp == 10, "State table: absent multiplexed signals are kept");
+    check(mode_2.value == 7 && mode_2.timestamp == 20 && mode.value == 2 && mode.timestamp == 20,
+          "State table: latest values");
+    check(other.timestamp == -1 && mux_table.updates(*mux_decoder.find(1001)) == 0 &&
+          mux_table.updates(*mux_decoder.find(1000)) == 2, "State table: update counts");
+
+    frame.flags = LogFrame::Remote;
+    LogFrame unknown = frame;
+    unknown.flags = 0;
+    unknown.can_id = 0x123;
+    check(!mux_table.update(frame) && !mux_table.update(unknown), "State table: ignored frames");
+
+    // Readers never see the values of two different updates in the same snapshot:
+    // the low byte of SPEED's raw value is always equal to GEAR
+    CANDatabase db = CANDatabase::fromString(SOURCE_DBC);
+    CANDecoder decoder(db);
+    SignalStateTable table(decoder);
+    const CANDecoder::FramePlan& plan = *decoder.find(291);
+    SignalHandle speed = decoder.handle(291, "SPEED");
+    SignalHandle gear = decoder.handle(291, "GEAR");
+
+    const int UPDATE_COUNT = 200000;
+    std::atomic<bool> done(false);
+    std::atomic<bool> consistent(true);
+    std::vector<std::thread> readers;
+    for(int r = 0; r < 2; r++) {
+        readers.emplace_back([&]() {
+            SignalSample samples[2]; // GEAR, SPEED
+            int64_t last = -1;
+            while(!done) {
+                int64_t timestamp = table.snapshot(plan, samples);
+                long raw_speed = std::lround(samples[speed.signal].value * 100);
+                bool ok = timestamp >= last && samples[0].timestamp == timestamp && samples[1].timestamp == timestamp &&
+                          (raw_speed & 0xFF) == static_cast<long>(samples[gear.signal].value);
+                SignalSample single = table.get(gear);
+                ok = ok && single.timestamp >= timestamp;
+                if(!ok)
+                    consistent = false;
+                last = timestamp;
+            }
+        });
+    }
+
+    for(int i = 0; i < UPDATE_COUNT; i++) {
+        uint8_t data[8] = { static_cast<uint8_t>(i), static_cast<uint8_t>(i >> 8), static_cast<uint8_t>(i), 0, 0, 0, 0, 0 };
+        table.update(plan, data, 8, i);
+    }
+    done = true;
+    for(std::thread& reader : readers)
+        reader.join();
+
+    check(consistent, "State table: consistent snapshots");
+    check(table.get(speed).timestamp == UPDATE_COUNT - 1 && table.updates(plan) == UPDATE_COUNT,
+          "State table: last update");
+}
+
+static LogFrame id_frame(uint32_t id, bool extended) {
+    LogFrame frame = LogFrame();
+    frame.can_id = id;
+    frame.length = 0;
+    frame.flags = extended ? LogFrame::Extended : 0;
+    return frame;
+}
+
+static void test_id_filter() {
+    CANDatabase db = CANDatabase::fromString(
+        SOURCE_DBC +
+        "BO_ 2166598605 EXTENDED_FRAME: 8 TestNode\n"
+        " SG_ COUNTER : 0|8@1+ (1,0) [0|0] \"\" TestNode\n"
+        "BO_ 3221225472 VECTOR__INDEPENDENT_SIG_MSG: 0 Vector__XXX\n"
+        " SG_ UNUSED : 0|8@1+ (1,0) [0|0] \"\" Vector__XXX\n");
+
+    CANIdFilter from_db = CANIdFilter::from_database(db);
+    check(from_db.standard_count() == 1 && from_db.extended_id_count() == 1, "ID filter: database");
+    check(from_db.matches(0x123, false) && !from_db.matches(0x123, true) && from_db.matches(0x0123ABCD, true) &&
+          !from_db.matches(0x0123ABCC, true) && !from_db.matches(0x124, false) && !from_db.matches(5000, false),
+          "ID filter: database IDs");
+    check(!from_db.matches(0x40000000, true) && !from_db.matches(0, true),
+          "ID filter: database pseudo-messages are skipped");
+
+    LogFrame error = id_frame(0x123, false);
+    error.flags = LogFrame::ErrorFrame;
+    LogFrame remote = id_frame(0x123, false);
+    remote.flags = LogFrame::Remote;
+    check(!from_db.matches(error) && from_db.matches(remote), "ID filter: error and remote frames");
+
+    CANIdFilter filter;
+    filter.add_id(0x7FF, false)
+          .add_range(0x100, 0x10F, false)
+          .add_mask(0x600, 0x700, false)          // 0x600 - 0x6FF
+          .add_range(0x1000, 0x1010, true)        // Expanded
+          .add_range(0x100000, 0x1FFFFF, true)    // Range
+          .add_range(0x180000, 0x2FFFFF, true)    // Merged with the previous one
+          .add_mask(0x18DA00F1, 0x1FFF00FF, true) // 256 IDs, expanded
+          .add_mask(0x0A000000, 0x1F000000, true) // Kept as a mask
+          .add_id(0x1000, true);                  // Already there
+    check(filter.standard_count() == 1 + 16 + 256, "ID filter: standard bitmap");
+    check(filter.extended_id_count() == 17 + 256 && filter.extended_ranges().size() == 1 &&
+          filter.extended_ranges()[0].first == 0x100000 && filter.extended_ranges()[0].second == 0x2FFFFF &&
+          filter.extended_masks().size() == 1, "ID filter: extended structures");
+
+    const uint32_t accepted[] = { 0x1000, 0x1010, 0x100000, 0x250000, 0x2FFFFF, 0x18DA42F1, 0x0A000000, 0x0AFFFFFF };
+    const uint32_t rejected[] = { 0xFFF, 0x1011, 0xFFFFF, 0x300000, 0x18DA42F2, 0x0B000000, 0x1FFFFFFF, 0x20000000 };
+    bool ok = filter.matches(0x7FF, false) && filter.matches(0x105, false) && filter.matches(0x6AB, false) &&
+              !filter.matches(0x110, false) && !filter.matches(0x7FE, false) && !filter.matches(0x105, true);
+    for(uint32_t id : accepted)
+        ok = ok && filter.matches(id, true);
+    for(uint32_t id : rejected)
+        ok = ok && !filter.matches(id, true);
+    check(ok, "ID filter: matches");
+
+    bool thrown = false;
+    try {
+        filter.add_id(0x800, false);
+    }
+    catch(const std::out_of_range&) {
+        thrown = true;
+    }
+    check(thrown, "ID filter: standard ID out of range");
+
+    // Many extended IDs: the hash set grows and every ID stays found
+    CANIdFilter large;
+    for(uint32_t i = 0; i < 10000; i++)
+        large.add_id(i * 7919u, true);
+    ok = large.extended_id_count() == 10000;
+    for(uint32_t i = 0; i < 10000; i++)
+        ok = ok && large.matches(i * 7919u, true) && !large.matches(i * 7919u + 1, true);
+    check(ok, "ID filter: hash set");
+
+    // The filter is shared by threads that only read it
+    std::vector<LogFrame> frames;
+    for(uint32_t id = 0; id < 0x800; id++)
+        frames.push_back(id_frame(id, false));
+    std::vector<uint32_t> indices(frames.size());
+    std::size_t expected = filter.scan(frames.data(), frames.size(), indices.data());
+    check(expected == filter.standard_count() && indices[0] == 0x100, "ID filter: scan");
+
+    std::atomic<int> mismatches(0);
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; t++) {
+        threads.emplace_back([&]() {
+            std::vector<LogFrame> batch = frames;
+            IdFilterStage stage(filter);
+            if(stage.process(batch.data(), batch.size()) != expected || batch[0].can_id != 0x100)
+                mismatches++;
+        });
+    }
+    for(std::thread& thread : threads)
+        thread.join();
+    check(mismatches == 0, "ID filter: shared between stages");
+}
+
+int main() {
+    try {
+        test_parse_frame();
+        test_fake_source();
+        test_socketcan_source();
+        test_rings();
+        test_pipeline();
+        test_sharded_decoder();
+        test_signal_state_table();
+        test_id_filter();
+    }
+    catch(const std::exception& e) {
+        std::cerr << "An unexpected exception happened: " << e.what() << std::endl;
+        errors.push_back(e.what());
+    }
+
+    std::cout << "-----------" << std::endl;
+    if(errors.size() == 0) {
+        std::cout << "Success. All tests passed." << std::endl;
+    }
+    else {
+        std::cout << "Failure. " << errors.size() << " check(s) failed." << std::endl;
+    }
+
+    return static_cast<int>(errors.size() != 0);
+}
@@ -3,6 +3,7 @@
 #include <cstring>
 #include <algorithm>
 #include <set>
+#include <thread>
 #include "operations.h"
 #include <iomanip>
 
@@ -12,11 +13,15 @@ enum CanParseAction {
   PrintOne,
   CheckAll,
   CheckOne,
+  DecodeLog,
+  ConvertLog,
   Help
 };
 
 static std::string CHECKFRAME_ACTION = "checkframe";
 static std::string PRINTFRAME_ACTION = "printframe";
+static std::string DECODE_ACTION = "decode";
+static std::string CONVERT_ACTION = "convert";
 
 void showUsage(std::ostream& ostrm, char* program_name) {
   ostrm << "Usage: " << program_name << " [ACTION [ARGUMENTS]] <path/to/file>" << std::endl;
@@ -26,17 +31,39 @@ void showUsage(std::ostream& ostrm, char* program_name) {
   ostrm << "\t"              << std::setw(22) << ""                                << "if CAN ID is specified, prints the details of the given frame" << std::endl;
   ostrm << "\t"              << std::setw(22) << (CHECKFRAME_ACTION + " [CAN ID]") << "Check different properties of the CAN database" << std::endl;
   ostrm << "\t"              << std::setw(22) << ""                                << "if CAN ID is specified, print the check details of the given frame" << std::endl;
+  ostrm << "\t"              << std::setw(22) << (DECODE_ACTION + " <DBC> <LOG>") << "Decode the frames of a log (candump -L or Vector .asc)" << std::endl;
+  ostrm << "\t"              << std::setw(22) << ""                                << "the log is decoded by -j<N> threads (default: one per core)" << std::endl;
+  ostrm << "\t"              << std::setw(22) << (CONVERT_ACTION + " <LOG> <OUT>") << "Convert a candump or Vector log into a binary log" << std::endl;
   ostrm << "\t"              << std::setw(22) << "-h / --help"                     << "Print the present help message" << std::endl;
   ostrm << "Currently supported formats: DBC" << std::endl;
 }
 
 
-std::tuple<CanParseAction, std::string, uint32_t> extractAction(int argc, char** argv) {
+// More threads than that only add contention
+static const unsigned MAX_THREADS_PER_CORE = 4;
+
+/**
+ * @return The number of threads given by "-j<N>", capped to a few threads per core
+ * @throw CanParseException if N is not a positive number
+ */
+static unsigned parseThreads(const std::string& option) {
+  std::string value = option.substr(2);
+  if(value.empty() || value.size() > 9 || value.find_first_not_of("0123456789") != std::string::npos ||
+     std::stoul(value) == 0)
+    throw CppCAN::can_parse::CanParseException("Invalid number of threads: " + option);
+
+  unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+  return static_cast<unsigned>(std::min<unsigned long>(std::stoul(value), MAX_THREADS_PER_CORE * cores));
+}
+
+std::tuple<CanParseAction, std::string, uint32_t, std::string, unsigned> extractAction(int argc, char** argv) {
   std::vector<std::string> args(argv + 1, argv + argc); // +1 so we ignore the executable name
   
   CanParseAction action = None;
   std::string src_file;
+  std::string log_file;
   uint32_t detail_frame = 0;
+  unsigned threads = 0;
 
   if (args.size() < 1) {
     throw CppCAN::can_parse::CanParseException("Not enough arguments");
@@ -65,6 +92,16 @@ std::tuple<CanParseAction, std::string, uint32_t> extractAction(int argc, char**
         check_action = false;
         continue;
       }
+      else if(arg == DECODE_ACTION) {
+        action = DecodeLog;
+        check_action = false;
+        continue;
+      }
+      else if(arg == CONVERT_ACTION) {
+        action = ConvertLog;
+        check_action = false;
+        continue;
+      }
       else {
         action = PrintAll;
         check_action = false;
@@ -83,11 +120,25 @@ std::tuple<CanParseAction, std::string, uint32_t> extractAction(int argc, char**
       }
     }
 
+    // The log to decode comes after the database, the output of
+    // the conversion after the log to convert
+    if((action == DecodeLog || action == ConvertLog) && src_file.size() > 0) {
+      log_file = arg;
+      continue;
+    }
+
     // At this point, nothing has matched. The only valid thing that this could be
     // is the file name of the database to parse.
     src_file = arg;
   }
 
+  for(const std::string& option : options) {
+    if(option.compare(0, 2, "-j") != 0)
+      continue;
+
+    threads = parseThreads(option);
+  }
+
   if(options.count("-h") > 0 || options.count("--help")) {
     action = Help;
   }
@@ -95,18 +146,26 @@ std::tuple<CanParseAction, std::string, uint32_t> extractAction(int argc, char**
   if(action != Help && src_file.size() == 0)
     throw CppCAN::can_parse::CanParseException("No source file specified");
 
-  return std::make_tuple(action != None ? action : PrintAll, src_file, detail_frame);
+  if(action == DecodeLog && log_file.size() == 0)
+    throw CppCAN::can_parse::CanParseException("No log file specified");
+
+  if(action == ConvertLog && log_file.size() == 0)
+    throw CppCAN::can_parse::CanParseException("No output file specified");
+
+  return std::make_tuple(action != None ? action : PrintAll, src_file, detail_frame, log_file, threads);
 }
 
 int main(int argc, char** argv) {
   using namespace CppCAN::can_parse;
 
   std::string src_file;
+  std::string log_file;
   CanParseAction action;
   uint32_t detail_frame;
+  unsigned threads;
   
   try {
-    std::tie(action, src_file, detail_frame) = extractAction(argc, argv);
+    std::tie(action, src_file, detail_frame, log_file, threads) = extractAction(argc, argv);
   }
   catch(const CanParseException& e) {
     std::cerr << "Invalid use of the program: " << e.what() << std::endl;
@@ -118,6 +177,17 @@ int main(int argc, char** argv) {
     showUsage(std::cout, argv[0]);
     return 0;
   }
+
+  // The conversion of logs does not need any database
+  if(action == ConvertLog) {
+    try {
+      return convert_log(src_file, log_file) ? 0 : 3;
+    }
+    catch(const std::exception& e) {
+      std::cerr << "Cannot convert " << src_file << ": " << e.what() << std::endl;
+      return 3;
+    }
+  }
   
   CppCAN::CANDatabase db;
   std::vector<CppCAN::CANDatabase::parsing_warning> warnings;
@@ -166,6 +236,19 @@ int main(int argc, char** argv) {
       }
       break;
 
+    case DecodeLog:
+      {
+        try {
+          if(!decode_log(db, log_file, threads))
+            return 3;
+        }
+        catch(const std::exception& e) {
+          std::cerr << "Cannot decode " << log_file << ": " << e.what() << std::endl;
+          return 3;
+        }
+      }
+      break;
+
     case Help:
       // Already handled before.
       break;
@@ -0,0 +1,41 @@
+#include "operations.h"
+#include "cpp-can-parser/CANBinaryLog.h"
+#include "cpp-can-parser/CANLogReader.h"
+#include <iostream>
+#include <memory>
+
+using namespace CppCAN;
+
+bool CppCAN::can_parse::convert_log(const std::string& log_file, const std::string& out_file) {
+  MappedFile file(log_file);
+
+  std::unique_ptr<CANLogReader> reader;
+  CandumpReader* candump = nullptr;
+  switch(log_format(file, log_file)) {
+    case ParallelLogDecoder::Asc:
+      reader.reset(new AscReader(file.begin(), file.end()));
+      break;
+    case ParallelLogDecoder::Candump:
+      candump = new CandumpReader(file.begin(), file.end());
+      reader.reset(candump);
+      break;
+    case ParallelLogDecoder::Binary:
+      throw CANLogException(log_file + " is already a binary log");
+  }
+
+  BinaryLogWriter writer(out_file);
+  LogFrame frame;
+  while(reader->next(frame))
+    writer.write(frame);
+
+  // The interfaces of candump logs are named, the channels of Vector logs are numbers
+  if(candump != nullptr)
+    writer.set_channels(candump->channels());
+  writer.close();
+
+  MappedFile result(out_file);
+  std::cerr << writer.frame_count() << " frame(s) written in " << writer.block_count()
+            << " block(s), " << file.size() << " -> " << result.size() << " bytes, "
+            << reader->skipped_lines() << " invalid line(s)" << std::endl;
+  return reader->skipped_lines() == 0;
+}
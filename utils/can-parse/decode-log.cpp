@@ -0,0 +1,135 @@
+#include "operations.h"
+#include "cpp-can-parser/CANDecoder.h"
+#include "cpp-can-parser/CANLogReader.h"
+#include "cpp-can-parser/ParallelLogDecoder.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace CppCAN;
+
+template<typename T>
+static void
+append_number(std::string& out, T value) {
+  char buffer[32];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  out.append(buffer, result.ptr);
+}
+
+static void
+append_timestamp(std::string& out, int64_t timestamp) {
+  if(timestamp < 0) {
+    out += '-';
+    timestamp = -timestamp;
+  }
+
+  // Same format as candump: seconds with 6 decimals
+  char buffer[32];
+  int size = std::snprintf(buffer, sizeof(buffer), "(%lld.%06lld)",
+                           static_cast<long long>(timestamp / 1000000000),
+                           static_cast<long long>(timestamp % 1000000000 / 1000));
+  out.append(buffer, static_cast<std::size_t>(size));
+}
+
+static bool
+ends_with(const std::string& str, const std::string& suffix) {
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+ParallelLogDecoder::Format
+CppCAN::can_parse::log_format(const MappedFile& file, const std::string& log_file) {
+  // Binary logs are recognized by their header, Vector logs by their extension
+  // and anything else is read as a candump log
+  if(binlog::is_binary_log(file.begin(), file.end()))
+    return ParallelLogDecoder::Binary;
+
+  return ends_with(log_file, ".asc") ? ParallelLogDecoder::Asc : ParallelLogDecoder::Candump;
+}
+
+static void
+format_chunk(ParallelLogDecoder::DecodedChunk& chunk, const CANDecoder& decoder) {
+  std::string& out = chunk.output;
+  std::vector<uint32_t> active;
+
+  for(std::size_t f = 0; f < chunk.frames.size(); f++) {
+    const LogFrame& frame = chunk.frames[f];
+    const CANDecoder::FramePlan* plan = chunk.plans[f];
+    if(plan == nullptr)
+      continue;
+
+    active.resize(plan->signals.size());
+    std::size_t count = decoder.active_signals(*plan, frame.data, frame.length, active.data());
+    const double* values = chunk.values.data() + chunk.value_offsets[f];
+
+    append_timestamp(out, frame.timestamp);
+    out += ' ';
+    // Named interfaces of candump logs and of the binary logs converted from them
+    if(frame.channel < chunk.channels.size()) {
+      out += chunk.channels[frame.channel];
+    }
+    else {
+      out += "CAN";
+      append_number(out, frame.channel + 1);
+    }
+    out += ' ';
+    out += plan->frame->name();
+
+    // Copied once per frame, and only if one of the signals has labels
+    std::optional<CANDecoder::Payload> payload;
+    for(std::size_t i = 0; i < count; i++) {
+      const CANDecoder::SignalPlan& signal = plan->signals[active[i]];
+
+      out += ' ';
+      out += signal.signal->name();
+      out += '=';
+      append_number(out, values[active[i]]);
+
+      if(signal.choices == nullptr && signal.lut_labels == nullptr)
+        continue;
+
+      if(!payload)
+        payload.emplace(frame.data, frame.length);
+      std::string_view label = signal.label(signal.raw(*payload));
+      if(label.data() != nullptr) {
+        out += " \"";
+        out.append(label.data(), label.size());
+        out += '"';
+      }
+    }
+    out += '\n';
+  }
+}
+
+bool CppCAN::can_parse::decode_log(CANDatabase& db, const std::string& log_file, unsigned threads) {
+  CANDecoder decoder(db);
+  MappedFile file(log_file);
+
+  ParallelLogDecoder::Format format = log_format(file, log_file);
+
+  // The values are formatted by the workers, the main thread only writes the text
+  ParallelLogDecoder::Options options;
+  options.threads = threads;
+  options.worker_stage = [&decoder](ParallelLogDecoder::DecodedChunk& chunk) {
+    format_chunk(chunk, decoder);
+  };
+
+  ParallelLogDecoder parallel(decoder, format, file.begin(), file.end(), options);
+
+  std::size_t unknown = 0;
+  parallel.run([&unknown](const ParallelLogDecoder::DecodedChunk& chunk) {
+    unknown += static_cast<std::size_t>(std::count(chunk.plans.begin(), chunk.plans.end(), nullptr));
+    std::fwrite(chunk.output.data(), 1, chunk.output.size(), stdout);
+  });
+  std::fflush(stdout);
+
+  std::size_t frames = parallel.frame_count();
+  std::cerr << frames << " frame(s) read, " << frames - unknown << " decoded, "
+            << unknown << " unknown or without payload, "
+            << parallel.skipped_lines() << " invalid line(s)" << std::endl;
+  return parallel.skipped_lines() == 0;
+}
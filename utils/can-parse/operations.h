@@ -6,6 +6,7 @@
 #include <stdexcept>
 #include <vector>
 #include "cpp-can-parser/CANDatabase.h"
+#include "cpp-can-parser/ParallelLogDecoder.h"
 
 namespace CppCAN {
 namespace can_parse {
@@ -30,6 +31,28 @@ namespace can_parse {
      */
     bool check_all_frames(CANDatabase& db, const std::vector<CANDatabase::parsing_warning>& warnings);
 
+    /**
+     * @brief Decodes all the frames of a log (see log_format()) and prints the
+     *        values of their signals
+     * @param threads Number of decoding threads (0: one per core)
+     * @return false if some lines of the log could not be parsed
+     * @throw CANLogException if the log cannot be opened
+     */
+    bool decode_log(CANDatabase& db, const std::string& log_file, unsigned threads);
+
+    /**
+     * @brief Converts a candump or Vector log into a binary log (see BinaryLogWriter)
+     * @return false if some lines of the log could not be parsed
+     * @throw CANLogException if a log cannot be opened or written
+     */
+    bool convert_log(const std::string& log_file, const std::string& out_file);
+
+    /**
+     * @return The format of the given log: binary logs are recognized by their header,
+     *         Vector logs by their extension (.asc), other logs are candump logs
+     */
+    ParallelLogDecoder::Format log_format(const MappedFile& file, const std::string& log_file);
+
     /**
      * Exception thrown by any operation if an error happens during their
      * analysis.
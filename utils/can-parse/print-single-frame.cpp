@@ -263,7 +263,8 @@ ConsoleTable::TableData::TableCell createFloat(double val) {
 
 void print_frame_impl(const CANFrame& frame) {   
   std::cout << frame.name() << ":\t"  
-            << std::hex << std::showbase << frame.can_id() << "/" 
+            << std::hex << std::showbase << frame.can_id() 
+            << (frame.is_extended() ? "x" : "") << (frame.is_fd() ? " FD" : "") << "/" 
             << std::dec << std::noshowbase << frame.dlc() << "/"
             << frame.period() << "ms" << std::endl;
 
@@ -284,11 +285,48 @@ std::vector<ConsoleTable::TableData::TableCell> createSignalChoicesVector(const
   return result;
 }
 
+std::string signedness_str(const CANSignal& sig) {
+  switch(sig.value_type()) {
+  case CANSignal::Float:
+    return "Float";
+  case CANSignal::Double:
+    return "Double";
+  default:
+    return sig.signedness() == CANSignal::Signed ? "Signed" : "Unsigned";
+  }
+}
+
+std::string createSignalName(const CANSignal& sig) {
+  std::string result = sig.name();
+  
+  if(sig.is_multiplexed()) {
+    result += " (m";
+    for(size_t i = 0; i < sig.multiplexer_ranges().size(); i++) {
+      const auto& range = sig.multiplexer_ranges()[i];
+      result += (i > 0 ? "," : "") + std::to_string(range.min);
+      if(range.max != range.min)
+        result += "-" + std::to_string(range.max);
+    }
+    if(sig.multiplexer_switch().size() > 0)
+      result += " of " + sig.multiplexer_switch();
+    result += sig.is_multiplexor() ? " M)" : ")";
+  }
+  else if(sig.is_multiplexor()) {
+    result += " (M)";
+  }
+
+  return result;
+}
+
 void CppCAN::can_parse::print_single_frame(CANDatabase& db, uint32_t can_id) {
   const CANFrame& frame = db[can_id];
 
   std::stringstream can_id_ss;
   can_id_ss << "CAN ID: " << std::hex << std::showbase << frame.can_id();
+  if(frame.is_extended())
+    can_id_ss << " (extended)";
+  if(frame.is_fd())
+    can_id_ss << " (CAN FD)";
 
   ConsoleTable summary_header(4, false);
   summary_header.add_row({
@@ -304,12 +342,12 @@ void CppCAN::can_parse::print_single_frame(CANDatabase& db, uint32_t can_id) {
   for(const auto& sig : frame) {
     const CANSignal& signal = sig.second;
     console_table.add_row({
-      createStr(signal.name()), 
+      createStr(createSignalName(signal)), 
       createUnsigned(signal.start_bit()), 
       createUnsigned(signal.length()),
       createFloat(signal.scale()), 
       createFloat(signal.offset()),
-      signal.signedness() == CANSignal::Signed ? createStr("Signed") : createStr("Unsigned"),
+      createStr(signedness_str(signal)),
       signal.endianness() == CANSignal::BigEndian ? createStr("BigEndian") : createStr("LittleEndian"),
       createStr("[" + std::to_string(signal.range().min) + ", " + std::to_string(signal.range().max) + "]")
     }, false);            